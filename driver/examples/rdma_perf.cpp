@@ -0,0 +1,629 @@
+/// @file rdma_perf.cpp
+/// @brief perftest-style RDMA benchmark (ib_write_bw, ib_read_lat, ib_send_bw, ...).
+///
+/// Client drivers connect to one server driver through a PacketRouter and keep a
+/// fixed number of WQEs outstanding per QP. Each router pass advances every engine
+/// by --hop-us plus the time the busiest link needs to serialize the pass's bytes at
+/// --link-gbps, so results are reported twice: in simulated time (what the modeled
+/// NIC would achieve) and in wall-clock time (what the model costs to run, the figure
+/// to compare across versions).
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "nic/device.h"
+#include "nic/rocev2/latency.h"
+#include "nic_driver/driver.h"
+#include "nic_driver/packet_router.h"
+#include "nic_driver/rdma_types.h"
+
+using namespace nic_driver;
+using nic::rocev2::LatencyHistogram;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr nic::HostAddress kBufferBase = 0x10000;
+constexpr std::size_t kMaxReadsPerQp = 1;  // The requester tracks one READ per QP
+
+enum class PerfOp : std::uint8_t { Write, Read, Send };
+enum class PerfMode : std::uint8_t { Bandwidth, Latency };
+
+struct PerfOptions {
+  std::vector<PerfOp> ops{PerfOp::Write};
+  PerfMode mode{PerfMode::Bandwidth};
+  std::vector<std::size_t> sizes{64, 1024, 4096, 65536};
+  std::vector<std::size_t> qp_counts{1};
+  std::vector<std::size_t> depths{16};
+  std::vector<std::uint32_t> mtus{4096};
+  std::size_t iterations{1000};  // Messages per QP
+  std::size_t nodes{2};          // One server plus nodes - 1 clients
+  std::uint64_t hop_us{1};       // Simulated propagation time of one router pass
+  std::uint64_t link_gbps{100};  // Rate at which each node's link serializes its bytes
+  bool csv{false};
+};
+
+/// One point of the sweep.
+struct PerfCase {
+  PerfOp op{PerfOp::Write};
+  std::size_t size{0};
+  std::size_t qps{0};    // Per client
+  std::size_t depth{0};  // Outstanding WQEs per QP
+  std::uint32_t mtu{0};
+};
+
+struct PerfResult {
+  std::uint64_t messages{0};
+  std::uint64_t bytes{0};
+  std::uint64_t errors{0};
+  double sim_ns{0.0};
+  double wall_ns{0.0};
+  LatencyHistogram sim_latency_us;
+  LatencyHistogram wall_latency_ns;
+};
+
+/// Per-QP requester state of a client.
+struct ClientQp {
+  QpHandle qp{};
+  nic::HostAddress local_address{0};
+  nic::HostAddress remote_address{0};
+  std::size_t posted{0};
+  std::size_t completed{0};
+  std::deque<Clock::time_point> post_times{};  // Outstanding WQEs in posting order
+};
+
+struct PerfNode {
+  NicDriver driver;
+  PacketRouter::IpAddress ip{};
+  PdHandle pd{};
+  CqHandle send_cq{};
+  CqHandle recv_cq{};
+  MrHandle mr{};
+  std::vector<ClientQp> client_qps;                   // Clients: QPs to the server
+  std::vector<QpHandle> server_qps;                   // Server: one per client QP
+  std::unordered_map<std::uint32_t, std::size_t> qp_index;  // QP number -> vector index
+};
+
+const char* op_name(PerfOp op) {
+  switch (op) {
+    case PerfOp::Write:
+      return "write";
+    case PerfOp::Read:
+      return "read";
+    case PerfOp::Send:
+      return "send";
+  }
+  return "?";
+}
+
+/// Clamp the requested depths to what the engine supports for an opcode.
+std::vector<std::size_t> op_depths(PerfOp op, const std::vector<std::size_t>& depths) {
+  std::vector<std::size_t> result;
+  for (std::size_t depth : depths) {
+    std::size_t effective = (op == PerfOp::Read) ? std::min(depth, kMaxReadsPerQp) : depth;
+    if (std::ranges::find(result, effective) == result.end()) {
+      result.push_back(effective);
+    }
+  }
+  return result;
+}
+
+WqeOpcode op_opcode(PerfOp op) {
+  switch (op) {
+    case PerfOp::Write:
+      return WqeOpcode::RdmaWrite;
+    case PerfOp::Read:
+      return WqeOpcode::RdmaRead;
+    case PerfOp::Send:
+      return WqeOpcode::Send;
+  }
+  return WqeOpcode::Send;
+}
+
+std::uint8_t path_mtu_code(std::uint32_t mtu) {
+  // 1=256 ... 5=4096
+  return static_cast<std::uint8_t>(std::bit_width(std::clamp<std::uint32_t>(mtu, 256, 4096)) - 8);
+}
+
+std::vector<std::string_view> split_list(std::string_view list) {
+  std::vector<std::string_view> items;
+  while (!list.empty()) {
+    std::size_t comma = list.find(',');
+    items.push_back(list.substr(0, comma));
+    list = (comma == std::string_view::npos) ? std::string_view{} : list.substr(comma + 1);
+  }
+  return items;
+}
+
+template <typename T>
+std::optional<std::vector<T>> parse_numbers(std::string_view list) {
+  std::vector<T> values;
+  for (std::string_view item : split_list(list)) {
+    std::string text(item);
+    char* end = nullptr;
+    unsigned long long value = std::strtoull(text.c_str(), &end, 0);
+    if (text.empty() || (*end != '\0') || (value == 0)) {
+      return std::nullopt;
+    }
+    values.push_back(static_cast<T>(value));
+  }
+  return values;
+}
+
+void print_usage(const char* program) {
+  std::printf(
+      "Usage: %s [options]\n"
+      "  --op LIST       write,read,send (default write)\n"
+      "  --mode MODE     bw or lat; lat runs one outstanding WQE per QP (default bw)\n"
+      "  --size LIST     message sizes in bytes (default 64,1024,4096,65536)\n"
+      "  --qps LIST      QPs per client (default 1)\n"
+      "  --depth LIST    outstanding WQEs per QP in bw mode; READ is capped at 1 (default 16)\n"
+      "  --mtu LIST      path MTU, 256..4096 (default 4096)\n"
+      "  --iters N       messages per QP (default 1000)\n"
+      "  --nodes N       drivers: one server and N-1 clients (default 2)\n"
+      "  --hop-us N      simulated microseconds per router pass (default 1)\n"
+      "  --link-gbps N   link rate serializing each pass's bytes (default 100)\n"
+      "  --csv           print comma-separated rows\n",
+      program);
+}
+
+std::optional<PerfOptions> parse_options(int argc, char** argv) {
+  PerfOptions options;
+  for (int idx = 1; idx < argc; ++idx) {
+    std::string_view arg = argv[idx];
+    if (arg == "--csv") {
+      options.csv = true;
+      continue;
+    }
+    if ((idx + 1 >= argc) || !arg.starts_with("--")) {
+      return std::nullopt;
+    }
+    std::string_view value = argv[++idx];
+    bool ok = true;
+    if (arg == "--op") {
+      options.ops.clear();
+      for (std::string_view name : split_list(value)) {
+        if (name == "write") {
+          options.ops.push_back(PerfOp::Write);
+        } else if (name == "read") {
+          options.ops.push_back(PerfOp::Read);
+        } else if (name == "send") {
+          options.ops.push_back(PerfOp::Send);
+        } else {
+          ok = false;
+        }
+      }
+    } else if (arg == "--mode") {
+      ok = (value == "bw") || (value == "lat");
+      options.mode = (value == "lat") ? PerfMode::Latency : PerfMode::Bandwidth;
+    } else if (arg == "--size") {
+      auto sizes = parse_numbers<std::size_t>(value);
+      ok = sizes.has_value();
+      options.sizes = sizes.value_or(options.sizes);
+    } else if (arg == "--qps") {
+      auto qp_counts = parse_numbers<std::size_t>(value);
+      ok = qp_counts.has_value();
+      options.qp_counts = qp_counts.value_or(options.qp_counts);
+    } else if (arg == "--depth") {
+      auto depths = parse_numbers<std::size_t>(value);
+      ok = depths.has_value();
+      options.depths = depths.value_or(options.depths);
+    } else if (arg == "--mtu") {
+      auto mtus = parse_numbers<std::uint32_t>(value);
+      ok = mtus.has_value() && std::ranges::all_of(*mtus, [](std::uint32_t mtu) {
+             return std::has_single_bit(mtu) && (mtu >= 256) && (mtu <= 4096);
+           });
+      options.mtus = ok ? *mtus : options.mtus;
+    } else if ((arg == "--iters") || (arg == "--nodes") || (arg == "--hop-us")
+               || (arg == "--link-gbps")) {
+      auto number = parse_numbers<std::uint64_t>(value);
+      ok = number.has_value() && (number->size() == 1);
+      if (ok && (arg == "--iters")) {
+        options.iterations = number->front();
+      } else if (ok && (arg == "--nodes")) {
+        options.nodes = number->front();
+        ok = options.nodes >= 2;
+      } else if (ok && (arg == "--hop-us")) {
+        options.hop_us = number->front();
+      } else if (ok) {
+        options.link_gbps = number->front();
+      }
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      std::fprintf(stderr, "invalid value for %s: %.*s\n", argv[idx - 1],
+                   static_cast<int>(value.size()), value.data());
+      return std::nullopt;
+    }
+  }
+  if (options.ops.empty()) {
+    return std::nullopt;
+  }
+  if (options.mode == PerfMode::Latency) {
+    options.depths = {1};
+  }
+  return options;
+}
+
+/// Bring up a driver with an RDMA device large enough for its buffers.
+bool init_node(PerfNode& node, std::size_t buffer_bytes, std::size_t index) {
+  nic::DeviceConfig config{};
+  config.enable_queue_pair = false;
+  config.enable_rdma = true;
+  config.rdma_config.mtu = 4096;  // Each QP narrows it with path_mtu
+  std::size_t memory_bytes = std::bit_ceil(kBufferBase + buffer_bytes);
+  config.host_memory_config.size_bytes = std::max<std::size_t>(memory_bytes, 1 << 20);
+  auto device = std::make_unique<nic::Device>(config);
+  device->reset();
+  if (!node.driver.init(std::move(device))) {
+    return false;
+  }
+  node.ip = {10, 0, static_cast<std::uint8_t>(index >> 8), static_cast<std::uint8_t>(index)};
+
+  auto pd = node.driver.create_pd();
+  if (!pd) {
+    return false;
+  }
+  node.pd = *pd;
+  AccessFlags access{
+      .local_read = true, .local_write = true, .remote_read = true, .remote_write = true};
+  auto mr = node.driver.register_mr(node.pd, kBufferBase, buffer_bytes, access);
+  if (!mr) {
+    return false;
+  }
+  node.mr = *mr;
+  return true;
+}
+
+bool create_cqs(PerfNode& node, std::size_t outstanding) {
+  std::size_t depth = std::bit_ceil(std::max<std::size_t>(outstanding * 2, 16));
+  auto send_cq = node.driver.create_cq(depth);
+  auto recv_cq = node.driver.create_cq(depth);
+  if (!send_cq || !recv_cq) {
+    return false;
+  }
+  node.send_cq = *send_cq;
+  node.recv_cq = *recv_cq;
+  return true;
+}
+
+std::optional<QpHandle> create_qp(PerfNode& node, std::size_t depth) {
+  RdmaQpConfig config;
+  config.pd_handle = node.pd.value;
+  config.send_cq_number = node.send_cq.value;
+  config.recv_cq_number = node.recv_cq.value;
+  config.send_queue_depth = std::max<std::size_t>(depth, 1);
+  config.recv_queue_depth = std::max<std::size_t>(depth, 1);
+  config.sq_sig_all = true;
+  return node.driver.create_qp(config);
+}
+
+bool connect_qp(NicDriver& driver,
+                QpHandle qp,
+                QpHandle peer,
+                PacketRouter::IpAddress peer_ip,
+                std::uint32_t mtu) {
+  RdmaQpModifyParams params;
+  params.target_state = QpState::Init;
+  if (!driver.modify_qp(qp, params)) {
+    return false;
+  }
+  params = RdmaQpModifyParams{};
+  params.target_state = QpState::Rtr;
+  params.dest_qp_number = peer.value;
+  params.dest_ip = peer_ip;
+  params.rq_psn = 0;
+  params.path_mtu = path_mtu_code(mtu);
+  if (!driver.modify_qp(qp, params)) {
+    return false;
+  }
+  params = RdmaQpModifyParams{};
+  params.target_state = QpState::Rts;
+  params.sq_psn = 0;
+  return driver.modify_qp(qp, params);
+}
+
+bool post_server_recv(PerfNode& server, QpHandle qp, nic::HostAddress address, std::size_t size) {
+  RecvWqe wqe;
+  wqe.wr_id = qp.value;
+  wqe.sgl.push_back(nic::SglEntry{.address = address, .length = size});
+  return server.driver.post_recv(qp, wqe);
+}
+
+/// Run one point of the sweep on freshly created drivers.
+std::optional<PerfResult> run_case(const PerfOptions& options, const PerfCase& perf_case) {
+  std::size_t clients = options.nodes - 1;
+  std::size_t server_slots = clients * perf_case.qps;
+  std::vector<std::unique_ptr<PerfNode>> nodes;
+  PacketRouter router;
+  for (std::size_t idx = 0; idx < options.nodes; ++idx) {
+    std::size_t slots = (idx == 0) ? server_slots : perf_case.qps;
+    auto node = std::make_unique<PerfNode>();
+    std::size_t outstanding = ((idx == 0) ? server_slots : perf_case.qps) * perf_case.depth;
+    if (!init_node(*node, slots * perf_case.size, idx + 1) || !create_cqs(*node, outstanding)) {
+      return std::nullopt;
+    }
+    router.register_driver(node->ip, &node->driver);
+    nodes.push_back(std::move(node));
+  }
+
+  // Each client QP pairs with its own server QP and buffer slot
+  PerfNode& server = *nodes.front();
+  for (std::size_t client_idx = 1; client_idx < nodes.size(); ++client_idx) {
+    PerfNode& client = *nodes[client_idx];
+    for (std::size_t qp_idx = 0; qp_idx < perf_case.qps; ++qp_idx) {
+      auto client_qp = create_qp(client, perf_case.depth);
+      auto server_qp = create_qp(server, perf_case.depth);
+      if (!client_qp || !server_qp
+          || !connect_qp(client.driver, *client_qp, *server_qp, server.ip, perf_case.mtu)
+          || !connect_qp(server.driver, *server_qp, *client_qp, client.ip, perf_case.mtu)) {
+        return std::nullopt;
+      }
+      std::size_t slot = ((client_idx - 1) * perf_case.qps) + qp_idx;
+      nic::HostAddress server_address = kBufferBase + (slot * perf_case.size);
+      client.qp_index[client_qp->value] = client.client_qps.size();
+      ClientQp& state = client.client_qps.emplace_back();
+      state.qp = *client_qp;
+      state.local_address = kBufferBase + (qp_idx * perf_case.size);
+      state.remote_address = server_address;
+      server.qp_index[server_qp->value] = slot;
+      server.server_qps.push_back(*server_qp);
+      if (perf_case.op == PerfOp::Send) {
+        for (std::size_t recv = 0; recv < perf_case.depth; ++recv) {
+          if (!post_server_recv(server, *server_qp, server_address, perf_case.size)) {
+            return std::nullopt;
+          }
+        }
+      }
+    }
+  }
+
+  PerfResult result;
+  std::uint64_t total = static_cast<std::uint64_t>(clients) * perf_case.qps * options.iterations;
+  std::uint64_t stalled_passes = 0;
+  std::vector<SendWqe> batch;
+  std::vector<RdmaCqe> cqes(256);
+  std::uint64_t engine_us = 0;  // Simulated time the engines have been advanced to
+  std::vector<std::vector<nic::rocev2::OutgoingPacket>> pass_packets(nodes.size());
+  auto wall_start = Clock::now();
+
+  while ((result.messages + result.errors < total) && (stalled_passes < 10000)) {
+    // Top every QP up to its depth
+    for (std::size_t client_idx = 1; client_idx < nodes.size(); ++client_idx) {
+      PerfNode& client = *nodes[client_idx];
+      for (ClientQp& state : client.client_qps) {
+        batch.clear();
+        while ((state.posted + batch.size() < options.iterations)
+               && (state.post_times.size() + batch.size() < perf_case.depth)) {
+          SendWqe wqe;
+          wqe.wr_id = state.posted + batch.size();
+          wqe.opcode = op_opcode(perf_case.op);
+          wqe.sgl.push_back(
+              nic::SglEntry{.address = state.local_address, .length = perf_case.size});
+          wqe.total_length = static_cast<std::uint32_t>(perf_case.size);
+          wqe.local_lkey = client.mr.lkey;
+          wqe.remote_address = state.remote_address;
+          wqe.rkey = server.mr.rkey;
+          batch.push_back(wqe);
+        }
+        std::size_t posted = client.driver.post_send_list(state.qp, batch);
+        auto now = Clock::now();
+        state.post_times.insert(state.post_times.end(), posted, now);
+        state.posted += posted;
+      }
+    }
+
+    // Every packet crosses the server's link. A pass lasts one hop plus the time that link
+    // takes to serialize the busier direction, and the engines reach the end of the pass
+    // before its packets are delivered, so completions see the serialization delay.
+    std::uint64_t server_tx_bytes = 0;
+    std::uint64_t server_rx_bytes = 0;
+    for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+      pass_packets[idx] = nodes[idx]->driver.rdma_generate_packets();
+      for (const auto& packet : pass_packets[idx]) {
+        (idx == 0 ? server_tx_bytes : server_rx_bytes) += packet.data.size();
+      }
+    }
+    result.sim_ns += (static_cast<double>(options.hop_us) * 1000.0)
+                     + (static_cast<double>(std::max(server_tx_bytes, server_rx_bytes)) * 8.0
+                        / static_cast<double>(options.link_gbps));
+    auto sim_us = static_cast<std::uint64_t>(result.sim_ns / 1000.0);
+    for (auto& node : nodes) {
+      node->driver.device()->rdma_engine()->advance_time(sim_us - engine_us);
+    }
+    engine_us = sim_us;
+
+    std::size_t routed = 0;
+    for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+      for (const auto& packet : pass_packets[idx]) {
+        routed += router.route_packet(packet, nodes[idx]->ip) ? 1 : 0;
+      }
+    }
+
+    // Reap completions; SEND targets get their receive WQEs back
+    std::uint64_t reaped = 0;
+    for (std::size_t client_idx = 1; client_idx < nodes.size(); ++client_idx) {
+      PerfNode& client = *nodes[client_idx];
+      std::size_t count = 0;
+      while ((count = client.driver.poll_cq(client.send_cq, cqes)) != 0) {
+        auto now = Clock::now();
+        for (std::size_t idx = 0; idx < count; ++idx) {
+          ClientQp& state = client.client_qps[client.qp_index.at(cqes[idx].qp_number)];
+          if (!state.post_times.empty()) {
+            result.wall_latency_ns.record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - state.post_times.front())
+                    .count()));
+            state.post_times.pop_front();
+          }
+          ++state.completed;
+          ++reaped;
+          if (cqes[idx].status == WqeStatus::Success) {
+            ++result.messages;
+            result.bytes += perf_case.size;
+          } else {
+            ++result.errors;
+          }
+        }
+      }
+    }
+    std::size_t count = 0;
+    while ((count = server.driver.poll_cq(server.recv_cq, cqes)) != 0) {
+      for (std::size_t idx = 0; idx < count; ++idx) {
+        std::size_t slot = server.qp_index.at(cqes[idx].qp_number);
+        nic::HostAddress address = kBufferBase + (slot * perf_case.size);
+        static_cast<void>(
+            post_server_recv(server, server.server_qps[slot], address, perf_case.size));
+      }
+    }
+    stalled_passes = ((routed == 0) && (reaped == 0)) ? stalled_passes + 1 : 0;
+  }
+
+  result.wall_ns = static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - wall_start).count());
+  result.errors += total - result.messages - result.errors;  // Lost to a stall
+  for (std::size_t client_idx = 1; client_idx < nodes.size(); ++client_idx) {
+    const auto* engine = nodes[client_idx]->driver.device()->rdma_engine();
+    result.sim_latency_us.merge(engine->latency_stats().opcode(op_opcode(perf_case.op)));
+  }
+  return result;
+}
+
+void print_header(const PerfOptions& options) {
+  if (options.csv) {
+    std::printf("op,mode,bytes,mtu,qps,depth,messages,errors,sim_gbps,sim_mmsgs,sim_p50_us,"
+                "sim_p99_us,sim_p999_us,wall_gbps,wall_mmsgs,wall_p50_us,wall_p99_us,"
+                "wall_p999_us\n");
+    return;
+  }
+  std::printf("%-5s %-3s %7s %4s %4s %5s | %9s %8s %6s %6s %6s | %8s %8s %8s %8s %8s\n",
+              "op",
+              "",
+              "bytes",
+              "mtu",
+              "qps",
+              "depth",
+              "sim Gbps",
+              "Mmsg/s",
+              "p50us",
+              "p99us",
+              "p999us",
+              "wall Gbps",
+              "Mmsg/s",
+              "p50us",
+              "p99us",
+              "p999us");
+}
+
+void print_result(const PerfOptions& options, const PerfCase& perf_case, const PerfResult& result) {
+  double sim_ns = result.sim_ns;
+  double bits = static_cast<double>(result.bytes) * 8.0;
+  double messages = static_cast<double>(result.messages);
+  double sim_gbps = (sim_ns > 0.0) ? bits / sim_ns : 0.0;
+  double sim_mmsgs = (sim_ns > 0.0) ? messages * 1000.0 / sim_ns : 0.0;
+  double wall_gbps = (result.wall_ns > 0.0) ? bits / result.wall_ns : 0.0;
+  double wall_mmsgs = (result.wall_ns > 0.0) ? messages * 1000.0 / result.wall_ns : 0.0;
+  auto sim_pct = [&result](double percentile) {
+    return static_cast<double>(result.sim_latency_us.value_at_percentile(percentile));
+  };
+  auto wall_pct = [&result](double percentile) {
+    return static_cast<double>(result.wall_latency_ns.value_at_percentile(percentile)) / 1000.0;
+  };
+  const char* mode = (options.mode == PerfMode::Latency) ? "lat" : "bw";
+
+  if (options.csv) {
+    std::printf("%s,%s,%zu,%u,%zu,%zu,%llu,%llu,%.3f,%.3f,%.0f,%.0f,%.0f,%.4f,%.4f,%.2f,%.2f,"
+                "%.2f\n",
+                op_name(perf_case.op),
+                mode,
+                perf_case.size,
+                perf_case.mtu,
+                perf_case.qps,
+                perf_case.depth,
+                static_cast<unsigned long long>(result.messages),
+                static_cast<unsigned long long>(result.errors),
+                sim_gbps,
+                sim_mmsgs,
+                sim_pct(50.0),
+                sim_pct(99.0),
+                sim_pct(99.9),
+                wall_gbps,
+                wall_mmsgs,
+                wall_pct(50.0),
+                wall_pct(99.0),
+                wall_pct(99.9));
+  } else {
+    std::printf(
+        "%-5s %-3s %7zu %4u %4zu %5zu | %9.3f %8.3f %6.0f %6.0f %6.0f | %8.4f %8.4f %8.2f %8.2f "
+        "%8.2f%s\n",
+        op_name(perf_case.op),
+        mode,
+        perf_case.size,
+        perf_case.mtu,
+        perf_case.qps,
+        perf_case.depth,
+        sim_gbps,
+        sim_mmsgs,
+        sim_pct(50.0),
+        sim_pct(99.0),
+        sim_pct(99.9),
+        wall_gbps,
+        wall_mmsgs,
+        wall_pct(50.0),
+        wall_pct(99.0),
+        wall_pct(99.9),
+        (result.errors != 0) ? "  (errors)" : "");
+  }
+  std::fflush(stdout);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string_view first = (argc > 1) ? argv[1] : "";
+  if ((first == "--help") || (first == "-h")) {
+    print_usage(argv[0]);
+    return 0;
+  }
+  auto options = parse_options(argc, argv);
+  if (!options) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  print_header(*options);
+  bool failed = false;
+  for (PerfOp op : options->ops) {
+    for (std::uint32_t mtu : options->mtus) {
+      for (std::size_t qps : options->qp_counts) {
+        for (std::size_t depth : op_depths(op, options->depths)) {
+          for (std::size_t size : options->sizes) {
+            PerfCase perf_case{.op = op, .size = size, .qps = qps, .depth = depth, .mtu = mtu};
+            auto result = run_case(*options, perf_case);
+            if (!result) {
+              std::fprintf(stderr, "setup failed: %s size=%zu qps=%zu depth=%zu mtu=%u\n",
+                           op_name(op), size, qps, depth, mtu);
+              failed = true;
+              continue;
+            }
+            print_result(*options, perf_case, *result);
+            failed = failed || (result->errors != 0);
+          }
+        }
+      }
+    }
+  }
+  return failed ? 1 : 0;
+}
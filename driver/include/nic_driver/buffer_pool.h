@@ -0,0 +1,54 @@
+#pragma once
+
+/// @file buffer_pool.h
+/// @brief Fixed-size host buffer slabs for driver TX/RX descriptors.
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "nic/host_memory.h"
+
+namespace nic_driver {
+
+/// Hands out equal-sized buffers from one contiguous host-memory region.
+/// Buffers are named by their slab index, which the driver also uses as the
+/// descriptor index, so a completion maps back to its buffer without a lookup.
+/// Freed buffers are reused LIFO so the most recently touched memory goes out first.
+class BufferPool {
+public:
+  BufferPool() = default;
+  BufferPool(nic::HostAddress base_address, std::size_t buffer_size, std::size_t buffer_count);
+
+  /// Take a free buffer.
+  /// @return Slab index, or nullopt if every buffer is in use.
+  [[nodiscard]] std::optional<std::uint32_t> allocate();
+
+  /// Return a buffer to the pool.
+  /// @return false if the index is out of range or the buffer is already free.
+  bool release(std::uint32_t index);
+
+  /// Mark every buffer free.
+  void reset();
+
+  [[nodiscard]] nic::HostAddress address(std::uint32_t index) const noexcept {
+    return base_address_ + (static_cast<nic::HostAddress>(index) * buffer_size_);
+  }
+  [[nodiscard]] bool in_use(std::uint32_t index) const noexcept {
+    return (index < in_use_.size()) && in_use_[index];
+  }
+  [[nodiscard]] nic::HostAddress base_address() const noexcept { return base_address_; }
+  [[nodiscard]] std::size_t buffer_size() const noexcept { return buffer_size_; }
+  [[nodiscard]] std::size_t capacity() const noexcept { return in_use_.size(); }
+  [[nodiscard]] std::size_t available() const noexcept { return free_.size(); }
+  [[nodiscard]] std::size_t region_bytes() const noexcept { return buffer_size_ * capacity(); }
+
+private:
+  nic::HostAddress base_address_{0};
+  std::size_t buffer_size_{0};
+  std::vector<std::uint32_t> free_{};  // Stack of free slab indices
+  std::vector<bool> in_use_{};
+};
+
+}  // namespace nic_driver
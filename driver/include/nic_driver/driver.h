@@ -1,14 +1,17 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <optional>
 #include <span>
+#include <thread>
 #include <vector>
 
+#include "nic_driver/buffer_pool.h"
 #include "nic_driver/rdma_types.h"
 
 namespace nic {
@@ -19,6 +22,43 @@ class QueuePair;
 
 namespace nic_driver {
 
+/// Driver-owned host memory settings.
+struct DriverConfig {
+  std::size_t buffer_size{2048};  // Bytes per pool buffer (one frame)
+  std::size_t tx_buffers{0};      // TX buffers per queue (0 = TX ring size)
+  /// RX buffers per queue that the driver posts and refills for receive_burst()
+  /// (0 = the application posts its own RX descriptors).
+  std::size_t rx_buffers{0};
+  /// Start of the buffer pool region (nullopt = the top of host memory, page aligned).
+  std::optional<nic::HostAddress> buffer_base{};
+};
+
+/// TX buffer handed out by alloc_tx_buffer(). The application writes the frame
+/// straight into data (host memory) and passes the buffer to send_buffer().
+struct TxBuffer {
+  std::span<std::byte> data{};  // Writable host memory, buffer_size bytes
+  nic::HostAddress address{0};
+  std::uint32_t index{0};     // Pool slab, also the TX descriptor index
+  std::uint16_t queue_id{0};  // Queue whose pool owns the buffer
+};
+
+/// Frame for send_burst(): the first length bytes of a filled TX buffer.
+struct PacketRef {
+  TxBuffer buffer{};
+  std::size_t length{0};
+};
+
+/// Frame returned by receive_burst(). data points into the driver's RX buffer in host
+/// memory and stays valid until the next receive_burst() call, which recycles the buffer.
+struct RxPacketView {
+  std::span<const std::byte> data{};
+  nic::HostAddress address{0};
+  std::uint16_t queue_id{0};
+  std::uint16_t vlan_tag{0};  // Valid when vlan_stripped
+  bool vlan_stripped{false};
+  bool checksum_verified{false};
+};
+
 // Simplified driver that wraps the NIC model API
 class NicDriver {
 public:
@@ -32,7 +72,7 @@ public:
   NicDriver& operator=(NicDriver&&) = delete;
 
   // Initialization - takes ownership of device pointer
-  bool init(std::unique_ptr<nic::Device> device);
+  bool init(std::unique_ptr<nic::Device> device, const DriverConfig& config = {});
   void reset();
   bool is_initialized() const { return initialized_; }
 
@@ -43,8 +83,28 @@ public:
   // Packet transmission (uses device's queue pair)
   bool send_packet(std::span<const std::byte> packet);
 
-  // Process device (polls for work)
+  // Zero-copy transmission: fill an allocated buffer in place, then send length bytes of it.
+  // A buffer goes back to the pool on its TX completion; free_tx_buffer() returns an unsent one.
+  [[nodiscard]] std::optional<TxBuffer> alloc_tx_buffer();
+  bool send_buffer(const TxBuffer& buffer, std::size_t length);
+  bool free_tx_buffer(const TxBuffer& buffer);
+
+  // Poll TX completions and recycle their buffers; returns the buffers recycled
+  std::size_t reclaim_tx_buffers();
+  [[nodiscard]] std::size_t tx_buffers_available() const;
+
+  // Burst I/O (rte_eth_tx_burst/rx_burst style). Each returns the packets handled; send_burst
+  // stops at the first packet it cannot queue, which stays with the caller.
+  [[nodiscard]] std::size_t alloc_tx_buffers(std::span<TxBuffer> out);
+  [[nodiscard]] std::size_t send_burst(std::span<const PacketRef> packets);
+  // Needs DriverConfig::rx_buffers; refills the RX ring from the pool before returning
+  [[nodiscard]] std::size_t receive_burst(std::span<RxPacketView> out);
+
+  // Process device (polls for work). Runs every queue, so it is refused while any queue is
+  // bound to another thread
   bool process();
+  // Process up to budget TX descriptors; returns the number processed
+  std::size_t process_burst(std::size_t budget);
 
   // Statistics
   struct Stats {
@@ -53,11 +113,34 @@ public:
     std::uint64_t rx_packets{0};
     std::uint64_t rx_bytes{0};
     std::uint64_t processed{0};
+    std::uint64_t tx_completions{0};  // TX buffers recycled
+    std::uint64_t tx_no_buffer{0};    // Sends refused with every TX buffer in flight
+    std::uint64_t rx_errors{0};       // RX completions with a non-success status
   };
 
+  // Sum over the driver and every queue; read while no queue thread is running
   Stats get_stats() const;
   void clear_stats();
 
+  // Multi-queue I/O: one TX/RX pool per device queue (each QueueManager queue, or the single
+  // queue pair). Queues share no driver state, so each can be run by its own thread without
+  // driver locks; a shared InterruptDispatcher serializes itself. bind_queue() makes the calling
+  // thread the queue's owner; calls naming that queue from any other thread fail until the owner
+  // unbinds. The queue-less calls above use queue 0
+  [[nodiscard]] std::size_t queue_count() const { return queues_.size(); }
+  bool bind_queue(std::uint16_t queue_id);
+  bool unbind_queue(std::uint16_t queue_id);
+  [[nodiscard]] std::optional<TxBuffer> alloc_tx_buffer(std::uint16_t queue_id);
+  [[nodiscard]] std::size_t alloc_tx_buffers(std::uint16_t queue_id, std::span<TxBuffer> out);
+  [[nodiscard]] std::size_t send_burst(std::uint16_t queue_id,
+                                       std::span<const PacketRef> packets);
+  [[nodiscard]] std::size_t receive_burst(std::uint16_t queue_id, std::span<RxPacketView> out);
+  // Process up to budget TX descriptors of one queue, bypassing the device scheduler
+  std::size_t process_burst(std::uint16_t queue_id, std::size_t budget);
+  std::size_t reclaim_tx_buffers(std::uint16_t queue_id);
+  [[nodiscard]] std::size_t tx_buffers_available(std::uint16_t queue_id) const;
+  [[nodiscard]] Stats queue_stats(std::uint16_t queue_id) const;
+
   // ============================================
   // RDMA API (hardware-style, mirrors libibverbs)
   // ============================================
@@ -74,21 +157,68 @@ public:
                                                     std::uint64_t virtual_address,
                                                     std::size_t length,
                                                     AccessFlags access);
+  // Batch registration in one PD: returns the handles registered (stops at the first failure)
+  [[nodiscard]] std::vector<MrHandle> register_mrs(PdHandle pd,
+                                                   std::span<const RdmaMrRegion> regions);
   bool deregister_mr(MrHandle mr);
 
+  // Address Handle (UD destinations)
+  [[nodiscard]] std::optional<AhHandle> create_ah(PdHandle pd, const RdmaAhAttr& attr);
+  bool destroy_ah(AhHandle ah);
+
   // Completion Queue
-  [[nodiscard]] std::optional<CqHandle> create_cq(std::size_t depth);
+  [[nodiscard]] std::optional<CqHandle> create_cq(
+      std::size_t depth,
+      std::optional<std::uint64_t> host_ring_address = std::nullopt,
+      std::uint16_t comp_vector = 0);
+  [[nodiscard]] std::optional<CqHandle> create_cq(const RdmaCqConfig& config);
   bool destroy_cq(CqHandle cq);
   [[nodiscard]] std::vector<RdmaCqe> poll_cq(CqHandle cq, std::size_t max_cqes);
+  [[nodiscard]] std::size_t poll_cq(CqHandle cq, std::span<RdmaCqe> out);
+
+  // Completion channel: arm a CQ, then wait for its event instead of busy-polling the CQ.
+  // Each event disarms its CQ; re-arm before polling the CQ empty to catch later CQEs
+  bool req_notify_cq(CqHandle cq, bool solicited_only = false);
+  bool modify_cq(CqHandle cq, const RdmaCqModeration& moderation);
+  [[nodiscard]] std::vector<RdmaCqEvent> poll_cq_events(std::size_t max_events);
+  // Block until an event arrives or timeout_us of simulated time passes. Each wait step runs
+  // progress (e.g. PacketRouter::process_all) and advances the device clock by step_us.
+  // step_us = 0 steps 1 us while traffic is in flight, else jumps to the next engine timer
+  [[nodiscard]] std::optional<RdmaCqEvent> get_cq_event(
+      std::uint64_t timeout_us,
+      const std::function<void()>& progress = {},
+      std::uint64_t step_us = 0);
+
+  // Shared Receive Queue
+  [[nodiscard]] std::optional<SrqHandle> create_srq(std::size_t depth, std::size_t limit = 0);
+  bool destroy_srq(SrqHandle srq);
+  bool arm_srq(SrqHandle srq, std::size_t limit);
+  bool post_srq_recv(SrqHandle srq, const RecvWqe& wqe);
+
+  // Asynchronous events (SRQ limit reached, ...)
+  [[nodiscard]] std::vector<RdmaAsyncEvent> poll_async_events(std::size_t max_events);
 
   // Queue Pair
   [[nodiscard]] std::optional<QpHandle> create_qp(const RdmaQpConfig& config);
   bool destroy_qp(QpHandle qp);
   bool modify_qp(QpHandle qp, const RdmaQpModifyParams& params);
+  // Bulk connection setup: create_qps returns the handles created (stops at the first
+  // failure); modify_qps takes one params entry per QP, or one entry for all of them, and
+  // returns the number modified. Destroyed QP numbers are reused, oldest first
+  [[nodiscard]] std::vector<QpHandle> create_qps(std::span<const RdmaQpConfig> configs);
+  [[nodiscard]] std::size_t modify_qps(std::span<const QpHandle> qps,
+                                       std::span<const RdmaQpModifyParams> params);
 
   // Work Requests
   bool post_send(QpHandle qp, const SendWqe& wqe);
   bool post_recv(QpHandle qp, const RecvWqe& wqe);
+  // Chained posts: return the number posted (index of the first failure, or size on success)
+  [[nodiscard]] std::size_t post_send_list(QpHandle qp, std::span<const SendWqe> wqes);
+  [[nodiscard]] std::size_t post_recv_list(QpHandle qp, std::span<const RecvWqe> wqes);
+  // Host-ring posts for QPs created with sq_ring_address: write the WQE into the ring, then
+  // ring the BAR2 doorbell (device fetches the WQE) or write it to the BlueFlame buffer
+  bool post_send_doorbell(QpHandle qp, const SendWqe& wqe);
+  bool post_send_blueflame(QpHandle qp, const SendWqe& wqe);
 
   // Packet I/O for inter-driver routing
   [[nodiscard]] std::vector<OutgoingPacket> rdma_generate_packets();
@@ -98,9 +228,40 @@ public:
                            std::uint16_t src_port);
 
 private:
+  /// Driver state of one device queue pair, written only by the queue's owning thread.
+  /// Cache-line aligned so queues polled from different cores do not false-share.
+  struct alignas(64) QueueState {
+    std::uint16_t queue_id{0};
+    nic::QueuePair* queue_pair{nullptr};
+    BufferPool tx_buffers;
+    BufferPool rx_buffers;
+    std::vector<std::uint32_t> rx_held;  // RX buffers lent out by the last receive_burst()
+    Stats stats;
+    std::atomic<std::thread::id> owner{};  // Bound thread (default id = unbound)
+    bool device_claim{false};  // Owner was taken by a device-wide call, not bind_queue()
+  };
+
+  bool post_send_ring(QpHandle qp, const SendWqe& wqe, bool blueflame);
+  bool init_buffer_pools();
+  /// Get a queue the calling thread may use, or nullptr (logged) if it is out of range or
+  /// bound to another thread.
+  [[nodiscard]] QueueState* owned_queue(std::uint16_t queue_id) const;
+  [[nodiscard]] static bool accessible(const QueueState& queue);
+  std::size_t reclaim_tx(QueueState& queue);
+  std::size_t refill_rx(QueueState& queue);
+  void sync_rx_stats(QueueState& queue);
+  void sync_queues();
+  /// Take every unbound queue for a device-wide call. Fails (logged, nothing kept) if any
+  /// queue is bound to another thread.
+  [[nodiscard]] bool claim_queues();
+  void release_queues(std::size_t count);
+  bool process_device_once();
+
   bool initialized_{false};
   std::unique_ptr<nic::Device> device_;
-  mutable Stats stats_;
+  DriverConfig config_{};
+  std::vector<std::unique_ptr<QueueState>> queues_;
+  mutable Stats stats_;  // Device-wide work (process()); per-queue counters live in QueueState
 };
 
 }  // namespace nic_driver
@@ -52,6 +52,24 @@ public:
   /// Get the number of registered drivers.
   [[nodiscard]] std::size_t driver_count() const noexcept { return drivers_.size(); }
 
+  /// Model an ECMP fabric of equal-cost paths between the drivers. Each routed packet
+  /// is assigned a path by hashing its 5-tuple, as a switch would.
+  /// @param path_count Number of paths (0 disables path accounting).
+  void set_ecmp_paths(std::size_t path_count);
+
+  /// Get the number of packets routed over each ECMP path.
+  [[nodiscard]] const std::vector<std::uint64_t>& path_packets() const noexcept {
+    return path_packets_;
+  }
+
+  /// Select the ECMP path of a RoCEv2 packet from its UDP/IP 5-tuple.
+  /// @param path_count Number of paths (must be non-zero).
+  [[nodiscard]] static std::size_t ecmp_path(IpAddress src_ip,
+                                             IpAddress dest_ip,
+                                             std::uint16_t src_port,
+                                             std::uint16_t dest_port,
+                                             std::size_t path_count) noexcept;
+
 private:
   struct DriverEntry {
     IpAddress ip{};
@@ -59,6 +77,7 @@ private:
   };
 
   std::vector<DriverEntry> drivers_;
+  std::vector<std::uint64_t> path_packets_;  // Packets routed per ECMP path
 
   /// Find a driver by IP address.
   /// @param ip The IP address to search for.
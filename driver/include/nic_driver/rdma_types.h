@@ -34,16 +34,35 @@ struct QpHandle {
   std::uint32_t value;
 };
 
+/// Address Handle wrapper for type safety (UD destinations).
+struct AhHandle {
+  std::uint32_t value;
+};
+
+/// Shared Receive Queue handle wrapper for type safety.
+struct SrqHandle {
+  std::uint32_t value;
+};
+
 // Re-export types from nic::rocev2 for driver API convenience.
 using nic::rocev2::AccessFlags;
+using nic::rocev2::AsyncEventType;
 using nic::rocev2::OutgoingPacket;
+using nic::rocev2::RdmaAhAttr;
+using nic::rocev2::RdmaAsyncEvent;
 using nic::rocev2::QpState;
 using nic::rocev2::QpType;
+using nic::rocev2::RdmaCqConfig;
 using nic::rocev2::RdmaCqe;
+using nic::rocev2::RdmaCqEvent;
+using nic::rocev2::RdmaCqModeration;
+using nic::rocev2::RdmaMrRegion;
 using nic::rocev2::RdmaQpConfig;
 using nic::rocev2::RdmaQpModifyParams;
 using nic::rocev2::RecvWqe;
 using nic::rocev2::SendWqe;
+using nic::rocev2::SrcPortConfig;
+using nic::rocev2::SrcPortMode;
 using nic::rocev2::WqeOpcode;
 using nic::rocev2::WqeStatus;
 
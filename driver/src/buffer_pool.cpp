@@ -0,0 +1,52 @@
+#include "nic_driver/buffer_pool.h"
+
+#include <algorithm>
+
+#include "nic/trace.h"
+
+namespace nic_driver {
+
+BufferPool::BufferPool(nic::HostAddress base_address,
+                       std::size_t buffer_size,
+                       std::size_t buffer_count)
+  : base_address_(base_address), buffer_size_(buffer_size), in_use_(buffer_count, false) {
+  NIC_TRACE_SCOPED(__func__);
+  reset();
+}
+
+std::optional<std::uint32_t> BufferPool::allocate() {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (free_.empty()) {
+    return std::nullopt;
+  }
+  std::uint32_t index = free_.back();
+  free_.pop_back();
+  in_use_[index] = true;
+  return index;
+}
+
+bool BufferPool::release(std::uint32_t index) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!in_use(index)) {
+    return false;
+  }
+  in_use_[index] = false;
+  free_.push_back(index);
+  return true;
+}
+
+void BufferPool::reset() {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::fill(in_use_.begin(), in_use_.end(), false);
+  free_.clear();
+  free_.reserve(in_use_.size());
+  // Highest index at the bottom so the first allocations come out in address order
+  for (std::size_t index = in_use_.size(); index > 0; --index) {
+    free_.push_back(static_cast<std::uint32_t>(index - 1));
+  }
+}
+
+}  // namespace nic_driver
@@ -3,10 +3,12 @@
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <limits>
 
 #include "nic/device.h"
 #include "nic/host_memory.h"
 #include "nic/log.h"
+#include "nic/queue_manager.h"
 #include "nic/queue_pair.h"
 #include "nic/rocev2/engine.h"
 #include "nic/trace.h"
@@ -23,13 +25,18 @@ NicDriver::~NicDriver() {
   }
 }
 
-bool NicDriver::init(std::unique_ptr<nic::Device> device) {
+bool NicDriver::init(std::unique_ptr<nic::Device> device, const DriverConfig& config) {
   NIC_TRACE_SCOPED(__func__);
   if (initialized_ || !device) {
     return false;
   }
 
   device_ = std::move(device);
+  config_ = config;
+  if (!init_buffer_pools()) {
+    device_.reset();
+    return false;
+  }
   initialized_ = true;
   NIC_LOG_INFO("driver initialized");
   return true;
@@ -46,84 +53,509 @@ void NicDriver::reset() {
   }
 
   initialized_ = false;
+  queues_.clear();
   device_.reset();
   NIC_LOG_INFO("driver reset");
 }
 
+bool NicDriver::init_buffer_pools() {
+  NIC_TRACE_SCOPED(__func__);
+
+  queues_.clear();
+  std::vector<nic::QueuePair*> queue_pairs;
+  if (auto* queue_manager = device_->queue_manager()) {
+    for (std::size_t index = 0; index < queue_manager->queue_count(); ++index) {
+      queue_pairs.push_back(queue_manager->queue(index));
+    }
+  } else if (auto* queue_pair = device_->queue_pair()) {
+    queue_pairs.push_back(queue_pair);
+  }
+  if (queue_pairs.empty()) {
+    return true;  // RDMA-only device: no Ethernet buffers to manage
+  }
+
+  // Descriptor indices are 16 bits wide and name the buffer on completion
+  constexpr std::size_t kMaxBuffers = std::size_t{std::numeric_limits<std::uint16_t>::max()} + 1;
+  std::vector<std::size_t> tx_counts;
+  std::size_t rx_count = config_.rx_buffers;
+  std::size_t total_buffers = 0;
+  bool counts_ok = (config_.buffer_size != 0) && (rx_count <= kMaxBuffers);
+  for (const auto* queue_pair : queue_pairs) {
+    std::size_t ring_size = queue_pair->config().tx_ring.ring_size;
+    std::size_t tx_count = (config_.tx_buffers != 0) ? config_.tx_buffers : ring_size;
+    counts_ok = counts_ok && (tx_count != 0) && (tx_count <= kMaxBuffers);
+    tx_counts.push_back(tx_count);
+    total_buffers += tx_count + rx_count;
+  }
+  std::size_t region = total_buffers * config_.buffer_size;
+  nic::HostMemoryConfig memory = device_->host_memory().config();
+  nic::HostAddress base = config_.buffer_base.value_or(
+      (memory.size_bytes >= region) ? (memory.size_bytes - region) & ~(memory.page_size - 1) : 0);
+  if (!counts_ok || (base + region > memory.size_bytes)) {
+    NIC_LOGF_WARNING("driver buffer pool does not fit: buffers={} size={} base={:#x} memory={}",
+                     total_buffers,
+                     config_.buffer_size,
+                     base,
+                     memory.size_bytes);
+    return false;
+  }
+
+  // One slice per queue: its TX buffers, then its RX buffers
+  nic::HostAddress slice = base;
+  for (std::size_t index = 0; index < queue_pairs.size(); ++index) {
+    nic::HostAddress rx_base = slice + (tx_counts[index] * config_.buffer_size);
+    auto& queue = *queues_.emplace_back(std::make_unique<QueueState>());
+    queue.queue_id = static_cast<std::uint16_t>(index);
+    queue.queue_pair = queue_pairs[index];
+    queue.tx_buffers = BufferPool(slice, config_.buffer_size, tx_counts[index]);
+    queue.rx_buffers = BufferPool(rx_base, config_.buffer_size, rx_count);
+    refill_rx(queue);
+    slice = rx_base + (rx_count * config_.buffer_size);
+  }
+  NIC_LOGF_DEBUG("driver buffer pool: queues={} buffers={} size={} base={:#x}",
+                 queues_.size(),
+                 total_buffers,
+                 config_.buffer_size,
+                 base);
+  return true;
+}
+
+NicDriver::QueueState* NicDriver::owned_queue(std::uint16_t queue_id) const {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || (queue_id >= queues_.size())) {
+    return nullptr;
+  }
+
+  QueueState& queue = *queues_[queue_id];
+  if (!accessible(queue)) {
+    NIC_LOGF_WARNING("driver queue {} is bound to another thread", queue_id);
+    return nullptr;
+  }
+  return &queue;
+}
+
+bool NicDriver::accessible(const QueueState& queue) {
+  std::thread::id owner = queue.owner.load(std::memory_order_acquire);
+  return (owner == std::thread::id{}) || (owner == std::this_thread::get_id());
+}
+
+bool NicDriver::bind_queue(std::uint16_t queue_id) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || (queue_id >= queues_.size())) {
+    return false;
+  }
+
+  std::thread::id self = std::this_thread::get_id();
+  std::thread::id unbound{};
+  auto& owner = queues_[queue_id]->owner;
+  if (!owner.compare_exchange_strong(unbound, self, std::memory_order_acq_rel)
+      && (unbound != self)) {
+    NIC_LOGF_WARNING("bind_queue: queue {} is bound to another thread", queue_id);
+    return false;
+  }
+  return true;
+}
+
+bool NicDriver::unbind_queue(std::uint16_t queue_id) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || (queue_id >= queues_.size())) {
+    return false;
+  }
+
+  std::thread::id self = std::this_thread::get_id();
+  return queues_[queue_id]->owner.compare_exchange_strong(
+      self, std::thread::id{}, std::memory_order_acq_rel);
+}
+
+bool NicDriver::claim_queues() {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::thread::id self = std::this_thread::get_id();
+  for (std::size_t index = 0; index < queues_.size(); ++index) {
+    QueueState& queue = *queues_[index];
+    std::thread::id unbound{};
+    if (queue.owner.compare_exchange_strong(unbound, self, std::memory_order_acq_rel)) {
+      queue.device_claim = true;
+    } else if (unbound != self) {
+      NIC_LOGF_WARNING("driver queue {} is bound to another thread; device-wide process refused",
+                       index);
+      release_queues(index);
+      return false;
+    }
+  }
+  return true;
+}
+
+void NicDriver::release_queues(std::size_t count) {
+  NIC_TRACE_SCOPED(__func__);
+
+  for (std::size_t index = 0; index < count; ++index) {
+    QueueState& queue = *queues_[index];
+    if (queue.device_claim) {
+      queue.device_claim = false;
+      queue.owner.store(std::thread::id{}, std::memory_order_release);
+    }
+  }
+}
+
+std::size_t NicDriver::refill_rx(QueueState& queue) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto& rx_ring = queue.queue_pair->rx_ring();
+  std::size_t posted = 0;
+  while (!rx_ring.is_full()) {
+    auto index = queue.rx_buffers.allocate();
+    if (!index) {
+      break;
+    }
+    nic::RxDescriptor rx_desc{};
+    rx_desc.buffer_address = queue.rx_buffers.address(*index);
+    rx_desc.buffer_length = static_cast<std::uint32_t>(queue.rx_buffers.buffer_size());
+    rx_desc.descriptor_index = static_cast<std::uint16_t>(*index);
+
+    std::array<std::byte, sizeof(nic::RxDescriptor)> desc_bytes{};
+    std::memcpy(desc_bytes.data(), &rx_desc, sizeof(nic::RxDescriptor));
+    if (!rx_ring.push_descriptor(desc_bytes).ok()) {
+      queue.rx_buffers.release(*index);
+      break;
+    }
+    ++posted;
+  }
+  return posted;
+}
+
 bool NicDriver::send_packet(std::span<const std::byte> packet) {
   NIC_TRACE_SCOPED(__func__);
   if (!initialized_ || !device_) {
     return false;
   }
+  if (packet.size() > config_.buffer_size) {
+    NIC_LOGF_WARNING("send_packet: {} bytes exceed the {}-byte TX buffer",
+                     packet.size(),
+                     config_.buffer_size);
+    return false;
+  }
 
-  auto* qp = device_->queue_pair();
-  if (!qp) {
+  auto buffer = alloc_tx_buffer();
+  if (!buffer) {
+    return false;
+  }
+  std::copy(packet.begin(), packet.end(), buffer->data.begin());
+  if (!send_buffer(*buffer, packet.size())) {
+    free_tx_buffer(*buffer);
     return false;
   }
+  return true;
+}
 
-  // Get host memory for writing packet data
-  auto& host_mem = device_->host_memory();
+std::optional<TxBuffer> NicDriver::alloc_tx_buffer() {
+  NIC_TRACE_SCOPED(__func__);
+  return alloc_tx_buffer(0);
+}
 
-  // Allocate a buffer address in host memory (simplified - using packet size as address offset)
-  // In a real driver, would manage a proper buffer pool
-  static nic::HostAddress next_addr = 0x10000;  // Start at 64KB
-  nic::HostAddress buffer_addr = next_addr;
-  next_addr += packet.size() + 256;  // Add padding
+std::optional<TxBuffer> NicDriver::alloc_tx_buffer(std::uint16_t queue_id) {
+  NIC_TRACE_SCOPED(__func__);
+  QueueState* queue = owned_queue(queue_id);
+  if (queue == nullptr) {
+    return std::nullopt;
+  }
+
+  BufferPool& pool = queue->tx_buffers;
+  auto index = pool.allocate();
+  if (!index && (reclaim_tx(*queue) != 0)) {
+    index = pool.allocate();
+  }
+  if (!index) {
+    ++queue->stats.tx_no_buffer;
+    return std::nullopt;
+  }
+
+  nic::HostMemoryView view;
+  if (!device_->host_memory().translate(pool.address(*index), pool.buffer_size(), view).ok()) {
+    pool.release(*index);
+    return std::nullopt;
+  }
+  return TxBuffer{.data = std::span<std::byte>(view.data, view.length),
+                  .address = view.address,
+                  .index = *index,
+                  .queue_id = queue_id};
+}
+
+bool NicDriver::send_buffer(const TxBuffer& buffer, std::size_t length) {
+  NIC_TRACE_SCOPED(__func__);
+  QueueState* queue = owned_queue(buffer.queue_id);
+  if (queue == nullptr) {
+    return false;
+  }
 
-  // Write packet to host memory
-  std::vector<std::byte> packet_vec(packet.begin(), packet.end());
-  auto write_result = host_mem.write(buffer_addr, packet_vec);
-  if (!write_result.ok()) {
+  if (!queue->tx_buffers.in_use(buffer.index)
+      || (buffer.address != queue->tx_buffers.address(buffer.index))
+      || (length > queue->tx_buffers.buffer_size())) {
+    NIC_LOGF_WARNING("send_buffer: invalid buffer queue={} index={} addr={:#x} len={}",
+                     buffer.queue_id,
+                     buffer.index,
+                     buffer.address,
+                     length);
     return false;
   }
 
-  // Create TX descriptor
   nic::TxDescriptor tx_desc{};
-  tx_desc.buffer_address = buffer_addr;
-  tx_desc.length = static_cast<std::uint32_t>(packet.size());
+  tx_desc.buffer_address = buffer.address;
+  tx_desc.length = static_cast<std::uint32_t>(length);
   tx_desc.checksum = nic::ChecksumMode::None;
-  tx_desc.descriptor_index = 0;
+  tx_desc.descriptor_index = static_cast<std::uint16_t>(buffer.index);
 
-  // Serialize descriptor to bytes
-  std::vector<std::byte> desc_bytes(sizeof(nic::TxDescriptor));
+  std::array<std::byte, sizeof(nic::TxDescriptor)> desc_bytes{};
   std::memcpy(desc_bytes.data(), &tx_desc, sizeof(nic::TxDescriptor));
+  if (!queue->queue_pair->tx_ring().push_descriptor(desc_bytes).ok()) {
+    return false;
+  }
 
-  // Push descriptor to TX ring
-  auto& tx_ring = qp->tx_ring();
-  auto push_result = tx_ring.push_descriptor(desc_bytes);
+  queue->stats.tx_packets++;
+  queue->stats.tx_bytes += length;
+  return true;
+}
 
-  if (!push_result.ok()) {
+bool NicDriver::free_tx_buffer(const TxBuffer& buffer) {
+  NIC_TRACE_SCOPED(__func__);
+  QueueState* queue = owned_queue(buffer.queue_id);
+  if (queue == nullptr) {
     return false;
   }
+  return queue->tx_buffers.release(buffer.index);
+}
+
+std::size_t NicDriver::reclaim_tx(QueueState& queue) {
+  NIC_TRACE_SCOPED(__func__);
 
-  // Update stats
-  stats_.tx_packets++;
-  stats_.tx_bytes += packet.size();
+  std::size_t reclaimed = 0;
+  auto& completions = queue.queue_pair->tx_completion();
+  while (auto entry = completions.poll_completion()) {
+    if (queue.tx_buffers.release(entry->descriptor_index)) {
+      ++reclaimed;
+    }
+  }
+  queue.stats.tx_completions += reclaimed;
+  return reclaimed;
+}
 
-  return true;
+std::size_t NicDriver::reclaim_tx_buffers() {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_) {
+    return 0;
+  }
+
+  std::size_t reclaimed = 0;
+  for (auto& queue : queues_) {
+    if (accessible(*queue)) {
+      reclaimed += reclaim_tx(*queue);
+    }
+  }
+  return reclaimed;
+}
+
+std::size_t NicDriver::reclaim_tx_buffers(std::uint16_t queue_id) {
+  NIC_TRACE_SCOPED(__func__);
+  QueueState* queue = owned_queue(queue_id);
+  return (queue == nullptr) ? 0 : reclaim_tx(*queue);
+}
+
+std::size_t NicDriver::tx_buffers_available() const {
+  NIC_TRACE_SCOPED(__func__);
+  return tx_buffers_available(0);
+}
+
+std::size_t NicDriver::tx_buffers_available(std::uint16_t queue_id) const {
+  NIC_TRACE_SCOPED(__func__);
+  return (queue_id < queues_.size()) ? queues_[queue_id]->tx_buffers.available() : 0;
+}
+
+std::size_t NicDriver::alloc_tx_buffers(std::span<TxBuffer> out) {
+  NIC_TRACE_SCOPED(__func__);
+  return alloc_tx_buffers(0, out);
+}
+
+std::size_t NicDriver::alloc_tx_buffers(std::uint16_t queue_id, std::span<TxBuffer> out) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::size_t count = 0;
+  while (count < out.size()) {
+    auto buffer = alloc_tx_buffer(queue_id);
+    if (!buffer) {
+      break;
+    }
+    out[count++] = *buffer;
+  }
+  return count;
+}
+
+std::size_t NicDriver::send_burst(std::span<const PacketRef> packets) {
+  NIC_TRACE_SCOPED(__func__);
+  return send_burst(0, packets);
+}
+
+std::size_t NicDriver::send_burst(std::uint16_t queue_id, std::span<const PacketRef> packets) {
+  NIC_TRACE_SCOPED(__func__);
+  QueueState* queue = owned_queue(queue_id);
+  if (queue == nullptr) {
+    return 0;
+  }
+
+  reclaim_tx(*queue);
+  std::size_t sent = 0;
+  for (const PacketRef& packet : packets) {
+    if ((packet.buffer.queue_id != queue_id) || !send_buffer(packet.buffer, packet.length)) {
+      break;
+    }
+    ++sent;
+  }
+  return sent;
+}
+
+std::size_t NicDriver::receive_burst(std::span<RxPacketView> out) {
+  NIC_TRACE_SCOPED(__func__);
+  return receive_burst(0, out);
+}
+
+std::size_t NicDriver::receive_burst(std::uint16_t queue_id, std::span<RxPacketView> out) {
+  NIC_TRACE_SCOPED(__func__);
+  QueueState* queue = owned_queue(queue_id);
+  if (queue == nullptr) {
+    return 0;
+  }
+
+  BufferPool& pool = queue->rx_buffers;
+  if (pool.capacity() == 0) {
+    return 0;
+  }
+
+  // The views handed out last time are now stale; their buffers go back to the pool
+  for (std::uint32_t index : queue->rx_held) {
+    pool.release(index);
+  }
+  queue->rx_held.clear();
+  reclaim_tx(*queue);
+
+  auto& completions = queue->queue_pair->rx_completion();
+  std::size_t count = 0;
+  while (count < out.size()) {
+    auto entry = completions.poll_completion();
+    if (!entry) {
+      break;
+    }
+    std::uint32_t index = entry->descriptor_index;
+    if (!pool.in_use(index)) {
+      continue;
+    }
+    const auto& host_memory = device_->host_memory();
+    nic::ConstHostMemoryView view;
+    bool ok = entry->status == static_cast<std::uint32_t>(nic::CompletionCode::Success);
+    ok = ok && host_memory.translate_const(pool.address(index), entry->byte_count, view).ok();
+    if (!ok) {
+      ++queue->stats.rx_errors;
+      pool.release(index);
+      continue;
+    }
+    out[count++] = RxPacketView{.data = std::span<const std::byte>(view.data, view.length),
+                                .address = view.address,
+                                .queue_id = entry->queue_id,
+                                .vlan_tag = entry->vlan_tag,
+                                .vlan_stripped = entry->vlan_stripped,
+                                .checksum_verified = entry->checksum_verified};
+    queue->rx_held.push_back(index);
+  }
+
+  refill_rx(*queue);
+  sync_rx_stats(*queue);
+  return count;
+}
+
+void NicDriver::sync_rx_stats(QueueState& queue) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto qp_stats = queue.queue_pair->stats();
+  queue.stats.rx_packets = qp_stats.rx_packets;
+  queue.stats.rx_bytes = qp_stats.rx_bytes;
+}
+
+void NicDriver::sync_queues() {
+  NIC_TRACE_SCOPED(__func__);
+
+  for (auto& queue : queues_) {
+    if (accessible(*queue)) {
+      sync_rx_stats(*queue);
+      reclaim_tx(*queue);
+    }
+  }
+}
+
+std::size_t NicDriver::process_burst(std::size_t budget) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_ || !claim_queues()) {
+    return 0;
+  }
+
+  std::size_t processed = 0;
+  while ((processed < budget) && process_device_once()) {
+    ++processed;
+  }
+  if (processed != 0) {
+    stats_.processed += processed;
+    sync_queues();
+  }
+  release_queues(queues_.size());
+  return processed;
+}
+
+std::size_t NicDriver::process_burst(std::uint16_t queue_id, std::size_t budget) {
+  NIC_TRACE_SCOPED(__func__);
+  QueueState* queue = owned_queue(queue_id);
+  if (queue == nullptr) {
+    return 0;
+  }
+
+  auto* queue_manager = device_->queue_manager();
+  std::size_t processed = 0;
+  while (processed < budget) {
+    bool work_done = (queue_manager != nullptr) ? queue_manager->process_queue(queue_id)
+                                                : queue->queue_pair->process_once();
+    if (!work_done) {
+      break;
+    }
+    ++processed;
+  }
+  if (processed != 0) {
+    queue->stats.processed += processed;
+    sync_rx_stats(*queue);
+    reclaim_tx(*queue);
+  }
+  return processed;
+}
+
+bool NicDriver::process_device_once() {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Queue-manager devices have no single queue pair; run their weighted scheduler instead
+  auto* queue_manager = device_->queue_manager();
+  return (queue_manager != nullptr) ? queue_manager->process_once()
+                                    : device_->process_queue_once();
 }
 
 bool NicDriver::process() {
   NIC_TRACE_SCOPED(__func__);
-  if (!initialized_ || !device_) {
+  if (!initialized_ || !device_ || !claim_queues()) {
     return false;
   }
 
   // Process the device (this moves packets from TX to RX)
-  bool work_done = device_->process_queue_once();
+  bool work_done = process_device_once();
 
   if (work_done) {
     stats_.processed++;
-
-    // Update stats from device queue pair
-    auto* qp = device_->queue_pair();
-    if (qp) {
-      auto qp_stats = qp->stats();
-      stats_.rx_packets = qp_stats.rx_packets;
-      stats_.rx_bytes = qp_stats.rx_bytes;
-    }
+    sync_queues();
   }
 
+  release_queues(queues_.size());
   return work_done;
 }
 
@@ -131,18 +563,32 @@ NicDriver::Stats NicDriver::get_stats() const {
   NIC_TRACE_SCOPED(__func__);
   // Return our locally tracked stats
   // Note: In a real driver, might sync certain stats from hardware counters
-  return stats_;
+  Stats total = stats_;
+  for (const auto& queue : queues_) {
+    total.tx_packets += queue->stats.tx_packets;
+    total.tx_bytes += queue->stats.tx_bytes;
+    total.rx_packets += queue->stats.rx_packets;
+    total.rx_bytes += queue->stats.rx_bytes;
+    total.processed += queue->stats.processed;
+    total.tx_completions += queue->stats.tx_completions;
+    total.tx_no_buffer += queue->stats.tx_no_buffer;
+    total.rx_errors += queue->stats.rx_errors;
+  }
+  return total;
+}
+
+NicDriver::Stats NicDriver::queue_stats(std::uint16_t queue_id) const {
+  NIC_TRACE_SCOPED(__func__);
+  return (queue_id < queues_.size()) ? queues_[queue_id]->stats : Stats{};
 }
 
 void NicDriver::clear_stats() {
   NIC_TRACE_SCOPED(__func__);
   stats_ = Stats{};
 
-  if (initialized_ && device_) {
-    auto* qp = device_->queue_pair();
-    if (qp) {
-      qp->reset_stats();
-    }
+  for (auto& queue : queues_) {
+    queue->stats = Stats{};
+    queue->queue_pair->reset_stats();
   }
 }
 
@@ -173,7 +619,7 @@ std::optional<PdHandle> NicDriver::create_pd() {
   if (!result) {
     return std::nullopt;
   }
-  NIC_LOGF_INFO("driver create_pd: handle={}", *result);
+  NIC_LOGF_DEBUG("driver create_pd: handle={}", *result);
   return PdHandle{*result};
 }
 
@@ -216,14 +662,35 @@ std::optional<MrHandle> NicDriver::register_mr(PdHandle pd,
     return std::nullopt;
   }
 
-  NIC_LOGF_INFO("driver register_mr: lkey={:#x} rkey={:#x} addr={:#x} len={}",
-                mr->lkey,
-                mr->rkey,
-                virtual_address,
-                length);
+  NIC_LOGF_DEBUG("driver register_mr: lkey={:#x} rkey={:#x} addr={:#x} len={}",
+                 mr->lkey,
+                 mr->rkey,
+                 virtual_address,
+                 length);
   return MrHandle{mr->lkey, mr->rkey};
 }
 
+std::vector<MrHandle> NicDriver::register_mrs(PdHandle pd, std::span<const RdmaMrRegion> regions) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return {};
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return {};
+  }
+
+  std::vector<std::uint32_t> lkeys = engine->register_mrs(pd.value, regions);
+  std::vector<MrHandle> handles;
+  handles.reserve(lkeys.size());
+  for (std::uint32_t lkey : lkeys) {
+    const auto* mr = engine->mr_table().get_by_lkey(lkey);
+    handles.push_back(MrHandle{lkey, mr->rkey});
+  }
+  return handles;
+}
+
 bool NicDriver::deregister_mr(MrHandle mr) {
   NIC_TRACE_SCOPED(__func__);
   if (!initialized_ || !device_) {
@@ -238,7 +705,7 @@ bool NicDriver::deregister_mr(MrHandle mr) {
   return engine->deregister_mr(mr.lkey);
 }
 
-std::optional<CqHandle> NicDriver::create_cq(std::size_t depth) {
+std::optional<AhHandle> NicDriver::create_ah(PdHandle pd, const RdmaAhAttr& attr) {
   NIC_TRACE_SCOPED(__func__);
   if (!initialized_ || !device_) {
     return std::nullopt;
@@ -249,7 +716,59 @@ std::optional<CqHandle> NicDriver::create_cq(std::size_t depth) {
     return std::nullopt;
   }
 
-  auto result = engine->create_cq(depth);
+  auto result = engine->create_ah(pd.value, attr);
+  if (!result) {
+    return std::nullopt;
+  }
+  return AhHandle{*result};
+}
+
+bool NicDriver::destroy_ah(AhHandle ah) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return false;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return false;
+  }
+
+  return engine->destroy_ah(ah.value);
+}
+
+std::optional<CqHandle> NicDriver::create_cq(std::size_t depth,
+                                             std::optional<std::uint64_t> host_ring_address,
+                                             std::uint16_t comp_vector) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return std::nullopt;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return std::nullopt;
+  }
+
+  auto result = engine->create_cq(depth, host_ring_address, comp_vector);
+  if (!result) {
+    return std::nullopt;
+  }
+  return CqHandle{*result};
+}
+
+std::optional<CqHandle> NicDriver::create_cq(const RdmaCqConfig& config) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return std::nullopt;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return std::nullopt;
+  }
+
+  auto result = engine->create_cq(config);
   if (!result) {
     return std::nullopt;
   }
@@ -284,6 +803,179 @@ std::vector<RdmaCqe> NicDriver::poll_cq(CqHandle cq, std::size_t max_cqes) {
   return engine->poll_cq(cq.value, max_cqes);
 }
 
+std::size_t NicDriver::poll_cq(CqHandle cq, std::span<RdmaCqe> out) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return 0;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return 0;
+  }
+
+  return engine->poll_cq(cq.value, out);
+}
+
+bool NicDriver::req_notify_cq(CqHandle cq, bool solicited_only) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return false;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return false;
+  }
+
+  return engine->arm_cq(cq.value, solicited_only);
+}
+
+bool NicDriver::modify_cq(CqHandle cq, const RdmaCqModeration& moderation) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return false;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return false;
+  }
+
+  return engine->modify_cq(cq.value, moderation);
+}
+
+std::vector<RdmaCqEvent> NicDriver::poll_cq_events(std::size_t max_events) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return {};
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return {};
+  }
+
+  return engine->poll_cq_events(max_events);
+}
+
+std::optional<RdmaCqEvent> NicDriver::get_cq_event(std::uint64_t timeout_us,
+                                                   const std::function<void()>& progress,
+                                                   std::uint64_t step_us) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return std::nullopt;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return std::nullopt;
+  }
+
+  // The model has no threads to sleep on: waiting means letting simulated time pass
+  std::uint64_t waited_us = 0;
+  while (true) {
+    if (progress) {
+      progress();
+    }
+    auto events = engine->poll_cq_events(1);
+    if (!events.empty()) {
+      return events.front();
+    }
+    if (waited_us >= timeout_us) {
+      return std::nullopt;
+    }
+    std::uint64_t remaining_us = timeout_us - waited_us;
+    std::uint64_t step = step_us;
+    if (step == 0) {
+      // Traffic in flight needs more progress rounds, so time moves in small steps.
+      // Otherwise nothing can change before the next timer fires.
+      if (progress && engine->has_traffic_in_flight()) {
+        step = 1;
+      } else {
+        step = engine->time_to_next_timer_us().value_or(remaining_us);
+      }
+    }
+    step = std::clamp<std::uint64_t>(step, 1, remaining_us);
+    engine->advance_time(step);
+    waited_us += step;
+  }
+}
+
+std::optional<SrqHandle> NicDriver::create_srq(std::size_t depth, std::size_t limit) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return std::nullopt;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return std::nullopt;
+  }
+
+  auto result = engine->create_srq(depth, limit);
+  if (!result) {
+    return std::nullopt;
+  }
+  return SrqHandle{*result};
+}
+
+bool NicDriver::destroy_srq(SrqHandle srq) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return false;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return false;
+  }
+
+  return engine->destroy_srq(srq.value);
+}
+
+bool NicDriver::arm_srq(SrqHandle srq, std::size_t limit) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return false;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return false;
+  }
+
+  return engine->arm_srq(srq.value, limit);
+}
+
+bool NicDriver::post_srq_recv(SrqHandle srq, const RecvWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return false;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return false;
+  }
+
+  return engine->post_srq_recv(srq.value, wqe);
+}
+
+std::vector<RdmaAsyncEvent> NicDriver::poll_async_events(std::size_t max_events) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return {};
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return {};
+  }
+
+  return engine->poll_async_events(max_events);
+}
+
 std::optional<QpHandle> NicDriver::create_qp(const RdmaQpConfig& config) {
   NIC_TRACE_SCOPED(__func__);
   if (!initialized_ || !device_) {
@@ -299,10 +991,30 @@ std::optional<QpHandle> NicDriver::create_qp(const RdmaQpConfig& config) {
   if (!result) {
     return std::nullopt;
   }
-  NIC_LOGF_INFO("driver create_qp: handle={}", *result);
+  NIC_LOGF_DEBUG("driver create_qp: handle={}", *result);
   return QpHandle{*result};
 }
 
+std::vector<QpHandle> NicDriver::create_qps(std::span<const RdmaQpConfig> configs) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return {};
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return {};
+  }
+
+  std::vector<std::uint32_t> qp_numbers = engine->create_qps(configs);
+  std::vector<QpHandle> handles;
+  handles.reserve(qp_numbers.size());
+  for (std::uint32_t qp_number : qp_numbers) {
+    handles.push_back(QpHandle{qp_number});
+  }
+  return handles;
+}
+
 bool NicDriver::destroy_qp(QpHandle qp) {
   NIC_TRACE_SCOPED(__func__);
   if (!initialized_ || !device_) {
@@ -331,6 +1043,26 @@ bool NicDriver::modify_qp(QpHandle qp, const RdmaQpModifyParams& params) {
   return engine->modify_qp(qp.value, params);
 }
 
+std::size_t NicDriver::modify_qps(std::span<const QpHandle> qps,
+                                  std::span<const RdmaQpModifyParams> params) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return 0;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return 0;
+  }
+
+  std::vector<std::uint32_t> qp_numbers;
+  qp_numbers.reserve(qps.size());
+  for (QpHandle qp : qps) {
+    qp_numbers.push_back(qp.value);
+  }
+  return engine->modify_qps(qp_numbers, params);
+}
+
 bool NicDriver::post_send(QpHandle qp, const SendWqe& wqe) {
   NIC_TRACE_SCOPED(__func__);
   if (!initialized_ || !device_) {
@@ -345,6 +1077,58 @@ bool NicDriver::post_send(QpHandle qp, const SendWqe& wqe) {
   return engine->post_send(qp.value, wqe);
 }
 
+bool NicDriver::post_send_doorbell(QpHandle qp, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+  return post_send_ring(qp, wqe, false);
+}
+
+bool NicDriver::post_send_blueflame(QpHandle qp, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+  return post_send_ring(qp, wqe, true);
+}
+
+bool NicDriver::post_send_ring(QpHandle qp, const SendWqe& wqe, bool blueflame) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return false;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return false;
+  }
+
+  const auto* ring = engine->query_sq_ring(qp.value);
+  if (ring == nullptr) {
+    return false;
+  }
+
+  auto entry = nic::rocev2::encode_sq_wqe(wqe, qp.value);
+  if (!entry || (ring->pending() >= ring->depth())) {
+    return false;
+  }
+
+  // The ring copy is always written; BlueFlame only saves the device from fetching it
+  std::uint32_t producer_index = ring->producer_index();
+  std::array<std::byte, nic::rocev2::kSqWqeSize> slot{};
+  std::memcpy(slot.data(), static_cast<const void*>(&*entry), slot.size());
+  if (!device_->host_memory().write(ring->slot_address(producer_index), slot).ok()) {
+    return false;
+  }
+
+  std::uint64_t posted_before = engine->stats().send_wqes_posted;
+  if (blueflame) {
+    device_->write_doorbell(nic::rocev2::kRdmaBlueFlameOffset, slot);
+  } else {
+    nic::rocev2::RdmaSqDoorbell doorbell{.qp_number = qp.value,
+                                         .producer_index = producer_index + 1};
+    std::array<std::byte, sizeof(doorbell)> record{};
+    std::memcpy(record.data(), static_cast<const void*>(&doorbell), record.size());
+    device_->write_doorbell(nic::rocev2::kRdmaSqDoorbellOffset, record);
+  }
+  return engine->stats().send_wqes_posted > posted_before;
+}
+
 bool NicDriver::post_recv(QpHandle qp, const RecvWqe& wqe) {
   NIC_TRACE_SCOPED(__func__);
   if (!initialized_ || !device_) {
@@ -359,6 +1143,34 @@ bool NicDriver::post_recv(QpHandle qp, const RecvWqe& wqe) {
   return engine->post_recv(qp.value, wqe);
 }
 
+std::size_t NicDriver::post_send_list(QpHandle qp, std::span<const SendWqe> wqes) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return 0;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return 0;
+  }
+
+  return engine->post_send_list(qp.value, wqes);
+}
+
+std::size_t NicDriver::post_recv_list(QpHandle qp, std::span<const RecvWqe> wqes) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!initialized_ || !device_) {
+    return 0;
+  }
+
+  auto* engine = device_->rdma_engine();
+  if (!engine) {
+    return 0;
+  }
+
+  return engine->post_recv_list(qp.value, wqes);
+}
+
 std::vector<OutgoingPacket> NicDriver::rdma_generate_packets() {
   NIC_TRACE_SCOPED(__func__);
   if (!initialized_ || !device_) {
@@ -50,6 +50,12 @@ bool PacketRouter::route_packet(const nic::rocev2::OutgoingPacket& packet, IpAdd
     return false;
   }
 
+  if (!path_packets_.empty()) {
+    std::size_t path = ecmp_path(
+        src_ip, packet.dest_ip, packet.src_port, packet.dest_port, path_packets_.size());
+    ++path_packets_[path];
+  }
+
   // Deliver the packet to the destination driver
   return dest_driver->rdma_process_packet(
       std::span<const std::byte>(packet.data.data(), packet.data.size()),
@@ -89,6 +95,36 @@ std::size_t PacketRouter::process_all() {
   return total_routed;
 }
 
+void PacketRouter::set_ecmp_paths(std::size_t path_count) {
+  NIC_TRACE_SCOPED(__func__);
+
+  path_packets_.assign(path_count, 0);
+}
+
+std::size_t PacketRouter::ecmp_path(IpAddress src_ip,
+                                    IpAddress dest_ip,
+                                    std::uint16_t src_port,
+                                    std::uint16_t dest_port,
+                                    std::size_t path_count) noexcept {
+  // FNV-1a over the 5-tuple; the protocol is always UDP
+  std::uint32_t hash = 2166136261U;
+  auto mix = [&hash](std::uint8_t octet) {
+    hash ^= octet;
+    hash *= 16777619U;
+  };
+  for (std::uint8_t octet : src_ip) {
+    mix(octet);
+  }
+  for (std::uint8_t octet : dest_ip) {
+    mix(octet);
+  }
+  mix(static_cast<std::uint8_t>(src_port >> 8));
+  mix(static_cast<std::uint8_t>(src_port));
+  mix(static_cast<std::uint8_t>(dest_port >> 8));
+  mix(static_cast<std::uint8_t>(dest_port));
+  return hash % path_count;
+}
+
 NicDriver* PacketRouter::find_driver(IpAddress ip) {
   NIC_TRACE_SCOPED(__func__);
 
@@ -23,6 +23,7 @@ struct CompletionEntry {
   bool gro_aggregated{false};
   std::uint16_t segments_produced{1};
   std::uint16_t vlan_tag{0};
+  std::uint32_t byte_count{0};  ///< RX: frame bytes written to the buffer
 };
 
 struct CompletionQueueConfig {
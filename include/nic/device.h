@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -105,6 +106,11 @@ public:
   [[nodiscard]] std::uint32_t read_register(std::uint32_t offset) const noexcept;
   void write_register(std::uint32_t offset, std::uint32_t value);
 
+  // Doorbell page access (BAR2 MMIO)
+  /// Write to the doorbell page: an RdmaSqDoorbell at kRdmaSqDoorbellOffset, or a whole
+  /// RdmaSqWqe at kRdmaBlueFlameOffset. Returns true if the write hit a doorbell register.
+  bool write_doorbell(std::uint32_t offset, std::span<const std::byte> data);
+
   // Direct access for testing/debugging
   [[nodiscard]] const ConfigSpace& config_space() const noexcept { return config_space_; }
   [[nodiscard]] const RegisterFile& register_file() const noexcept { return register_file_; }
@@ -152,6 +158,15 @@ public:
   /// Process one descriptor from the TX/RX queue pair. Returns true if work was done.
   bool process_queue_once();
 
+  /// Move the RDMA engine's outgoing frames onto the queue manager's RoCE traffic class,
+  /// where they compete with the Ethernet queues for the port. Needs rdma_config.encap.
+  /// @return Number of frames queued.
+  std::size_t queue_rdma_egress();
+
+  /// Receive a frame from the port. UDP/4791 frames are classified to the RDMA engine;
+  /// other frames land in the RX ring of queue_index. Returns false if dropped.
+  bool receive_frame(std::span<const std::byte> frame, std::size_t queue_index = 0);
+
 private:
   DeviceConfig config_;
   DeviceState state_{DeviceState::Uninitialized};
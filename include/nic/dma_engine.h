@@ -45,6 +45,8 @@ public:
                                        DmaDirection direction,
                                        std::span<std::byte> buffer);
 
+  /// Counters are updated atomically, so queues on different threads may share the
+  /// engine; read or reset them only while no transfer is in progress.
   [[nodiscard]] const DmaCounters& counters() const noexcept { return counters_; }
   void reset_counters() noexcept { counters_ = DmaCounters{}; }
 
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <mutex>
 #include <optional>
 #include <unordered_map>
 #include <vector>
@@ -43,6 +44,8 @@ struct InterruptStats {
 };
 
 /// Simple dispatcher that maps queue/admin events to MSI-X vectors and coalesces them.
+/// Thread-safe: queues run from different threads share one dispatcher, so every call takes
+/// an internal lock. The deliver callback runs under that lock and must not call back in.
 class InterruptDispatcher {
 public:
   using DeliverFn = std::function<void(std::uint16_t vector_id, std::uint32_t batch_size)>;
@@ -53,6 +56,9 @@ public:
                       DeliverFn deliver);
 
   bool on_completion(const InterruptEvent& ev);
+  /// Fire a vector directly for a source that moderates its own events (RDMA CQs).
+  /// Returns true if the interrupt was delivered (vector valid, enabled and unmasked).
+  bool raise_vector(std::uint16_t vector_id);
   void flush(std::optional<std::uint16_t> vector_id = std::nullopt);
   void on_timer_tick(std::uint32_t elapsed_us);
 
@@ -66,9 +72,9 @@ public:
   void clear_queue_coalesce_config(std::uint16_t queue_id) noexcept;
 
   void set_adaptive_config(const AdaptiveConfig& config) noexcept;
-  [[nodiscard]] const AdaptiveConfig& adaptive_config() const noexcept { return adaptive_; }
+  [[nodiscard]] AdaptiveConfig adaptive_config() const;
 
-  [[nodiscard]] const InterruptStats& stats() const noexcept { return stats_; }
+  [[nodiscard]] InterruptStats stats() const;
 
 private:
   struct AdaptiveState {
@@ -77,6 +83,7 @@ private:
     std::uint32_t current_threshold{1};  ///< Current adaptive threshold
   };
 
+  mutable std::mutex mutex_;  // Guards all state below
   MsixTable table_;
   MsixMapping mapping_;
   CoalesceConfig coalesce_;
@@ -88,7 +95,7 @@ private:
   std::unordered_map<std::uint16_t, CoalesceConfig> per_queue_coalesce_;
   std::unordered_map<std::uint16_t, AdaptiveState> adaptive_state_;
 
-  void try_fire(std::uint16_t vector_id);
+  bool try_fire(std::uint16_t vector_id);
   void update_adaptive_threshold(std::uint16_t vector_id, std::uint32_t batch_size) noexcept;
   [[nodiscard]] std::optional<std::uint16_t> resolve_vector(std::uint16_t queue_id) const noexcept;
   [[nodiscard]] const CoalesceConfig& get_coalesce_config(std::uint16_t queue_id) const noexcept;
@@ -2,17 +2,31 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
+#include "nic/flow_control.h"
 #include "nic/queue_pair.h"
 
 namespace nic {
 
+/// RoCEv2 traffic class sharing the port scheduler with the Ethernet queues.
+struct RoceTrafficClassConfig {
+  bool enabled{false};                  ///< Schedule RoCEv2 frames alongside the Ethernet queues
+  std::uint8_t priority{3};             ///< 802.1p priority (PFC class) of RoCE traffic
+  std::uint8_t weight{1};               ///< Scheduler weight (>=1)
+  std::size_t max_queued_frames{1024};  ///< Egress buffer depth; further frames are tail-dropped
+};
+
 struct QueueManagerConfig {
   std::vector<QueuePairConfig> queue_configs;
+  RoceTrafficClassConfig roce{};
+  PFCManager* pfc{nullptr};  ///< Optional; the scheduler skips queues whose priority is paused
 };
 
 struct QueueManagerStats {
@@ -31,6 +45,11 @@ struct QueueManagerStats {
   std::uint64_t total_rx_gro_aggregated{0};
   std::uint64_t scheduler_advances{0};
   std::uint64_t scheduler_skips{0};
+  std::uint64_t pfc_paused_skips{0};  ///< Scheduler turns lost to a PFC-paused priority
+  std::uint64_t roce_tx_frames{0};
+  std::uint64_t roce_tx_bytes{0};
+  std::uint64_t roce_rx_frames{0};         ///< RX frames classified to the RoCE handler
+  std::uint64_t roce_drops_queue_full{0};  ///< RoCE frames tail-dropped at enqueue
 };
 
 /// Manages multiple queue pairs and aggregates stats.
@@ -48,9 +67,33 @@ public:
 
   [[nodiscard]] std::optional<QueuePairStats> queue_stats(std::size_t index) const noexcept;
 
-  /// Process one descriptor across queues (simple round-robin).
+  /// Process one descriptor or RoCE frame across queues (weighted round-robin).
   bool process_once();
 
+  /// Process one descriptor of a single queue, bypassing the scheduler. Besides its own queue
+  /// pair it touches only the DMA engine counters and the interrupt dispatcher, both safe to
+  /// share, so each queue may be driven from its own thread. It reads the PFC pause state
+  /// unlocked, and must not run concurrently with process_once(), which walks every queue.
+  /// Returns false if the queue is idle, PFC-paused or out of range.
+  bool process_queue(std::size_t index);
+
+  using FrameHandler = std::function<void(std::span<const std::byte>)>;
+
+  /// Queue a frame on the RoCE traffic class.
+  /// Returns false if the class is disabled or its buffer is full.
+  bool enqueue_roce_frame(std::vector<std::byte> frame);
+  [[nodiscard]] std::size_t roce_queue_depth() const noexcept { return roce_frames_.size(); }
+
+  /// Set where scheduled RoCE frames leave the port.
+  void set_roce_egress(FrameHandler handler) { roce_egress_ = std::move(handler); }
+
+  /// Set the receiver of UDP/4791 frames classified off the RX path.
+  void set_roce_ingress(FrameHandler handler) { roce_ingress_ = std::move(handler); }
+
+  /// Receive a frame from the port. RoCEv2 frames go to the RoCE ingress handler when one is
+  /// set; other frames land in the RX ring of queue_index. Returns false if dropped.
+  bool receive_frame(std::span<const std::byte> frame, std::size_t queue_index = 0);
+
   void reset();
 
   [[nodiscard]] QueueManagerStats stats() const;
@@ -65,7 +108,20 @@ private:
   std::vector<std::uint8_t> weights_;
   std::uint64_t scheduler_advances_{0};
   std::uint64_t scheduler_skips_{0};
-
+  std::uint64_t pfc_paused_skips_{0};
+
+  // RoCE traffic class: the scheduler slot after the last Ethernet queue
+  std::deque<std::vector<std::byte>> roce_frames_;
+  FrameHandler roce_egress_;
+  FrameHandler roce_ingress_;
+  std::uint64_t roce_tx_frames_{0};
+  std::uint64_t roce_tx_bytes_{0};
+  std::uint64_t roce_rx_frames_{0};
+  std::uint64_t roce_drops_queue_full_{0};
+
+  [[nodiscard]] bool is_paused(std::uint8_t priority) const noexcept;
+  bool process_slot(std::size_t slot);
+  bool transmit_roce_frame();
   void aggregate_stats(QueueManagerStats& out) const;
 };
 
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -32,6 +33,7 @@ struct QueuePairConfig {
   std::size_t max_mtu{kJumboMtu};    ///< Maximum supported MTU
   bool enable_tx_interrupts{false};  ///< Fire interrupts on TX completions
   bool enable_rx_interrupts{true};   ///< Fire interrupts on RX completions
+  std::uint8_t priority{0};          ///< 802.1p priority; PFC pauses of it stall TX
 };
 
 struct QueuePairStats {
@@ -61,6 +63,7 @@ public:
   QueuePair(const QueuePair&) = delete;
   QueuePair& operator=(const QueuePair&) = delete;
 
+  [[nodiscard]] const QueuePairConfig& config() const noexcept { return config_; }
   [[nodiscard]] DescriptorRing& tx_ring() noexcept;
   [[nodiscard]] DescriptorRing& rx_ring() noexcept;
   [[nodiscard]] CompletionQueue& tx_completion() noexcept;
@@ -73,6 +76,10 @@ public:
   /// Process a single TX descriptor and loop back to RX (returns true if work was done).
   bool process_once();
 
+  /// Deliver a frame received from the port into the next RX descriptor.
+  /// Returns false if the frame was dropped.
+  bool receive_frame(std::span<const std::byte> frame);
+
   [[nodiscard]] const QueuePairStats& stats() const noexcept { return stats_; }
   [[nodiscard]] std::string stats_summary() const;
   void reset_stats() noexcept { stats_ = QueuePairStats{}; }
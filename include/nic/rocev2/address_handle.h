@@ -0,0 +1,29 @@
+#pragma once
+
+/// @file address_handle.h
+/// @brief Address handles for Unreliable Datagram sends.
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "nic/rocev2/types.h"
+
+namespace nic::rocev2 {
+
+/// Address handle attributes - the network path to a remote UD endpoint.
+struct RdmaAhAttr {
+  std::array<std::uint8_t, 4> dest_ip{};        // Destination IPv4 address
+  std::uint16_t dest_port{kRoceUdpPort};        // Destination UDP port
+  MacAddress dest_mac{};                        // Next-hop MAC (used when encapsulation is enabled)
+  std::optional<std::uint8_t> traffic_class{};  // DSCP/ECN override (nullopt = engine default)
+};
+
+/// Address handle - referenced per-WQE by UD sends.
+struct AddressHandle {
+  std::uint32_t ah_handle{0};
+  std::uint32_t pd_handle{0};
+  RdmaAhAttr attr{};
+};
+
+}  // namespace nic::rocev2
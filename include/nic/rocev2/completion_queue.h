@@ -3,19 +3,37 @@
 /// @file completion_queue.h
 /// @brief RDMA Completion Queue for RoCEv2.
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
-#include <deque>
+#include <cstring>
 #include <optional>
+#include <span>
+#include <type_traits>
 #include <vector>
 
+#include "nic/host_memory.h"
 #include "nic/rocev2/cqe.h"
 #include "nic/trace.h"
 
 namespace nic::rocev2 {
 
+/// Moderation of a CQ's completion events. With both fields zero every qualifying CQE
+/// raises an event; otherwise the event waits for cq_count CQEs or for cq_period_us after
+/// the first one, whichever comes first.
+struct RdmaCqModeration {
+  std::uint16_t cq_count{0};      // CQEs per event (0 = no count limit)
+  std::uint16_t cq_period_us{0};  // Longest wait after the first pending CQE (0 = no timer)
+};
+
 /// Completion Queue configuration.
 struct RdmaCqConfig {
-  std::size_t depth{256};  // Maximum number of CQEs
+  std::size_t depth{256};  // Requested CQEs; rounded up to a power of two
+  /// Place the CQE ring in host memory at this address (nullopt = in-model storage).
+  std::optional<HostAddress> host_ring_address{};
+  std::uint16_t comp_vector{0};  // MSI-X vector raised by completion events
+  RdmaCqModeration moderation{};
+  bool compression{false};  // Pack runs of similar CQEs into mini-CQE blocks
 };
 
 /// Completion Queue statistics.
@@ -24,18 +42,89 @@ struct RdmaCqStats {
   std::uint64_t cqes_polled{0};
   std::uint64_t overflows{0};
   std::uint64_t arm_count{0};
+  std::uint64_t events{0};  // Completion events raised while armed
+  std::uint64_t host_access_errors{0};
+  std::uint64_t bytes_written{0};    // Ring bytes written by the producer
+  std::uint64_t compressed_cqes{0};  // CQEs written as mini-CQEs
+  std::uint64_t mini_blocks{0};      // Ring slots holding mini-CQEs
+
+  /// Get the ring bytes written per posted CQE.
+  [[nodiscard]] double bytes_per_cqe() const noexcept {
+    if (cqes_posted == 0) {
+      return 0.0;
+    }
+    return static_cast<double>(bytes_written) / static_cast<double>(cqes_posted);
+  }
+};
+
+/// Slot formats of a CQ ring.
+inline constexpr std::uint8_t kCqeFormatFull = 0;       // One full CQE
+inline constexpr std::uint8_t kCqeFormatMiniBlock = 1;  // Mini-CQEs of the last full CQE
+
+/// Compressed completion: the fields of a CQE that differ from its title, the last
+/// full CQE written to the ring. Every other field is copied from the title.
+struct RdmaMiniCqe {
+  std::uint32_t bytes_completed{0};
+  std::uint32_t wr_id_delta{0};  // wr_id minus the title's wr_id
 };
 
-/// RDMA Completion Queue - holds completed work requests.
+/// Mini-CQEs carried by one mini block slot, in place of its full CQE.
+inline constexpr std::size_t kMiniCqesPerSlot = sizeof(RdmaCqe) / sizeof(RdmaMiniCqe);
+
+static_assert(std::is_trivially_copyable_v<RdmaCqe>);
+static_assert(std::is_trivially_copyable_v<RdmaMiniCqe>);
+
+/// One CQ ring slot as laid out in memory: the CQE followed by its owner bit.
+/// The owner bit written by the producer equals the ring pass parity, so a slot
+/// belongs to software once its owner bit matches the consumer's expected phase.
+/// The payload is raw bytes, so mini-CQEs never land in an RdmaCqe's bool and enum
+/// members; the CQE or mini-CQEs are copied in and out explicitly.
+struct RdmaCqeSlot {
+  // Full CQE, or mini_count RdmaMiniCqe for a mini block
+  alignas(RdmaCqe) std::array<std::byte, sizeof(RdmaCqe)> payload{};
+  std::uint8_t owner{1};  // Initialized to hardware-owned for the first pass
+  std::uint8_t format{kCqeFormatFull};
+  std::uint8_t mini_count{0};
+
+  void store_cqe(const RdmaCqe& cqe) noexcept {
+    std::memcpy(payload.data(), static_cast<const void*>(&cqe), sizeof(RdmaCqe));
+  }
+  [[nodiscard]] RdmaCqe load_cqe() const noexcept {
+    RdmaCqe cqe;
+    std::memcpy(static_cast<void*>(&cqe), payload.data(), sizeof(RdmaCqe));
+    return cqe;
+  }
+  void store_minis(std::span<const RdmaMiniCqe> minis) noexcept {
+    std::memcpy(payload.data(), minis.data(), minis.size_bytes());
+  }
+  void load_minis(std::span<RdmaMiniCqe> minis) const noexcept {
+    std::memcpy(minis.data(), payload.data(), minis.size_bytes());
+  }
+};
+
+/// Stride between consecutive CQE slots in a host-resident ring.
+inline constexpr std::size_t kCqeSlotSize = sizeof(RdmaCqeSlot);
+
+/// RDMA Completion Queue - fixed-capacity ring of completed work requests.
 class RdmaCompletionQueue {
 public:
-  explicit RdmaCompletionQueue(std::uint32_t cq_number, RdmaCqConfig config = {});
+  /// @param cq_number CQ number.
+  /// @param config CQ configuration.
+  /// @param host_memory Backing memory when config.host_ring_address is set.
+  explicit RdmaCompletionQueue(std::uint32_t cq_number,
+                               RdmaCqConfig config = {},
+                               HostMemory* host_memory = nullptr);
 
   /// Post a CQE to the queue.
   /// @param cqe The completion entry to post.
   /// @return true if posted successfully, false if queue is full.
   bool post(const RdmaCqe& cqe);
 
+  /// Poll CQEs into a caller-provided buffer without allocating.
+  /// @param out Destination for polled CQEs.
+  /// @return Number of CQEs written to out.
+  [[nodiscard]] std::size_t poll(std::span<RdmaCqe> out);
+
   /// Poll CQEs from the queue.
   /// @param max_cqes Maximum number of CQEs to poll.
   /// @return Vector of CQEs (may be empty if queue is empty).
@@ -46,45 +135,120 @@ public:
   [[nodiscard]] std::optional<RdmaCqe> poll_one();
 
   /// Arm the CQ for notification (e.g., interrupt on next completion).
-  void arm();
+  /// @param solicited_only Notify only for solicited receive CQEs and error CQEs.
+  void arm(bool solicited_only = false);
 
   /// Check if CQ is armed.
   [[nodiscard]] bool is_armed() const noexcept { return armed_; }
 
+  /// Check if the CQ was armed for solicited completions only.
+  [[nodiscard]] bool is_solicited_only() const noexcept { return solicited_only_; }
+
   /// Clear the armed state (called after notification).
-  void clear_arm() noexcept { armed_ = false; }
+  void clear_arm() noexcept {
+    armed_ = false;
+    event_cqes_ = 0;
+  }
 
   /// Check if a notification should be triggered.
   /// Returns true if CQ was armed and has new completions.
   [[nodiscard]] bool should_notify() const noexcept;
 
+  /// Check if the moderation count allows the pending notification to fire now.
+  /// A CQ whose moderation only has a period waits for its timer instead.
+  [[nodiscard]] bool event_due() const noexcept;
+
+  /// Get the number of qualifying CQEs posted since the CQ was armed.
+  [[nodiscard]] std::uint32_t event_cqes() const noexcept { return event_cqes_; }
+
+  /// Record a completion event: disarms the CQ.
+  /// @return Number of CQEs the event covers.
+  std::uint32_t take_event() noexcept;
+
+  /// Get the MSI-X vector of completion events.
+  [[nodiscard]] std::uint16_t comp_vector() const noexcept { return config_.comp_vector; }
+
+  /// Get the event moderation.
+  [[nodiscard]] const RdmaCqModeration& moderation() const noexcept { return config_.moderation; }
+
+  /// Change the event moderation; applies from the next pending event.
+  void set_moderation(const RdmaCqModeration& moderation) noexcept {
+    config_.moderation = moderation;
+  }
+
   /// Get the CQ number.
   [[nodiscard]] std::uint32_t cq_number() const noexcept { return cq_number_; }
 
   /// Get current number of CQEs in queue.
-  [[nodiscard]] std::size_t count() const noexcept { return cqes_.size(); }
+  [[nodiscard]] std::size_t count() const noexcept { return pending_cqes_; }
 
   /// Check if CQ is empty.
-  [[nodiscard]] bool is_empty() const noexcept { return cqes_.empty(); }
+  [[nodiscard]] bool is_empty() const noexcept { return pending_cqes_ == 0; }
+
+  /// Check if every ring slot is taken (a compressed CQ may still fit mini-CQEs).
+  [[nodiscard]] bool is_full() const noexcept { return used_slots() >= capacity_; }
 
-  /// Check if CQ is full.
-  [[nodiscard]] bool is_full() const noexcept { return cqes_.size() >= config_.depth; }
+  /// Check whether runs of similar CQEs are compressed.
+  [[nodiscard]] bool is_compressed() const noexcept { return config_.compression; }
 
-  /// Get the CQ depth (capacity).
-  [[nodiscard]] std::size_t depth() const noexcept { return config_.depth; }
+  /// Get the CQ depth (ring capacity, a power of two).
+  [[nodiscard]] std::size_t depth() const noexcept { return capacity_; }
+
+  /// Check whether the CQE ring lives in host memory.
+  [[nodiscard]] bool is_host_resident() const noexcept { return host_memory_ != nullptr; }
+
+  /// Get the producer index in slots (free-running, not masked).
+  [[nodiscard]] std::uint64_t producer_index() const noexcept { return producer_index_; }
+
+  /// Get the consumer index in slots (free-running, not masked).
+  [[nodiscard]] std::uint64_t consumer_index() const noexcept { return consumer_index_; }
 
   /// Get statistics.
   [[nodiscard]] const RdmaCqStats& stats() const noexcept { return stats_; }
 
+  /// Count a QP using the CQ (once per send/recv role); the CQ cannot be destroyed
+  /// while any are.
+  void attach_qp() noexcept { ++qp_refs_; }
+  void detach_qp() noexcept { --qp_refs_; }
+  [[nodiscard]] std::uint32_t qp_refs() const noexcept { return qp_refs_; }
+
   /// Reset the CQ.
   void reset();
 
 private:
+  [[nodiscard]] std::size_t used_slots() const noexcept {
+    return (producer_index_ - consumer_index_) + ((session_count_ != 0) ? 1 : 0);
+  }
+  [[nodiscard]] bool can_compress(const RdmaCqe& cqe) const noexcept;
+  bool flush_session();
+  [[nodiscard]] std::uint8_t phase_of(std::uint64_t index) const noexcept;
+  [[nodiscard]] HostAddress slot_address(std::uint64_t index) const noexcept;
+  [[nodiscard]] bool write_slot(std::uint64_t index, const RdmaCqeSlot& slot);
+  [[nodiscard]] bool read_slot(std::uint64_t index, RdmaCqeSlot& slot);
+  void initialize_ring();
+
   std::uint32_t cq_number_;
   RdmaCqConfig config_;
-  std::deque<RdmaCqe> cqes_;
+  HostMemory* host_memory_{nullptr};
+  std::size_t capacity_{1};
+  std::size_t mask_{0};
+  unsigned int log2_capacity_{0};
+  std::vector<RdmaCqeSlot> ring_;  // In-model storage (empty when host-resident)
+  std::uint64_t producer_index_{0};
+  std::uint64_t consumer_index_{0};
+  std::size_t pending_cqes_{0};  // CQEs posted and not yet polled
+  // Producer compression session: mini-CQEs of title_ not yet written to the ring
+  std::optional<RdmaCqe> title_{};
+  std::array<RdmaMiniCqe, kMiniCqesPerSlot> session_minis_{};
+  std::size_t session_count_{0};
+  // Consumer decompression state
+  RdmaCqe consumer_title_{};
+  std::size_t mini_offset_{0};  // Mini-CQEs already polled from the slot at consumer_index_
   bool armed_{false};
+  bool solicited_only_{false};
   bool has_new_completions_{false};
+  std::uint32_t event_cqes_{0};  // Qualifying CQEs since arm()
+  std::uint32_t qp_refs_{0};
   RdmaCqStats stats_;
 };
 
@@ -99,6 +99,9 @@ public:
   /// Clear flow state for a QP.
   void clear_flow_state(std::uint32_t qp_number);
 
+  /// Get the approximate host memory held by per-QP flow state.
+  [[nodiscard]] std::size_t memory_footprint() const noexcept;
+
 private:
   DcqcnConfig config_;
   CongestionStats stats_;
@@ -123,12 +126,15 @@ private:
   void update_alpha(DcqcnFlowState& state, bool cnp_received);
 };
 
+/// RNR retry count that retries forever, as in the IB 3-bit rnr_retry field.
+inline constexpr std::uint32_t kRnrRetryInfinite = 7;
+
 /// Configuration for reliability/retransmission.
 struct ReliabilityConfig {
   std::uint32_t max_retries{7};          // Max retransmission attempts
-  std::uint32_t rnr_retry_count{7};      // RNR retry count
+  std::uint32_t rnr_retry_count{7};      // RNR retries when no per-QP limit is given (7 = infinite)
   std::uint64_t ack_timeout_us{4096};    // Initial ACK timeout (4.096 ms)
-  std::uint64_t rnr_timeout_us{655360};  // RNR timeout (655.36 ms default)
+  std::uint64_t rnr_timeout_us{655360};  // Cap of the RNR back-off (655.36 ms default)
   std::uint8_t timeout_exponent{14};     // Timeout = 4.096us * 2^exponent
 };
 
@@ -139,16 +145,19 @@ struct PendingAck {
   std::uint64_t send_time_us{0};  // When the operation was sent
   std::uint64_t wr_id{0};         // Work request ID
   WqeOpcode opcode{WqeOpcode::Send};
-  std::uint32_t retry_count{0};  // Number of retries so far
-  bool waiting_for_ack{true};    // True if still awaiting ACK
+  std::uint32_t retry_count{0};      // Timeout and sequence-error retries so far
+  std::uint32_t rnr_retry_count{0};  // RNR NAKs so far (drives the RNR back-off)
+  bool waiting_for_ack{true};        // True if still awaiting ACK
+  bool signaled{true};               // False = retires silently when ACKed
 };
 
 /// Result of processing an ACK/NAK.
 struct AckResult {
   bool success{false};
   bool needs_retransmit{false};
-  std::vector<std::uint64_t> completed_wr_ids;  // WR IDs that completed
+  std::vector<std::uint64_t> completed_wr_ids;  // Signaled WR IDs that completed
   std::optional<WqeStatus> error_status;        // Set if operation failed
+  std::uint64_t retry_delay_us{0};              // RNR NAK: wait before retransmitting
 };
 
 /// Statistics for reliability.
@@ -159,6 +168,7 @@ struct ReliabilityStats {
   std::uint64_t timeouts{0};
   std::uint64_t rnr_retries{0};
   std::uint64_t retry_exceeded{0};
+  std::uint64_t unsignaled_retired{0};  // Unsignaled ops completed without a CQE
 };
 
 /// Reliability Manager - handles ACK/NAK processing and retransmission.
@@ -173,12 +183,14 @@ public:
   /// @param wr_id Work request ID.
   /// @param opcode Operation type.
   /// @param send_time_us Time when operation was sent.
+  /// @param signaled False to retire the operation without reporting its wr_id.
   void add_pending(std::uint32_t qp_number,
                    std::uint32_t start_psn,
                    std::uint32_t end_psn,
                    std::uint64_t wr_id,
                    WqeOpcode opcode,
-                   std::uint64_t send_time_us);
+                   std::uint64_t send_time_us,
+                   bool signaled = true);
 
   /// Process an ACK packet.
   /// @param qp_number QP that received the ACK.
@@ -190,10 +202,15 @@ public:
   /// @param qp_number QP that received the NAK.
   /// @param nak_psn PSN of the NAK.
   /// @param syndrome NAK syndrome (type of error).
+  /// @param rnr_timer Minimum RNR timer code advertised by an RNR NAK.
+  /// @param rnr_retry_limit The QP's RNR retry count; nullopt uses the configured one.
+  ///        kRnrRetryInfinite never gives up.
   /// @return Result indicating needed actions.
   [[nodiscard]] AckResult process_nak(std::uint32_t qp_number,
                                       std::uint32_t nak_psn,
-                                      AethSyndrome syndrome);
+                                      AethSyndrome syndrome,
+                                      std::uint8_t rnr_timer = 0,
+                                      std::optional<std::uint32_t> rnr_retry_limit = std::nullopt);
 
   /// Check for timeouts and trigger retransmissions.
   /// @param qp_number QP to check.
@@ -202,6 +219,14 @@ public:
   [[nodiscard]] std::vector<std::uint32_t> check_timeouts(std::uint32_t qp_number,
                                                           std::uint64_t current_time_us);
 
+  /// Check whether a QP has operations still awaiting acknowledgment.
+  /// @param qp_number QP to check.
+  /// @return True if any pending operation is waiting for an ACK.
+  [[nodiscard]] bool has_outstanding(std::uint32_t qp_number) const;
+
+  /// Check whether any QP has operations still awaiting acknowledgment.
+  [[nodiscard]] bool has_any_outstanding() const;
+
   /// Get statistics.
   [[nodiscard]] const ReliabilityStats& stats() const noexcept { return stats_; }
 
@@ -211,6 +236,17 @@ public:
   /// Clear pending state for a QP.
   void clear_pending(std::uint32_t qp_number);
 
+  /// Drop a QP's pending list if it is empty.
+  /// @return true if the QP holds no pending list afterwards.
+  bool release_idle_state(std::uint32_t qp_number);
+
+  /// Check for timeouts on every QP with operations awaiting an ACK.
+  /// @param current_time_us Current time.
+  void check_all_timeouts(std::uint64_t current_time_us);
+
+  /// Get the approximate host memory held by per-QP pending lists.
+  [[nodiscard]] std::size_t memory_footprint() const noexcept;
+
 private:
   ReliabilityConfig config_;
   ReliabilityStats stats_;
@@ -221,6 +257,10 @@ private:
   /// Calculate timeout in microseconds for given retry count.
   [[nodiscard]] std::uint64_t calculate_timeout(std::uint32_t retry_count) const;
 
+  /// Calculate the RNR back-off: the advertised timer doubled per retry, capped at rnr_timeout_us.
+  [[nodiscard]] std::uint64_t calculate_rnr_delay(std::uint8_t rnr_timer,
+                                                  std::uint32_t retry_count) const;
+
   /// Mark operations as completed up to ack_psn.
   void complete_up_to(std::vector<PendingAck>& pending,
                       std::uint32_t ack_psn,
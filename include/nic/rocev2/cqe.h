@@ -11,14 +11,20 @@ namespace nic::rocev2 {
 
 /// Completion Queue Entry - result of a completed WQE.
 struct RdmaCqe {
-  std::uint64_t wr_id{0};            // Work request ID from original WQE
-  WqeStatus status{};                // Completion status
-  WqeOpcode opcode{};                // Operation type
-  std::uint32_t qp_number{0};        // Queue pair that generated this CQE
-  std::uint32_t bytes_completed{0};  // Number of bytes transferred
-  std::uint32_t immediate_data{0};   // Immediate data (if present)
-  bool has_immediate{false};         // True if immediate data is valid
-  bool is_send{true};                // True if send CQE, false if recv CQE
+  std::uint64_t wr_id{0};             // Work request ID from original WQE
+  WqeStatus status{};                 // Completion status
+  WqeOpcode opcode{};                 // Operation type
+  std::uint32_t qp_number{0};         // Queue pair that generated this CQE
+  std::uint32_t bytes_completed{0};   // Number of bytes transferred
+  std::uint32_t immediate_data{0};    // Immediate data (if present)
+  bool has_immediate{false};          // True if immediate data is valid
+  bool is_send{true};                 // True if send CQE, false if recv CQE
+  std::uint32_t src_qp{0};            // UD recv: source QP from DETH
+  bool has_grh{false};                // UD recv: GRH occupies first kGrhSize bytes of buffer
+  bool has_invalidate{false};         // Recv: the SEND invalidated invalidated_rkey
+  std::uint32_t invalidated_rkey{0};  // Recv: rkey invalidated by SendWithInvalidate
+  bool solicited{false};              // Recv: the SEND carried the solicited event bit
+  std::uint64_t timestamp_us{0};      // Engine clock when the CQE was written
 };
 
 }  // namespace nic::rocev2
@@ -0,0 +1,137 @@
+#pragma once
+
+/// @file encap.h
+/// @brief Ethernet/IPv4/UDP encapsulation of RoCEv2 packets.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "nic/rocev2/congestion.h"
+#include "nic/rocev2/types.h"
+
+namespace nic::rocev2 {
+
+/// Outer header sizes.
+inline constexpr std::size_t kEthHeaderSize = 14;
+inline constexpr std::size_t kVlanTagSize = 4;
+inline constexpr std::size_t kIpv4HeaderSize = 20;  // No options
+inline constexpr std::size_t kUdpHeaderSize = 8;
+inline constexpr std::size_t kMaxEncapHeaderSize =
+    kEthHeaderSize + kVlanTagSize + kIpv4HeaderSize + kUdpHeaderSize;
+
+inline constexpr std::uint16_t kEtherTypeIpv4 = 0x0800;
+inline constexpr std::uint16_t kEtherTypeVlan = 0x8100;
+inline constexpr std::uint8_t kIpProtocolUdp = 17;
+
+/// RoCEv2 UDP source ports are drawn from the dynamic range [0xC000, 0xFFFF].
+inline constexpr std::uint16_t kRoceSrcPortBase = 0xC000;
+
+/// Default traffic class of RoCE data packets: DSCP 26 with ECT(0).
+inline constexpr std::uint8_t kDefaultRoceTrafficClass =
+    (26 << 2) | static_cast<std::uint8_t>(EcnCodepoint::Ect0);
+
+/// Engine-wide L2/L3 settings for encapsulated RoCEv2 frames.
+struct RoceEncapConfig {
+  bool enabled{false};  // Emit full Ethernet frames instead of bare UDP payloads
+  MacAddress src_mac{};
+  std::array<std::uint8_t, 4> src_ip{};
+  std::optional<std::uint16_t> vlan_id{};  // 802.1Q VID (nullopt = untagged)
+  std::uint8_t vlan_pcp{0};
+  std::uint8_t traffic_class{kDefaultRoceTrafficClass};  // DSCP(6) | ECN(2) of data packets
+  std::uint8_t ttl{64};
+};
+
+/// Outer headers of one RoCEv2 flow.
+struct RoceFlowAttr {
+  MacAddress src_mac{};
+  MacAddress dest_mac{};
+  std::optional<std::uint16_t> vlan_id{};
+  std::uint8_t vlan_pcp{0};
+  std::array<std::uint8_t, 4> src_ip{};
+  std::array<std::uint8_t, 4> dest_ip{};
+  std::uint8_t traffic_class{kDefaultRoceTrafficClass};
+  std::uint8_t ttl{64};
+  std::uint16_t src_port{kRoceSrcPortBase};
+  std::uint16_t dest_port{kRoceUdpPort};
+};
+
+/// How a QP chooses the UDP source port of its packets.
+enum class SrcPortMode : std::uint8_t {
+  FlowHash,   // One port hashed from the QP pair (default)
+  Fixed,      // One configured port
+  Multipath,  // Rotate across path_count hashed ports
+};
+
+/// UDP source port policy of a QP. Switches hash the source port into their ECMP
+/// path choice, so a Multipath QP spreads its packets across up to path_count paths.
+struct SrcPortConfig {
+  SrcPortMode mode{SrcPortMode::FlowHash};
+  std::uint16_t fixed_port{kRoceSrcPortBase};  // Fixed: port of every packet
+  std::uint8_t path_count{4};                  // Multipath: number of ports to rotate across
+  std::uint64_t flowlet_gap_us{0};  // Multipath: idle gap before switching ports (0 = every packet)
+};
+
+/// Compute the UDP source port of a QP pair. Each connection hashes to its own port,
+/// so ECMP spreads connections across paths while a connection stays in order.
+[[nodiscard]] std::uint16_t roce_flow_src_port(std::uint32_t src_qp,
+                                               std::uint32_t dest_qp) noexcept;
+
+/// Compute the UDP source port of one path of a multipath QP pair.
+/// Path 0 is roce_flow_src_port(); paths below 2^14 map to distinct ports.
+[[nodiscard]] std::uint16_t roce_path_src_port(std::uint32_t src_qp,
+                                               std::uint32_t dest_qp,
+                                               std::uint32_t path) noexcept;
+
+/// Precomputed Ethernet(+VLAN)+IPv4+UDP header of one flow. Encapsulating a packet
+/// copies the template and patches only the length fields and the IPv4 checksum;
+/// the UDP checksum is left zero, as RoCEv2 relies on the ICRC.
+class RoceHeaderTemplate {
+public:
+  RoceHeaderTemplate() = default;
+  explicit RoceHeaderTemplate(const RoceFlowAttr& attr);
+
+  /// Build a frame around a UDP payload (BTH through ICRC).
+  /// @param traffic_class Override of the flow's DSCP/ECN for this packet (e.g. CNPs).
+  /// @param src_port Override of the flow's UDP source port (e.g. multipath QPs).
+  [[nodiscard]] std::vector<std::byte> encapsulate(
+      std::span<const std::byte> udp_payload,
+      std::optional<std::uint8_t> traffic_class = std::nullopt,
+      std::optional<std::uint16_t> src_port = std::nullopt) const;
+
+  [[nodiscard]] const RoceFlowAttr& attr() const noexcept { return attr_; }
+  [[nodiscard]] std::size_t header_size() const noexcept { return size_; }
+
+private:
+  RoceFlowAttr attr_{};
+  std::array<std::byte, kMaxEncapHeaderSize> header_{};
+  std::uint8_t size_{0};
+  std::uint8_t ip_offset_{0};
+  std::uint32_t partial_checksum_{0};  // Ones' complement sum of the fixed IPv4 header words
+};
+
+/// Outer headers of a received RoCEv2 frame.
+struct RoceFrameInfo {
+  MacAddress src_mac{};
+  MacAddress dest_mac{};
+  std::optional<std::uint16_t> vlan_id{};
+  std::array<std::uint8_t, 4> src_ip{};
+  std::array<std::uint8_t, 4> dest_ip{};
+  EcnCodepoint ecn{EcnCodepoint::NonEct};
+  std::uint16_t src_port{0};
+  std::span<const std::byte> udp_payload{};  // Points into the frame
+};
+
+/// Parse and validate the Ethernet(+VLAN), IPv4 and UDP headers of a RoCEv2 frame.
+/// @return Header fields and the UDP payload, or nullopt if the frame is not a
+///         well-formed, unfragmented IPv4/UDP datagram to kRoceUdpPort.
+[[nodiscard]] std::optional<RoceFrameInfo> parse_roce_frame(std::span<const std::byte> frame);
+
+/// Check whether a frame is an IPv4/UDP datagram to kRoceUdpPort, without validating it.
+/// Cheap enough for RX classification; the receiver runs parse_roce_frame() afterwards.
+[[nodiscard]] bool is_roce_frame(std::span<const std::byte> frame) noexcept;
+
+}  // namespace nic::rocev2
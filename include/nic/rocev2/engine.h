@@ -5,23 +5,31 @@
 
 #include <array>
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <span>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "nic/dma_engine.h"
 #include "nic/host_memory.h"
+#include "nic/rocev2/address_handle.h"
 #include "nic/rocev2/completion_queue.h"
 #include "nic/rocev2/congestion.h"
+#include "nic/rocev2/encap.h"
+#include "nic/rocev2/latency.h"
 #include "nic/rocev2/memory_region.h"
 #include "nic/rocev2/packet.h"
 #include "nic/rocev2/protection_domain.h"
 #include "nic/rocev2/queue_pair.h"
 #include "nic/rocev2/rdma_read.h"
 #include "nic/rocev2/rdma_write.h"
+#include "nic/rocev2/send_queue.h"
 #include "nic/rocev2/send_recv.h"
+#include "nic/rocev2/srq.h"
 #include "nic/rocev2/types.h"
 #include "nic/trace.h"
 
@@ -34,10 +42,27 @@ struct RdmaEngineConfig {
   std::size_t max_mrs{4096};               ///< Maximum memory regions
   std::size_t max_qps{1024};               ///< Maximum queue pairs
   std::size_t max_cqs{512};                ///< Maximum completion queues
+  std::size_t max_srqs{64};                ///< Maximum shared receive queues
+  std::size_t max_ahs{4096};               ///< Maximum UD address handles
   std::size_t default_cq_depth{256};       ///< Default CQ depth
   std::uint32_t mtu{4096};                 ///< RDMA MTU
+  std::size_t odp_page_size{4096};         ///< Page size of on-demand paging MRs
   DcqcnConfig dcqcn_config{};              ///< Congestion control config
   ReliabilityConfig reliability_config{};  ///< Reliability config
+  RoceEncapConfig encap{};                 ///< Ethernet/IPv4/UDP encapsulation of outgoing packets
+  /// PSNs past the expected one whose WRITE packets are placed on arrival (0 = strict order)
+  std::uint32_t write_reorder_window{0};
+  /// Advertise receive WQE credits in ACKs, and hold SENDs while the peer has none
+  bool end_to_end_credits{false};
+  /// This device's IP; RC QPs connected to a local QP at this IP bypass the wire (nullopt = off)
+  std::optional<std::array<std::uint8_t, 4>> local_ip{};
+  /// QP, CQ and SRQ numbers run first_object_number, +stride, +2*stride, ... so that
+  /// several engines can split one number space (see ShardedRdmaEngine)
+  std::uint32_t first_object_number{1};
+  std::uint32_t object_number_stride{1};
+  /// Engine time a destroyed QP's number stays out of use, so late packets for the old
+  /// QP cannot reach a new one (0 = reuse at once)
+  std::uint64_t qp_number_quarantine_us{1000000};
 };
 
 /// Statistics for the RDMA engine.
@@ -47,6 +72,13 @@ struct RdmaEngineStats {
   std::uint64_t bytes_received{0};
   std::uint64_t bytes_sent{0};
   std::uint64_t send_wqes_posted{0};
+  std::uint64_t inline_sends{0};
+  std::uint64_t unsignaled_sends{0};
+  std::uint64_t loopback_ops{0};
+  std::uint64_t sq_doorbells{0};
+  std::uint64_t sq_wqes_fetched{0};
+  std::uint64_t blueflame_wqes{0};
+  std::uint64_t blueflame_fallbacks{0};
   std::uint64_t recv_wqes_posted{0};
   std::uint64_t cqes_generated{0};
   std::uint64_t errors{0};
@@ -54,14 +86,83 @@ struct RdmaEngineStats {
   std::uint64_t mrs_registered{0};
   std::uint64_t qps_created{0};
   std::uint64_t cqs_created{0};
+  std::uint64_t srqs_created{0};
+  std::uint64_t ahs_created{0};
+  std::uint64_t async_events{0};
+  std::uint64_t idle_storage_releases{0};
+  std::uint64_t memory_wqes{0};          // RegMr, LocalInvalidate and BindMw WQEs executed
+  std::uint64_t odp_parked_wqes{0};      // Send WQEs parked behind an ODP page fault
+  std::uint64_t odp_resumed_wqes{0};     // Parked WQEs restarted after their pages arrived
+  std::uint64_t odp_stall_us{0};         // Time send queues spent parked on ODP faults
+  std::uint64_t frames_encapsulated{0};  // Outgoing packets built from a header template
+  std::uint64_t frames_received{0};      // Incoming Ethernet frames accepted
+  std::uint64_t frame_errors{0};         // Incoming frames with malformed outer headers
+  std::uint64_t src_port_switches{0};    // Multipath QPs moving to their next source port
+  std::uint64_t rnr_backoffs{0};         // RNR NAKs that paused a send queue
+  std::uint64_t rnr_resends{0};          // Messages resent after an RNR back-off
+  std::uint64_t rnr_wait_us{0};          // Time send queues spent in RNR back-off
+  std::uint64_t credit_stalls{0};        // Send WQEs held because the peer had no receive credits
+  std::uint64_t cq_events{0};            // Completion events raised by armed CQs
+  std::uint64_t cq_event_timeouts{0};    // Completion events raised by a CQ's cq_period timer
+  std::uint64_t qp_numbers_reused{0};    // QPs created with a number from the free list
+};
+
+/// Number of WqeOpcode values, for per-opcode tables.
+inline constexpr std::size_t kWqeOpcodeCount = static_cast<std::size_t>(WqeOpcode::BindMw) + 1;
+
+/// Latency of signaled send WQEs on the engine clock, from post to the successful CQE.
+struct RdmaLatencyStats {
+  LatencyHistogram completion;                                 // Post to CQE, all QPs
+  LatencyHistogram queueing;                                   // Post to first transmit
+  std::array<LatencyHistogram, kWqeOpcodeCount> by_opcode{};   // Post to CQE, per opcode
+  std::unordered_map<std::uint32_t, LatencyHistogram> by_qp;  // Post to CQE, per live QP
+
+  [[nodiscard]] const LatencyHistogram& opcode(WqeOpcode op) const noexcept {
+    return by_opcode[static_cast<std::size_t>(op)];
+  }
+};
+
+/// Approximate host memory held by the engine's per-QP state.
+struct RdmaMemoryFootprint {
+  std::size_t qp_count{0};
+  std::size_t qps_with_storage{0};  // QPs currently holding queue storage
+  std::size_t qp_bytes{0};          // QP records plus queued WQEs
+  std::size_t sq_ring_bytes{0};     // Send queue ring trackers
+  std::size_t protocol_bytes{0};    // Per-QP processor, reliability, and congestion state
+
+  [[nodiscard]] std::size_t total() const noexcept {
+    return qp_bytes + sq_ring_bytes + protocol_bytes;
+  }
+};
+
+/// Asynchronous event reported outside of the completion path.
+struct RdmaAsyncEvent {
+  AsyncEventType type{AsyncEventType::SrqLimitReached};
+  std::uint32_t srq_number{0};  // Valid for SRQ events
+  std::uint32_t qp_number{0};   // QP whose receive triggered the event (0 if none)
+};
+
+/// Completion event of an armed CQ, delivered through the completion channel.
+struct RdmaCqEvent {
+  std::uint32_t cq_number{0};
+  std::uint16_t comp_vector{0};  // MSI-X vector raised for the event
+  std::uint32_t cqes{0};         // Qualifying CQEs posted since the CQ was armed
+};
+
+/// One memory region of a register_mrs() batch.
+struct RdmaMrRegion {
+  std::uint64_t virtual_address{0};
+  std::size_t length{0};
+  AccessFlags access{};
 };
 
 /// Outgoing packet with metadata.
 struct OutgoingPacket {
-  std::vector<std::byte> data;
+  std::vector<std::byte> data;  // UDP payload, or a full Ethernet frame if is_frame
   std::array<std::uint8_t, 4> dest_ip{};
   std::uint16_t dest_port{kRoceUdpPort};
-  std::uint16_t src_port{0};  // 0 = use flow-based hash
+  std::uint16_t src_port{0};  // Flow-hashed RoCEv2 source port (0 = not assigned)
+  bool is_frame{false};       // data carries Ethernet/IPv4/UDP headers
 };
 
 /// RoCEv2 RDMA Engine - top-level coordinator for RDMA operations.
@@ -97,19 +198,101 @@ public:
                                                          std::size_t length,
                                                          AccessFlags access);
 
+  /// Register several memory regions in one PD, validating the PD once.
+  /// @param pd_handle Protection domain handle.
+  /// @param regions The regions, registered in order.
+  /// @return lkeys of the registered MRs; fewer than regions.size() if one failed, in which
+  ///         case the size is the index of the first failure.
+  [[nodiscard]] std::vector<std::uint32_t> register_mrs(std::uint32_t pd_handle,
+                                                        std::span<const RdmaMrRegion> regions);
+
   /// Deregister a memory region.
   /// @param lkey The local key of the MR to deregister.
   /// @return True if deregistered, false if MR not found.
   bool deregister_mr(std::uint32_t lkey);
 
+  /// Allocate an MR for fast registration. It has no mapping until a RegMr WQE
+  /// installs one, and can be remapped after each LocalInvalidate/SendWithInvalidate.
+  /// @param pd_handle Protection domain handle.
+  /// @param max_length Largest mapping a RegMr WQE may install.
+  /// @return lkey of the MR, or nullopt on failure.
+  [[nodiscard]] std::optional<std::uint32_t> alloc_fast_reg_mr(std::uint32_t pd_handle,
+                                                               std::size_t max_length);
+
+  /// Allocate a type-2 memory window, bound later by a BindMw WQE.
+  /// @param pd_handle Protection domain handle.
+  /// @return rkey of the window, or nullopt on failure.
+  [[nodiscard]] std::optional<std::uint32_t> alloc_mw(std::uint32_t pd_handle);
+
+  /// Deallocate a memory window.
+  /// @param rkey Current rkey of the window.
+  /// @return True if deallocated, false if not a window.
+  bool dealloc_mw(std::uint32_t rkey);
+
+  // ============================================
+  // On-Demand Paging
+  // ============================================
+
+  /// Install the host-side handler for ODP page faults. A send WQE whose SGL faults is
+  /// parked, with later WQEs of its QP queued behind it; an incoming WRITE or READ that
+  /// faults is RNR-NAKed. The handler may populate the pages before returning.
+  void set_page_fault_handler(MemoryRegionTable::PageFaultHandler handler);
+
+  /// Resolve page faults: make a host range present and restart parked WQEs.
+  /// @return Number of pages that became present.
+  std::size_t populate_odp_pages(HostAddress address, std::size_t length);
+
+  /// Prefetch advice (like ibv_advise_mr): fault in an ODP MR range ahead of use.
+  /// @param lkey ODP MR the range belongs to.
+  /// @return Number of pages that became present, or nullopt if the range is not in an ODP MR.
+  std::optional<std::size_t> advise_mr(std::uint32_t lkey,
+                                       HostAddress address,
+                                       std::size_t length);
+
+  /// Invalidation callback: the host unmapped a range, so ODP accesses to it fault again.
+  /// @return Number of present pages dropped.
+  std::size_t invalidate_odp_range(HostAddress address, std::size_t length);
+
+  /// Get the number of send WQEs parked on a QP behind an ODP fault.
+  [[nodiscard]] std::size_t odp_parked_count(std::uint32_t qp_number) const;
+
+  /// Get the number of send WQEs held on a QP by an RNR back-off or a lack of credits.
+  [[nodiscard]] std::size_t rnr_held_count(std::uint32_t qp_number) const;
+
+  // ============================================
+  // Address Handle Management
+  // ============================================
+
+  /// Create an address handle for UD sends.
+  /// @param pd_handle Protection domain handle.
+  /// @param attr Destination path attributes.
+  /// @return AH handle, or nullopt on failure.
+  [[nodiscard]] std::optional<std::uint32_t> create_ah(std::uint32_t pd_handle,
+                                                       const RdmaAhAttr& attr);
+
+  /// Destroy an address handle.
+  /// @param ah_handle The AH handle to destroy.
+  /// @return True if destroyed, false if AH not found.
+  bool destroy_ah(std::uint32_t ah_handle);
+
   // ============================================
   // Completion Queue Management
   // ============================================
 
   /// Create a completion queue.
-  /// @param depth Number of entries in the CQ.
+  /// @param depth Number of entries in the CQ (rounded up to a power of two).
+  /// @param host_ring_address Place the CQE ring in host memory here (nullopt = in-model).
+  /// @param comp_vector MSI-X vector raised by the CQ's completion events.
   /// @return CQ number, or nullopt on failure.
-  [[nodiscard]] std::optional<std::uint32_t> create_cq(std::size_t depth);
+  [[nodiscard]] std::optional<std::uint32_t> create_cq(
+      std::size_t depth,
+      std::optional<HostAddress> host_ring_address = std::nullopt,
+      std::uint16_t comp_vector = 0);
+
+  /// Create a completion queue from a full configuration (moderation, compression, ...).
+  /// @param config CQ configuration.
+  /// @return CQ number, or nullopt on failure.
+  [[nodiscard]] std::optional<std::uint32_t> create_cq(const RdmaCqConfig& config);
 
   /// Destroy a completion queue.
   /// @param cq_number The CQ to destroy.
@@ -122,6 +305,88 @@ public:
   /// @return Vector of CQEs (may be empty).
   [[nodiscard]] std::vector<RdmaCqe> poll_cq(std::uint32_t cq_number, std::size_t max_cqes);
 
+  /// Poll a completion queue into a caller-provided buffer without allocating.
+  /// @param cq_number The CQ to poll.
+  /// @param out Destination for polled CQEs.
+  /// @return Number of CQEs written to out (0 if the CQ is empty or not found).
+  [[nodiscard]] std::size_t poll_cq(std::uint32_t cq_number, std::span<RdmaCqe> out);
+
+  /// Query a completion queue (depth, statistics such as bytes written per CQE).
+  /// @param cq_number The CQ to query.
+  /// @return CQ pointer, or nullptr if not found.
+  [[nodiscard]] const RdmaCompletionQueue* query_cq(std::uint32_t cq_number) const;
+
+  /// Arm a completion queue: its next qualifying CQE raises one completion event.
+  /// CQEs already queued do not count, so poll once more after arming.
+  /// @param cq_number The CQ to arm.
+  /// @param solicited_only Notify only for solicited receives and error completions.
+  /// @return True if armed, false if CQ not found.
+  bool arm_cq(std::uint32_t cq_number, bool solicited_only = false);
+
+  /// Set the event moderation of a completion queue.
+  /// @param cq_number The CQ to modify.
+  /// @param moderation CQE count and period of one event.
+  /// @return True if modified, false if CQ not found.
+  bool modify_cq(std::uint32_t cq_number, const RdmaCqModeration& moderation);
+
+  /// Drain pending completion events (the completion channel).
+  /// @param max_events Maximum number of events to return.
+  /// @return Vector of events in the order they were raised (may be empty).
+  [[nodiscard]] std::vector<RdmaCqEvent> poll_cq_events(std::size_t max_events);
+
+  /// Get the number of completion events waiting in the completion channel.
+  [[nodiscard]] std::size_t pending_cq_events() const noexcept { return cq_events_.size(); }
+
+  /// Get the engine time left until the next timer that can raise a completion event:
+  /// a CQ moderation period or an RNR back-off ending.
+  /// @return nullopt if no such timer is running.
+  [[nodiscard]] std::optional<std::uint64_t> time_to_next_timer_us() const;
+
+  /// Check whether packets are queued to send or operations await a response. These
+  /// move on as packets are exchanged, not as time passes.
+  [[nodiscard]] bool has_traffic_in_flight() const;
+
+  /// Install the hook that raises a completion event's interrupt (see Device).
+  using CqEventHandler = std::function<void(const RdmaCqEvent&)>;
+  void set_cq_event_handler(CqEventHandler handler) { cq_event_handler_ = std::move(handler); }
+
+  // ============================================
+  // Shared Receive Queue Management
+  // ============================================
+
+  /// Create a shared receive queue.
+  /// @param depth Maximum number of receive WQEs the SRQ can hold.
+  /// @param limit Low watermark that arms the limit-reached event (0 = disarmed).
+  /// @return SRQ number, or nullopt on failure.
+  [[nodiscard]] std::optional<std::uint32_t> create_srq(std::size_t depth, std::size_t limit = 0);
+
+  /// Destroy a shared receive queue.
+  /// @param srq_number The SRQ to destroy.
+  /// @return True if destroyed, false if SRQ not found or in use.
+  bool destroy_srq(std::uint32_t srq_number);
+
+  /// Re-arm the limit-reached event of an SRQ.
+  /// @param srq_number The SRQ to arm.
+  /// @param limit New low watermark (0 = disarm).
+  /// @return True if armed, false if SRQ not found or limit exceeds depth.
+  bool arm_srq(std::uint32_t srq_number, std::size_t limit);
+
+  /// Post a receive work request to a shared receive queue.
+  /// @param srq_number Target SRQ.
+  /// @param wqe The receive WQE.
+  /// @return True if posted successfully.
+  bool post_srq_recv(std::uint32_t srq_number, const RecvWqe& wqe);
+
+  /// Query a shared receive queue.
+  /// @param srq_number The SRQ to query.
+  /// @return SRQ pointer, or nullptr if not found.
+  [[nodiscard]] const RdmaSharedReceiveQueue* query_srq(std::uint32_t srq_number) const;
+
+  /// Drain pending asynchronous events.
+  /// @param max_events Maximum number of events to return.
+  /// @return Vector of events in the order they were raised (may be empty).
+  [[nodiscard]] std::vector<RdmaAsyncEvent> poll_async_events(std::size_t max_events);
+
   // ============================================
   // Queue Pair Management
   // ============================================
@@ -131,7 +396,14 @@ public:
   /// @return QP number, or nullopt on failure.
   [[nodiscard]] std::optional<std::uint32_t> create_qp(const RdmaQpConfig& config);
 
-  /// Destroy a queue pair.
+  /// Create several queue pairs, sizing the QP table once for the whole batch.
+  /// @param configs QP configurations, created in order.
+  /// @return QP numbers of the created QPs; fewer than configs.size() if one failed, in
+  ///         which case the size is the index of the first failure.
+  [[nodiscard]] std::vector<std::uint32_t> create_qps(std::span<const RdmaQpConfig> configs);
+
+  /// Destroy a queue pair. Its number returns to the free list and is reused by later
+  /// creates, oldest first.
   /// @param qp_number The QP to destroy.
   /// @return True if destroyed, false if QP not found.
   bool destroy_qp(std::uint32_t qp_number);
@@ -142,6 +414,14 @@ public:
   /// @return True if modified successfully.
   bool modify_qp(std::uint32_t qp_number, const RdmaQpModifyParams& params);
 
+  /// Modify several queue pairs.
+  /// @param qp_numbers The QPs to modify, in order.
+  /// @param params One set of parameters per QP, or a single set applied to every QP.
+  /// @return Number of QPs modified; qp_numbers.size() on success, else the index of the
+  ///         first failure.
+  [[nodiscard]] std::size_t modify_qps(std::span<const std::uint32_t> qp_numbers,
+                                       std::span<const RdmaQpModifyParams> params);
+
   /// Query a queue pair.
   /// @param qp_number The QP to query.
   /// @return QP pointer, or nullptr if not found.
@@ -163,6 +443,44 @@ public:
   /// @return True if posted successfully.
   bool post_recv(std::uint32_t qp_number, const RecvWqe& wqe);
 
+  /// Post a chain of send work requests to a QP (like a linked ibv_send_wr list).
+  /// The QP lookup and state check are done once for the whole batch.
+  /// @param qp_number Target QP.
+  /// @param wqes The send WQEs, posted in order.
+  /// @return Number of WQEs posted; wqes.size() on success, else the index of the first failure.
+  [[nodiscard]] std::size_t post_send_list(std::uint32_t qp_number,
+                                           std::span<const SendWqe> wqes);
+
+  /// Post a chain of receive work requests to a QP.
+  /// @param qp_number Target QP.
+  /// @param wqes The receive WQEs, posted in order.
+  /// @return Number of WQEs posted; wqes.size() on success, else the index of the first failure.
+  [[nodiscard]] std::size_t post_recv_list(std::uint32_t qp_number,
+                                           std::span<const RecvWqe> wqes);
+
+  // ============================================
+  // Doorbell Posting
+  // ============================================
+
+  /// Handle a send queue doorbell (an RdmaSqDoorbell write to BAR2).
+  /// The device DMA-fetches every ring slot up to producer_index and posts it.
+  /// @param qp_number QP whose ring was updated; it must have been created with sq_ring_address.
+  /// @param producer_index New free-running producer index.
+  /// @return Number of fetched WQEs that were posted successfully.
+  std::size_t ring_sq_doorbell(std::uint32_t qp_number, std::uint32_t producer_index);
+
+  /// Handle a BlueFlame write: a whole WQE written into the doorbell page.
+  /// On an empty ring the WQE is posted without a descriptor fetch. Otherwise it acts as a
+  /// doorbell for one more slot, so software must also have written the WQE to the ring.
+  /// @param entry The WQE as written to the BlueFlame buffer.
+  /// @return True if the WQE was posted.
+  bool post_blueflame(const RdmaSqWqe& entry);
+
+  /// Query the host send queue ring of a QP.
+  /// @param qp_number The QP to query.
+  /// @return Ring pointer, or nullptr if the QP has no host ring.
+  [[nodiscard]] const RdmaSendQueueRing* query_sq_ring(std::uint32_t qp_number) const;
+
   // ============================================
   // Packet Processing
   // ============================================
@@ -178,6 +496,12 @@ public:
                                std::array<std::uint8_t, 4> dst_ip,
                                std::uint16_t src_port);
 
+  /// Process an incoming Ethernet frame carrying a RoCEv2 packet.
+  /// The outer headers are validated and the IPv4 ECN field drives congestion marking.
+  /// @param frame Ethernet frame (optionally VLAN tagged) without FCS.
+  /// @return True if processed successfully.
+  bool process_incoming_frame(std::span<const std::byte> frame);
+
   /// Generate outgoing packets from all QPs.
   /// @return Vector of packets ready to send.
   [[nodiscard]] std::vector<OutgoingPacket> generate_outgoing_packets();
@@ -190,6 +514,15 @@ public:
   /// @param elapsed_us Microseconds to advance.
   void advance_time(std::uint64_t elapsed_us);
 
+  /// Release queue storage and protocol state held by idle QPs. Runs on every
+  /// advance_time() but only visits QPs used since they were last found idle;
+  /// released state is allocated again on the QP's next use.
+  /// @return Number of QPs whose queue storage was released.
+  std::size_t release_idle_state();
+
+  /// Get the approximate host memory held by QP state.
+  [[nodiscard]] RdmaMemoryFootprint memory_footprint() const;
+
   /// Reset the engine to initial state.
   void reset();
 
@@ -199,10 +532,18 @@ public:
 
   [[nodiscard]] const RdmaEngineConfig& config() const noexcept { return config_; }
   [[nodiscard]] const RdmaEngineStats& stats() const noexcept { return stats_; }
+  [[nodiscard]] const RdmaLatencyStats& latency_stats() const noexcept { return latency_stats_; }
+  void clear_latency_stats() { latency_stats_ = RdmaLatencyStats{}; }
   [[nodiscard]] bool is_enabled() const noexcept { return config_.enabled; }
 
   // Component access for testing
+  [[nodiscard]] const PdTable& pd_table() const noexcept { return pd_table_; }
   [[nodiscard]] const MemoryRegionTable& mr_table() const noexcept { return mr_table_; }
+  [[nodiscard]] const SendRecvProcessor& send_recv_processor() const noexcept {
+    return send_recv_processor_;
+  }
+  [[nodiscard]] const WriteProcessor& write_processor() const noexcept { return write_processor_; }
+  [[nodiscard]] const ReadProcessor& read_processor() const noexcept { return read_processor_; }
   [[nodiscard]] const CongestionControlManager& congestion_manager() const noexcept {
     return congestion_manager_;
   }
@@ -213,16 +554,28 @@ public:
 private:
   RdmaEngineConfig config_;
   RdmaEngineStats stats_;
-  [[maybe_unused]] DMAEngine& dma_engine_;
-  [[maybe_unused]] HostMemory& host_memory_;
+  RdmaLatencyStats latency_stats_;
+  DMAEngine& dma_engine_;
+  HostMemory& host_memory_;
 
   // Resource tables
   PdTable pd_table_;
   MemoryRegionTable mr_table_;
   std::unordered_map<std::uint32_t, std::unique_ptr<RdmaCompletionQueue>> cqs_;
   std::unordered_map<std::uint32_t, std::unique_ptr<RdmaQueuePair>> qps_;
-  std::uint32_t next_cq_number_{1};
-  std::uint32_t next_qp_number_{1};
+  std::unordered_map<std::uint32_t, std::unique_ptr<RdmaSharedReceiveQueue>> srqs_;
+  std::unordered_map<std::uint32_t, std::unique_ptr<RdmaSendQueueRing>> sq_rings_;
+  std::uint32_t next_cq_number_;
+  std::unordered_map<std::uint32_t, AddressHandle> ahs_;
+  std::uint32_t next_srq_number_;
+  std::uint32_t next_ah_handle_{1};
+  std::uint32_t next_qp_number_;
+  // Numbers of destroyed QPs, oldest first, with the engine time they were freed
+  struct FreeQpNumber {
+    std::uint32_t qp_number{0};
+    std::uint64_t freed_us{0};
+  };
+  std::deque<FreeQpNumber> free_qp_numbers_;
 
   // Processors
   SendRecvProcessor send_recv_processor_;
@@ -234,19 +587,130 @@ private:
   // Pending outgoing packets
   std::vector<OutgoingPacket> outgoing_packets_;
 
+  // Pending asynchronous events
+  std::deque<RdmaAsyncEvent> async_events_;
+
+  // Completion channel: raised CQ events, moderation timers of armed CQs, interrupt hook
+  std::deque<RdmaCqEvent> cq_events_;
+  std::unordered_map<std::uint32_t, std::uint64_t> cq_event_deadlines_;
+  CqEventHandler cq_event_handler_;
+
+  // Send WQEs waiting for ODP pages, per QP, in posting order
+  struct OdpParkedWqes {
+    std::deque<SendWqeRecord> wqes;
+    std::uint64_t parked_at_us{0};  // Time the head WQE first faulted
+  };
+  std::unordered_map<std::uint32_t, OdpParkedWqes> odp_parked_;
+  std::uint64_t now_us_{0};
+
+  // Outer headers of encapsulated flows, per RC QP and per UD address handle
+  std::unordered_map<std::uint32_t, RoceHeaderTemplate> qp_header_templates_;
+  std::unordered_map<std::uint32_t, RoceHeaderTemplate> ah_header_templates_;
+
+  // UDP source port state of QPs with a non-default SrcPortConfig
+  struct SrcPortState {
+    SrcPortConfig config{};
+    std::uint32_t path{0};        // Current Multipath port index
+    std::uint64_t last_tx_us{0};  // Time of the QP's last packet
+    bool sent{false};             // A packet has used the current path
+  };
+  std::unordered_map<std::uint32_t, SrcPortState> src_port_states_;
+
+  // RNR back-off and end-to-end credit state of RC requester QPs
+  struct RnrState {
+    std::deque<SendWqeRecord> held;           // WQEs waiting on the back-off or on credits
+    std::optional<std::uint32_t> resend_psn;  // Go back to this PSN when the back-off ends
+    std::uint64_t backoff_start_us{0};
+    std::uint64_t resume_us{0};              // End of the current back-off
+    std::optional<std::uint32_t> credits{};  // Receive WQEs left at the peer (nullopt = unknown)
+    std::deque<std::uint32_t> consumers;     // Last PSNs of unACKed recv-consuming messages
+  };
+  std::unordered_map<std::uint32_t, RnrState> rnr_states_;
+
+  // Timestamps of signaled send WQEs awaiting their CQE, per QP, in posting order
+  struct WqeTimestamps {
+    std::uint64_t wr_id{0};
+    WqeOpcode opcode{WqeOpcode::Send};
+    std::uint64_t post_us{0};
+    std::optional<std::uint64_t> first_tx_us{};
+  };
+  std::unordered_map<std::uint32_t, std::deque<WqeTimestamps>> wqe_timestamps_;
+
+  // QPs used since release_idle_state() last found them idle
+  std::unordered_set<std::uint32_t> idle_candidates_;
+
   // Internal helpers
+  [[nodiscard]] std::uint32_t allocate_qp_number();
+  void retain_pd(std::uint32_t pd_handle);
+  void release_pd(std::uint32_t pd_handle);
+  void stamp_wqe_post(const RdmaQueuePair& qp, const SendWqe& wqe);
+  [[nodiscard]] bool release_qp_idle_state(RdmaQueuePair& qp);
+  void stamp_wqe_transmit(std::uint32_t qp_number, std::uint64_t wr_id);
+  void record_wqe_latency(const RdmaCqe& cqe);
+  bool post_send_wqe(RdmaQueuePair& qp, const SendWqe& wqe);
+  bool start_send_wqe(RdmaQueuePair& qp, const SendWqe& wqe);
+  bool transmit_send_wqe(RdmaQueuePair& qp, const SendWqe& wqe);
+  [[nodiscard]] std::vector<std::vector<std::byte>> build_send_packets(RdmaQueuePair& qp,
+                                                                       const SendWqe& wqe);
+  [[nodiscard]] bool hold_send_wqe(RdmaQueuePair& qp, const SendWqe& wqe);
+  [[nodiscard]] bool credit_blocked(const RnrState& state, WqeOpcode opcode) const;
+  void start_rnr_backoff(RdmaQueuePair& qp, std::uint32_t psn, std::uint64_t delay_us);
+  void process_rnr_ack(RdmaQueuePair& qp, std::uint32_t ack_psn, std::uint8_t credit_code);
+  void resend_from(RdmaQueuePair& qp, std::uint32_t psn);
+  void resume_rnr_wqes();
+  void release_rnr_wqes(RdmaQueuePair& qp, RnrState& state);
+  void flush_send_wqe(RdmaQueuePair& qp, const SendWqe& wqe);
+  [[nodiscard]] std::uint8_t ack_credit_code(const RdmaQueuePair& qp) const;
+  [[nodiscard]] bool park_odp_wqe(RdmaQueuePair& qp, const SendWqe& wqe);
+  [[nodiscard]] MrAccessStatus access_wqe_memory(WqeOpcode opcode,
+                                                 bool inline_data,
+                                                 std::uint32_t lkey,
+                                                 const WqeSgl& sgl);
+  void resume_odp_wqes();
+  bool post_ud_send(RdmaQueuePair& qp, const SendWqe& wqe);
+  std::size_t drain_sq_ring(RdmaQueuePair& qp, RdmaSendQueueRing& ring);
+  [[nodiscard]] RdmaQueuePair* loopback_peer(const RdmaQueuePair& qp);
+  bool post_loopback(RdmaQueuePair& qp, RdmaQueuePair& peer, const SendWqe& wqe);
+  void complete_loopback_error(RdmaQueuePair& qp, const SendWqe& wqe, WqeStatus status);
+  void execute_memory_wqe(RdmaQueuePair& qp, const SendWqe& wqe);
+  [[nodiscard]] bool gather_sgl(std::span<const SglEntry> sgl,
+                                std::uint32_t lkey,
+                                std::vector<std::byte>& out) const;
+  [[nodiscard]] bool scatter_sgl(std::span<const SglEntry> sgl,
+                                 std::span<const std::byte> data,
+                                 std::optional<std::uint32_t> lkey);
   void process_send_packet(RdmaQueuePair& qp,
                            const RdmaPacketParser& parser,
                            std::array<std::uint8_t, 4> src_ip);
+  void process_ud_send_packet(RdmaQueuePair& qp,
+                              const RdmaPacketParser& parser,
+                              std::array<std::uint8_t, 4> src_ip,
+                              std::array<std::uint8_t, 4> dst_ip);
   void process_write_packet(RdmaQueuePair& qp, const RdmaPacketParser& parser);
+  void complete_write_result(RdmaQueuePair& qp, const WriteResult& result);
+  void retire_placed_writes(RdmaQueuePair& qp);
   void process_read_request_packet(RdmaQueuePair& qp, const RdmaPacketParser& parser);
   void process_read_response_packet(RdmaQueuePair& qp, const RdmaPacketParser& parser);
   void process_ack_packet(RdmaQueuePair& qp, const RdmaPacketParser& parser);
   void process_cnp_packet(RdmaQueuePair& qp, const RdmaPacketParser& parser);
   void generate_ack(RdmaQueuePair& qp, std::uint32_t psn, AethSyndrome syndrome);
   void generate_nak(RdmaQueuePair& qp, std::uint32_t psn, AethSyndrome syndrome);
-  void queue_outgoing_packet(std::vector<std::byte> packet, RdmaQueuePair& qp);
+  bool process_udp_payload(std::span<const std::byte> udp_payload,
+                           std::array<std::uint8_t, 4> src_ip,
+                           std::array<std::uint8_t, 4> dst_ip,
+                           EcnCodepoint ecn);
+  void update_qp_header_template(RdmaQueuePair& qp, const RdmaQpModifyParams& params);
+  [[nodiscard]] RoceFlowAttr default_flow_attr() const;
+  void set_src_port_config(std::uint32_t qp_number, const SrcPortConfig& config);
+  [[nodiscard]] std::uint16_t select_src_port(const RdmaQueuePair& qp);
+  void queue_outgoing_packet(std::vector<std::byte> packet,
+                             RdmaQueuePair& qp,
+                             std::optional<std::uint8_t> traffic_class = std::nullopt);
   void deliver_cqe(std::uint32_t cq_number, const RdmaCqe& cqe);
+  void check_cq_event(RdmaCompletionQueue& cq);
+  void raise_cq_event(RdmaCompletionQueue& cq);
+  void expire_cq_moderation();
+  void check_srq_limit(const RdmaQueuePair& qp);
 };
 
 }  // namespace nic::rocev2
@@ -65,6 +65,51 @@ inline constexpr bit_fields::PacketFormat<1> kImmediateFormat{{{
     bit_fields::FieldDef{"immediate", 32},
 }}};
 
+/// Invalidate Extended Transport Header (IETH) - 32 bits / 4 bytes
+///
+/// Format:
+///   Bytes 0-3:    rkey (32 bits)
+inline constexpr bit_fields::PacketFormat<1> kIethFormat{{{
+    bit_fields::FieldDef{"rkey", 32},
+}}};
+
+/// Datagram Extended Transport Header (DETH) - 64 bits / 8 bytes
+///
+/// Format:
+///   Bytes 0-3:    qkey (32 bits)
+///   Byte 4:       reserved (8 bits)
+///   Bytes 5-7:    src_qp (24 bits)
+inline constexpr bit_fields::PacketFormat<3> kDethFormat{{{
+    bit_fields::FieldDef{"qkey", 32},
+    bit_fields::FieldDef{"_reserved", 8},
+    bit_fields::FieldDef{"src_qp", 24},
+}}};
+
+/// Global Route Header (GRH) - 320 bits / 40 bytes
+///
+/// Not carried on the RoCEv2 wire; the responder synthesizes it from the IP header and
+/// places it at the start of UD receive buffers. IPv4 addresses use IPv4-mapped GIDs.
+///
+/// Format:
+///   Byte 0-3:     ip_version(4) | traffic_class(8) | flow_label(20)
+///   Bytes 4-5:    payload_length (16 bits)
+///   Byte 6:       next_header (8 bits)
+///   Byte 7:       hop_limit (8 bits)
+///   Bytes 8-23:   sgid (128 bits)
+///   Bytes 24-39:  dgid (128 bits)
+inline constexpr bit_fields::PacketFormat<10> kGrhFormat{{{
+    bit_fields::FieldDef{"ip_version", 4},
+    bit_fields::FieldDef{"traffic_class", 8},
+    bit_fields::FieldDef{"flow_label", 20},
+    bit_fields::FieldDef{"payload_length", 16},
+    bit_fields::FieldDef{"next_header", 8},
+    bit_fields::FieldDef{"hop_limit", 8},
+    bit_fields::FieldDef{"sgid_hi", 64},
+    bit_fields::FieldDef{"sgid_lo", 64},
+    bit_fields::FieldDef{"dgid_hi", 64},
+    bit_fields::FieldDef{"dgid_lo", 64},
+}}};
+
 /// Atomic ETH Header - 224 bits / 28 bytes
 ///
 /// Format:
@@ -103,6 +148,12 @@ inline constexpr std::size_t kAethFormatSize = kAethFormat.total_bits() / 8;
 /// Size of Immediate Data header in bytes.
 inline constexpr std::size_t kImmediateFormatSize = kImmediateFormat.total_bits() / 8;
 
+/// Size of DETH header in bytes.
+inline constexpr std::size_t kDethFormatSize = kDethFormat.total_bits() / 8;
+
+/// Size of GRH in bytes.
+inline constexpr std::size_t kGrhFormatSize = kGrhFormat.total_bits() / 8;
+
 /// Size of Atomic ETH header in bytes.
 inline constexpr std::size_t kAtomicEthFormatSize = kAtomicEthFormat.total_bits() / 8;
 
@@ -117,6 +168,8 @@ static_assert(kBthFormatSize == 12, "BTH must be 12 bytes");
 static_assert(kRethFormatSize == 16, "RETH must be 16 bytes");
 static_assert(kAethFormatSize == 4, "AETH must be 4 bytes");
 static_assert(kImmediateFormatSize == 4, "Immediate must be 4 bytes");
+static_assert(kDethFormatSize == 8, "DETH must be 8 bytes");
+static_assert(kGrhFormatSize == 40, "GRH must be 40 bytes");
 static_assert(kAtomicEthFormatSize == 28, "AtomicETH must be 28 bytes");
 static_assert(kAtomicAckEthFormatSize == 8, "AtomicAckETH must be 8 bytes");
 
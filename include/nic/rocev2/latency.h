@@ -0,0 +1,64 @@
+#pragma once
+
+/// @file latency.h
+/// @brief Log-linear latency histogram for RDMA completion timing.
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace nic::rocev2 {
+
+/// HDR-style histogram of non-negative integer samples (e.g. microseconds).
+/// Values below kSubBuckets are counted exactly; above that, each power of two is
+/// split into kSubBuckets linear buckets, so a reported percentile is within
+/// 1/kSubBuckets (about 3%) of the recorded value. Buckets are allocated as larger
+/// values arrive, so an idle histogram holds no heap memory.
+class LatencyHistogram {
+public:
+  static constexpr unsigned kSubBucketBits = 5;
+  static constexpr std::uint64_t kSubBuckets = std::uint64_t{1} << kSubBucketBits;
+
+  /// Count one sample.
+  void record(std::uint64_t value);
+
+  /// Add every sample of another histogram.
+  void merge(const LatencyHistogram& other);
+
+  /// Forget all samples.
+  void reset() noexcept;
+
+  [[nodiscard]] std::uint64_t count() const noexcept { return count_; }
+  [[nodiscard]] std::uint64_t min() const noexcept { return (count_ == 0) ? 0 : min_; }
+  [[nodiscard]] std::uint64_t max() const noexcept { return max_; }
+  [[nodiscard]] double mean() const noexcept {
+    return (count_ == 0) ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+  }
+
+  /// Get the smallest value that at least percentile% of the samples do not exceed,
+  /// rounded up to its bucket's upper bound and clamped to max().
+  /// @param percentile In [0, 100], e.g. 50, 99 or 99.9.
+  /// @return 0 if the histogram is empty.
+  [[nodiscard]] std::uint64_t value_at_percentile(double percentile) const noexcept;
+
+  /// Get the heap bytes held by the bucket counts.
+  [[nodiscard]] std::size_t heap_bytes() const noexcept {
+    return counts_.capacity() * sizeof(std::uint64_t);
+  }
+
+  /// Get the index of the bucket counting value.
+  [[nodiscard]] static std::size_t bucket_index(std::uint64_t value) noexcept;
+
+  /// Get the largest value counted by a bucket.
+  [[nodiscard]] static std::uint64_t bucket_upper_bound(std::size_t index) noexcept;
+
+private:
+  std::vector<std::uint64_t> counts_{};
+  std::uint64_t count_{0};
+  std::uint64_t sum_{0};
+  std::uint64_t min_{std::numeric_limits<std::uint64_t>::max()};
+  std::uint64_t max_{0};
+};
+
+}  // namespace nic::rocev2
@@ -4,9 +4,11 @@
 /// @brief Memory Region management for RoCEv2.
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "nic/host_memory.h"
 #include "nic/rocev2/types.h"
@@ -23,11 +25,35 @@ struct MemoryRegion {
   std::uint32_t pd_handle;      // Protection domain
   AccessFlags access;           // Access permissions
   bool is_valid{true};          // Invalidation flag
+
+  // Fast registration and memory windows
+  bool fast_reg{false};                   // Remapped by RegMr WQEs; starts invalid
+  std::size_t max_length{0};              // Fast-reg: largest mapping RegMr may install
+  bool is_window{false};                  // Type-2 memory window; lkey is its handle
+  std::uint32_t parent_lkey{0};           // Window: MR the window is bound into
+  std::optional<std::uint32_t> bound_qp;  // Window: only this QP may use the rkey
+};
+
+/// Outcome of an access check against a region that may page on demand.
+enum class MrAccessStatus : std::uint8_t {
+  Ok,
+  Denied,     // Bad key, bounds, PD or permissions
+  PageFault,  // Allowed, but an ODP page in the range is not present
+};
+
+/// Page fault raised by an access to a non-present page of an ODP MR.
+struct OdpPageFault {
+  std::uint32_t lkey{0};   // Faulting MR (the parent MR for a window access)
+  HostAddress address{0};  // First non-present page (page aligned)
+  std::size_t length{0};   // Bytes from address to the end of the access, page aligned
+  bool is_write{false};    // Access needs the page writable
+  bool is_remote{false};   // Raised by an incoming request rather than a local WQE
 };
 
 /// Memory Region table configuration.
 struct MrTableConfig {
   std::size_t max_mrs{4096};
+  std::size_t odp_page_size{4096};  // Page granularity of ODP faults and prefetch
 };
 
 /// Memory Region table statistics.
@@ -38,11 +64,26 @@ struct MrTableStats {
   std::uint64_t rkey_validations{0};
   std::uint64_t access_errors{0};
   std::uint64_t registration_failures{0};
+  std::uint64_t fast_registrations{0};
+  std::uint64_t invalidations{0};
+  std::uint64_t window_binds{0};
+  std::uint64_t page_faults{0};        // ODP faults raised to the fault handler
+  std::uint64_t pages_populated{0};    // Pages made present by fault resolution
+  std::uint64_t pages_prefetched{0};   // Pages made present by prefetch advice
+  std::uint64_t pages_invalidated{0};  // Present pages dropped by invalidate_range()
 };
 
 /// Memory Region Table - manages MR registrations.
+///
+/// MRs registered with AccessFlags::on_demand are not pinned: the table tracks which
+/// host pages are present, and an access to a missing page raises an OdpPageFault
+/// to the host-side handler instead of failing. The handler may populate the pages
+/// before returning, or later through populate().
 class MemoryRegionTable {
 public:
+  /// Host-side page fault handler (the ODP equivalent of the kernel fault path).
+  using PageFaultHandler = std::function<void(const OdpPageFault&)>;
+
   explicit MemoryRegionTable(MrTableConfig config = {});
 
   /// Register a memory region.
@@ -61,6 +102,67 @@ public:
   /// @return true if successfully deregistered.
   bool deregister_mr(std::uint32_t lkey);
 
+  /// Allocate an MR for fast registration. The MR starts invalid and gets its
+  /// mapping from a RegMr work request.
+  /// @param pd_handle Protection domain handle.
+  /// @param max_length Largest mapping the MR may be registered over.
+  /// @return lkey on success, std::nullopt on failure.
+  [[nodiscard]] std::optional<std::uint32_t> allocate_fast_reg_mr(std::uint32_t pd_handle,
+                                                                  std::size_t max_length);
+
+  /// Map a fast-register MR over a new range (RegMr work request).
+  /// @param lkey MR allocated by allocate_fast_reg_mr; must be invalid.
+  /// @param pd_handle Protection domain of the posting QP.
+  /// @param virtual_address Base address of the new mapping.
+  /// @param length Size in bytes (at most the MR's max_length).
+  /// @param access Access permissions of the new mapping.
+  /// @param new_rkey rkey to assign, or 0 to keep the current one.
+  /// @return true if the MR now maps the range.
+  bool fast_register(std::uint32_t lkey,
+                     std::uint32_t pd_handle,
+                     HostAddress virtual_address,
+                     std::size_t length,
+                     AccessFlags access,
+                     std::uint32_t new_rkey);
+
+  /// Invalidate a fast-register MR or a memory window by rkey.
+  /// @param rkey Key to invalidate (a fast-register MR's lkey is also accepted).
+  /// @param pd_handle Protection domain of the invalidating QP.
+  /// @param qp_number Set for remote invalidation: a window must be bound to this QP.
+  /// @return true if the key was invalidated.
+  bool invalidate(std::uint32_t rkey,
+                  std::uint32_t pd_handle,
+                  std::optional<std::uint32_t> qp_number = std::nullopt);
+
+  /// Allocate a type-2 memory window.
+  /// @param pd_handle Protection domain handle.
+  /// @return Window rkey on success, std::nullopt on failure.
+  [[nodiscard]] std::optional<std::uint32_t> allocate_mw(std::uint32_t pd_handle);
+
+  /// Deallocate a memory window.
+  /// @param rkey Current rkey of the window.
+  /// @return true if the window was deallocated.
+  bool deallocate_mw(std::uint32_t rkey);
+
+  /// Bind a type-2 memory window to a range of an MR (BindMw work request).
+  /// @param rkey Current rkey of the window; the window must be unbound.
+  /// @param parent_lkey MR the window grants access into (needs mw_bind access).
+  /// @param pd_handle Protection domain of the posting QP.
+  /// @param virtual_address Base address of the window.
+  /// @param length Size in bytes, within the parent MR.
+  /// @param access Remote access rights granted through the window.
+  /// @param qp_number QP the window is bound to.
+  /// @param new_rkey rkey to assign, or 0 to keep the current one.
+  /// @return true if the window is bound.
+  bool bind_mw(std::uint32_t rkey,
+               std::uint32_t parent_lkey,
+               std::uint32_t pd_handle,
+               HostAddress virtual_address,
+               std::size_t length,
+               AccessFlags access,
+               std::uint32_t qp_number,
+               std::uint32_t new_rkey);
+
   /// Validate lkey access for local operations.
   /// @param lkey Local key to validate.
   /// @param address Address within the MR.
@@ -78,12 +180,50 @@ public:
   /// @param address Address within the MR.
   /// @param length Length of the access.
   /// @param is_write true if write access required.
+  /// @param qp_number QP the request arrived on (a window must be bound to it).
   /// @return true if access is valid.
   [[nodiscard]] bool validate_rkey(std::uint32_t rkey,
                                    std::uint32_t pd_handle,
                                    HostAddress address,
                                    std::size_t length,
-                                   bool is_write) const;
+                                   bool is_write,
+                                   std::optional<std::uint32_t> qp_number = std::nullopt) const;
+
+  /// Check lkey access, raising a page fault if an ODP page is missing.
+  /// @return Ok, Denied, or PageFault if the range is still not present after the handler ran.
+  [[nodiscard]] MrAccessStatus access_lkey(std::uint32_t lkey,
+                                           HostAddress address,
+                                           std::size_t length,
+                                           bool is_write);
+
+  /// Check rkey access, raising a page fault if an ODP page is missing.
+  /// @return Ok, Denied, or PageFault if the range is still not present after the handler ran.
+  [[nodiscard]] MrAccessStatus access_rkey(std::uint32_t rkey,
+                                           std::uint32_t pd_handle,
+                                           HostAddress address,
+                                           std::size_t length,
+                                           bool is_write,
+                                           std::optional<std::uint32_t> qp_number = std::nullopt);
+
+  /// Install the handler that receives ODP page faults.
+  void set_page_fault_handler(PageFaultHandler handler) { fault_handler_ = std::move(handler); }
+
+  /// Resolve a page fault: mark the pages of a range present.
+  /// @return Number of pages that became present.
+  std::size_t populate(HostAddress address, std::size_t length);
+
+  /// Prefetch advice: make the pages of an ODP MR range present ahead of access.
+  /// @param lkey ODP MR the range belongs to.
+  /// @return Number of pages that became present, or nullopt if the range is not in an ODP MR.
+  std::optional<std::size_t> prefetch(std::uint32_t lkey, HostAddress address, std::size_t length);
+
+  /// Invalidation callback for the host's MMU notifier: pages of the range are no
+  /// longer mapped, so the next access to them faults again.
+  /// @return Number of present pages dropped.
+  std::size_t invalidate_range(HostAddress address, std::size_t length);
+
+  /// Check whether every page of a range is present.
+  [[nodiscard]] bool pages_present(HostAddress address, std::size_t length) const;
 
   /// Get MR by lkey.
   [[nodiscard]] const MemoryRegion* get_by_lkey(std::uint32_t lkey) const noexcept;
@@ -94,6 +234,9 @@ public:
   /// Get current count of registered MRs.
   [[nodiscard]] std::size_t count() const noexcept { return mrs_by_lkey_.size(); }
 
+  /// Get current count of allocated memory windows.
+  [[nodiscard]] std::size_t window_count() const noexcept { return windows_.size(); }
+
   /// Get statistics.
   [[nodiscard]] const MrTableStats& stats() const noexcept { return stats_; }
 
@@ -104,16 +247,41 @@ private:
   MrTableConfig config_;
   std::unordered_map<std::uint32_t, std::unique_ptr<MemoryRegion>> mrs_by_lkey_;
   std::unordered_map<std::uint32_t, MemoryRegion*> mrs_by_rkey_;
+  std::unordered_map<std::uint32_t, std::unique_ptr<MemoryRegion>> windows_;  // By allocation key
   std::uint32_t next_key_{0x100};  // Start above 0 to catch null key bugs
   mutable MrTableStats stats_;
+  std::unordered_set<std::uint64_t> odp_present_pages_;  // Host page numbers, shared by ODP MRs
+  PageFaultHandler fault_handler_;
 
   [[nodiscard]] std::uint32_t generate_key();
 
+  /// Move a region to a new rkey; fails if another region holds it.
+  [[nodiscard]] bool rekey(MemoryRegion& mr, std::uint32_t new_rkey);
+
   [[nodiscard]] bool validate_access(const MemoryRegion* mr,
                                      HostAddress address,
                                      std::size_t length,
                                      bool is_write,
                                      bool is_remote) const;
+
+  /// Find the MR of an rkey access that passes the key, PD and window checks.
+  [[nodiscard]] const MemoryRegion* find_remote(std::uint32_t rkey,
+                                                std::uint32_t pd_handle,
+                                                std::optional<std::uint32_t> qp_number) const;
+
+  /// Mark the pages of a range present.
+  /// @return Number of pages that were not present before.
+  std::size_t add_present_pages(HostAddress address, std::size_t length);
+
+  /// Whether an access through mr must check ODP page presence.
+  [[nodiscard]] bool is_on_demand(const MemoryRegion& mr) const noexcept;
+
+  /// Raise a fault for the first missing page of a range and let the handler run.
+  [[nodiscard]] MrAccessStatus fault_in(const MemoryRegion& mr,
+                                        HostAddress address,
+                                        std::size_t length,
+                                        bool is_write,
+                                        bool is_remote);
 };
 
 }  // namespace nic::rocev2
@@ -19,6 +19,8 @@ inline constexpr std::size_t kBthSize = 12;   // Base Transport Header
 inline constexpr std::size_t kRethSize = 16;  // RDMA Extended Transport Header
 inline constexpr std::size_t kAethSize = 4;   // ACK Extended Transport Header
 inline constexpr std::size_t kImmSize = 4;    // Immediate Data
+inline constexpr std::size_t kIethSize = 4;   // Invalidate Extended Transport Header
+inline constexpr std::size_t kDethSize = 8;   // Datagram Extended Transport Header
 inline constexpr std::size_t kIcrcSize = 4;   // Invariant CRC
 
 /// Parsed Base Transport Header.
@@ -43,12 +45,22 @@ struct RethFields {
   std::uint32_t dma_length;
 };
 
+/// AETH credit count code of an ACK that carries no credit information (e.g. SRQ QPs).
+inline constexpr std::uint8_t kAethCreditsInvalid = 0x1F;
+
 /// Parsed ACK Extended Transport Header.
 struct AethFields {
-  AethSyndrome syndrome;
+  AethSyndrome syndrome;        // ACK/RNR NAK type, or the full NAK code
+  std::uint8_t syndrome_value;  // Low 5 bits: credit count code (ACK) or RNR timer (RNR NAK)
   std::uint32_t msn;
 };
 
+/// Parsed Datagram Extended Transport Header.
+struct DethFields {
+  std::uint32_t qkey;
+  std::uint32_t src_qp;
+};
+
 /// RoCEv2 packet builder - constructs packets with proper headers.
 class RdmaPacketBuilder {
 public:
@@ -72,11 +84,19 @@ public:
 
   /// Set AETH fields (for ACK/NAK).
   RdmaPacketBuilder& set_syndrome(AethSyndrome syndrome);
+  RdmaPacketBuilder& set_syndrome_value(std::uint8_t value);
   RdmaPacketBuilder& set_msn(std::uint32_t msn);
 
+  /// Set DETH fields (for UD SEND).
+  RdmaPacketBuilder& set_qkey(std::uint32_t qkey);
+  RdmaPacketBuilder& set_src_qp(std::uint32_t src_qp);
+
   /// Set immediate data.
   RdmaPacketBuilder& set_immediate(std::uint32_t imm);
 
+  /// Set IETH rkey (for SEND with Invalidate).
+  RdmaPacketBuilder& set_invalidate_rkey(std::uint32_t rkey);
+
   /// Set payload data.
   RdmaPacketBuilder& set_payload(std::span<const std::byte> data);
 
@@ -105,12 +125,20 @@ private:
 
   // AETH fields
   AethSyndrome syndrome_{AethSyndrome::Ack};
+  std::uint8_t syndrome_value_{0};
   std::uint32_t msn_{0};
 
+  // DETH fields
+  std::uint32_t qkey_{0};
+  std::uint32_t src_qp_{0};
+
   // Immediate data
   std::uint32_t immediate_{0};
   bool has_immediate_{false};
 
+  // IETH fields
+  std::uint32_t invalidate_rkey_{0};
+
   // Payload
   std::vector<std::byte> payload_;
 
@@ -120,9 +148,15 @@ private:
   /// Check if opcode requires AETH header.
   [[nodiscard]] bool needs_aeth() const noexcept;
 
+  /// Check if opcode requires DETH header.
+  [[nodiscard]] bool needs_deth() const noexcept;
+
   /// Check if opcode has immediate data variant.
   [[nodiscard]] bool has_immediate_variant() const noexcept;
 
+  /// Check if opcode requires IETH header.
+  [[nodiscard]] bool needs_ieth() const noexcept;
+
   /// Write BTH to buffer.
   void write_bth(std::span<std::byte> buffer) const;
 
@@ -132,8 +166,14 @@ private:
   /// Write AETH to buffer.
   void write_aeth(std::span<std::byte> buffer) const;
 
+  /// Write DETH to buffer.
+  void write_deth(std::span<std::byte> buffer) const;
+
   /// Write immediate data to buffer.
   void write_immediate(std::span<std::byte> buffer) const;
+
+  /// Write IETH to buffer.
+  void write_ieth(std::span<std::byte> buffer) const;
 };
 
 /// RoCEv2 packet parser - extracts fields from received packets.
@@ -153,9 +193,15 @@ public:
   /// Get parsed AETH fields (valid only if has_aeth() is true).
   [[nodiscard]] const AethFields& aeth() const noexcept { return aeth_; }
 
+  /// Get parsed DETH fields (valid only if has_deth() is true).
+  [[nodiscard]] const DethFields& deth() const noexcept { return deth_; }
+
   /// Get immediate data (valid only if has_immediate() is true).
   [[nodiscard]] std::uint32_t immediate() const noexcept { return immediate_; }
 
+  /// Get the rkey to invalidate (valid only if has_ieth() is true).
+  [[nodiscard]] std::uint32_t invalidate_rkey() const noexcept { return invalidate_rkey_; }
+
   /// Get payload span (excluding headers and ICRC).
   [[nodiscard]] std::span<const std::byte> payload() const noexcept { return payload_; }
 
@@ -165,9 +211,15 @@ public:
   /// Check if packet has AETH header.
   [[nodiscard]] bool has_aeth() const noexcept { return has_aeth_; }
 
+  /// Check if packet has DETH header.
+  [[nodiscard]] bool has_deth() const noexcept { return has_deth_; }
+
   /// Check if packet has immediate data.
   [[nodiscard]] bool has_immediate() const noexcept { return has_immediate_; }
 
+  /// Check if packet has IETH header.
+  [[nodiscard]] bool has_ieth() const noexcept { return has_ieth_; }
+
   /// Verify ICRC of the packet.
   /// @param data Full packet data including ICRC.
   /// @return true if ICRC is valid.
@@ -177,11 +229,15 @@ private:
   BthFields bth_{};
   RethFields reth_{};
   AethFields aeth_{};
+  DethFields deth_{};
   std::uint32_t immediate_{0};
+  std::uint32_t invalidate_rkey_{0};
   std::span<const std::byte> payload_;
   bool has_reth_{false};
   bool has_aeth_{false};
+  bool has_deth_{false};
   bool has_immediate_{false};
+  bool has_ieth_{false};
 
   /// Parse BTH from data.
   bool parse_bth(std::span<const std::byte> data);
@@ -219,5 +275,18 @@ private:
 [[nodiscard]] bool opcode_is_only(RdmaOpcode op) noexcept;
 [[nodiscard]] bool opcode_has_payload(RdmaOpcode op) noexcept;
 [[nodiscard]] bool opcode_is_read_response(RdmaOpcode op) noexcept;
+[[nodiscard]] bool opcode_is_ud(RdmaOpcode op) noexcept;
+
+/// Decode the 5-bit RNR timer of an RNR NAK (IBA table 45) into microseconds.
+/// Code 0 is the longest wait (655.36 ms); codes 1-31 run from 10 us to 491.52 ms.
+[[nodiscard]] std::uint64_t rnr_timer_us(std::uint8_t code) noexcept;
+
+/// Encode a number of available receive WQEs as an AETH credit count code,
+/// rounding down to the nearest value the 5-bit logarithmic encoding can express.
+[[nodiscard]] std::uint8_t encode_aeth_credits(std::size_t recv_wqes) noexcept;
+
+/// Decode an AETH credit count code.
+/// @return Number of receive WQEs, or nullopt for kAethCreditsInvalid.
+[[nodiscard]] std::optional<std::uint32_t> decode_aeth_credits(std::uint8_t code) noexcept;
 
 }  // namespace nic::rocev2
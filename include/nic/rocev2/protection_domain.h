@@ -19,8 +19,14 @@ public:
 
   [[nodiscard]] std::uint32_t handle() const noexcept { return handle_; }
 
+  /// Count an object (QP, MR, MW, AH) created in the PD.
+  void acquire() noexcept { ++ref_count_; }
+  void release() noexcept { --ref_count_; }
+  [[nodiscard]] std::uint32_t ref_count() const noexcept { return ref_count_; }
+
 private:
   std::uint32_t handle_;
+  std::uint32_t ref_count_{0};  // Objects still using the PD
 };
 
 /// Protection Domain table configuration.
@@ -33,6 +39,7 @@ struct PdTableStats {
   std::uint64_t allocations{0};
   std::uint64_t deallocations{0};
   std::uint64_t allocation_failures{0};
+  std::uint64_t busy_deallocations{0};  // Refused because objects still use the PD
 };
 
 /// Protection Domain table - manages PD allocations.
@@ -46,7 +53,7 @@ public:
 
   /// Deallocate a protection domain.
   /// @param pd_handle The PD handle to deallocate.
-  /// @return true if successfully deallocated, false if handle not found.
+  /// @return true if successfully deallocated, false if handle not found or still in use.
   bool deallocate(std::uint32_t pd_handle);
 
   /// Check if a PD handle is valid.
@@ -0,0 +1,88 @@
+#pragma once
+
+/// @file psn_bitmap.h
+/// @brief Bitmap of received PSNs for out-of-order packet placement.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "nic/rocev2/types.h"
+
+namespace nic::rocev2 {
+
+/// Tracks which PSNs of the window [base, base + size) have arrived. The bits form a
+/// ring, so moving the base forward costs one step per PSN and never shifts words.
+class PsnBitmap {
+public:
+  PsnBitmap() = default;
+  PsnBitmap(std::uint32_t base, std::uint32_t size)
+    : words_((static_cast<std::size_t>(size) + 63) / 64, 0), base_(base), size_(size) {}
+
+  [[nodiscard]] std::uint32_t base() const noexcept { return base_; }
+  [[nodiscard]] std::uint32_t size() const noexcept { return size_; }
+  [[nodiscard]] std::uint32_t count() const noexcept { return count_; }
+  [[nodiscard]] bool full() const noexcept { return count_ == size_; }
+
+  /// Check whether a PSN falls inside the window.
+  [[nodiscard]] bool contains(std::uint32_t psn) const noexcept {
+    return psn_in_window(psn, base_, size_);
+  }
+
+  /// Check whether a PSN inside the window has arrived.
+  [[nodiscard]] bool test(std::uint32_t psn) const noexcept {
+    if (!contains(psn)) {
+      return false;
+    }
+    std::uint32_t bit = slot(psn);
+    return ((words_[bit / 64] >> (bit % 64)) & 1U) != 0;
+  }
+
+  /// Mark a PSN as arrived.
+  /// @return false if the PSN is outside the window or already marked.
+  bool set(std::uint32_t psn) noexcept {
+    if (!contains(psn) || test(psn)) {
+      return false;
+    }
+    std::uint32_t bit = slot(psn);
+    words_[bit / 64] |= std::uint64_t{1} << (bit % 64);
+    ++count_;
+    return true;
+  }
+
+  /// Slide the window forward by one PSN, forgetting the base.
+  void advance_base() noexcept {
+    if (test(base_)) {
+      words_[head_ / 64] &= ~(std::uint64_t{1} << (head_ % 64));
+      --count_;
+    }
+    head_ = (size_ == 0) ? 0 : (head_ + 1) % size_;
+    base_ = advance_psn(base_);
+  }
+
+  /// Slide the window forward until its base is psn (PSNs consumed by another path).
+  void skip_to(std::uint32_t psn) noexcept {
+    while ((base_ != psn) && (count_ != 0)) {
+      advance_base();
+    }
+    base_ = psn;
+  }
+
+  /// Get the heap bytes held by the bit words.
+  [[nodiscard]] std::size_t heap_bytes() const noexcept {
+    return words_.capacity() * sizeof(std::uint64_t);
+  }
+
+private:
+  [[nodiscard]] std::uint32_t slot(std::uint32_t psn) const noexcept {
+    return (head_ + ((psn - base_) & kMaxPsn)) % size_;
+  }
+
+  std::vector<std::uint64_t> words_{};
+  std::uint32_t base_{0};
+  std::uint32_t size_{0};
+  std::uint32_t head_{0};   // Ring slot of base_
+  std::uint32_t count_{0};  // PSNs marked inside the window
+};
+
+}  // namespace nic::rocev2
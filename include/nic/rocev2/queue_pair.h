@@ -5,10 +5,13 @@
 
 #include <cstdint>
 #include <deque>
+#include <memory>
 #include <optional>
 #include <vector>
 
 #include "nic/rocev2/completion_queue.h"
+#include "nic/rocev2/encap.h"
+#include "nic/rocev2/srq.h"
 #include "nic/rocev2/types.h"
 #include "nic/rocev2/wqe.h"
 #include "nic/trace.h"
@@ -25,11 +28,16 @@ struct RdmaQpConfig {
   std::uint32_t pd_handle{0};          // Protection domain
   std::uint32_t send_cq_number{0};     // Send completion queue
   std::uint32_t recv_cq_number{0};     // Receive completion queue
+  std::uint32_t srq_number{0};         // Shared receive queue (0 = private recv queue)
   std::uint32_t max_inline_data{256};  // Maximum inline data size
   std::uint32_t retry_count{7};        // Number of retries before error
-  std::uint32_t rnr_retry_count{7};    // RNR retry count
+  std::uint32_t rnr_retry_count{7};    // RNR retries before RnrRetryExceededError (7 = infinite)
   std::uint32_t timeout{14};           // Timeout exponent (4.096us * 2^timeout)
-  std::uint32_t min_rnr_timer{12};     // Min RNR NAK timer exponent
+  std::uint32_t min_rnr_timer{12};     // RNR timer code sent in RNR NAKs (see rnr_timer_us)
+  bool sq_sig_all{false};              // Signal every send WQE regardless of SendWqe::signaled
+  std::uint32_t sq_signal_interval{0};  // Require a signaled WQE at least every N sends (0 = off)
+  /// Host-resident WQE ring of send_queue_depth slots for doorbell posting (nullopt = none).
+  std::optional<HostAddress> sq_ring_address{};
 };
 
 /// Queue Pair state transition parameters.
@@ -42,12 +50,16 @@ struct RdmaQpModifyParams {
   std::optional<std::uint16_t> dest_port;
   std::optional<std::uint32_t> sq_psn;
   std::optional<std::uint32_t> rq_psn;
-  std::optional<std::uint8_t> path_mtu;  // 1=256, 2=512, 3=1024, 4=2048, 5=4096
+  std::optional<std::uint8_t> path_mtu;       // 1=256, 2=512, 3=1024, 4=2048, 5=4096
+  std::optional<std::uint32_t> qkey;          // UD Q_Key
+  std::optional<MacAddress> dest_mac;         // Next-hop MAC (used when encapsulation is enabled)
+  std::optional<std::uint8_t> traffic_class;  // DSCP/ECN of the QP's packets
+  std::optional<SrcPortConfig> src_port;      // UDP source port policy (RC)
 };
 
 /// Pending operation for reliability tracking.
 struct PendingOperation {
-  SendWqe wqe;
+  SendWqeRecord wqe;           // What to resend (no inline buffer unless the WQE was inline)
   std::uint32_t psn;           // Starting PSN of this operation
   std::uint32_t num_packets;   // Number of packets for this WQE
   std::uint64_t timestamp_us;  // When the operation was sent
@@ -96,9 +108,14 @@ public:
   [[nodiscard]] std::optional<SendWqe> get_next_send();
 
   /// Get a receive WQE to consume incoming data.
+  /// Draws from the attached SRQ when one is set, otherwise from the private recv queue.
   /// @return WQE if available, nullopt otherwise.
   [[nodiscard]] std::optional<RecvWqe> consume_recv();
 
+  /// Attach a shared receive queue. The QP then stops accepting private recv WQEs.
+  /// @param srq The SRQ to draw receive WQEs from (nullptr detaches).
+  void attach_srq(RdmaSharedReceiveQueue* srq) noexcept { srq_ = srq; }
+
   /// Record that a packet was sent.
   /// @param bytes Number of bytes in the packet.
   void record_packet_sent(std::size_t bytes);
@@ -115,20 +132,29 @@ public:
   /// Add a pending operation for reliability tracking.
   /// @param wqe The WQE being sent.
   /// @param num_packets Number of packets for this WQE.
-  void add_pending_operation(const SendWqe& wqe, std::uint32_t num_packets);
+  /// @param start_psn PSN of the WQE's first packet (nullopt = the current send PSN).
+  void add_pending_operation(const SendWqe& wqe,
+                             std::uint32_t num_packets,
+                             std::optional<std::uint32_t> start_psn = std::nullopt);
+
+  /// Remove the pending operations from the one holding psn onward, for go-back-N resending.
+  /// @param psn PSN inside the first operation to resend.
+  /// @return The removed operations in PSN order (empty if no operation holds psn).
+  [[nodiscard]] std::vector<PendingOperation> take_pending_from(std::uint32_t psn);
 
   /// Check for timeout and retransmit if needed.
   /// @param current_time_us Current time in microseconds.
   /// @return Vector of WQEs to retransmit.
-  [[nodiscard]] std::vector<SendWqe> check_timeouts(std::uint64_t current_time_us);
+  [[nodiscard]] std::vector<SendWqeRecord> check_timeouts(std::uint64_t current_time_us);
 
   /// Advance time for deterministic simulation.
   /// @param elapsed_us Microseconds elapsed.
   void advance_time(std::uint64_t elapsed_us);
 
   /// Generate next send PSN and advance.
+  /// @param count Number of PSNs to take (a READ takes one per response packet).
   /// @return The current send PSN before advancing.
-  [[nodiscard]] std::uint32_t next_send_psn();
+  [[nodiscard]] std::uint32_t next_send_psn(std::uint32_t count = 1);
 
   /// Get the last PSN that was sent (current sq_psn - 1).
   [[nodiscard]] std::uint32_t last_sent_psn() const noexcept {
@@ -139,7 +165,25 @@ public:
   [[nodiscard]] std::uint32_t expected_recv_psn() const noexcept { return rq_psn_; }
 
   /// Advance expected receive PSN.
-  void advance_recv_psn();
+  /// @param count Number of PSNs to skip (a READ request covers one per response packet).
+  void advance_recv_psn(std::uint32_t count = 1);
+
+  /// Check if a send WQE generates a CQE on success on this QP.
+  [[nodiscard]] bool is_send_signaled(const SendWqe& wqe) const noexcept {
+    return config_.sq_sig_all || wqe.signaled;
+  }
+
+  /// Check if posting a send would break the sq_signal_interval requirement.
+  /// @param signaled Whether the WQE being posted is signaled.
+  /// @return true if an unsignaled WQE would leave sq_signal_interval sends without a CQE.
+  [[nodiscard]] bool violates_signal_interval(bool signaled) const noexcept;
+
+  /// Record a successfully posted send for signaling-interval tracking.
+  /// @param signaled Whether the posted WQE was signaled.
+  void record_send_signaling(bool signaled) noexcept;
+
+  /// Get the number of unsignaled sends posted since the last signaled one.
+  [[nodiscard]] std::uint32_t unsignaled_run() const noexcept { return unsignaled_run_; }
 
   // Accessors
   [[nodiscard]] std::uint32_t qp_number() const noexcept { return qp_number_; }
@@ -148,13 +192,22 @@ public:
   [[nodiscard]] std::uint32_t pd_handle() const noexcept { return config_.pd_handle; }
   [[nodiscard]] std::uint32_t send_cq_number() const noexcept { return config_.send_cq_number; }
   [[nodiscard]] std::uint32_t recv_cq_number() const noexcept { return config_.recv_cq_number; }
+  [[nodiscard]] std::uint32_t srq_number() const noexcept { return config_.srq_number; }
+  [[nodiscard]] RdmaSharedReceiveQueue* srq() const noexcept { return srq_; }
   [[nodiscard]] std::uint32_t dest_qp_number() const noexcept { return dest_qp_number_; }
   [[nodiscard]] std::uint32_t sq_psn() const noexcept { return sq_psn_; }
   [[nodiscard]] std::uint32_t rq_psn() const noexcept { return rq_psn_; }
   [[nodiscard]] std::uint8_t path_mtu() const noexcept { return path_mtu_; }
-  [[nodiscard]] std::size_t send_queue_size() const noexcept { return send_queue_.size(); }
-  [[nodiscard]] std::size_t recv_queue_size() const noexcept { return recv_queue_.size(); }
-  [[nodiscard]] std::size_t pending_count() const noexcept { return pending_operations_.size(); }
+  [[nodiscard]] std::uint32_t qkey() const noexcept { return qkey_; }
+  [[nodiscard]] std::size_t send_queue_size() const noexcept {
+    return queues_ ? queues_->send_queue.size() : 0;
+  }
+  [[nodiscard]] std::size_t recv_queue_size() const noexcept {
+    return queues_ ? queues_->recv_queue.size() : 0;
+  }
+  [[nodiscard]] std::size_t pending_count() const noexcept {
+    return queues_ ? queues_->pending_operations.size() : 0;
+  }
   [[nodiscard]] const RdmaQpConfig& config() const noexcept { return config_; }
   [[nodiscard]] const RdmaQpStats& stats() const noexcept { return stats_; }
   [[nodiscard]] const std::array<std::uint8_t, 4>& dest_ip() const noexcept { return dest_ip_; }
@@ -163,6 +216,17 @@ public:
   /// Get MTU in bytes based on path_mtu setting.
   [[nodiscard]] std::uint32_t mtu_bytes() const noexcept;
 
+  /// Check if the QP currently holds allocated queue storage.
+  [[nodiscard]] bool has_queue_storage() const noexcept { return queues_ != nullptr; }
+
+  /// Free the queue storage if the send, recv, and pending queues are all empty.
+  /// Storage is allocated again by the next post.
+  /// @return true if storage was released.
+  bool release_idle_storage() noexcept;
+
+  /// Get the approximate host memory held by this QP, including queued WQEs.
+  [[nodiscard]] std::size_t memory_footprint() const noexcept;
+
   /// Reset QP to initial state.
   void reset();
 
@@ -190,22 +254,32 @@ private:
   std::array<std::uint8_t, 4> dest_ip_{};
   std::uint16_t dest_port_{kRoceUdpPort};
   std::uint8_t path_mtu_{3};  // Default 1024 bytes
+  std::uint32_t qkey_{0};     // UD Q_Key
 
   // PSN tracking
   std::uint32_t sq_psn_{0};  // Next PSN to send
   std::uint32_t rq_psn_{0};  // Next expected PSN to receive
   std::uint32_t last_acked_psn_{0};
 
-  // Work queues
-  std::deque<SendWqe> send_queue_;
-  std::deque<RecvWqe> recv_queue_;
-
-  // Reliability tracking
-  std::deque<PendingOperation> pending_operations_;
+  // Consecutive unsignaled sends since the last signaled one
+  std::uint32_t unsignaled_run_{0};
+
+  // Work queues and reliability tracking. Kept out of line and allocated on first
+  // post so that an idle QP costs only its fixed fields.
+  struct QueueStorage {
+    std::deque<SendWqe> send_queue;
+    std::deque<RecvWqe> recv_queue;
+    std::deque<PendingOperation> pending_operations;
+  };
+  std::unique_ptr<QueueStorage> queues_;
+  RdmaSharedReceiveQueue* srq_{nullptr};  // Owned by the engine; outlives attached QPs
   std::uint64_t current_time_us_{0};
 
   RdmaQpStats stats_;
 
+  /// Get the queue storage, allocating it on first use.
+  QueueStorage& queues();
+
   /// Validate state transition.
   [[nodiscard]] bool is_valid_transition(QpState from, QpState to) const;
 
@@ -13,6 +13,7 @@
 #include "nic/rocev2/cqe.h"
 #include "nic/rocev2/memory_region.h"
 #include "nic/rocev2/packet.h"
+#include "nic/rocev2/psn_bitmap.h"
 #include "nic/rocev2/queue_pair.h"
 #include "nic/rocev2/types.h"
 #include "nic/rocev2/wqe.h"
@@ -33,6 +34,8 @@ struct ReadRequestResult {
 struct ReadResponseResult {
   bool success{false};
   bool is_read_complete{false};  // True when all response packets received
+  std::uint32_t request_psn{0};  // PSN of the READ request the response belongs to
+  std::uint32_t last_psn{0};     // PSN of the READ's last response
   std::optional<RdmaCqe> cqe;    // CQE when read completes
 };
 
@@ -43,12 +46,11 @@ struct ReadRequestState {
   std::uint32_t local_lkey{0};      // Local key for write
   std::uint32_t total_length{0};    // Total expected response length
   std::uint32_t bytes_received{0};  // Bytes received so far
-  std::uint32_t expected_psn{0};    // Expected next response PSN
-  std::uint32_t start_psn{0};       // PSN of original request
-  std::vector<SglEntry> sgl;        // Scatter-gather list for local buffer
-  std::size_t current_sge_idx{0};   // Current SGE index
-  std::size_t sge_offset{0};        // Offset within current SGE
+  std::uint32_t start_psn{0};       // PSN of original request (and of the first response)
+  WqeSgl sgl;                       // Scatter-gather list for local buffer
+  PsnBitmap responses{};            // Response PSNs placed so far, one bit per packet
   bool in_progress{false};          // True if waiting for responses
+  bool signaled{true};              // Generate a CQE on successful completion
 };
 
 /// Responder state for incoming READ requests.
@@ -73,6 +75,9 @@ struct ReadStats {
   std::uint64_t rkey_errors{0};
   std::uint64_t sequence_errors{0};
   std::uint64_t access_errors{0};
+  std::uint64_t page_fault_naks{0};         // RNR NAKs sent while an ODP page was faulted in
+  std::uint64_t out_of_order_responses{0};  // Responses placed before their predecessor
+  std::uint64_t duplicate_responses{0};     // Responses for PSNs already placed
 };
 
 /// RDMA READ processor - handles READ request/response operations.
@@ -110,6 +115,13 @@ public:
   /// Clear read state for a QP (e.g., on QP reset).
   void clear_read_state(std::uint32_t qp_number);
 
+  /// Drop a QP's requester and responder state if no READ is in progress.
+  /// @return true if the QP holds no READ state afterwards.
+  bool release_idle_state(std::uint32_t qp_number);
+
+  /// Get the approximate host memory held by per-QP READ state.
+  [[nodiscard]] std::size_t memory_footprint() const noexcept;
+
 private:
   HostMemory& host_memory_;
   MemoryRegionTable& mr_table_;
@@ -125,13 +137,15 @@ private:
   [[nodiscard]] std::vector<std::byte> read_from_remote(std::uint64_t address,
                                                         std::uint32_t rkey,
                                                         std::uint32_t pd_handle,
+                                                        std::uint32_t qp_number,
                                                         std::size_t length);
 
-  /// Write incoming response data to local SGL.
-  std::size_t write_to_sgl(const std::vector<SglEntry>& sgl,
+  /// Write incoming response data to the local SGL.
+  /// @param offset Byte offset of data within the buffer the SGL describes.
+  /// @return Bytes written (less than data.size() on an access error).
+  std::size_t write_to_sgl(std::span<const SglEntry> sgl,
+                           std::size_t offset,
                            std::span<const std::byte> data,
-                           std::size_t& sge_idx,
-                           std::size_t& sge_offset,
                            std::uint32_t lkey);
 
   /// Generate READ_RESPONSE packets for a request.
@@ -4,6 +4,7 @@
 /// @brief RDMA WRITE operation processing for RoCEv2.
 
 #include <cstdint>
+#include <deque>
 #include <optional>
 #include <span>
 #include <unordered_map>
@@ -13,6 +14,7 @@
 #include "nic/rocev2/cqe.h"
 #include "nic/rocev2/memory_region.h"
 #include "nic/rocev2/packet.h"
+#include "nic/rocev2/psn_bitmap.h"
 #include "nic/rocev2/queue_pair.h"
 #include "nic/rocev2/types.h"
 #include "nic/rocev2/wqe.h"
@@ -27,7 +29,7 @@ struct WriteResult {
   bool is_message_complete{false};
   std::uint32_t ack_psn{0};
   AethSyndrome syndrome{AethSyndrome::Ack};
-  std::optional<RdmaCqe> recv_cqe;  // Only for WRITE with immediate
+  std::vector<RdmaCqe> recv_cqes;  // WRITE with immediate completions (several if a gap filled)
 };
 
 /// Receiver state for multi-packet WRITE operations.
@@ -37,27 +39,66 @@ struct WriteMessageState {
   std::uint32_t total_length{0};    // Total DMA length from RETH
   std::uint32_t bytes_written{0};   // Bytes written so far
   std::uint32_t expected_psn{0};    // Next expected PSN
+  std::uint32_t first_psn{0};       // PSN of the message's first packet
   bool in_progress{false};          // True if multi-packet write in progress
   std::uint32_t immediate_data{0};  // Immediate data (from last packet)
   bool has_immediate{false};        // True if WRITE with immediate
 };
 
+/// A WRITE message whose first packet has arrived at a QP with a reorder window.
+struct PlacedWriteMessage {
+  std::uint32_t first_psn{0};
+  std::uint32_t last_psn{0};
+  std::uint64_t remote_address{0};  // Remote virtual address from RETH
+  std::uint32_t rkey{0};            // Remote key from RETH
+  std::uint32_t total_length{0};    // DMA length from RETH
+  std::uint32_t bytes_placed{0};    // Bytes written so far, in any order
+  std::uint32_t immediate_data{0};  // Immediate data (from last packet)
+  bool has_immediate{false};        // True if WRITE with immediate
+};
+
+/// A middle or last WRITE packet that arrived before its message's first packet.
+struct StagedWritePacket {
+  std::vector<std::byte> payload;
+  std::optional<std::uint32_t> immediate_data;
+  bool ack_request{false};
+};
+
+/// Receiver state for WRITE packets placed out of order.
+struct WriteReorderState {
+  PsnBitmap placed{};                         // Placed PSNs; the base is the next PSN to retire
+  std::deque<PlacedWriteMessage> messages{};  // Messages with a known RETH, in PSN order
+  bool ack_pending{false};                    // A placed packet requested an ACK
+
+  // Packets waiting for their message's RETH, by PSN
+  std::unordered_map<std::uint32_t, StagedWritePacket> staged{};
+};
+
 /// Statistics for RDMA WRITE operations.
 struct WriteStats {
   std::uint64_t writes_started{0};
   std::uint64_t writes_completed{0};
   std::uint64_t write_packets_generated{0};
+  std::uint64_t inline_writes{0};
   std::uint64_t write_packets_processed{0};
   std::uint64_t bytes_written{0};
   std::uint64_t rkey_errors{0};
   std::uint64_t sequence_errors{0};
   std::uint64_t access_errors{0};
+  std::uint64_t page_fault_naks{0};       // RNR NAKs sent while an ODP page was faulted in
+  std::uint64_t out_of_order_packets{0};  // Packets placed ahead of a missing PSN
+  std::uint64_t staged_packets{0};        // Packets held until their message's RETH arrived
+  std::uint64_t duplicate_packets{0};     // Retransmitted packets that were already placed
 };
 
 /// RDMA WRITE processor - handles one-sided WRITE operations.
 class WriteProcessor {
 public:
-  WriteProcessor(HostMemory& host_memory, MemoryRegionTable& mr_table);
+  /// @param reorder_window PSNs past the expected one whose WRITE packets are placed on
+  ///        arrival instead of NAKed (0 = strict order).
+  WriteProcessor(HostMemory& host_memory,
+                 MemoryRegionTable& mr_table,
+                 std::uint32_t reorder_window = 0);
 
   /// Generate packets for an RDMA WRITE operation.
   /// @param qp The queue pair for sending.
@@ -72,6 +113,11 @@ public:
   /// @return Result indicating success, ACK needs, and any CQE (for immediate).
   [[nodiscard]] WriteResult process_write_packet(RdmaQueuePair& qp, const RdmaPacketParser& parser);
 
+  /// Retire placed WRITE packets that follow a PSN another receive path just consumed.
+  /// @param qp The destination queue pair.
+  /// @return ACK and CQEs of the WRITEs that completed.
+  [[nodiscard]] WriteResult retire_placed_packets(RdmaQueuePair& qp);
+
   /// Get statistics.
   [[nodiscard]] const WriteStats& stats() const noexcept { return stats_; }
 
@@ -81,27 +127,65 @@ public:
   /// Clear write state for a QP (e.g., on QP reset).
   void clear_write_state(std::uint32_t qp_number);
 
+  /// Drop a QP's responder state if no WRITE is in progress.
+  /// @return true if the QP holds no WRITE state afterwards.
+  bool release_idle_state(std::uint32_t qp_number);
+
+  /// Get the approximate host memory held by per-QP WRITE state.
+  [[nodiscard]] std::size_t memory_footprint() const noexcept;
+
 private:
   HostMemory& host_memory_;
   MemoryRegionTable& mr_table_;
   WriteStats stats_;
+  std::uint32_t reorder_window_{0};
 
   // Per-QP write state (for multi-packet writes)
   std::unordered_map<std::uint32_t, WriteMessageState> write_states_;
 
+  // Per-QP out-of-order placement state (reorder_window_ > 0)
+  std::unordered_map<std::uint32_t, WriteReorderState> reorder_states_;
+
+  /// Validate the RETH of a first or only packet; fills result with the NAK on failure.
+  [[nodiscard]] bool check_reth_access(RdmaQueuePair& qp,
+                                       const RdmaPacketParser& parser,
+                                       WriteResult& result);
+
+  /// Process a WRITE packet at a QP with a reorder window.
+  [[nodiscard]] WriteResult process_reordered_packet(RdmaQueuePair& qp,
+                                                     const RdmaPacketParser& parser);
+
+  /// Write one packet's payload at its offset in the message and mark its PSN placed.
+  /// @return false on a remote access error or a payload past the message end.
+  bool place_packet(RdmaQueuePair& qp,
+                    WriteReorderState& state,
+                    PlacedWriteMessage& message,
+                    std::uint32_t psn,
+                    std::span<const std::byte> payload,
+                    std::optional<std::uint32_t> immediate_data,
+                    bool ack_request);
+
+  /// Move the window base to the QP's expected PSN, dropping staged packets left behind.
+  void sync_reorder_window(WriteReorderState& state, std::uint32_t expected_psn);
+
+  /// Retire the placed PSNs at the window base, completing the messages they finish.
+  void retire_in_order(RdmaQueuePair& qp, WriteReorderState& state, WriteResult& result);
+
   /// Read data from host memory using scatter-gather list.
-  [[nodiscard]] std::vector<std::byte> read_from_sgl(const std::vector<SglEntry>& sgl,
+  [[nodiscard]] std::vector<std::byte> read_from_sgl(std::span<const SglEntry> sgl,
                                                      std::uint32_t lkey);
 
   /// Write data directly to remote memory address.
   /// @param address Remote virtual address.
   /// @param rkey Remote key for validation.
   /// @param pd_handle Protection domain.
+  /// @param qp_number QP the write arrived on.
   /// @param data Data to write.
   /// @return true if write succeeded.
   bool write_to_remote(std::uint64_t address,
                        std::uint32_t rkey,
                        std::uint32_t pd_handle,
+                       std::uint32_t qp_number,
                        std::span<const std::byte> data);
 
   /// Calculate number of packets needed for a message.
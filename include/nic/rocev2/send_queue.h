@@ -0,0 +1,126 @@
+#pragma once
+
+/// @file send_queue.h
+/// @brief Host-resident RDMA send queue ring and BAR2 doorbell layout for RoCEv2.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "nic/dma_engine.h"
+#include "nic/host_memory.h"
+#include "nic/rocev2/wqe.h"
+#include "nic/trace.h"
+
+namespace nic::rocev2 {
+
+/// Bytes of payload an RdmaSqWqe carries inline.
+inline constexpr std::size_t kSqWqeInlineBytes = 16;
+
+/// RdmaSqWqe::flags bits.
+inline constexpr std::uint8_t kSqWqeSignaled = 0x01;
+inline constexpr std::uint8_t kSqWqeSolicited = 0x02;
+inline constexpr std::uint8_t kSqWqeFence = 0x04;
+inline constexpr std::uint8_t kSqWqeInline = 0x08;
+
+/// RdmaSqWqe::access bits (RegMr and BindMw).
+inline constexpr std::uint8_t kSqAccessLocalWrite = 0x01;
+inline constexpr std::uint8_t kSqAccessRemoteRead = 0x02;
+inline constexpr std::uint8_t kSqAccessRemoteWrite = 0x04;
+inline constexpr std::uint8_t kSqAccessMwBind = 0x08;
+
+/// Send WQE as laid out in a host-resident send queue ring, and as written to the
+/// BlueFlame buffer. One 64-byte slot carries one SGE or up to kSqWqeInlineBytes inline.
+/// Key operations carry their key in immediate_data: the key to invalidate for
+/// LocalInvalidate/SendWithInvalidate, the new rkey for RegMr/BindMw.
+struct RdmaSqWqe {
+  std::uint64_t wr_id{0};
+  std::uint64_t remote_address{0};
+  std::uint64_t sge_address{0};
+  std::uint32_t sge_length{0};
+  std::uint32_t lkey{0};
+  std::uint32_t rkey{0};
+  std::uint32_t immediate_data{0};
+  std::uint32_t qp_number{0};  // Owning QP; lets a BlueFlame write identify its queue
+  std::uint8_t opcode{0};      // WqeOpcode
+  std::uint8_t flags{0};       // kSqWqe* bits
+  std::uint8_t inline_length{0};
+  std::uint8_t access{0};  // kSqAccess* bits (RegMr/BindMw)
+  std::array<std::byte, kSqWqeInlineBytes> inline_data{};
+};
+
+/// Stride between consecutive slots of a host-resident send queue ring.
+inline constexpr std::size_t kSqWqeSize = sizeof(RdmaSqWqe);
+static_assert(kSqWqeSize == 64, "RdmaSqWqe must fill one 64-byte write-combining chunk");
+
+/// Send queue doorbell record: the new producer index for one QP.
+struct RdmaSqDoorbell {
+  std::uint32_t qp_number{0};
+  std::uint32_t producer_index{0};  // Free-running; slot = producer_index % depth
+};
+
+/// BAR2 offset of the send queue doorbell register (one RdmaSqDoorbell write).
+inline constexpr std::uint32_t kRdmaSqDoorbellOffset = 0x0000;
+
+/// BAR2 offset of the BlueFlame buffer (one RdmaSqWqe write: WQE and doorbell in one).
+inline constexpr std::uint32_t kRdmaBlueFlameOffset = 0x0100;
+
+/// Encode a SendWqe into its ring layout.
+/// @param wqe The WQE to encode.
+/// @param qp_number QP the WQE is posted to.
+/// @return Encoded slot, or nullopt if the WQE needs more than one SGE or kSqWqeInlineBytes.
+[[nodiscard]] std::optional<RdmaSqWqe> encode_sq_wqe(const SendWqe& wqe, std::uint32_t qp_number);
+
+/// Decode a ring slot back into a SendWqe.
+[[nodiscard]] SendWqe decode_sq_wqe(const RdmaSqWqe& entry);
+
+/// Host send queue ring configuration.
+struct RdmaSqRingConfig {
+  HostAddress base_address{0};  // First slot in host memory
+  std::size_t depth{256};       // Number of slots (power of two)
+};
+
+/// Host-resident send queue ring. Software writes slots and rings the doorbell with
+/// its producer index; the device DMA-fetches every slot between its consumer index
+/// and that producer index.
+class RdmaSendQueueRing {
+public:
+  /// @param config Ring placement and depth.
+  /// @param dma_engine DMA engine used to fetch slots.
+  RdmaSendQueueRing(RdmaSqRingConfig config, DMAEngine& dma_engine);
+
+  /// Accept a new producer index from a doorbell.
+  /// @param producer_index Free-running producer index.
+  /// @return false if the index moves backwards or past a full ring (ignored).
+  bool update_producer(std::uint32_t producer_index);
+
+  /// DMA-fetch the slot at the consumer index and advance past it.
+  /// @return The slot, or nullopt if the ring is empty or the DMA read failed.
+  [[nodiscard]] std::optional<RdmaSqWqe> fetch();
+
+  /// Retire one BlueFlame WQE without fetching it. Only legal on an empty ring,
+  /// since the WQE would otherwise overtake slots the device has not fetched yet.
+  /// @return true if the producer and consumer indices both advanced.
+  bool consume_blueflame();
+
+  /// Get the number of slots published but not yet fetched.
+  [[nodiscard]] std::uint32_t pending() const noexcept { return producer_index_ - consumer_index_; }
+
+  [[nodiscard]] std::uint32_t producer_index() const noexcept { return producer_index_; }
+  [[nodiscard]] std::uint32_t consumer_index() const noexcept { return consumer_index_; }
+  [[nodiscard]] std::size_t depth() const noexcept { return config_.depth; }
+
+  /// Get the host address of the slot for a free-running index.
+  [[nodiscard]] HostAddress slot_address(std::uint32_t index) const noexcept {
+    return config_.base_address + ((index & (config_.depth - 1)) * kSqWqeSize);
+  }
+
+private:
+  RdmaSqRingConfig config_;
+  DMAEngine& dma_engine_;
+  std::uint32_t producer_index_{0};
+  std::uint32_t consumer_index_{0};
+};
+
+}  // namespace nic::rocev2
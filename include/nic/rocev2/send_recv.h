@@ -3,6 +3,7 @@
 /// @file send_recv.h
 /// @brief SEND/RECV operation processing for RoCEv2.
 
+#include <array>
 #include <cstdint>
 #include <deque>
 #include <optional>
@@ -32,15 +33,17 @@ struct RecvResult {
 
 /// Receiver state for multi-packet messages.
 struct RecvMessageState {
-  std::uint64_t wr_id{0};           // Work request ID from recv WQE
-  std::uint32_t bytes_received{0};  // Bytes received so far
-  std::uint32_t expected_psn{0};    // Next expected PSN
-  std::vector<SglEntry> sgl;        // Scatter-gather list from recv WQE
-  std::size_t current_sge_idx{0};   // Current SGE being filled
-  std::size_t sge_offset{0};        // Offset within current SGE
-  bool in_progress{false};          // True if message is being received
-  std::uint32_t immediate_data{0};  // Immediate data (from last packet)
-  bool has_immediate{false};        // True if immediate data present
+  std::uint64_t wr_id{0};             // Work request ID from recv WQE
+  std::uint32_t bytes_received{0};    // Bytes received so far
+  std::uint32_t expected_psn{0};      // Next expected PSN
+  WqeSgl sgl;                         // Scatter-gather list from recv WQE
+  std::size_t current_sge_idx{0};     // Current SGE being filled
+  std::size_t sge_offset{0};          // Offset within current SGE
+  bool in_progress{false};            // True if message is being received
+  std::uint32_t immediate_data{0};    // Immediate data (from last packet)
+  bool has_immediate{false};          // True if immediate data present
+  std::uint32_t invalidated_rkey{0};  // rkey invalidated by the last packet's IETH
+  bool has_invalidate{false};         // True if the SEND invalidated a key
 };
 
 /// Statistics for SEND/RECV operations.
@@ -49,11 +52,17 @@ struct SendRecvStats {
   std::uint64_t sends_completed{0};
   std::uint64_t recvs_completed{0};
   std::uint64_t send_packets_generated{0};
+  std::uint64_t inline_sends{0};
   std::uint64_t recv_packets_processed{0};
   std::uint64_t rnr_naks_sent{0};
   std::uint64_t sequence_errors{0};
   std::uint64_t bytes_sent{0};
   std::uint64_t bytes_received{0};
+  std::uint64_t ud_sends{0};
+  std::uint64_t ud_recvs{0};
+  std::uint64_t ud_drops{0};           // No recv WQE available (UD never RNR NAKs)
+  std::uint64_t qkey_violations{0};    // DETH Q_Key did not match the QP's Q_Key
+  std::uint64_t invalidate_errors{0};  // IETH rkey could not be invalidated
 };
 
 /// SEND/RECV processor - handles SEND and RECV operations.
@@ -74,6 +83,25 @@ public:
   /// @return Result indicating success, ACK needs, and any CQE.
   [[nodiscard]] RecvResult process_recv_packet(RdmaQueuePair& qp, const RdmaPacketParser& parser);
 
+  /// Generate the single packet for a UD SEND operation.
+  /// @param qp The UD queue pair for sending.
+  /// @param wqe The send WQE (Send or SendImm; length must fit in one MTU).
+  /// @return The packet, or an empty vector on error.
+  [[nodiscard]] std::vector<std::byte> generate_ud_send_packet(RdmaQueuePair& qp,
+                                                               const SendWqe& wqe);
+
+  /// Process an incoming UD SEND packet.
+  /// Places a synthesized GRH ahead of the payload; never requests an ACK.
+  /// @param qp The destination UD queue pair.
+  /// @param parser Parsed packet (BTH, DETH and payload extracted).
+  /// @param src_ip Source IP address (becomes the GRH SGID).
+  /// @param dst_ip Destination IP address (becomes the GRH DGID).
+  /// @return Result with success and any CQE; needs_ack is always false.
+  [[nodiscard]] RecvResult process_ud_recv_packet(RdmaQueuePair& qp,
+                                                  const RdmaPacketParser& parser,
+                                                  std::array<std::uint8_t, 4> src_ip,
+                                                  std::array<std::uint8_t, 4> dst_ip);
+
   /// Generate an ACK packet.
   /// @param qp The queue pair generating the ACK.
   /// @param psn The PSN being acknowledged.
@@ -94,6 +122,13 @@ public:
   /// Clear receiver state for a QP (e.g., on QP reset).
   void clear_recv_state(std::uint32_t qp_number);
 
+  /// Drop a QP's receiver state if no message is in progress.
+  /// @return true if the QP holds no receiver state afterwards.
+  bool release_idle_state(std::uint32_t qp_number);
+
+  /// Get the approximate host memory held by per-QP receiver state.
+  [[nodiscard]] std::size_t memory_footprint() const noexcept;
+
 private:
   HostMemory& host_memory_;
   MemoryRegionTable& mr_table_;
@@ -107,7 +142,7 @@ private:
   /// @param lkey The local key for validation.
   /// @param pd_handle The protection domain.
   /// @return Data read from memory, or empty vector on error.
-  [[nodiscard]] std::vector<std::byte> read_from_sgl(const std::vector<SglEntry>& sgl,
+  [[nodiscard]] std::vector<std::byte> read_from_sgl(std::span<const SglEntry> sgl,
                                                      std::uint32_t lkey,
                                                      std::uint32_t pd_handle);
 
@@ -117,17 +152,25 @@ private:
   /// @param sge_idx Starting SGE index.
   /// @param sge_offset Starting offset within SGE.
   /// @return Number of bytes written, 0 on error.
-  std::size_t write_to_sgl(const std::vector<SglEntry>& sgl,
+  std::size_t write_to_sgl(std::span<const SglEntry> sgl,
                            std::span<const std::byte> data,
                            std::size_t& sge_idx,
                            std::size_t& sge_offset);
 
+  /// Build a GRH for a UD receive using IPv4-mapped GIDs.
+  [[nodiscard]] std::array<std::byte, kGrhSize> build_grh(std::array<std::uint8_t, 4> src_ip,
+                                                          std::array<std::uint8_t, 4> dst_ip,
+                                                          std::size_t payload_length) const;
+
   /// Calculate number of packets needed for a message.
   [[nodiscard]] std::uint32_t calculate_packet_count(std::uint32_t total_length,
                                                      std::uint32_t mtu) const;
 
   /// Determine the appropriate SEND opcode for a packet.
-  [[nodiscard]] RdmaOpcode get_send_opcode(bool is_first, bool is_last, bool has_immediate) const;
+  [[nodiscard]] RdmaOpcode get_send_opcode(bool is_first,
+                                           bool is_last,
+                                           bool has_immediate,
+                                           bool has_invalidate) const;
 };
 
 }  // namespace nic::rocev2
@@ -0,0 +1,209 @@
+#pragma once
+
+/// @file sharded_engine.h
+/// @brief RoCEv2 RDMA engine split into per-thread shards.
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "nic/dma_engine.h"
+#include "nic/host_memory.h"
+#include "nic/rocev2/engine.h"
+#include "nic/trace.h"
+
+namespace nic::rocev2 {
+
+/// Configuration for the sharded RDMA engine.
+struct ShardedRdmaEngineConfig {
+  std::size_t num_shards{4};            ///< Number of shards (one worker thread each)
+  RdmaEngineConfig engine_config{};     ///< Per-shard engine config; max_* limits apply per shard
+  std::size_t max_inbox_packets{4096};  ///< Packets queued per shard before deliveries are dropped
+};
+
+/// Statistics for the sharded RDMA engine (shard engines keep their own RdmaEngineStats).
+struct ShardedRdmaEngineStats {
+  std::atomic<std::uint64_t> packets_routed{0};
+  std::atomic<std::uint64_t> packets_queued{0};
+  std::atomic<std::uint64_t> packets_dropped{0};     // Inbox full
+  std::atomic<std::uint64_t> unroutable_packets{0};  // Truncated or unknown destination QP
+  std::atomic<std::uint64_t> replicated_ops{0};      // PD/MR/AH changes applied to every shard
+  std::atomic<std::uint64_t> errors{0};
+};
+
+/// RoCEv2 RDMA engine split into shards. Each shard is a complete RdmaEngine that owns
+/// its QPs, CQs, SRQs, processor state and outgoing packet queue, behind its own lock,
+/// and can run incoming packets on its own worker thread.
+///
+/// CQs and SRQs are spread round-robin across shards. A QP lives on the shard of its
+/// CQs, so a QP's fast path never takes another shard's lock. Object numbers are
+/// interleaved (shard = (number - first_object_number) % num_shards), so any QP, CQ or
+/// SRQ number routes to its shard without a lookup.
+///
+/// PDs, MRs and AHs are replicated into every shard. Changes lock all shards and are
+/// applied in the same order everywhere, so handles and keys agree. Data-path lookups
+/// then read only the shard's own replica.
+///
+/// Anything that would change a replica from one shard's data path is refused, since
+/// the other replicas would not see it: on-demand paging MRs (page faults populate
+/// only the faulting shard), and the send-queue memory-key WQEs (RegMr, LocalInvalidate,
+/// BindMw, SendWithInvalidate). Fast-register MRs and memory windows are not offered.
+class ShardedRdmaEngine {
+public:
+  /// @param config Shard count and per-shard engine configuration.
+  /// @param host_memory Host memory shared by all shards (each shard gets its own DMAEngine).
+  ShardedRdmaEngine(ShardedRdmaEngineConfig config, HostMemory& host_memory);
+  ~ShardedRdmaEngine();
+
+  ShardedRdmaEngine(const ShardedRdmaEngine&) = delete;
+  ShardedRdmaEngine& operator=(const ShardedRdmaEngine&) = delete;
+
+  // ============================================
+  // Worker Threads
+  // ============================================
+
+  /// Start one worker thread per shard. Delivered packets are then queued to the
+  /// owning shard and processed asynchronously.
+  void start();
+
+  /// Finish queued packets, then stop and join the worker threads.
+  void stop();
+
+  /// Block until every shard inbox is empty.
+  void drain();
+
+  [[nodiscard]] bool is_running() const noexcept { return running_.load(); }
+
+  // ============================================
+  // Replicated Resources
+  // ============================================
+
+  /// Allocate a protection domain in every shard.
+  [[nodiscard]] std::optional<std::uint32_t> create_pd();
+  bool destroy_pd(std::uint32_t pd_handle);
+
+  /// Register a memory region in every shard. On-demand paging MRs are refused.
+  [[nodiscard]] std::optional<std::uint32_t> register_mr(std::uint32_t pd_handle,
+                                                         std::uint64_t virtual_address,
+                                                         std::size_t length,
+                                                         AccessFlags access);
+  bool deregister_mr(std::uint32_t lkey);
+
+  /// Get the rkey of a registered MR.
+  [[nodiscard]] std::optional<std::uint32_t> query_rkey(std::uint32_t lkey);
+
+  /// Create a UD address handle in every shard.
+  [[nodiscard]] std::optional<std::uint32_t> create_ah(std::uint32_t pd_handle,
+                                                       const RdmaAhAttr& attr);
+  bool destroy_ah(std::uint32_t ah_handle);
+
+  // ============================================
+  // Shard-Local Resources
+  // ============================================
+
+  /// Create a completion queue on the next shard in round-robin order.
+  [[nodiscard]] std::optional<std::uint32_t> create_cq(std::size_t depth);
+  bool destroy_cq(std::uint32_t cq_number);
+  [[nodiscard]] std::size_t poll_cq(std::uint32_t cq_number, std::span<RdmaCqe> out);
+
+  /// Create a shared receive queue on the next shard in round-robin order.
+  [[nodiscard]] std::optional<std::uint32_t> create_srq(std::size_t depth, std::size_t limit = 0);
+  bool destroy_srq(std::uint32_t srq_number);
+  bool post_srq_recv(std::uint32_t srq_number, const RecvWqe& wqe);
+
+  /// Create a QP on the shard that owns its send CQ.
+  /// @return QP number, or nullopt if the CQs or SRQ span shards or the shard refuses it.
+  [[nodiscard]] std::optional<std::uint32_t> create_qp(const RdmaQpConfig& config);
+  bool destroy_qp(std::uint32_t qp_number);
+  bool modify_qp(std::uint32_t qp_number, const RdmaQpModifyParams& params);
+
+  /// Post send WQEs to the owning shard. The list stops at the first memory-key WQE,
+  /// which would change only that shard's MR replica.
+  bool post_send(std::uint32_t qp_number, const SendWqe& wqe);
+  bool post_recv(std::uint32_t qp_number, const RecvWqe& wqe);
+  [[nodiscard]] std::size_t post_send_list(std::uint32_t qp_number,
+                                           std::span<const SendWqe> wqes);
+  [[nodiscard]] std::size_t post_recv_list(std::uint32_t qp_number,
+                                           std::span<const RecvWqe> wqes);
+
+  // ============================================
+  // Packet Processing
+  // ============================================
+
+  /// Route an incoming RoCEv2 packet to the shard of its destination QP.
+  /// With workers running the packet is queued to that shard; otherwise it is
+  /// processed on the calling thread under the shard lock.
+  /// @return True if queued or processed successfully.
+  bool deliver_packet(std::span<const std::byte> udp_payload,
+                      std::array<std::uint8_t, 4> src_ip,
+                      std::array<std::uint8_t, 4> dst_ip,
+                      std::uint16_t src_port);
+
+  /// Drain the outgoing packet queue of one shard.
+  [[nodiscard]] std::vector<OutgoingPacket> generate_outgoing_packets(std::size_t shard);
+
+  /// Drain the outgoing packet queues of all shards, in shard order.
+  [[nodiscard]] std::vector<OutgoingPacket> generate_outgoing_packets();
+
+  /// Advance time on every shard.
+  void advance_time(std::uint64_t elapsed_us);
+
+  // ============================================
+  // Accessors
+  // ============================================
+
+  [[nodiscard]] std::size_t num_shards() const noexcept { return shards_.size(); }
+
+  /// Get the shard that owns a QP, CQ or SRQ number.
+  [[nodiscard]] std::optional<std::size_t> shard_of(std::uint32_t object_number) const noexcept;
+
+  /// Get a snapshot of one shard's engine statistics.
+  [[nodiscard]] RdmaEngineStats shard_stats(std::size_t shard);
+
+  [[nodiscard]] const ShardedRdmaEngineStats& stats() const noexcept { return stats_; }
+
+private:
+  struct InboundPacket {
+    std::vector<std::byte> data;
+    std::array<std::uint8_t, 4> src_ip{};
+    std::array<std::uint8_t, 4> dst_ip{};
+    std::uint16_t src_port{0};
+  };
+
+  struct Shard {
+    std::unique_ptr<DMAEngine> dma_engine;
+    std::unique_ptr<RdmaEngine> engine;
+    std::mutex mutex;                 // Guards engine, inbox and stopping
+    std::condition_variable wake;     // Signals the worker: inbox non-empty or stopping
+    std::condition_variable drained;  // Signals drain(): inbox empty
+    std::deque<InboundPacket> inbox;
+    bool stopping{false};
+    std::thread worker;
+  };
+
+  ShardedRdmaEngineConfig config_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::mutex control_mutex_;  // Serializes replicated changes and round-robin placement
+  std::size_t next_shard_{0};
+  std::atomic<bool> running_{false};
+  ShardedRdmaEngineStats stats_;
+
+  /// Worker thread body: process the shard inbox until stopped.
+  void run_shard(Shard& shard);
+
+  /// Get the shard owning an object number, or nullptr.
+  [[nodiscard]] Shard* owning_shard(std::uint32_t object_number) noexcept;
+
+  /// Lock every shard in index order, for replicated changes.
+  [[nodiscard]] std::vector<std::unique_lock<std::mutex>> lock_all_shards();
+};
+
+}  // namespace nic::rocev2
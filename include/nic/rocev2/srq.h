@@ -0,0 +1,95 @@
+#pragma once
+
+/// @file srq.h
+/// @brief RDMA Shared Receive Queue for RoCEv2.
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+#include "nic/rocev2/wqe.h"
+#include "nic/trace.h"
+
+namespace nic::rocev2 {
+
+/// Shared Receive Queue configuration.
+struct RdmaSrqConfig {
+  std::size_t depth{4096};  // Maximum number of outstanding receive WQEs
+  std::size_t limit{0};     // Low watermark for the limit event (0 = disarmed)
+};
+
+/// Shared Receive Queue statistics.
+struct RdmaSrqStats {
+  std::uint64_t recv_wqes_posted{0};
+  std::uint64_t recv_wqes_consumed{0};
+  std::uint64_t empty_consumes{0};
+  std::uint64_t overflows{0};
+  std::uint64_t limit_events{0};
+};
+
+/// RDMA Shared Receive Queue - a pool of receive WQEs consumed by any attached QP.
+///
+/// The limit works like ibv_modify_srq(IBV_SRQ_LIMIT): once armed, the first consume that
+/// leaves fewer than `limit` WQEs posted latches a limit event and disarms the SRQ. The
+/// consumer must re-arm to receive another event.
+class RdmaSharedReceiveQueue {
+public:
+  explicit RdmaSharedReceiveQueue(std::uint32_t srq_number, RdmaSrqConfig config = {});
+
+  /// Post a receive WQE to the shared pool.
+  /// @param wqe The work queue entry to post.
+  /// @return true if posted successfully, false if the SRQ is full.
+  bool post_recv(const RecvWqe& wqe);
+
+  /// Take the oldest receive WQE from the pool.
+  /// @return WQE if available, nullopt otherwise.
+  [[nodiscard]] std::optional<RecvWqe> consume_recv();
+
+  /// Arm the limit event.
+  /// @param limit Low watermark; 0 disarms the SRQ.
+  void arm(std::size_t limit) noexcept;
+
+  /// Consume a latched limit event.
+  /// @return true if the limit was crossed since the last call.
+  [[nodiscard]] bool take_limit_event() noexcept;
+
+  /// Check if the limit event is armed.
+  [[nodiscard]] bool is_armed() const noexcept { return limit_ > 0; }
+
+  /// Get the SRQ number.
+  [[nodiscard]] std::uint32_t srq_number() const noexcept { return srq_number_; }
+
+  /// Get the armed low watermark (0 when disarmed).
+  [[nodiscard]] std::size_t limit() const noexcept { return limit_; }
+
+  /// Get current number of posted WQEs.
+  [[nodiscard]] std::size_t count() const noexcept { return recv_queue_.size(); }
+
+  /// Get the SRQ depth (capacity).
+  [[nodiscard]] std::size_t depth() const noexcept { return config_.depth; }
+
+  /// Check if the SRQ is full.
+  [[nodiscard]] bool is_full() const noexcept { return recv_queue_.size() >= config_.depth; }
+
+  /// Get statistics.
+  [[nodiscard]] const RdmaSrqStats& stats() const noexcept { return stats_; }
+
+  /// Count a QP attached to the SRQ; the SRQ cannot be destroyed while any are.
+  void attach_qp() noexcept { ++qp_refs_; }
+  void detach_qp() noexcept { --qp_refs_; }
+  [[nodiscard]] std::uint32_t qp_refs() const noexcept { return qp_refs_; }
+
+  /// Reset the SRQ.
+  void reset();
+
+private:
+  std::uint32_t srq_number_;
+  RdmaSrqConfig config_;
+  std::deque<RecvWqe> recv_queue_;
+  std::size_t limit_{0};
+  bool limit_event_pending_{false};
+  std::uint32_t qp_refs_{0};
+  RdmaSrqStats stats_;
+};
+
+}  // namespace nic::rocev2
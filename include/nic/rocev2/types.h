@@ -3,6 +3,8 @@
 /// @file types.h
 /// @brief Core RDMA type definitions for RoCEv2 implementation.
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 
 namespace nic::rocev2 {
@@ -10,17 +12,26 @@ namespace nic::rocev2 {
 /// RoCEv2 well-known UDP destination port.
 inline constexpr std::uint16_t kRoceUdpPort = 4791;
 
+/// Ethernet MAC address, most significant octet first.
+using MacAddress = std::array<std::uint8_t, 6>;
+
 /// Maximum PSN value (24-bit).
 inline constexpr std::uint32_t kMaxPsn = 0x00FFFFFF;
 
 /// Default partition key.
 inline constexpr std::uint16_t kDefaultPkey = 0xFFFF;
 
+/// Size of the Global Route Header the responder places ahead of UD receive payloads.
+inline constexpr std::size_t kGrhSize = 40;
+
+/// Q_Key values with the MSB set select the sending QP's own Q_Key (IB spec 10.2.5).
+inline constexpr std::uint32_t kQkeyUseQpMask = 0x80000000;
+
 /// Queue Pair types.
 enum class QpType : std::uint8_t {
   Rc,  // Reliable Connection - implemented
   Uc,  // Unreliable Connection - future
-  Ud,  // Unreliable Datagram - future
+  Ud,  // Unreliable Datagram - SEND only, no ACK/retransmit
 };
 
 /// Queue Pair state machine states (IB Spec).
@@ -54,6 +65,10 @@ enum class RdmaOpcode : std::uint8_t {
   kRcReadResponseLast = 0x0F,
   kRcReadResponseOnly = 0x10,
   kRcAck = 0x11,
+  kRcSendLastInv = 0x16,
+  kRcSendOnlyInv = 0x17,
+  kUdSendOnly = 0x64,
+  kUdSendOnlyImm = 0x65,
   kCnp = 0x81,
 };
 
@@ -64,6 +79,10 @@ enum class WqeOpcode : std::uint8_t {
   RdmaWrite,
   RdmaWriteImm,
   RdmaRead,
+  SendWithInvalidate,  // SEND that invalidates invalidate_rkey at the responder
+  LocalInvalidate,     // Invalidate a fast-register MR or memory window key locally
+  RegMr,               // Fast-register: remap a pre-allocated MR over the SGL
+  BindMw,              // Bind a type-2 memory window to a range of an MR
 };
 
 /// Completion status codes.
@@ -95,6 +114,11 @@ enum class AethSyndrome : std::uint8_t {
   RemoteOpError = 0x63,      // Remote operation error NAK
 };
 
+/// Asynchronous event types (mirrors ibv_event_type).
+enum class AsyncEventType : std::uint8_t {
+  SrqLimitReached,  // SRQ dropped below its armed limit
+};
+
 /// Access flags for memory regions.
 struct AccessFlags {
   bool local_read{true};
@@ -102,6 +126,8 @@ struct AccessFlags {
   bool remote_read{false};
   bool remote_write{false};
   bool zero_based{false};
+  bool mw_bind{false};    // Memory windows may be bound to this MR
+  bool on_demand{false};  // ODP: pages are faulted in on first access instead of pinned
 };
 
 /// Advance PSN with 24-bit wraparound.
@@ -3,7 +3,12 @@
 /// @file wqe.h
 /// @brief Work Queue Element definitions for RoCEv2.
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <initializer_list>
+#include <span>
 #include <vector>
 
 #include "nic/host_memory.h"
@@ -12,33 +17,105 @@
 
 namespace nic::rocev2 {
 
+/// Maximum payload a SendWqe can carry inline.
+inline constexpr std::size_t kMaxInlineData = 256;
+
+/// Number of SGEs a WqeSgl stores without a heap allocation.
+inline constexpr std::size_t kWqeInlineSges = 2;
+
+/// Scatter-gather list of a WQE. Lists of up to kWqeInlineSges entries live inside
+/// the WQE; longer lists move to a heap vector.
+class WqeSgl {
+public:
+  WqeSgl() = default;
+  WqeSgl(std::initializer_list<SglEntry> entries) {
+    for (const SglEntry& entry : entries) {
+      push_back(entry);
+    }
+  }
+
+  void push_back(const SglEntry& entry) {
+    if (size_ < kWqeInlineSges) {
+      inline_entries_[size_++] = entry;
+      return;
+    }
+    if (size_ == kWqeInlineSges) {
+      overflow_.assign(inline_entries_.begin(), inline_entries_.end());
+    }
+    overflow_.push_back(entry);
+    ++size_;
+  }
+
+  void clear() noexcept {
+    overflow_ = std::vector<SglEntry>();
+    size_ = 0;
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return size_; }
+  [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+  [[nodiscard]] const SglEntry* data() const noexcept {
+    return is_inline() ? inline_entries_.data() : overflow_.data();
+  }
+  [[nodiscard]] const SglEntry* begin() const noexcept { return data(); }
+  [[nodiscard]] const SglEntry* end() const noexcept { return data() + size_; }
+  [[nodiscard]] const SglEntry& front() const noexcept { return data()[0]; }
+  [[nodiscard]] const SglEntry& operator[](std::size_t index) const noexcept {
+    return data()[index];
+  }
+
+  /// Get the heap bytes held by a list that outgrew the inline entries.
+  [[nodiscard]] std::size_t heap_bytes() const noexcept {
+    return overflow_.capacity() * sizeof(SglEntry);
+  }
+
+private:
+  [[nodiscard]] bool is_inline() const noexcept { return size_ <= kWqeInlineSges; }
+
+  std::array<SglEntry, kWqeInlineSges> inline_entries_{};
+  std::vector<SglEntry> overflow_{};  // Holds every entry once size_ > kWqeInlineSges
+  std::uint32_t size_{0};
+};
+
 /// Send Work Queue Element.
 struct SendWqe {
   std::uint64_t wr_id{0};             // Work request ID (user tag)
   WqeOpcode opcode{WqeOpcode::Send};  // SEND, WRITE, READ
-  std::vector<SglEntry> sgl{};        // Scatter-gather list
+  WqeSgl sgl{};                       // Scatter-gather list
   std::uint32_t total_length{0};      // Computed from SGL
   bool signaled{true};                // Generate CQE on completion
   bool solicited{false};              // Request solicited event
   bool fence{false};                  // Wait for prior ops
-  bool inline_data{false};            // Data in WQE, not via SGL
+  bool inline_data{false};            // Data in inline_payload, not via SGL
   std::uint32_t immediate_data{0};    // For SendImm/WriteImm
 
   // RDMA WRITE/READ specific
   HostAddress remote_address{0};  // Remote virtual address
   std::uint32_t rkey{0};          // Remote key
   std::uint32_t local_lkey{0};    // Local key for SGL validation
+
+  // Memory registration specific
+  std::uint32_t invalidate_rkey{0};  // LocalInvalidate/SendWithInvalidate: key to invalidate
+  std::uint32_t new_rkey{0};         // RegMr/BindMw: rkey to assign (0 keeps the current key)
+  AccessFlags access{};              // RegMr/BindMw: access rights of the new mapping
+
+  // UD specific
+  std::uint32_t ah_handle{0};    // Address handle for the destination
+  std::uint32_t remote_qpn{0};   // Destination QP number
+  std::uint32_t remote_qkey{0};  // Destination Q_Key (MSB set = use the QP's Q_Key)
+
+  // Inline payload (first total_length bytes valid when inline_data is set)
+  std::array<std::byte, kMaxInlineData> inline_payload{};
 };
 
 /// Receive Work Queue Element.
 struct RecvWqe {
   std::uint64_t wr_id{0};         // Work request ID
-  std::vector<SglEntry> sgl{};    // Scatter-gather for receive buffers
+  WqeSgl sgl{};                   // Scatter-gather for receive buffers
   std::uint32_t total_length{0};  // Available buffer space
 };
 
 /// Compute total length from scatter-gather list.
-[[nodiscard]] inline std::uint32_t compute_sgl_length(const std::vector<SglEntry>& sgl) noexcept {
+[[nodiscard]] inline std::uint32_t compute_sgl_length(std::span<const SglEntry> sgl) noexcept {
   std::uint32_t total = 0;
   for (const auto& entry : sgl) {
     total += entry.length;
@@ -46,4 +123,120 @@ struct RecvWqe {
   return total;
 }
 
+/// Copy a payload into the WQE's inline buffer and mark the WQE inline.
+/// @param wqe The WQE to fill.
+/// @param data Payload bytes.
+/// @return false if data exceeds kMaxInlineData (WQE left unchanged).
+inline bool set_inline_payload(SendWqe& wqe, std::span<const std::byte> data) noexcept {
+  if (data.size() > kMaxInlineData) {
+    return false;
+  }
+  std::copy(data.begin(), data.end(), wqe.inline_payload.begin());
+  wqe.inline_data = true;
+  wqe.total_length = static_cast<std::uint32_t>(data.size());
+  wqe.sgl.clear();
+  return true;
+}
+
+/// View the valid bytes of an inline WQE.
+[[nodiscard]] inline std::span<const std::byte> inline_payload_view(const SendWqe& wqe) noexcept {
+  std::size_t length = std::min<std::size_t>(wqe.total_length, kMaxInlineData);
+  return std::span<const std::byte>(wqe.inline_payload.data(), length);
+}
+
+/// Send WQE kept by the engine after posting: retransmit copies and WQEs held for an RNR
+/// back-off or an ODP fault. Holds the same fields as SendWqe, except that inline data is
+/// copied to a buffer sized to the payload instead of the fixed kMaxInlineData array.
+struct SendWqeRecord {
+  std::uint64_t wr_id{0};
+  WqeOpcode opcode{WqeOpcode::Send};
+  WqeSgl sgl{};  // Host buffers to re-read on a resend (empty for inline data)
+  std::uint32_t total_length{0};
+  std::uint32_t immediate_data{0};
+  HostAddress remote_address{0};
+  std::uint32_t rkey{0};
+  std::uint32_t local_lkey{0};
+  std::uint32_t invalidate_rkey{0};
+  std::uint32_t new_rkey{0};
+  std::uint32_t ah_handle{0};
+  std::uint32_t remote_qpn{0};
+  std::uint32_t remote_qkey{0};
+  AccessFlags access{};
+  bool signaled{true};
+  bool solicited{false};
+  bool fence{false};
+  bool inline_data{false};
+  std::vector<std::byte> inline_payload{};  // Empty unless inline_data
+
+  /// Get the heap bytes held by the record.
+  [[nodiscard]] std::size_t heap_bytes() const noexcept {
+    return sgl.heap_bytes() + inline_payload.capacity();
+  }
+};
+
+/// Capture a send WQE as a record.
+[[nodiscard]] inline SendWqeRecord make_wqe_record(const SendWqe& wqe) {
+  SendWqeRecord record{.wr_id = wqe.wr_id,
+                       .opcode = wqe.opcode,
+                       .sgl = wqe.sgl,
+                       .total_length = wqe.total_length,
+                       .immediate_data = wqe.immediate_data,
+                       .remote_address = wqe.remote_address,
+                       .rkey = wqe.rkey,
+                       .local_lkey = wqe.local_lkey,
+                       .invalidate_rkey = wqe.invalidate_rkey,
+                       .new_rkey = wqe.new_rkey,
+                       .ah_handle = wqe.ah_handle,
+                       .remote_qpn = wqe.remote_qpn,
+                       .remote_qkey = wqe.remote_qkey,
+                       .access = wqe.access,
+                       .signaled = wqe.signaled,
+                       .solicited = wqe.solicited,
+                       .fence = wqe.fence,
+                       .inline_data = wqe.inline_data,
+                       .inline_payload = {}};
+  if (wqe.inline_data) {
+    auto payload = inline_payload_view(wqe);
+    record.inline_payload.assign(payload.begin(), payload.end());
+  }
+  return record;
+}
+
+/// Rebuild the send WQE a record was made from.
+[[nodiscard]] inline SendWqe make_send_wqe(const SendWqeRecord& record) {
+  SendWqe wqe;
+  wqe.wr_id = record.wr_id;
+  wqe.opcode = record.opcode;
+  wqe.sgl = record.sgl;
+  wqe.total_length = record.total_length;
+  wqe.signaled = record.signaled;
+  wqe.solicited = record.solicited;
+  wqe.fence = record.fence;
+  wqe.inline_data = record.inline_data;
+  wqe.immediate_data = record.immediate_data;
+  wqe.remote_address = record.remote_address;
+  wqe.rkey = record.rkey;
+  wqe.local_lkey = record.local_lkey;
+  wqe.invalidate_rkey = record.invalidate_rkey;
+  wqe.new_rkey = record.new_rkey;
+  wqe.access = record.access;
+  wqe.ah_handle = record.ah_handle;
+  wqe.remote_qpn = record.remote_qpn;
+  wqe.remote_qkey = record.remote_qkey;
+  std::copy(record.inline_payload.begin(), record.inline_payload.end(), wqe.inline_payload.begin());
+  return wqe;
+}
+
+/// Check if a send WQE operates on local memory keys instead of moving data.
+[[nodiscard]] inline bool is_memory_wqe(WqeOpcode opcode) noexcept {
+  return (opcode == WqeOpcode::RegMr) || (opcode == WqeOpcode::LocalInvalidate)
+         || (opcode == WqeOpcode::BindMw);
+}
+
+/// Check if a send WQE consumes a receive WQE at the responder.
+[[nodiscard]] inline bool consumes_recv_wqe(WqeOpcode opcode) noexcept {
+  return (opcode == WqeOpcode::Send) || (opcode == WqeOpcode::SendImm)
+         || (opcode == WqeOpcode::SendWithInvalidate) || (opcode == WqeOpcode::RdmaWriteImm);
+}
+
 }  // namespace nic::rocev2
@@ -1,6 +1,9 @@
 #include "nic/device.h"
 
+#include <cstring>
+
 #include "nic/log.h"
+#include "nic/rocev2/encap.h"
 #include "nic/trace.h"
 
 using namespace nic;
@@ -129,6 +132,15 @@ void Device::initialize_runtime() {
           std::make_unique<rocev2::RdmaEngine>(config_.rdma_config, *dma_engine_, *host_memory_);
       rdma_engine_ = default_rdma_engine_.get();
     }
+    // Completion events of armed CQs interrupt the host on the CQ's vector
+    rdma_engine_->set_cq_event_handler([this](const rocev2::RdmaCqEvent& event) {
+      interrupt_dispatcher_->raise_vector(event.comp_vector);
+    });
+    if (queue_manager_ != nullptr) {
+      queue_manager_->set_roce_ingress([engine = rdma_engine_](std::span<const std::byte> frame) {
+        engine->process_incoming_frame(frame);
+      });
+    }
   }
 }
 
@@ -168,6 +180,29 @@ void Device::write_register(std::uint32_t offset, std::uint32_t value) {
   register_file_.write32(offset, value);
 }
 
+bool Device::write_doorbell(std::uint32_t offset, std::span<const std::byte> data) {
+  NIC_TRACE_SCOPED(__func__);
+  if ((rdma_engine_ == nullptr) || (offset + data.size() > config_.bars[2].size)) {
+    return false;
+  }
+
+  if ((offset == rocev2::kRdmaSqDoorbellOffset) && (data.size() == sizeof(rocev2::RdmaSqDoorbell))) {
+    rocev2::RdmaSqDoorbell doorbell;
+    std::memcpy(static_cast<void*>(&doorbell), data.data(), sizeof(doorbell));
+    rdma_engine_->ring_sq_doorbell(doorbell.qp_number, doorbell.producer_index);
+    return true;
+  }
+
+  if ((offset == rocev2::kRdmaBlueFlameOffset) && (data.size() == rocev2::kSqWqeSize)) {
+    rocev2::RdmaSqWqe entry;
+    std::memcpy(static_cast<void*>(&entry), data.data(), sizeof(entry));
+    rdma_engine_->post_blueflame(entry);
+    return true;
+  }
+
+  return false;
+}
+
 bool Device::process_queue_once() {
   NIC_TRACE_SCOPED(__func__);
   if (queue_pair_ == nullptr) {
@@ -176,6 +211,40 @@ bool Device::process_queue_once() {
   return queue_pair_->process_once();
 }
 
+std::size_t Device::queue_rdma_egress() {
+  NIC_TRACE_SCOPED(__func__);
+  if ((rdma_engine_ == nullptr) || (queue_manager_ == nullptr)) {
+    return 0;
+  }
+
+  std::size_t queued = 0;
+  for (auto& packet : rdma_engine_->generate_outgoing_packets()) {
+    if (!packet.is_frame) {
+      NIC_LOGF_WARNING("rdma egress: dropping bare UDP payload (encapsulation disabled)");
+      continue;
+    }
+    if (queue_manager_->enqueue_roce_frame(std::move(packet.data))) {
+      ++queued;
+    }
+  }
+  return queued;
+}
+
+bool Device::receive_frame(std::span<const std::byte> frame, std::size_t queue_index) {
+  NIC_TRACE_SCOPED(__func__);
+  if (queue_manager_ != nullptr) {
+    return queue_manager_->receive_frame(frame, queue_index);
+  }
+  if ((rdma_engine_ != nullptr) && rocev2::is_roce_frame(frame)) {
+    rdma_engine_->process_incoming_frame(frame);
+    return true;
+  }
+  if ((queue_pair_ == nullptr) || (queue_index != 0)) {
+    return false;
+  }
+  return queue_pair_->receive_frame(frame);
+}
+
 bool Device::set_msix_queue_vector(std::uint16_t queue_id, std::uint16_t vector_id) {
   NIC_TRACE_SCOPED(__func__);
   if (interrupt_dispatcher_ == nullptr) {
@@ -1,10 +1,21 @@
 #include "nic/dma_engine.h"
 
+#include <atomic>
+
 #include "nic/log.h"
 #include "nic/trace.h"
 
 using namespace nic;
 
+namespace {
+
+/// Queue pairs sharing this engine may run on different threads.
+void add_counter(std::size_t& counter, std::size_t value) noexcept {
+  std::atomic_ref<std::size_t>(counter).fetch_add(value, std::memory_order_relaxed);
+}
+
+}  // namespace
+
 DMAEngine::DMAEngine(HostMemory& memory) : memory_(memory) {
   NIC_TRACE_SCOPED(__func__);
 }
@@ -14,8 +25,8 @@ DmaResult DMAEngine::read(HostAddress address, std::span<std::byte> buffer) {
   HostMemoryResult host_result = memory_.read(address, buffer);
   DmaResult result = map_result(host_result, DmaDirection::Read, buffer.size(), "dma_read");
   if (result.ok()) {
-    counters_.read_ops += 1;
-    counters_.bytes_read += result.bytes_processed;
+    add_counter(counters_.read_ops, 1);
+    add_counter(counters_.bytes_read, result.bytes_processed);
   }
   return result;
 }
@@ -25,8 +36,8 @@ DmaResult DMAEngine::write(HostAddress address, std::span<const std::byte> data)
   HostMemoryResult host_result = memory_.write(address, data);
   DmaResult result = map_result(host_result, DmaDirection::Write, data.size(), "dma_write");
   if (result.ok()) {
-    counters_.write_ops += 1;
-    counters_.bytes_written += result.bytes_processed;
+    add_counter(counters_.write_ops, 1);
+    add_counter(counters_.bytes_written, result.bytes_processed);
   }
   return result;
 }
@@ -38,17 +49,17 @@ DmaResult DMAEngine::read_burst(HostAddress address,
   NIC_TRACE_SCOPED(__func__);
   if ((beat_bytes == 0) || (stride_bytes == 0)) {
     trace_dma_error(DmaError::AlignmentError, "dma_read_burst_invalid_stride");
-    counters_.errors += 1;
+    add_counter(counters_.errors, 1);
     return {DmaError::AlignmentError, 0, "invalid_stride"};
   }
   if (buffer.size() % beat_bytes != 0) {
     trace_dma_error(DmaError::AlignmentError, "dma_read_burst_partial_beat");
-    counters_.errors += 1;
+    add_counter(counters_.errors, 1);
     return {DmaError::AlignmentError, 0, "partial_beat"};
   }
 
   std::size_t beats = buffer.size() / beat_bytes;
-  counters_.burst_read_ops += 1;
+  add_counter(counters_.burst_read_ops, 1);
 
   std::size_t total_bytes = 0;
   for (std::size_t beat_index = 0; beat_index < beats; ++beat_index) {
@@ -62,7 +73,7 @@ DmaResult DMAEngine::read_burst(HostAddress address,
     total_bytes += result.bytes_processed;
   }
 
-  counters_.bytes_read += total_bytes;
+  add_counter(counters_.bytes_read, total_bytes);
   return {DmaError::None, total_bytes, nullptr};
 }
 
@@ -73,17 +84,17 @@ DmaResult DMAEngine::write_burst(HostAddress address,
   NIC_TRACE_SCOPED(__func__);
   if ((beat_bytes == 0) || (stride_bytes == 0)) {
     trace_dma_error(DmaError::AlignmentError, "dma_write_burst_invalid_stride");
-    counters_.errors += 1;
+    add_counter(counters_.errors, 1);
     return {DmaError::AlignmentError, 0, "invalid_stride"};
   }
   if (data.size() % beat_bytes != 0) {
     trace_dma_error(DmaError::AlignmentError, "dma_write_burst_partial_beat");
-    counters_.errors += 1;
+    add_counter(counters_.errors, 1);
     return {DmaError::AlignmentError, 0, "partial_beat"};
   }
 
   std::size_t beats = data.size() / beat_bytes;
-  counters_.burst_write_ops += 1;
+  add_counter(counters_.burst_write_ops, 1);
 
   std::size_t total_bytes = 0;
   for (std::size_t beat_index = 0; beat_index < beats; ++beat_index) {
@@ -97,7 +108,7 @@ DmaResult DMAEngine::write_burst(HostAddress address,
     total_bytes += result.bytes_processed;
   }
 
-  counters_.bytes_written += total_bytes;
+  add_counter(counters_.bytes_written, total_bytes);
   return {DmaError::None, total_bytes, nullptr};
 }
 
@@ -108,14 +119,14 @@ DmaResult DMAEngine::transfer_sgl(const SglView& sgl,
 
   if (sgl.empty()) {
     trace_dma_error(DmaError::AccessError, "dma_sgl_empty");
-    counters_.errors += 1;
+    add_counter(counters_.errors, 1);
     return {DmaError::AccessError, 0, "empty_sgl"};
   }
 
   std::size_t total_length = sgl.total_length();
   if (buffer.size() < total_length) {
     trace_dma_error(DmaError::AccessError, "dma_sgl_buffer_too_small");
-    counters_.errors += 1;
+    add_counter(counters_.errors, 1);
     return {DmaError::AccessError, 0, "buffer_too_small"};
   }
 
@@ -144,11 +155,11 @@ DmaResult DMAEngine::transfer_sgl(const SglView& sgl,
   }
 
   if (direction == DmaDirection::Read) {
-    counters_.read_ops += 1;
-    counters_.bytes_read += processed;
+    add_counter(counters_.read_ops, 1);
+    add_counter(counters_.bytes_read, processed);
   } else {
-    counters_.write_ops += 1;
-    counters_.bytes_written += processed;
+    add_counter(counters_.write_ops, 1);
+    add_counter(counters_.bytes_written, processed);
   }
 
   return {DmaError::None, processed, nullptr};
@@ -165,7 +176,7 @@ DmaResult DMAEngine::map_result(const HostMemoryResult& host_result,
 
   DmaError error = ToDmaError(host_result.error);
   trace_dma_error(error, context);
-  counters_.errors += 1;
+  add_counter(counters_.errors, 1);
   NIC_LOGF_WARNING("DMA error: context={} err={}", context, static_cast<int>(error));
   if (direction == DmaDirection::Read) {
     // No byte accumulation on error; counters updated by caller when successful.
@@ -22,26 +22,26 @@ std::optional<std::uint16_t> InterruptDispatcher::resolve_vector(
   return mapping_.queue_vector(queue_id);
 }
 
-void InterruptDispatcher::try_fire(std::uint16_t vector_id) {
+bool InterruptDispatcher::try_fire(std::uint16_t vector_id) {
   NIC_TRACE_SCOPED(__func__);
   if (!table_.valid_index(vector_id)) {
-    return;
+    return false;
   }
   auto vec = table_.vector(vector_id);
   if (!vec.has_value()) {
-    return;
+    return false;
   }
   if (!vec->enabled) {
     stats_.suppressed_disabled += 1;
     stats_.per_vector_suppressed_disabled[vector_id] += 1;
     NIC_LOGF_TRACE("interrupt suppressed: vector={} reason=disabled", vector_id);
-    return;
+    return false;
   }
   if (vec->masked) {
     stats_.suppressed_masked += 1;
     stats_.per_vector_suppressed_masked[vector_id] += 1;
     NIC_LOGF_TRACE("interrupt suppressed: vector={} reason=masked", vector_id);
-    return;
+    return false;
   }
 
   auto it = pending_counts_.find(vector_id);
@@ -65,10 +65,12 @@ void InterruptDispatcher::try_fire(std::uint16_t vector_id) {
   }
   stats_.interrupts_fired += 1;
   stats_.per_vector_fired[vector_id] += 1;
+  return true;
 }
 
 bool InterruptDispatcher::on_completion(const InterruptEvent& ev) {
   NIC_TRACE_SCOPED(__func__);
+  std::lock_guard lock(mutex_);
   auto vector_id = resolve_vector(ev.queue_id);
   if (!vector_id.has_value()) {
     return false;
@@ -114,8 +116,17 @@ bool InterruptDispatcher::on_completion(const InterruptEvent& ev) {
   return true;
 }
 
+bool InterruptDispatcher::raise_vector(std::uint16_t vector_id) {
+  NIC_TRACE_SCOPED(__func__);
+  std::lock_guard lock(mutex_);
+  bool fired = try_fire(vector_id);
+  pending_time_us_.erase(vector_id);
+  return fired;
+}
+
 void InterruptDispatcher::flush(std::optional<std::uint16_t> vector_id) {
   NIC_TRACE_SCOPED(__func__);
+  std::lock_guard lock(mutex_);
   if (vector_id.has_value()) {
     try_fire(*vector_id);
     pending_time_us_.erase(*vector_id);
@@ -136,6 +147,7 @@ void InterruptDispatcher::flush(std::optional<std::uint16_t> vector_id) {
 
 void InterruptDispatcher::on_timer_tick(std::uint32_t elapsed_us) {
   NIC_TRACE_SCOPED(__func__);
+  std::lock_guard lock(mutex_);
   if ((coalesce_.timer_threshold_us == 0) || pending_counts_.empty()) {
     return;
   }
@@ -155,19 +167,32 @@ void InterruptDispatcher::on_timer_tick(std::uint32_t elapsed_us) {
   }
 }
 
+AdaptiveConfig InterruptDispatcher::adaptive_config() const {
+  std::lock_guard lock(mutex_);
+  return adaptive_;
+}
+
+InterruptStats InterruptDispatcher::stats() const {
+  std::lock_guard lock(mutex_);
+  return stats_;
+}
+
 bool InterruptDispatcher::set_queue_vector(std::uint16_t queue_id,
                                            std::uint16_t vector_id) noexcept {
   NIC_TRACE_SCOPED(__func__);
+  std::lock_guard lock(mutex_);
   return mapping_.set_queue_vector(queue_id, vector_id);
 }
 
 bool InterruptDispatcher::mask_vector(std::uint16_t vector_id, bool masked) noexcept {
   NIC_TRACE_SCOPED(__func__);
+  std::lock_guard lock(mutex_);
   return table_.mask(vector_id, masked);
 }
 
 bool InterruptDispatcher::enable_vector(std::uint16_t vector_id, bool enabled) noexcept {
   NIC_TRACE_SCOPED(__func__);
+  std::lock_guard lock(mutex_);
   return table_.enable(vector_id, enabled);
 }
 
@@ -184,6 +209,7 @@ const CoalesceConfig& InterruptDispatcher::get_coalesce_config(
 bool InterruptDispatcher::set_queue_coalesce_config(std::uint16_t queue_id,
                                                     const CoalesceConfig& config) noexcept {
   NIC_TRACE_SCOPED(__func__);
+  std::lock_guard lock(mutex_);
   per_queue_coalesce_[queue_id] = config;
   return true;
 }
@@ -191,6 +217,7 @@ bool InterruptDispatcher::set_queue_coalesce_config(std::uint16_t queue_id,
 std::optional<CoalesceConfig> InterruptDispatcher::queue_coalesce_config(
     std::uint16_t queue_id) const noexcept {
   NIC_TRACE_SCOPED(__func__);
+  std::lock_guard lock(mutex_);
   auto it = per_queue_coalesce_.find(queue_id);
   if (it != per_queue_coalesce_.end()) {
     return it->second;
@@ -200,11 +227,13 @@ std::optional<CoalesceConfig> InterruptDispatcher::queue_coalesce_config(
 
 void InterruptDispatcher::clear_queue_coalesce_config(std::uint16_t queue_id) noexcept {
   NIC_TRACE_SCOPED(__func__);
+  std::lock_guard lock(mutex_);
   per_queue_coalesce_.erase(queue_id);
 }
 
 void InterruptDispatcher::set_adaptive_config(const AdaptiveConfig& config) noexcept {
   NIC_TRACE_SCOPED(__func__);
+  std::lock_guard lock(mutex_);
   adaptive_ = config;
   // Reset adaptive state when config changes
   if (config.enabled) {
@@ -3,6 +3,7 @@
 #include <sstream>
 
 #include "nic/log.h"
+#include "nic/rocev2/encap.h"
 #include "nic/trace.h"
 
 using namespace nic;
@@ -18,7 +19,13 @@ QueueManager::QueueManager(QueueManagerConfig config, DMAEngine& dma_engine)
     weights_.push_back(qp_cfg.weight);
     queue_pairs_.push_back(std::make_unique<QueuePair>(qp_cfg, dma_engine_));
   }
-  if (queue_pairs_.empty()) {
+  if (config_.roce.enabled) {
+    if (config_.roce.weight == 0) {
+      config_.roce.weight = 1;
+    }
+    weights_.push_back(config_.roce.weight);
+  }
+  if (weights_.empty()) {
     scheduler_credit_ = 0;
   } else {
     scheduler_credit_ = weights_.front();
@@ -53,17 +60,18 @@ std::optional<QueuePairStats> QueueManager::queue_stats(std::size_t index) const
 
 bool QueueManager::process_once() {
   NIC_TRACE_SCOPED(__func__);
-  if (queue_pairs_.empty()) {
+  // One scheduler slot per Ethernet queue, plus one for the RoCE traffic class
+  const std::size_t slots = weights_.size();
+  if (slots == 0) {
     return false;
   }
 
-  for (std::size_t i = 0; i < queue_pairs_.size(); ++i) {
-    auto& qp = queue_pairs_[scheduler_index_];
-    if (qp->process_once()) {
+  for (std::size_t i = 0; i < slots; ++i) {
+    if (process_slot(scheduler_index_)) {
       if (scheduler_credit_ > 1) {
         --scheduler_credit_;
       } else {
-        scheduler_index_ = (scheduler_index_ + 1) % queue_pairs_.size();
+        scheduler_index_ = (scheduler_index_ + 1) % slots;
         scheduler_credit_ = weights_[scheduler_index_];
       }
       ++scheduler_advances_;
@@ -71,22 +79,100 @@ bool QueueManager::process_once() {
     }
     // Skip blocked queue; move on.
     ++scheduler_skips_;
-    scheduler_index_ = (scheduler_index_ + 1) % queue_pairs_.size();
+    scheduler_index_ = (scheduler_index_ + 1) % slots;
     scheduler_credit_ = weights_[scheduler_index_];
   }
   return false;
 }
 
+bool QueueManager::process_queue(std::size_t index) {
+  NIC_TRACE_SCOPED(__func__);
+  if ((index >= queue_pairs_.size()) || is_paused(config_.queue_configs[index].priority)) {
+    return false;
+  }
+  return queue_pairs_[index]->process_once();
+}
+
+bool QueueManager::process_slot(std::size_t slot) {
+  NIC_TRACE_SCOPED(__func__);
+  if (slot == queue_pairs_.size()) {
+    return transmit_roce_frame();
+  }
+  if (is_paused(config_.queue_configs[slot].priority)) {
+    ++pfc_paused_skips_;
+    return false;
+  }
+  return queue_pairs_[slot]->process_once();
+}
+
+bool QueueManager::is_paused(std::uint8_t priority) const noexcept {
+  return (config_.pfc != nullptr) && config_.pfc->is_priority_paused(priority);
+}
+
+bool QueueManager::transmit_roce_frame() {
+  NIC_TRACE_SCOPED(__func__);
+  if (roce_frames_.empty()) {
+    return false;
+  }
+  if (is_paused(config_.roce.priority)) {
+    ++pfc_paused_skips_;
+    return false;
+  }
+
+  std::vector<std::byte> frame = std::move(roce_frames_.front());
+  roce_frames_.pop_front();
+  ++roce_tx_frames_;
+  roce_tx_bytes_ += frame.size();
+  if (roce_egress_) {
+    roce_egress_(frame);
+  }
+  return true;
+}
+
+bool QueueManager::enqueue_roce_frame(std::vector<std::byte> frame) {
+  NIC_TRACE_SCOPED(__func__);
+  if (!config_.roce.enabled) {
+    return false;
+  }
+  if (roce_frames_.size() >= config_.roce.max_queued_frames) {
+    ++roce_drops_queue_full_;
+    NIC_LOGF_WARNING("roce drop: egress queue full ({} frames)", roce_frames_.size());
+    return false;
+  }
+  roce_frames_.push_back(std::move(frame));
+  return true;
+}
+
+bool QueueManager::receive_frame(std::span<const std::byte> frame, std::size_t queue_index) {
+  NIC_TRACE_SCOPED(__func__);
+  if (roce_ingress_ && rocev2::is_roce_frame(frame)) {
+    ++roce_rx_frames_;
+    roce_ingress_(frame);
+    return true;
+  }
+  QueuePair* qp = queue(queue_index);
+  if (qp == nullptr) {
+    return false;
+  }
+  return qp->receive_frame(frame);
+}
+
 void QueueManager::reset() {
   NIC_TRACE_SCOPED(__func__);
   scheduler_index_ = 0;
-  if (queue_pairs_.empty()) {
+  if (weights_.empty()) {
     scheduler_credit_ = 0;
   } else {
     scheduler_credit_ = weights_.front();
   }
   scheduler_advances_ = 0;
   scheduler_skips_ = 0;
+  pfc_paused_skips_ = 0;
+  roce_frames_.clear();
+  roce_tx_frames_ = 0;
+  roce_tx_bytes_ = 0;
+  roce_rx_frames_ = 0;
+  roce_drops_queue_full_ = 0;
   for (auto& qp : queue_pairs_) {
     qp->reset();
   }
@@ -112,7 +198,9 @@ std::string QueueManager::stats_summary() const {
       << " tx_vlan_ins=" << s.total_tx_vlan_insertions
       << " rx_vlan_strip=" << s.total_rx_vlan_strips
       << " rx_csum_ver=" << s.total_rx_checksum_verified << " rx_gro=" << s.total_rx_gro_aggregated
-      << " sched_adv=" << s.scheduler_advances << " sched_skip=" << s.scheduler_skips;
+      << " sched_adv=" << s.scheduler_advances << " sched_skip=" << s.scheduler_skips
+      << " pfc_skip=" << s.pfc_paused_skips << " roce_tx=" << s.roce_tx_frames
+      << " roce_rx=" << s.roce_rx_frames << " roce_drops=" << s.roce_drops_queue_full;
   return oss.str();
 }
 
@@ -136,4 +224,9 @@ void QueueManager::aggregate_stats(QueueManagerStats& out) const {
   }
   out.scheduler_advances += scheduler_advances_;
   out.scheduler_skips += scheduler_skips_;
+  out.pfc_paused_skips += pfc_paused_skips_;
+  out.roce_tx_frames += roce_tx_frames_;
+  out.roce_tx_bytes += roce_tx_bytes_;
+  out.roce_rx_frames += roce_rx_frames_;
+  out.roce_drops_queue_full += roce_drops_queue_full_;
 }
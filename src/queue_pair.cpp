@@ -118,6 +118,55 @@ bool QueuePair::process_once() {
   return process_segments(tx_desc, packet);
 }
 
+bool QueuePair::receive_frame(std::span<const std::byte> frame) {
+  NIC_TRACE_SCOPED(__func__);
+  if (rx_ring_->is_empty()) {
+    stats_.drops_no_rx_desc += 1;
+    NIC_LOGF_WARNING("rx drop: qp={} no RX descriptor", config_.queue_id);
+    return false;
+  }
+
+  std::vector<std::byte> rx_bytes(config_.rx_ring.descriptor_size);
+  if (!rx_ring_->pop_descriptor(rx_bytes).ok()) {
+    trace_dma_error(DmaError::AccessError, "rx_pop_failed");
+    return false;
+  }
+
+  RxDescriptor rx_desc{};
+  if (!decode_rx_descriptor(rx_bytes, rx_desc)) {
+    trace_dma_error(DmaError::AccessError, "rx_decode_failed");
+    return false;
+  }
+
+  if (rx_desc.buffer_length < frame.size()) {
+    CompletionEntry rx_entry =
+        make_completion(rx_desc.descriptor_index, CompletionCode::BufferTooSmall);
+    rx_completion_->post_completion(rx_entry);
+    fire_rx_interrupt(rx_entry);
+    stats_.drops_buffer_small += 1;
+    NIC_LOGF_WARNING("rx drop: qp={} buffer too small (frame={} buf={})",
+                     config_.queue_id,
+                     frame.size(),
+                     rx_desc.buffer_length);
+    return false;
+  }
+
+  if (!dma_engine_.write(rx_desc.buffer_address, frame).ok()) {
+    CompletionEntry rx_entry = make_completion(rx_desc.descriptor_index, CompletionCode::Fault);
+    rx_completion_->post_completion(rx_entry);
+    fire_rx_interrupt(rx_entry);
+    return false;
+  }
+
+  CompletionEntry rx_entry = make_completion(rx_desc.descriptor_index, CompletionCode::Success);
+  rx_entry.byte_count = static_cast<std::uint32_t>(frame.size());
+  rx_completion_->post_completion(rx_entry);
+  fire_rx_interrupt(rx_entry);
+  stats_.rx_packets += 1;
+  stats_.rx_bytes += frame.size();
+  return true;
+}
+
 void QueuePair::reset() {
   NIC_TRACE_SCOPED(__func__);
   tx_ring_->reset();
@@ -426,6 +475,7 @@ bool QueuePair::handle_rx_segment(std::vector<std::byte> segment,
   }
 
   CompletionEntry rx_entry = make_completion(rx_desc.descriptor_index, CompletionCode::Success);
+  rx_entry.byte_count = static_cast<std::uint32_t>(segment.size());
   rx_entry.gro_aggregated = rx_desc.gro_enabled;
   if (rx_entry.gro_aggregated) {
     stats_.rx_gro_aggregated += 1;
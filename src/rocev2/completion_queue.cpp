@@ -1,69 +1,212 @@
 #include "nic/rocev2/completion_queue.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <limits>
+
+#include "nic/log.h"
+
 namespace nic::rocev2 {
 
-RdmaCompletionQueue::RdmaCompletionQueue(std::uint32_t cq_number, RdmaCqConfig config)
+namespace {
+
+/// Check whether two CQEs differ only in the fields a mini-CQE carries.
+bool same_title_fields(const RdmaCqe& lhs, const RdmaCqe& rhs) noexcept {
+  return (lhs.status == rhs.status) && (lhs.opcode == rhs.opcode)
+         && (lhs.qp_number == rhs.qp_number) && (lhs.immediate_data == rhs.immediate_data)
+         && (lhs.has_immediate == rhs.has_immediate) && (lhs.is_send == rhs.is_send)
+         && (lhs.src_qp == rhs.src_qp) && (lhs.has_grh == rhs.has_grh)
+         && (lhs.has_invalidate == rhs.has_invalidate)
+         && (lhs.invalidated_rkey == rhs.invalidated_rkey) && (lhs.solicited == rhs.solicited)
+         && (lhs.timestamp_us == rhs.timestamp_us);
+}
+
+}  // namespace
+
+RdmaCompletionQueue::RdmaCompletionQueue(std::uint32_t cq_number,
+                                         RdmaCqConfig config,
+                                         HostMemory* host_memory)
   : cq_number_(cq_number), config_(config) {
   NIC_TRACE_SCOPED(__func__);
+
+  capacity_ = std::bit_ceil(std::max<std::size_t>(config_.depth, 1));
+  mask_ = capacity_ - 1;
+  log2_capacity_ = static_cast<unsigned int>(std::countr_zero(capacity_));
+
+  if (config_.host_ring_address.has_value() && (host_memory != nullptr)) {
+    host_memory_ = host_memory;
+  } else {
+    ring_.resize(capacity_);
+  }
+
+  initialize_ring();
 }
 
 bool RdmaCompletionQueue::post(const RdmaCqe& cqe) {
   NIC_TRACE_SCOPED(__func__);
 
-  if (is_full()) {
+  // A mini-CQE joining an open block needs no slot; anything else takes one
+  bool compress = can_compress(cqe);
+  if ((!compress || (session_count_ == 0)) && is_full()) {
     ++stats_.overflows;
     return false;
   }
 
-  cqes_.push_back(cqe);
+  if (compress) {
+    session_minis_[session_count_] = RdmaMiniCqe{
+        .bytes_completed = cqe.bytes_completed,
+        .wr_id_delta = static_cast<std::uint32_t>(cqe.wr_id - title_->wr_id)};
+    ++session_count_;
+    ++pending_cqes_;
+    ++stats_.compressed_cqes;
+    if ((session_count_ == kMiniCqesPerSlot) && !flush_session()) {
+      return false;
+    }
+  } else {
+    if (!flush_session()) {
+      return false;
+    }
+    RdmaCqeSlot slot;
+    slot.store_cqe(cqe);
+    slot.owner = phase_of(producer_index_);
+    if (!write_slot(producer_index_, slot)) {
+      return false;
+    }
+    ++producer_index_;
+    ++pending_cqes_;
+    stats_.bytes_written += kCqeSlotSize;
+    if (config_.compression) {
+      title_ = cqe;
+    }
+  }
+
   ++stats_.cqes_posted;
-  has_new_completions_ = true;
+  // A solicited-only arm is woken by solicited receives and by errors, as in the IBA
+  if (!solicited_only_ || cqe.solicited || (cqe.status != WqeStatus::Success)) {
+    has_new_completions_ = true;
+    if (armed_) {
+      ++event_cqes_;
+    }
+  }
 
   return true;
 }
 
-std::vector<RdmaCqe> RdmaCompletionQueue::poll(std::size_t max_cqes) {
+bool RdmaCompletionQueue::can_compress(const RdmaCqe& cqe) const noexcept {
+  if (!config_.compression || !title_.has_value() || (cqe.status != WqeStatus::Success)) {
+    return false;
+  }
+  // wr_id must follow the title closely enough for a 32-bit delta
+  std::uint64_t delta = cqe.wr_id - title_->wr_id;
+  return (delta <= std::numeric_limits<std::uint32_t>::max()) && same_title_fields(cqe, *title_);
+}
+
+bool RdmaCompletionQueue::flush_session() {
   NIC_TRACE_SCOPED(__func__);
 
-  std::vector<RdmaCqe> result;
-  std::size_t to_poll = std::min(max_cqes, cqes_.size());
-  result.reserve(to_poll);
+  if (session_count_ == 0) {
+    return true;
+  }
 
-  for (std::size_t poll_idx = 0; poll_idx < to_poll; ++poll_idx) {
-    result.push_back(cqes_.front());
-    cqes_.pop_front();
-    ++stats_.cqes_polled;
+  RdmaCqeSlot slot;
+  slot.owner = phase_of(producer_index_);
+  slot.format = kCqeFormatMiniBlock;
+  slot.mini_count = static_cast<std::uint8_t>(session_count_);
+  slot.store_minis(std::span(session_minis_).first(session_count_));
+  std::size_t minis = session_count_;
+  session_count_ = 0;
+  if (!write_slot(producer_index_, slot)) {
+    pending_cqes_ -= minis;  // Lost with the block
+    return false;
   }
 
-  if (!cqes_.empty()) {
+  ++producer_index_;
+  stats_.bytes_written += kCqeSlotSize;
+  ++stats_.mini_blocks;
+  return true;
+}
+
+std::size_t RdmaCompletionQueue::poll(std::span<RdmaCqe> out) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Polling closes the open block, so no completion waits on the next CQE
+  static_cast<void>(flush_session());
+
+  std::size_t polled = 0;
+  RdmaCqeSlot slot;
+  std::array<RdmaMiniCqe, kMiniCqesPerSlot> minis{};
+  while ((polled < out.size()) && (consumer_index_ != producer_index_)) {
+    if (!read_slot(consumer_index_, slot)) {
+      break;
+    }
+    if (slot.owner != phase_of(consumer_index_)) {
+      break;  // Slot still owned by the producer
+    }
+
+    if (slot.format == kCqeFormatMiniBlock) {
+      // Expand each mini-CQE against the title; a partly polled block keeps its slot
+      std::size_t mini_count = std::min<std::size_t>(slot.mini_count, kMiniCqesPerSlot);
+      slot.load_minis(std::span(minis).first(mini_count));
+      while ((polled < out.size()) && (mini_offset_ < mini_count)) {
+        RdmaCqe cqe = consumer_title_;
+        cqe.wr_id += minis[mini_offset_].wr_id_delta;
+        cqe.bytes_completed = minis[mini_offset_].bytes_completed;
+        out[polled] = cqe;
+        ++polled;
+        ++mini_offset_;
+      }
+      if (mini_offset_ < mini_count) {
+        break;
+      }
+      mini_offset_ = 0;
+    } else {
+      consumer_title_ = slot.load_cqe();
+      out[polled] = consumer_title_;
+      ++polled;
+    }
+    ++consumer_index_;
+  }
+
+  pending_cqes_ -= polled;
+  stats_.cqes_polled += polled;
+  if (is_empty()) {
     has_new_completions_ = false;
   }
 
-  return result;
+  return polled;
 }
 
-std::optional<RdmaCqe> RdmaCompletionQueue::poll_one() {
+std::vector<RdmaCqe> RdmaCompletionQueue::poll(std::size_t max_cqes) {
   NIC_TRACE_SCOPED(__func__);
 
-  if (cqes_.empty()) {
-    return std::nullopt;
+  std::size_t to_poll = std::min(max_cqes, count());
+  if (to_poll == 0) {
+    return {};
   }
 
-  RdmaCqe cqe = cqes_.front();
-  cqes_.pop_front();
-  ++stats_.cqes_polled;
+  std::vector<RdmaCqe> result(to_poll);
+  result.resize(poll(std::span<RdmaCqe>(result)));
+  return result;
+}
 
-  if (cqes_.empty()) {
-    has_new_completions_ = false;
-  }
+std::optional<RdmaCqe> RdmaCompletionQueue::poll_one() {
+  NIC_TRACE_SCOPED(__func__);
 
+  RdmaCqe cqe;
+  if (poll(std::span<RdmaCqe>(&cqe, 1)) == 0) {
+    return std::nullopt;
+  }
   return cqe;
 }
 
-void RdmaCompletionQueue::arm() {
+void RdmaCompletionQueue::arm(bool solicited_only) {
   NIC_TRACE_SCOPED(__func__);
   armed_ = true;
+  solicited_only_ = solicited_only;
   has_new_completions_ = false;
+  event_cqes_ = 0;
   ++stats_.arm_count;
 }
 
@@ -71,12 +214,98 @@ bool RdmaCompletionQueue::should_notify() const noexcept {
   return armed_ && has_new_completions_;
 }
 
+bool RdmaCompletionQueue::event_due() const noexcept {
+  if (!should_notify()) {
+    return false;
+  }
+  const RdmaCqModeration& moderation = config_.moderation;
+  if (moderation.cq_count == 0) {
+    return moderation.cq_period_us == 0;
+  }
+  return event_cqes_ >= moderation.cq_count;
+}
+
+std::uint32_t RdmaCompletionQueue::take_event() noexcept {
+  std::uint32_t cqes = event_cqes_;
+  clear_arm();
+  ++stats_.events;
+  return cqes;
+}
+
 void RdmaCompletionQueue::reset() {
   NIC_TRACE_SCOPED(__func__);
-  cqes_.clear();
+  producer_index_ = 0;
+  consumer_index_ = 0;
+  pending_cqes_ = 0;
+  title_.reset();
+  session_count_ = 0;
+  consumer_title_ = RdmaCqe{};
+  mini_offset_ = 0;
   armed_ = false;
+  solicited_only_ = false;
   has_new_completions_ = false;
+  event_cqes_ = 0;
   stats_ = RdmaCqStats{};
+  initialize_ring();
+}
+
+std::uint8_t RdmaCompletionQueue::phase_of(std::uint64_t index) const noexcept {
+  return static_cast<std::uint8_t>((index >> log2_capacity_) & 1U);
+}
+
+HostAddress RdmaCompletionQueue::slot_address(std::uint64_t index) const noexcept {
+  return config_.host_ring_address.value_or(0) + ((index & mask_) * kCqeSlotSize);
+}
+
+bool RdmaCompletionQueue::write_slot(std::uint64_t index, const RdmaCqeSlot& slot) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (host_memory_ == nullptr) {
+    ring_[index & mask_] = slot;
+    return true;
+  }
+
+  std::array<std::byte, kCqeSlotSize> bytes{};
+  std::memcpy(bytes.data(), static_cast<const void*>(&slot), kCqeSlotSize);
+  if (!host_memory_->write(slot_address(index), bytes).ok()) {
+    ++stats_.host_access_errors;
+    NIC_LOGF_WARNING("CQ {} host ring write failed at index {}", cq_number_, index & mask_);
+    return false;
+  }
+  return true;
+}
+
+bool RdmaCompletionQueue::read_slot(std::uint64_t index, RdmaCqeSlot& slot) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (host_memory_ == nullptr) {
+    slot = ring_[index & mask_];
+    return true;
+  }
+
+  std::array<std::byte, kCqeSlotSize> bytes{};
+  if (!host_memory_->read(slot_address(index), bytes).ok()) {
+    ++stats_.host_access_errors;
+    return false;
+  }
+  std::memcpy(static_cast<void*>(&slot), bytes.data(), kCqeSlotSize);
+  return true;
+}
+
+void RdmaCompletionQueue::initialize_ring() {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Every slot starts hardware-owned: owner bit 1 never matches the first-pass phase 0.
+  if (host_memory_ == nullptr) {
+    std::fill(ring_.begin(), ring_.end(), RdmaCqeSlot{});
+    return;
+  }
+
+  for (std::uint64_t index = 0; index < capacity_; ++index) {
+    if (!write_slot(index, RdmaCqeSlot{})) {
+      break;
+    }
+  }
 }
 
 }  // namespace nic::rocev2
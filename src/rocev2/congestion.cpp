@@ -136,6 +136,11 @@ void CongestionControlManager::clear_flow_state(std::uint32_t qp_number) {
   cnp_timers_.erase(qp_number);
 }
 
+std::size_t CongestionControlManager::memory_footprint() const noexcept {
+  return (flow_states_.size() * sizeof(decltype(flow_states_)::value_type))
+         + (cnp_timers_.size() * sizeof(decltype(cnp_timers_)::value_type));
+}
+
 DcqcnFlowState& CongestionControlManager::get_flow_state(std::uint32_t qp_number) {
   NIC_TRACE_SCOPED(__func__);
 
@@ -217,7 +222,8 @@ void ReliabilityManager::add_pending(std::uint32_t qp_number,
                                      std::uint32_t end_psn,
                                      std::uint64_t wr_id,
                                      WqeOpcode opcode,
-                                     std::uint64_t send_time_us) {
+                                     std::uint64_t send_time_us,
+                                     bool signaled) {
   NIC_TRACE_SCOPED(__func__);
 
   PendingAck pending;
@@ -227,7 +233,9 @@ void ReliabilityManager::add_pending(std::uint32_t qp_number,
   pending.wr_id = wr_id;
   pending.opcode = opcode;
   pending.retry_count = 0;
+  pending.rnr_retry_count = 0;
   pending.waiting_for_ack = true;
+  pending.signaled = signaled;
 
   pending_ops_[qp_number].push_back(pending);
 }
@@ -260,7 +268,9 @@ AckResult ReliabilityManager::process_ack(std::uint32_t qp_number, std::uint32_t
 
 AckResult ReliabilityManager::process_nak(std::uint32_t qp_number,
                                           std::uint32_t nak_psn,
-                                          AethSyndrome syndrome) {
+                                          AethSyndrome syndrome,
+                                          std::uint8_t rnr_timer,
+                                          std::optional<std::uint32_t> rnr_retry_limit) {
   NIC_TRACE_SCOPED(__func__);
 
   AckResult result;
@@ -298,23 +308,28 @@ AckResult ReliabilityManager::process_nak(std::uint32_t qp_number,
     }
 
     case AethSyndrome::RnrNak: {
-      // Receiver Not Ready - retry after RNR timeout
+      // Receiver Not Ready - retry after RNR timeout. RNR retries have their own
+      // counter so ACK timeouts neither lengthen the back-off nor use up the RNR limit.
       ++stats_.rnr_retries;
       NIC_LOGF_WARNING("RNR NAK: qp={} psn={}", qp_number, nak_psn);
+      std::uint32_t limit = rnr_retry_limit.value_or(config_.rnr_retry_count);
       for (auto& pending : iter->second) {
         if ((pending.start_psn == nak_psn) || (pending.end_psn == nak_psn)) {
-          ++pending.retry_count;
-          if (pending.retry_count > config_.rnr_retry_count) {
+          ++pending.rnr_retry_count;
+          if ((limit != kRnrRetryInfinite) && (pending.rnr_retry_count > limit)) {
             result.error_status = WqeStatus::RnrRetryExceededError;
             pending.waiting_for_ack = false;
             ++stats_.retry_exceeded;
             NIC_LOGF_ERROR("RNR retry exceeded: qp={} psn={} retries={}",
                            qp_number,
                            pending.start_psn,
-                           pending.retry_count);
+                           pending.rnr_retry_count);
           } else {
-            // Schedule for later retransmission
+            // Schedule for retransmission once the responder's RNR timer has run
             result.needs_retransmit = true;
+            result.retry_delay_us =
+                std::max(result.retry_delay_us,
+                         calculate_rnr_delay(rnr_timer, pending.rnr_retry_count));
           }
         }
       }
@@ -400,11 +415,63 @@ void ReliabilityManager::reset() {
   stats_ = ReliabilityStats{};
 }
 
+bool ReliabilityManager::has_any_outstanding() const {
+  NIC_TRACE_SCOPED(__func__);
+
+  return std::any_of(pending_ops_.begin(), pending_ops_.end(), [](const auto& entry) {
+    return std::any_of(entry.second.begin(), entry.second.end(), [](const PendingAck& op) {
+      return op.waiting_for_ack;
+    });
+  });
+}
+
+bool ReliabilityManager::has_outstanding(std::uint32_t qp_number) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = pending_ops_.find(qp_number);
+  if (iter == pending_ops_.end()) {
+    return false;
+  }
+  return std::any_of(iter->second.begin(), iter->second.end(), [](const PendingAck& op) {
+    return op.waiting_for_ack;
+  });
+}
+
 void ReliabilityManager::clear_pending(std::uint32_t qp_number) {
   NIC_TRACE_SCOPED(__func__);
   pending_ops_.erase(qp_number);
 }
 
+bool ReliabilityManager::release_idle_state(std::uint32_t qp_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = pending_ops_.find(qp_number);
+  if (iter == pending_ops_.end()) {
+    return true;
+  }
+  if (!iter->second.empty()) {
+    return false;
+  }
+  pending_ops_.erase(iter);
+  return true;
+}
+
+void ReliabilityManager::check_all_timeouts(std::uint64_t current_time_us) {
+  NIC_TRACE_SCOPED(__func__);
+
+  for (const auto& [qp_number, pending] : pending_ops_) {
+    static_cast<void>(check_timeouts(qp_number, current_time_us));
+  }
+}
+
+std::size_t ReliabilityManager::memory_footprint() const noexcept {
+  std::size_t bytes = 0;
+  for (const auto& [qp_number, pending] : pending_ops_) {
+    bytes += sizeof(qp_number) + sizeof(pending) + (pending.capacity() * sizeof(PendingAck));
+  }
+  return bytes;
+}
+
 std::uint64_t ReliabilityManager::calculate_timeout(std::uint32_t retry_count) const {
   NIC_TRACE_SCOPED(__func__);
 
@@ -420,6 +487,15 @@ std::uint64_t ReliabilityManager::calculate_timeout(std::uint32_t retry_count) c
   return timeout;
 }
 
+std::uint64_t ReliabilityManager::calculate_rnr_delay(std::uint8_t rnr_timer,
+                                                      std::uint32_t retry_count) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Repeated RNR NAKs mean the receiver is falling behind: back off exponentially
+  std::uint32_t shift = std::min<std::uint32_t>((retry_count == 0) ? 0 : (retry_count - 1), 16);
+  return std::min(rnr_timer_us(rnr_timer) << shift, config_.rnr_timeout_us);
+}
+
 void ReliabilityManager::complete_up_to(std::vector<PendingAck>& pending,
                                         std::uint32_t ack_psn,
                                         std::vector<std::uint64_t>& completed) {
@@ -438,7 +514,12 @@ void ReliabilityManager::complete_up_to(std::vector<PendingAck>& pending,
     // If diff is small (within window), operation is complete
     if (diff < 0x800000) {  // Within half the PSN space
       op.waiting_for_ack = false;
-      completed.push_back(op.wr_id);
+      // Unsignaled ops are covered by the next signaled CQE on the send queue
+      if (op.signaled) {
+        completed.push_back(op.wr_id);
+      } else {
+        ++stats_.unsignaled_retired;
+      }
     }
   }
 }
@@ -0,0 +1,242 @@
+#include "nic/rocev2/encap.h"
+
+#include <algorithm>
+
+#include <bit_fields/bit_fields.h>
+
+#include "nic/checksum.h"
+#include "nic/trace.h"
+
+namespace nic::rocev2 {
+
+namespace {
+
+std::uint64_t mac_to_u64(const MacAddress& mac) noexcept {
+  std::uint64_t value = 0;
+  for (std::uint8_t octet : mac) {
+    value = (value << 8) | octet;
+  }
+  return value;
+}
+
+MacAddress u64_to_mac(std::uint64_t value) noexcept {
+  MacAddress mac{};
+  for (std::size_t idx = mac.size(); idx > 0; --idx) {
+    mac[idx - 1] = static_cast<std::uint8_t>(value & 0xFF);
+    value >>= 8;
+  }
+  return mac;
+}
+
+std::uint32_t ip_to_u32(const std::array<std::uint8_t, 4>& ip) noexcept {
+  return (static_cast<std::uint32_t>(ip[0]) << 24) | (static_cast<std::uint32_t>(ip[1]) << 16)
+         | (static_cast<std::uint32_t>(ip[2]) << 8) | static_cast<std::uint32_t>(ip[3]);
+}
+
+std::array<std::uint8_t, 4> u32_to_ip(std::uint32_t value) noexcept {
+  return {static_cast<std::uint8_t>(value >> 24),
+          static_cast<std::uint8_t>(value >> 16),
+          static_cast<std::uint8_t>(value >> 8),
+          static_cast<std::uint8_t>(value)};
+}
+
+std::uint16_t load_be16(std::span<const std::byte> data, std::size_t offset) noexcept {
+  return static_cast<std::uint16_t>((std::to_integer<std::uint16_t>(data[offset]) << 8)
+                                    | std::to_integer<std::uint16_t>(data[offset + 1]));
+}
+
+void store_be16(std::span<std::byte> data, std::size_t offset, std::uint16_t value) noexcept {
+  data[offset] = static_cast<std::byte>(value >> 8);
+  data[offset + 1] = static_cast<std::byte>(value & 0xFF);
+}
+
+}  // namespace
+
+std::uint16_t roce_flow_src_port(std::uint32_t src_qp, std::uint32_t dest_qp) noexcept {
+  return roce_path_src_port(src_qp, dest_qp, 0);
+}
+
+std::uint16_t roce_path_src_port(std::uint32_t src_qp,
+                                 std::uint32_t dest_qp,
+                                 std::uint32_t path) noexcept {
+  std::uint32_t hash = (src_qp * 0x9E3779B1U) ^ dest_qp;
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6BU;
+  hash ^= hash >> 13;
+  // An odd stride visits every 14-bit value before repeating, so paths never share a port
+  hash += path * 0x2F4BU;
+  return static_cast<std::uint16_t>(kRoceSrcPortBase | (hash & 0x3FFF));
+}
+
+// =============================================================================
+// RoceHeaderTemplate
+// =============================================================================
+
+RoceHeaderTemplate::RoceHeaderTemplate(const RoceFlowAttr& attr) : attr_(attr) {
+  NIC_TRACE_SCOPED(__func__);
+
+  bool tagged = attr.vlan_id.has_value();
+  ip_offset_ = static_cast<std::uint8_t>(kEthHeaderSize + (tagged ? kVlanTagSize : 0));
+  size_ = static_cast<std::uint8_t>(ip_offset_ + kIpv4HeaderSize + kUdpHeaderSize);
+
+  std::span<std::byte> header(header_.data(), size_);
+  bit_fields::NetworkBitWriter writer(header);
+  writer.serialize(bit_fields::formats::kEthernetHeader,
+                   mac_to_u64(attr.dest_mac),                  // dest_mac
+                   mac_to_u64(attr.src_mac),                   // src_mac
+                   tagged ? kEtherTypeVlan : kEtherTypeIpv4);  // ethertype
+  if (tagged) {
+    writer.serialize(bit_fields::formats::kVlanTag,
+                     attr.vlan_pcp,                                        // pcp
+                     0,                                                    // dei
+                     static_cast<std::uint16_t>(*attr.vlan_id & 0x0FFF));  // vid
+    writer.write_bits<16>(kEtherTypeIpv4);
+  }
+
+  // Total length and checksum stay zero; encapsulate() fills them per packet
+  writer.serialize(bit_fields::formats::kIpv4Header,
+                   4,                              // version
+                   5,                              // ihl
+                   attr.traffic_class >> 2,        // dscp
+                   attr.traffic_class & 0x03,      // ecn
+                   static_cast<std::uint16_t>(0),  // total_length
+                   static_cast<std::uint16_t>(0),  // identification
+                   0x02,                           // flags (DF)
+                   static_cast<std::uint16_t>(0),  // fragment_offset
+                   attr.ttl,                       // ttl
+                   kIpProtocolUdp,                 // protocol
+                   static_cast<std::uint16_t>(0),  // header_checksum
+                   ip_to_u32(attr.src_ip),         // src_ip
+                   ip_to_u32(attr.dest_ip));       // dst_ip
+  writer.serialize(bit_fields::formats::kUdpHeader,
+                   attr.src_port,                   // src_port
+                   attr.dest_port,                  // dst_port
+                   static_cast<std::uint16_t>(0),   // length
+                   static_cast<std::uint16_t>(0));  // checksum (unused by RoCEv2)
+
+  // Sum the IPv4 words that never change; the first word carries the per-packet ToS
+  for (std::size_t offset = ip_offset_ + 2; offset < ip_offset_ + kIpv4HeaderSize; offset += 2) {
+    partial_checksum_ += load_be16(header, offset);
+  }
+}
+
+std::vector<std::byte> RoceHeaderTemplate::encapsulate(
+    std::span<const std::byte> udp_payload,
+    std::optional<std::uint8_t> traffic_class,
+    std::optional<std::uint16_t> src_port) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::vector<std::byte> frame(size_ + udp_payload.size());
+  std::copy_n(header_.begin(), size_, frame.begin());
+  std::copy(udp_payload.begin(), udp_payload.end(), frame.begin() + size_);
+
+  std::span<std::byte> out(frame);
+  std::uint8_t tos = traffic_class.value_or(attr_.traffic_class);
+  auto udp_length = static_cast<std::uint16_t>(kUdpHeaderSize + udp_payload.size());
+  auto ip_length = static_cast<std::uint16_t>(kIpv4HeaderSize + udp_length);
+  out[ip_offset_ + 1] = static_cast<std::byte>(tos);
+  store_be16(out, ip_offset_ + 2, ip_length);
+  store_be16(out, ip_offset_ + kIpv4HeaderSize + 4, udp_length);
+  if (src_port) {
+    store_be16(out, ip_offset_ + kIpv4HeaderSize, *src_port);  // UDP only; IPv4 sum unaffected
+  }
+
+  // Incremental checksum: add the patched words to the precomputed sum
+  std::uint32_t sum = partial_checksum_ + ((0x45U << 8) | tos) + ip_length;
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  store_be16(out, ip_offset_ + 10, static_cast<std::uint16_t>(~sum));
+  return frame;
+}
+
+// =============================================================================
+// Frame Parsing
+// =============================================================================
+
+std::optional<RoceFrameInfo> parse_roce_frame(std::span<const std::byte> frame) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (frame.size() < kEthHeaderSize + kIpv4HeaderSize + kUdpHeaderSize) {
+    return std::nullopt;
+  }
+
+  RoceFrameInfo info;
+  bit_fields::NetworkBitReader eth_reader(frame.subspan(0, kEthHeaderSize));
+  auto eth = eth_reader.deserialize(bit_fields::formats::kEthernetHeader);
+  info.dest_mac = u64_to_mac(eth.get("dest_mac"));
+  info.src_mac = u64_to_mac(eth.get("src_mac"));
+  auto ethertype = static_cast<std::uint16_t>(eth.get("ethertype"));
+
+  std::size_t offset = kEthHeaderSize;
+  if (ethertype == kEtherTypeVlan) {
+    if (frame.size() < offset + kVlanTagSize + kIpv4HeaderSize + kUdpHeaderSize) {
+      return std::nullopt;
+    }
+    bit_fields::NetworkBitReader vlan_reader(frame.subspan(offset, kVlanTagSize));
+    auto vlan = vlan_reader.deserialize(bit_fields::formats::kVlanTag);
+    info.vlan_id = static_cast<std::uint16_t>(vlan.get("vid"));
+    ethertype = load_be16(frame, offset + 2);
+    offset += kVlanTagSize;
+  }
+  if (ethertype != kEtherTypeIpv4) {
+    return std::nullopt;
+  }
+
+  // IPv4: version 4, valid header checksum, UDP, not a fragment
+  std::size_t ihl_bytes = (std::to_integer<std::size_t>(frame[offset]) & 0x0F) * 4;
+  if (((std::to_integer<std::uint8_t>(frame[offset]) >> 4) != 4) || (ihl_bytes < kIpv4HeaderSize)
+      || (offset + ihl_bytes + kUdpHeaderSize > frame.size())
+      || (compute_checksum(frame.subspan(offset, ihl_bytes)) != 0)) {
+    return std::nullopt;
+  }
+  bit_fields::NetworkBitReader ip_reader(frame.subspan(offset, kIpv4HeaderSize));
+  auto ipv4 = ip_reader.deserialize(bit_fields::formats::kIpv4Header);
+  auto total_length = static_cast<std::size_t>(ipv4.get("total_length"));
+  bool fragmented = (load_be16(frame, offset + 6) & 0x3FFF) != 0;  // MF flag or offset
+  if ((ipv4.get("protocol") != kIpProtocolUdp) || fragmented
+      || (total_length < ihl_bytes + kUdpHeaderSize) || (offset + total_length > frame.size())) {
+    return std::nullopt;
+  }
+  info.ecn = static_cast<EcnCodepoint>(std::to_integer<std::uint8_t>(frame[offset + 1]) & 0x03);
+  info.src_ip = u32_to_ip(static_cast<std::uint32_t>(ipv4.get("src_ip")));
+  info.dest_ip = u32_to_ip(static_cast<std::uint32_t>(ipv4.get("dst_ip")));
+  offset += ihl_bytes;
+
+  // UDP: RoCEv2 port, length within the IP datagram (Ethernet padding is ignored)
+  bit_fields::NetworkBitReader udp_reader(frame.subspan(offset, kUdpHeaderSize));
+  auto udp = udp_reader.deserialize(bit_fields::formats::kUdpHeader);
+  auto udp_length = static_cast<std::size_t>(udp.get("length"));
+  if ((udp.get("dst_port") != kRoceUdpPort) || (udp_length < kUdpHeaderSize)
+      || (udp_length > total_length - ihl_bytes)) {
+    return std::nullopt;
+  }
+  info.src_port = static_cast<std::uint16_t>(udp.get("src_port"));
+  info.udp_payload = frame.subspan(offset + kUdpHeaderSize, udp_length - kUdpHeaderSize);
+  return info;
+}
+
+bool is_roce_frame(std::span<const std::byte> frame) noexcept {
+  std::size_t offset = kEthHeaderSize;
+  if (frame.size() < offset + kIpv4HeaderSize + kUdpHeaderSize) {
+    return false;
+  }
+  std::uint16_t ethertype = load_be16(frame, 12);
+  if (ethertype == kEtherTypeVlan) {
+    if (frame.size() < offset + kVlanTagSize + kIpv4HeaderSize + kUdpHeaderSize) {
+      return false;
+    }
+    ethertype = load_be16(frame, offset + 2);
+    offset += kVlanTagSize;
+  }
+  if ((ethertype != kEtherTypeIpv4)
+      || (std::to_integer<std::uint8_t>(frame[offset + 9]) != kIpProtocolUdp)) {
+    return false;
+  }
+  std::size_t ihl_bytes = (std::to_integer<std::size_t>(frame[offset]) & 0x0F) * 4;
+  if (offset + ihl_bytes + kUdpHeaderSize > frame.size()) {
+    return false;
+  }
+  return load_be16(frame, offset + ihl_bytes + 2) == kRoceUdpPort;
+}
+
+}  // namespace nic::rocev2
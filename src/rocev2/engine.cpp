@@ -1,18 +1,32 @@
 #include "nic/rocev2/engine.h"
 
 #include <algorithm>
+#include <bit>
+#include <iterator>
 
 #include "nic/log.h"
 
 namespace nic::rocev2 {
 
+namespace {
+
+/// Check whether a cumulative ACK of ack_psn covers psn.
+bool psn_acked(std::uint32_t ack_psn, std::uint32_t psn) noexcept {
+  return ((ack_psn - psn) & kMaxPsn) < 0x800000;  // Within half the PSN space
+}
+
+}  // namespace
+
 RdmaEngine::RdmaEngine(RdmaEngineConfig config, DMAEngine& dma_engine, HostMemory& host_memory)
   : config_(config),
     dma_engine_(dma_engine),
     host_memory_(host_memory),
-    mr_table_(),
+    mr_table_(MrTableConfig{.max_mrs = config.max_mrs, .odp_page_size = config.odp_page_size}),
+    next_cq_number_(config.first_object_number),
+    next_srq_number_(config.first_object_number),
+    next_qp_number_(config.first_object_number),
     send_recv_processor_(host_memory, mr_table_),
-    write_processor_(host_memory, mr_table_),
+    write_processor_(host_memory, mr_table_, config.write_reorder_window),
     read_processor_(host_memory, mr_table_),
     congestion_manager_(config.dcqcn_config),
     reliability_manager_(config.reliability_config) {
@@ -34,7 +48,7 @@ std::optional<std::uint32_t> RdmaEngine::create_pd() {
   auto pd_handle = pd_table_.allocate();
   if (pd_handle.has_value()) {
     ++stats_.pds_created;
-    NIC_LOGF_INFO("PD created: handle={}", *pd_handle);
+    NIC_LOGF_DEBUG("PD created: handle={}", *pd_handle);
   }
   return pd_handle;
 }
@@ -49,6 +63,24 @@ bool RdmaEngine::destroy_pd(std::uint32_t pd_handle) {
   return pd_table_.deallocate(pd_handle);
 }
 
+void RdmaEngine::retain_pd(std::uint32_t pd_handle) {
+  NIC_TRACE_SCOPED(__func__);
+
+  ProtectionDomain* pd = pd_table_.get(pd_handle);
+  if (pd != nullptr) {
+    pd->acquire();
+  }
+}
+
+void RdmaEngine::release_pd(std::uint32_t pd_handle) {
+  NIC_TRACE_SCOPED(__func__);
+
+  ProtectionDomain* pd = pd_table_.get(pd_handle);
+  if (pd != nullptr) {
+    pd->release();
+  }
+}
+
 // ============================================
 // Memory Region Management
 // ============================================
@@ -72,15 +104,48 @@ std::optional<std::uint32_t> RdmaEngine::register_mr(std::uint32_t pd_handle,
   auto lkey = mr_table_.register_mr(pd_handle, virtual_address, length, access);
   if (lkey.has_value()) {
     ++stats_.mrs_registered;
-    NIC_LOGF_INFO("MR registered: pd={} addr={:#x} len={} lkey={}",
-                  pd_handle,
-                  virtual_address,
-                  length,
-                  *lkey);
+    retain_pd(pd_handle);
+    NIC_LOGF_DEBUG("MR registered: pd={} addr={:#x} len={} lkey={}",
+                   pd_handle,
+                   virtual_address,
+                   length,
+                   *lkey);
   }
   return lkey;
 }
 
+std::vector<std::uint32_t> RdmaEngine::register_mrs(std::uint32_t pd_handle,
+                                                     std::span<const RdmaMrRegion> regions) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::vector<std::uint32_t> lkeys;
+  if (!config_.enabled) {
+    return lkeys;
+  }
+
+  ProtectionDomain* pd = pd_table_.get(pd_handle);
+  if (pd == nullptr) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("MR registration failed: invalid PD {}", pd_handle);
+    return lkeys;
+  }
+
+  lkeys.reserve(regions.size());
+  for (const RdmaMrRegion& region : regions) {
+    auto lkey =
+        mr_table_.register_mr(pd_handle, region.virtual_address, region.length, region.access);
+    if (!lkey.has_value()) {
+      ++stats_.errors;
+      NIC_LOGF_WARNING("MR batch registration stopped at {} of {}", lkeys.size(), regions.size());
+      break;
+    }
+    ++stats_.mrs_registered;
+    pd->acquire();
+    lkeys.push_back(*lkey);
+  }
+  return lkeys;
+}
+
 bool RdmaEngine::deregister_mr(std::uint32_t lkey) {
   NIC_TRACE_SCOPED(__func__);
 
@@ -88,14 +153,226 @@ bool RdmaEngine::deregister_mr(std::uint32_t lkey) {
     return false;
   }
 
-  return mr_table_.deregister_mr(lkey);
+  const MemoryRegion* mr = mr_table_.get_by_lkey(lkey);
+  if (mr == nullptr) {
+    return false;
+  }
+  std::uint32_t pd_handle = mr->pd_handle;
+  if (!mr_table_.deregister_mr(lkey)) {
+    return false;
+  }
+  release_pd(pd_handle);
+  return true;
+}
+
+std::optional<std::uint32_t> RdmaEngine::alloc_fast_reg_mr(std::uint32_t pd_handle,
+                                                           std::size_t max_length) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return std::nullopt;
+  }
+
+  if (!pd_table_.is_valid(pd_handle)) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("fast-reg MR allocation failed: invalid PD {}", pd_handle);
+    return std::nullopt;
+  }
+
+  auto lkey = mr_table_.allocate_fast_reg_mr(pd_handle, max_length);
+  if (lkey.has_value()) {
+    ++stats_.mrs_registered;
+    retain_pd(pd_handle);
+  }
+  return lkey;
+}
+
+std::optional<std::uint32_t> RdmaEngine::alloc_mw(std::uint32_t pd_handle) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return std::nullopt;
+  }
+
+  if (!pd_table_.is_valid(pd_handle)) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("MW allocation failed: invalid PD {}", pd_handle);
+    return std::nullopt;
+  }
+
+  auto rkey = mr_table_.allocate_mw(pd_handle);
+  if (rkey.has_value()) {
+    retain_pd(pd_handle);
+  }
+  return rkey;
+}
+
+bool RdmaEngine::dealloc_mw(std::uint32_t rkey) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return false;
+  }
+
+  const MemoryRegion* mw = mr_table_.get_by_rkey(rkey);
+  if (mw == nullptr) {
+    return false;
+  }
+  std::uint32_t pd_handle = mw->pd_handle;
+  if (!mr_table_.deallocate_mw(rkey)) {
+    return false;
+  }
+  release_pd(pd_handle);
+  return true;
+}
+
+// ============================================
+// On-Demand Paging
+// ============================================
+
+void RdmaEngine::set_page_fault_handler(MemoryRegionTable::PageFaultHandler handler) {
+  NIC_TRACE_SCOPED(__func__);
+
+  mr_table_.set_page_fault_handler(std::move(handler));
+}
+
+std::size_t RdmaEngine::populate_odp_pages(HostAddress address, std::size_t length) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return 0;
+  }
+
+  std::size_t added = mr_table_.populate(address, length);
+  resume_odp_wqes();
+  return added;
+}
+
+std::optional<std::size_t> RdmaEngine::advise_mr(std::uint32_t lkey,
+                                                 HostAddress address,
+                                                 std::size_t length) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return std::nullopt;
+  }
+
+  auto added = mr_table_.prefetch(lkey, address, length);
+  if (!added.has_value()) {
+    ++stats_.errors;
+    return std::nullopt;
+  }
+  resume_odp_wqes();
+  return added;
+}
+
+std::size_t RdmaEngine::invalidate_odp_range(HostAddress address, std::size_t length) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return 0;
+  }
+
+  return mr_table_.invalidate_range(address, length);
+}
+
+std::size_t RdmaEngine::odp_parked_count(std::uint32_t qp_number) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = odp_parked_.find(qp_number);
+  return (iter == odp_parked_.end()) ? 0 : iter->second.wqes.size();
+}
+
+std::size_t RdmaEngine::rnr_held_count(std::uint32_t qp_number) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = rnr_states_.find(qp_number);
+  return (iter == rnr_states_.end()) ? 0 : iter->second.held.size();
+}
+
+// ============================================
+// Address Handle Management
+// ============================================
+
+std::optional<std::uint32_t> RdmaEngine::create_ah(std::uint32_t pd_handle,
+                                                   const RdmaAhAttr& attr) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return std::nullopt;
+  }
+
+  if (!pd_table_.is_valid(pd_handle)) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("AH creation failed: invalid PD {}", pd_handle);
+    return std::nullopt;
+  }
+
+  if (ahs_.size() >= config_.max_ahs) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("AH creation failed: limit reached ({}/{})", ahs_.size(), config_.max_ahs);
+    return std::nullopt;
+  }
+
+  std::uint32_t ah_handle = next_ah_handle_++;
+  ahs_[ah_handle] = AddressHandle{.ah_handle = ah_handle, .pd_handle = pd_handle, .attr = attr};
+  if (config_.encap.enabled) {
+    RoceFlowAttr flow = default_flow_attr();
+    flow.dest_mac = attr.dest_mac;
+    flow.dest_ip = attr.dest_ip;
+    flow.dest_port = attr.dest_port;
+    flow.traffic_class = attr.traffic_class.value_or(flow.traffic_class);
+    flow.src_port = roce_flow_src_port(ah_handle, 0);
+    ah_header_templates_.insert_or_assign(ah_handle, RoceHeaderTemplate(flow));
+  }
+  ++stats_.ahs_created;
+  retain_pd(pd_handle);
+  NIC_LOGF_DEBUG("AH created: ah={} pd={} dest={}.{}.{}.{}",
+                 ah_handle,
+                 pd_handle,
+                 attr.dest_ip[0],
+                 attr.dest_ip[1],
+                 attr.dest_ip[2],
+                 attr.dest_ip[3]);
+
+  return ah_handle;
+}
+
+bool RdmaEngine::destroy_ah(std::uint32_t ah_handle) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return false;
+  }
+
+  auto iter = ahs_.find(ah_handle);
+  if (iter == ahs_.end()) {
+    return false;
+  }
+
+  release_pd(iter->second.pd_handle);
+  ah_header_templates_.erase(ah_handle);
+  ahs_.erase(iter);
+  return true;
 }
 
 // ============================================
 // Completion Queue Management
 // ============================================
 
-std::optional<std::uint32_t> RdmaEngine::create_cq(std::size_t depth) {
+std::optional<std::uint32_t> RdmaEngine::create_cq(std::size_t depth,
+                                                   std::optional<HostAddress> host_ring_address,
+                                                   std::uint16_t comp_vector) {
+  NIC_TRACE_SCOPED(__func__);
+
+  RdmaCqConfig cq_config;
+  cq_config.depth = depth;
+  cq_config.host_ring_address = host_ring_address;
+  cq_config.comp_vector = comp_vector;
+  return create_cq(cq_config);
+}
+
+std::optional<std::uint32_t> RdmaEngine::create_cq(const RdmaCqConfig& config) {
   NIC_TRACE_SCOPED(__func__);
 
   if (!config_.enabled) {
@@ -108,13 +385,28 @@ std::optional<std::uint32_t> RdmaEngine::create_cq(std::size_t depth) {
     return std::nullopt;
   }
 
-  std::uint32_t cq_number = next_cq_number_++;
-  RdmaCqConfig cq_config;
-  cq_config.depth = depth;
+  if (config.host_ring_address.has_value()) {
+    std::size_t ring_bytes = std::bit_ceil(std::max<std::size_t>(config.depth, 1)) * kCqeSlotSize;
+    ConstHostMemoryView view;
+    if (!host_memory_.translate_const(*config.host_ring_address, ring_bytes, view).ok()) {
+      ++stats_.errors;
+      NIC_LOGF_WARNING("CQ creation failed: host ring {:#x}+{} not accessible",
+                       *config.host_ring_address,
+                       ring_bytes);
+      return std::nullopt;
+    }
+  }
+
+  std::uint32_t cq_number = next_cq_number_;
+  next_cq_number_ += config_.object_number_stride;
 
-  cqs_[cq_number] = std::make_unique<RdmaCompletionQueue>(cq_number, cq_config);
+  cqs_[cq_number] = std::make_unique<RdmaCompletionQueue>(cq_number, config, &host_memory_);
   ++stats_.cqs_created;
-  NIC_LOGF_INFO("CQ created: cq={} depth={}", cq_number, depth);
+  NIC_LOGF_DEBUG("CQ created: cq={} depth={} host_resident={} compressed={}",
+                 cq_number,
+                 cqs_[cq_number]->depth(),
+                 config.host_ring_address.has_value(),
+                 config.compression);
 
   return cq_number;
 }
@@ -126,14 +418,14 @@ bool RdmaEngine::destroy_cq(std::uint32_t cq_number) {
     return false;
   }
 
-  // Check if any QP is using this CQ
-  for (const auto& [qp_number, qp] : qps_) {
-    if ((qp->send_cq_number() == cq_number) || (qp->recv_cq_number() == cq_number)) {
-      return false;  // CQ in use
-    }
+  auto iter = cqs_.find(cq_number);
+  if ((iter == cqs_.end()) || (iter->second->qp_refs() != 0)) {
+    return false;  // Not found, or CQ in use
   }
 
-  return cqs_.erase(cq_number) > 0;
+  cq_event_deadlines_.erase(cq_number);
+  cqs_.erase(iter);
+  return true;
 }
 
 std::vector<RdmaCqe> RdmaEngine::poll_cq(std::uint32_t cq_number, std::size_t max_cqes) {
@@ -151,283 +443,1560 @@ std::vector<RdmaCqe> RdmaEngine::poll_cq(std::uint32_t cq_number, std::size_t ma
   return iter->second->poll(max_cqes);
 }
 
+std::size_t RdmaEngine::poll_cq(std::uint32_t cq_number, std::span<RdmaCqe> out) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return 0;
+  }
+
+  auto iter = cqs_.find(cq_number);
+  if (iter == cqs_.end()) {
+    return 0;
+  }
+
+  return iter->second->poll(out);
+}
+
 // ============================================
-// Queue Pair Management
+// Shared Receive Queue Management
 // ============================================
 
-std::optional<std::uint32_t> RdmaEngine::create_qp(const RdmaQpConfig& config) {
+std::optional<std::uint32_t> RdmaEngine::create_srq(std::size_t depth, std::size_t limit) {
   NIC_TRACE_SCOPED(__func__);
 
   if (!config_.enabled) {
     return std::nullopt;
   }
 
-  if (qps_.size() >= config_.max_qps) {
+  if (srqs_.size() >= config_.max_srqs) {
     ++stats_.errors;
-    NIC_LOGF_WARNING("QP creation failed: limit reached ({}/{})", qps_.size(), config_.max_qps);
+    NIC_LOGF_WARNING("SRQ creation failed: limit reached ({}/{})", srqs_.size(), config_.max_srqs);
     return std::nullopt;
   }
 
-  // Validate PD
-  if (!pd_table_.is_valid(config.pd_handle)) {
+  if ((depth == 0) || (limit > depth)) {
     ++stats_.errors;
-    NIC_LOGF_WARNING("QP creation failed: invalid PD {}", config.pd_handle);
+    NIC_LOGF_WARNING("SRQ creation failed: invalid depth={} limit={}", depth, limit);
     return std::nullopt;
   }
 
-  // Validate CQs
-  if ((cqs_.find(config.send_cq_number) == cqs_.end())
-      || (cqs_.find(config.recv_cq_number) == cqs_.end())) {
-    ++stats_.errors;
-    NIC_LOGF_WARNING("QP creation failed: invalid CQ (send={} recv={})",
-                     config.send_cq_number,
-                     config.recv_cq_number);
-    return std::nullopt;
-  }
+  std::uint32_t srq_number = next_srq_number_;
+  next_srq_number_ += config_.object_number_stride;
+  RdmaSrqConfig srq_config;
+  srq_config.depth = depth;
+  srq_config.limit = limit;
 
-  std::uint32_t qp_number = next_qp_number_++;
-  qps_[qp_number] = std::make_unique<RdmaQueuePair>(qp_number, config);
-  ++stats_.qps_created;
-  NIC_LOGF_INFO("QP created: qp={} pd={} send_cq={} recv_cq={}",
-                qp_number,
-                config.pd_handle,
-                config.send_cq_number,
-                config.recv_cq_number);
+  srqs_[srq_number] = std::make_unique<RdmaSharedReceiveQueue>(srq_number, srq_config);
+  ++stats_.srqs_created;
+  NIC_LOGF_DEBUG("SRQ created: srq={} depth={} limit={}", srq_number, depth, limit);
 
-  return qp_number;
+  return srq_number;
 }
 
-bool RdmaEngine::destroy_qp(std::uint32_t qp_number) {
+bool RdmaEngine::destroy_srq(std::uint32_t srq_number) {
   NIC_TRACE_SCOPED(__func__);
 
   if (!config_.enabled) {
     return false;
   }
 
-  auto iter = qps_.find(qp_number);
-  if (iter == qps_.end()) {
+  auto iter = srqs_.find(srq_number);
+  if ((iter == srqs_.end()) || (iter->second->qp_refs() != 0)) {
+    return false;  // Not found, or SRQ in use
+  }
+
+  srqs_.erase(iter);
+  return true;
+}
+
+bool RdmaEngine::arm_srq(std::uint32_t srq_number, std::size_t limit) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
     return false;
   }
 
-  // Clear any pending state for this QP
-  read_processor_.clear_read_state(qp_number);
-  congestion_manager_.clear_flow_state(qp_number);
-  reliability_manager_.clear_pending(qp_number);
+  auto iter = srqs_.find(srq_number);
+  if ((iter == srqs_.end()) || (limit > iter->second->depth())) {
+    return false;
+  }
 
-  qps_.erase(iter);
+  iter->second->arm(limit);
   return true;
 }
 
-bool RdmaEngine::modify_qp(std::uint32_t qp_number, const RdmaQpModifyParams& params) {
+bool RdmaEngine::post_srq_recv(std::uint32_t srq_number, const RecvWqe& wqe) {
   NIC_TRACE_SCOPED(__func__);
 
   if (!config_.enabled) {
     return false;
   }
 
-  auto iter = qps_.find(qp_number);
-  if (iter == qps_.end()) {
+  auto iter = srqs_.find(srq_number);
+  if (iter == srqs_.end()) {
+    return false;
+  }
+
+  if (!iter->second->post_recv(wqe)) {
+    ++stats_.errors;
     return false;
   }
 
-  return iter->second->modify(params);
+  ++stats_.recv_wqes_posted;
+  return true;
 }
 
-RdmaQueuePair* RdmaEngine::query_qp(std::uint32_t qp_number) {
+const RdmaSharedReceiveQueue* RdmaEngine::query_srq(std::uint32_t srq_number) const {
   NIC_TRACE_SCOPED(__func__);
 
-  auto iter = qps_.find(qp_number);
-  if (iter == qps_.end()) {
+  auto iter = srqs_.find(srq_number);
+  if (iter == srqs_.end()) {
     return nullptr;
   }
   return iter->second.get();
 }
 
-// ============================================
-// Work Request Posting
-// ============================================
-
-bool RdmaEngine::post_send(std::uint32_t qp_number, const SendWqe& wqe) {
+std::vector<RdmaAsyncEvent> RdmaEngine::poll_async_events(std::size_t max_events) {
   NIC_TRACE_SCOPED(__func__);
 
-  if (!config_.enabled) {
-    return false;
+  std::vector<RdmaAsyncEvent> result;
+  std::size_t to_poll = std::min(max_events, async_events_.size());
+  result.reserve(to_poll);
+
+  for (std::size_t event_idx = 0; event_idx < to_poll; ++event_idx) {
+    result.push_back(async_events_.front());
+    async_events_.pop_front();
   }
 
-  auto iter = qps_.find(qp_number);
-  if (iter == qps_.end()) {
-    return false;
+  return result;
+}
+
+const RdmaCompletionQueue* RdmaEngine::query_cq(std::uint32_t cq_number) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = cqs_.find(cq_number);
+  if (iter == cqs_.end()) {
+    return nullptr;
   }
+  return iter->second.get();
+}
 
-  RdmaQueuePair& qp = *iter->second;
+bool RdmaEngine::arm_cq(std::uint32_t cq_number, bool solicited_only) {
+  NIC_TRACE_SCOPED(__func__);
 
-  if (!qp.can_send()) {
-    ++stats_.errors;
-    NIC_LOGF_WARNING("post_send failed: qp={} not in sendable state", qp_number);
+  auto iter = cqs_.find(cq_number);
+  if (!config_.enabled || (iter == cqs_.end())) {
     return false;
   }
 
-  // Capture starting PSN before generating packets (which advances PSN)
-  std::uint32_t start_psn = qp.sq_psn();
+  iter->second->arm(solicited_only);
+  cq_event_deadlines_.erase(cq_number);
+  return true;
+}
 
-  // Generate packets based on opcode
-  std::vector<std::vector<std::byte>> packets;
+bool RdmaEngine::modify_cq(std::uint32_t cq_number, const RdmaCqModeration& moderation) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = cqs_.find(cq_number);
+  if (!config_.enabled || (iter == cqs_.end())) {
+    return false;
+  }
+
+  iter->second->set_moderation(moderation);
+  NIC_LOGF_DEBUG("CQ moderation: cq={} count={} period={}us",
+                 cq_number,
+                 moderation.cq_count,
+                 moderation.cq_period_us);
+  return true;
+}
+
+std::vector<RdmaCqEvent> RdmaEngine::poll_cq_events(std::size_t max_events) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::vector<RdmaCqEvent> result;
+  std::size_t to_poll = std::min(max_events, cq_events_.size());
+  result.reserve(to_poll);
+
+  for (std::size_t event_idx = 0; event_idx < to_poll; ++event_idx) {
+    result.push_back(cq_events_.front());
+    cq_events_.pop_front();
+  }
+
+  return result;
+}
+
+// ============================================
+// Queue Pair Management
+// ============================================
+
+std::optional<std::uint32_t> RdmaEngine::create_qp(const RdmaQpConfig& config) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return std::nullopt;
+  }
+
+  if (qps_.size() >= config_.max_qps) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("QP creation failed: limit reached ({}/{})", qps_.size(), config_.max_qps);
+    return std::nullopt;
+  }
+
+  // Validate PD
+  ProtectionDomain* pd = pd_table_.get(config.pd_handle);
+  if (pd == nullptr) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("QP creation failed: invalid PD {}", config.pd_handle);
+    return std::nullopt;
+  }
+
+  // Validate CQs
+  auto send_cq_iter = cqs_.find(config.send_cq_number);
+  auto recv_cq_iter = cqs_.find(config.recv_cq_number);
+  if ((send_cq_iter == cqs_.end()) || (recv_cq_iter == cqs_.end())) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("QP creation failed: invalid CQ (send={} recv={})",
+                     config.send_cq_number,
+                     config.recv_cq_number);
+    return std::nullopt;
+  }
+
+  if (config.max_inline_data > kMaxInlineData) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("QP creation failed: max_inline_data {} exceeds {}",
+                     config.max_inline_data,
+                     kMaxInlineData);
+    return std::nullopt;
+  }
+
+  // Validate SRQ (0 = private receive queue)
+  RdmaSharedReceiveQueue* srq = nullptr;
+  if (config.srq_number != 0) {
+    auto srq_iter = srqs_.find(config.srq_number);
+    if (srq_iter == srqs_.end()) {
+      ++stats_.errors;
+      NIC_LOGF_WARNING("QP creation failed: invalid SRQ {}", config.srq_number);
+      return std::nullopt;
+    }
+    srq = srq_iter->second.get();
+  }
+
+  if (config.sq_ring_address.has_value()) {
+    std::size_t ring_bytes = config.send_queue_depth * kSqWqeSize;
+    ConstHostMemoryView view;
+    if (!std::has_single_bit(config.send_queue_depth)
+        || !host_memory_.translate_const(*config.sq_ring_address, ring_bytes, view).ok()) {
+      ++stats_.errors;
+      NIC_LOGF_WARNING("QP creation failed: send ring {:#x} depth={} not usable",
+                       *config.sq_ring_address,
+                       config.send_queue_depth);
+      return std::nullopt;
+    }
+  }
+
+  std::uint32_t qp_number = allocate_qp_number();
+  auto qp = std::make_unique<RdmaQueuePair>(qp_number, config);
+  qp->attach_srq(srq);
+  qps_[qp_number] = std::move(qp);
+  pd->acquire();
+  send_cq_iter->second->attach_qp();
+  recv_cq_iter->second->attach_qp();
+  if (srq != nullptr) {
+    srq->attach_qp();
+  }
+  if (config.sq_ring_address.has_value()) {
+    RdmaSqRingConfig ring_config{.base_address = *config.sq_ring_address,
+                                 .depth = config.send_queue_depth};
+    sq_rings_[qp_number] = std::make_unique<RdmaSendQueueRing>(ring_config, dma_engine_);
+  }
+  ++stats_.qps_created;
+  NIC_LOGF_DEBUG("QP created: qp={} pd={} send_cq={} recv_cq={} srq={}",
+                 qp_number,
+                 config.pd_handle,
+                 config.send_cq_number,
+                 config.recv_cq_number,
+                 config.srq_number);
+
+  return qp_number;
+}
+
+std::vector<std::uint32_t> RdmaEngine::create_qps(std::span<const RdmaQpConfig> configs) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::vector<std::uint32_t> qp_numbers;
+  if (!config_.enabled) {
+    return qp_numbers;
+  }
+
+  // Size the tables once instead of rehashing as the batch grows
+  qps_.reserve(qps_.size() + configs.size());
+  qp_numbers.reserve(configs.size());
+  for (const RdmaQpConfig& config : configs) {
+    auto qp_number = create_qp(config);
+    if (!qp_number.has_value()) {
+      break;
+    }
+    qp_numbers.push_back(*qp_number);
+  }
+  return qp_numbers;
+}
+
+std::uint32_t RdmaEngine::allocate_qp_number() {
+  NIC_TRACE_SCOPED(__func__);
+
+  // A freed number is reused only after its quarantine, so a stray packet or completion
+  // for the destroyed QP cannot be taken for the new one
+  if (!free_qp_numbers_.empty()
+      && (now_us_ - free_qp_numbers_.front().freed_us >= config_.qp_number_quarantine_us)) {
+    std::uint32_t qp_number = free_qp_numbers_.front().qp_number;
+    free_qp_numbers_.pop_front();
+    ++stats_.qp_numbers_reused;
+    return qp_number;
+  }
+  std::uint32_t qp_number = next_qp_number_;
+  next_qp_number_ += config_.object_number_stride;
+  return qp_number;
+}
+
+bool RdmaEngine::destroy_qp(std::uint32_t qp_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return false;
+  }
+
+  auto iter = qps_.find(qp_number);
+  if (iter == qps_.end()) {
+    return false;
+  }
+
+  // Drop the QP's references so its PD, CQs and SRQ can be destroyed
+  const RdmaQueuePair& qp = *iter->second;
+  release_pd(qp.pd_handle());
+  for (std::uint32_t cq_number : {qp.send_cq_number(), qp.recv_cq_number()}) {
+    auto cq_iter = cqs_.find(cq_number);
+    if (cq_iter != cqs_.end()) {
+      cq_iter->second->detach_qp();
+    }
+  }
+  if (qp.srq() != nullptr) {
+    qp.srq()->detach_qp();
+  }
+
+  // Clear any pending state for this QP
+  send_recv_processor_.clear_recv_state(qp_number);
+  write_processor_.clear_write_state(qp_number);
+  read_processor_.clear_read_state(qp_number);
+  congestion_manager_.clear_flow_state(qp_number);
+  reliability_manager_.clear_pending(qp_number);
+  sq_rings_.erase(qp_number);
+  odp_parked_.erase(qp_number);
+  qp_header_templates_.erase(qp_number);
+  src_port_states_.erase(qp_number);
+  rnr_states_.erase(qp_number);
+  wqe_timestamps_.erase(qp_number);
+  idle_candidates_.erase(qp_number);
+  latency_stats_.by_qp.erase(qp_number);
+
+  qps_.erase(iter);
+  free_qp_numbers_.push_back(FreeQpNumber{.qp_number = qp_number, .freed_us = now_us_});
+  return true;
+}
+
+bool RdmaEngine::modify_qp(std::uint32_t qp_number, const RdmaQpModifyParams& params) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return false;
+  }
+
+  auto iter = qps_.find(qp_number);
+  if (iter == qps_.end()) {
+    return false;
+  }
+
+  if (params.src_port && (params.src_port->mode == SrcPortMode::Multipath)
+      && (params.src_port->path_count == 0)) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("modify QP {} failed: multipath source port needs at least one path",
+                     qp_number);
+    return false;
+  }
+
+  if (!iter->second->modify(params)) {
+    return false;
+  }
+  if (config_.encap.enabled && (iter->second->type() == QpType::Rc)) {
+    update_qp_header_template(*iter->second, params);
+  }
+  if (params.src_port) {
+    set_src_port_config(qp_number, *params.src_port);
+  }
+  return true;
+}
+
+std::size_t RdmaEngine::modify_qps(std::span<const std::uint32_t> qp_numbers,
+                                   std::span<const RdmaQpModifyParams> params) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if ((params.size() != 1) && (params.size() != qp_numbers.size())) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("modify QPs failed: {} parameter sets for {} QPs",
+                     params.size(),
+                     qp_numbers.size());
+    return 0;
+  }
+
+  std::size_t modified = 0;
+  for (; modified < qp_numbers.size(); ++modified) {
+    const RdmaQpModifyParams& qp_params = params[(params.size() == 1) ? 0 : modified];
+    if (!modify_qp(qp_numbers[modified], qp_params)) {
+      break;
+    }
+  }
+  return modified;
+}
+
+void RdmaEngine::update_qp_header_template(RdmaQueuePair& qp, const RdmaQpModifyParams& params) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!params.dest_qp_number && !params.dest_ip && !params.dest_mac && !params.traffic_class) {
+    return;
+  }
+
+  // Rebuild from the current flow so attributes set by earlier modify calls persist
+  auto iter = qp_header_templates_.find(qp.qp_number());
+  RoceFlowAttr flow =
+      (iter != qp_header_templates_.end()) ? iter->second.attr() : default_flow_attr();
+  flow.dest_ip = qp.dest_ip();
+  flow.dest_mac = params.dest_mac.value_or(flow.dest_mac);
+  flow.traffic_class = params.traffic_class.value_or(flow.traffic_class);
+  flow.src_port = roce_flow_src_port(qp.qp_number(), qp.dest_qp_number());
+  qp_header_templates_.insert_or_assign(qp.qp_number(), RoceHeaderTemplate(flow));
+}
+
+void RdmaEngine::set_src_port_config(std::uint32_t qp_number, const SrcPortConfig& config) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (config.mode == SrcPortMode::FlowHash) {
+    src_port_states_.erase(qp_number);
+    return;
+  }
+  src_port_states_.insert_or_assign(qp_number, SrcPortState{.config = config});
+}
+
+std::uint16_t RdmaEngine::select_src_port(const RdmaQueuePair& qp) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = src_port_states_.find(qp.qp_number());
+  if (iter == src_port_states_.end()) {
+    return roce_flow_src_port(qp.qp_number(), qp.dest_qp_number());
+  }
+  SrcPortState& state = iter->second;
+  if (state.config.mode == SrcPortMode::Fixed) {
+    return state.config.fixed_port;
+  }
+
+  // Multipath: move to the next port once the QP has been idle for the flowlet gap.
+  // Packets closer together than the gap stay on one path and arrive in order.
+  if (state.sent && (now_us_ - state.last_tx_us >= state.config.flowlet_gap_us)) {
+    state.path = (state.path + 1) % state.config.path_count;
+    ++stats_.src_port_switches;
+  }
+  state.sent = true;
+  state.last_tx_us = now_us_;
+  return roce_path_src_port(qp.qp_number(), qp.dest_qp_number(), state.path);
+}
+
+RoceFlowAttr RdmaEngine::default_flow_attr() const {
+  NIC_TRACE_SCOPED(__func__);
+
+  RoceFlowAttr flow;
+  flow.src_mac = config_.encap.src_mac;
+  flow.src_ip = config_.encap.src_ip;
+  flow.vlan_id = config_.encap.vlan_id;
+  flow.vlan_pcp = config_.encap.vlan_pcp;
+  flow.traffic_class = config_.encap.traffic_class;
+  flow.ttl = config_.encap.ttl;
+  return flow;
+}
+
+RdmaQueuePair* RdmaEngine::query_qp(std::uint32_t qp_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = qps_.find(qp_number);
+  if (iter == qps_.end()) {
+    return nullptr;
+  }
+  return iter->second.get();
+}
+
+// ============================================
+// Work Request Posting
+// ============================================
+
+bool RdmaEngine::post_send(std::uint32_t qp_number, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  return post_send_list(qp_number, std::span<const SendWqe>(&wqe, 1)) == 1;
+}
+
+std::size_t RdmaEngine::post_send_list(std::uint32_t qp_number, std::span<const SendWqe> wqes) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return 0;
+  }
+
+  auto iter = qps_.find(qp_number);
+  if (iter == qps_.end()) {
+    return 0;
+  }
+
+  RdmaQueuePair& qp = *iter->second;
+  idle_candidates_.insert(qp_number);
+
+  if (!qp.can_send()) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("post_send failed: qp={} not in sendable state", qp_number);
+    return 0;
+  }
+
+  for (std::size_t wqe_idx = 0; wqe_idx < wqes.size(); ++wqe_idx) {
+    if (!post_send_wqe(qp, wqes[wqe_idx])) {
+      return wqe_idx;
+    }
+  }
+
+  return wqes.size();
+}
+
+bool RdmaEngine::post_send_wqe(RdmaQueuePair& qp, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // sq_sig_all overrides the per-WR flag; every stage below reads wqe.signaled
+  if (qp.is_send_signaled(wqe) && !wqe.signaled) {
+    SendWqe signaled_wqe = wqe;
+    signaled_wqe.signaled = true;
+    return post_send_wqe(qp, signaled_wqe);
+  }
+
+  if (qp.violates_signal_interval(wqe.signaled)) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("post_send failed: qp={} needs a signaled WQE every {} sends",
+                     qp.qp_number(),
+                     qp.config().sq_signal_interval);
+    return false;
+  }
+
+  if (wqe.inline_data) {
+    if ((wqe.opcode == WqeOpcode::RdmaRead) || (wqe.total_length > qp.config().max_inline_data)) {
+      ++stats_.errors;
+      NIC_LOGF_WARNING("post_send failed: qp={} invalid inline WQE (len={} max={})",
+                       qp.qp_number(),
+                       wqe.total_length,
+                       qp.config().max_inline_data);
+      return false;
+    }
+    ++stats_.inline_sends;
+  }
+
+  // Stamped first: UD, loopback and memory WQEs complete inside start_send_wqe()
+  if (wqe.signaled) {
+    stamp_wqe_post(qp, wqe);
+  }
+
+  // An ODP fault parks the WQE until the host populates its pages
+  if (!park_odp_wqe(qp, wqe) && !start_send_wqe(qp, wqe)) {
+    auto stamps = wqe_timestamps_.find(qp.qp_number());
+    if (wqe.signaled && (stamps != wqe_timestamps_.end()) && !stamps->second.empty()
+        && (stamps->second.back().wr_id == wqe.wr_id)) {
+      stamps->second.pop_back();
+    }
+    return false;
+  }
+
+  qp.record_send_signaling(wqe.signaled);
+  if (!wqe.signaled) {
+    ++stats_.unsignaled_sends;
+  }
+  return true;
+}
+
+bool RdmaEngine::start_send_wqe(RdmaQueuePair& qp, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Key operations run on the adapter in posting order and never reach the wire
+  if (is_memory_wqe(wqe.opcode)) {
+    execute_memory_wqe(qp, wqe);
+    return true;
+  }
+
+  if (qp.type() == QpType::Ud) {
+    return post_ud_send(qp, wqe);
+  }
+
+  // Both ends on this device: copy memory-to-memory instead of packetizing
+  RdmaQueuePair* peer = loopback_peer(qp);
+  if ((peer != nullptr) && post_loopback(qp, *peer, wqe)) {
+    return true;
+  }
+
+  // An RNR back-off or a lack of receive credits holds the send queue in posting order
+  if (hold_send_wqe(qp, wqe)) {
+    return true;
+  }
+  return transmit_send_wqe(qp, wqe);
+}
+
+bool RdmaEngine::transmit_send_wqe(RdmaQueuePair& qp, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::uint32_t qp_number = qp.qp_number();
+
+  // Capture starting PSN before generating packets (which advances PSN)
+  std::uint32_t start_psn = qp.sq_psn();
+
+  std::vector<std::vector<std::byte>> packets = build_send_packets(qp, wqe);
+  if (packets.empty()) {
+    ++stats_.errors;
+    return false;
+  }
+
+  // Track for reliability - end_psn is the last PSN the WQE took, which for a READ
+  // is its last response rather than its single request packet
+  std::uint32_t end_psn = qp.last_sent_psn();
+
+  // Unsignaled WQEs are tracked like the rest (they may need a resend) but retire without a
+  // CQE. A READ's CQE comes from its last response, so its ACK must not report it again.
+  bool ack_reports_cqe = wqe.signaled && (wqe.opcode != WqeOpcode::RdmaRead);
+  reliability_manager_.add_pending(
+      qp_number, start_psn, end_psn, wqe.wr_id, wqe.opcode, now_us_, ack_reports_cqe);
+  if (wqe.signaled) {
+    stamp_wqe_transmit(qp_number, wqe.wr_id);
+  }
+
+  if (config_.end_to_end_credits && consumes_recv_wqe(wqe.opcode)) {
+    RnrState& state = rnr_states_[qp_number];
+    state.consumers.push_back(end_psn);
+    if (state.credits.has_value() && (*state.credits > 0)) {
+      --*state.credits;
+    }
+  }
+
+  // Queue packets for sending
+  for (auto& packet : packets) {
+    stats_.bytes_sent += packet.size();
+    queue_outgoing_packet(std::move(packet), qp);
+  }
+
+  ++stats_.send_wqes_posted;
+  stats_.packets_sent += packets.size();
+  NIC_LOGF_DEBUG("post_send: qp={} opcode={} len={} packets={}",
+                 qp_number,
+                 static_cast<int>(wqe.opcode),
+                 wqe.total_length,
+                 packets.size());
+
+  return true;
+}
+
+std::vector<std::vector<std::byte>> RdmaEngine::build_send_packets(RdmaQueuePair& qp,
+                                                                   const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  switch (wqe.opcode) {
+    case WqeOpcode::Send:
+    case WqeOpcode::SendImm:
+    case WqeOpcode::SendWithInvalidate:
+      return send_recv_processor_.generate_send_packets(qp, wqe);
+    case WqeOpcode::RdmaWrite:
+    case WqeOpcode::RdmaWriteImm:
+      return write_processor_.generate_write_packets(qp, wqe);
+    case WqeOpcode::RdmaRead:
+      return read_processor_.generate_read_request(qp, wqe);
+    default:
+      return {};
+  }
+}
+
+bool RdmaEngine::post_ud_send(RdmaQueuePair& qp, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto ah_iter = ahs_.find(wqe.ah_handle);
+  if ((ah_iter == ahs_.end()) || (ah_iter->second.pd_handle != qp.pd_handle())) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("UD post_send failed: qp={} invalid AH {}", qp.qp_number(), wqe.ah_handle);
+    return false;
+  }
+
+  std::vector<std::byte> packet = send_recv_processor_.generate_ud_send_packet(qp, wqe);
+  if (packet.empty()) {
+    ++stats_.errors;
+    return false;
+  }
+
+  // No ACK/retransmit state: the datagram is complete once it is on the wire
+  const RdmaAhAttr& attr = ah_iter->second.attr;
+  OutgoingPacket out;
+  out.dest_ip = attr.dest_ip;
+  out.dest_port = attr.dest_port;
+  auto template_iter = ah_header_templates_.find(wqe.ah_handle);
+  if (template_iter != ah_header_templates_.end()) {
+    out.data = template_iter->second.encapsulate(packet);
+    out.src_port = template_iter->second.attr().src_port;
+    out.is_frame = true;
+    ++stats_.frames_encapsulated;
+  } else {
+    out.data = std::move(packet);
+    out.src_port = roce_flow_src_port(wqe.ah_handle, 0);
+  }
+  stats_.bytes_sent += out.data.size();
+  outgoing_packets_.push_back(std::move(out));
+
+  ++stats_.send_wqes_posted;
+  ++stats_.packets_sent;
+
+  if (wqe.signaled) {
+    stamp_wqe_transmit(qp.qp_number(), wqe.wr_id);
+    RdmaCqe cqe;
+    cqe.wr_id = wqe.wr_id;
+    cqe.status = WqeStatus::Success;
+    cqe.opcode = wqe.opcode;
+    cqe.qp_number = qp.qp_number();
+    cqe.bytes_completed = wqe.total_length;
+    deliver_cqe(qp.send_cq_number(), cqe);
+  }
+
+  NIC_LOGF_DEBUG("UD post_send: qp={} ah={} remote_qpn={} len={}",
+                 qp.qp_number(),
+                 wqe.ah_handle,
+                 wqe.remote_qpn,
+                 wqe.total_length);
+  return true;
+}
+
+bool RdmaEngine::post_recv(std::uint32_t qp_number, const RecvWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  return post_recv_list(qp_number, std::span<const RecvWqe>(&wqe, 1)) == 1;
+}
+
+std::size_t RdmaEngine::post_recv_list(std::uint32_t qp_number, std::span<const RecvWqe> wqes) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return 0;
+  }
+
+  auto iter = qps_.find(qp_number);
+  if (iter == qps_.end()) {
+    return 0;
+  }
+
+  RdmaQueuePair& qp = *iter->second;
+  idle_candidates_.insert(qp_number);
+  for (std::size_t wqe_idx = 0; wqe_idx < wqes.size(); ++wqe_idx) {
+    if (!qp.post_recv(wqes[wqe_idx])) {
+      ++stats_.errors;
+      return wqe_idx;
+    }
+    ++stats_.recv_wqes_posted;
+  }
+
+  return wqes.size();
+}
+
+// ============================================
+// Packet Processing
+// ============================================
+
+std::size_t RdmaEngine::ring_sq_doorbell(std::uint32_t qp_number, std::uint32_t producer_index) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return 0;
+  }
+
+  auto ring_iter = sq_rings_.find(qp_number);
+  if (ring_iter == sq_rings_.end()) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("SQ doorbell ignored: qp={} has no send ring", qp_number);
+    return 0;
+  }
+
+  ++stats_.sq_doorbells;
+  RdmaSendQueueRing& ring = *ring_iter->second;
+  if (!ring.update_producer(producer_index)) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("SQ doorbell ignored: qp={} producer={} consumer={} depth={}",
+                     qp_number,
+                     producer_index,
+                     ring.consumer_index(),
+                     ring.depth());
+    return 0;
+  }
+
+  return drain_sq_ring(*qps_.at(qp_number), ring);
+}
+
+bool RdmaEngine::post_blueflame(const RdmaSqWqe& entry) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return false;
+  }
+
+  auto ring_iter = sq_rings_.find(entry.qp_number);
+  if (ring_iter == sq_rings_.end()) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("BlueFlame write ignored: qp={} has no send ring", entry.qp_number);
+    return false;
+  }
+
+  RdmaSendQueueRing& ring = *ring_iter->second;
+  RdmaQueuePair& qp = *qps_.at(entry.qp_number);
+
+  // Earlier slots are still unfetched: the copy in the ring is fetched in order instead
+  if (!qp.can_send() || !ring.consume_blueflame()) {
+    ++stats_.blueflame_fallbacks;
+    std::uint32_t pending = ring.pending();
+    return ring_sq_doorbell(entry.qp_number, ring.producer_index() + 1) > pending;
+  }
+
+  ++stats_.blueflame_wqes;
+  return post_send_wqe(qp, decode_sq_wqe(entry));
+}
+
+const RdmaSendQueueRing* RdmaEngine::query_sq_ring(std::uint32_t qp_number) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = sq_rings_.find(qp_number);
+  if (iter == sq_rings_.end()) {
+    return nullptr;
+  }
+  return iter->second.get();
+}
+
+std::size_t RdmaEngine::drain_sq_ring(RdmaQueuePair& qp, RdmaSendQueueRing& ring) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Published slots stay pending until the QP can send; a later doorbell fetches them
+  if (!qp.can_send()) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("SQ doorbell: qp={} not in sendable state", qp.qp_number());
+    return 0;
+  }
+
+  std::size_t posted = 0;
+  while (ring.pending() > 0) {
+    std::optional<RdmaSqWqe> entry = ring.fetch();
+    if (!entry.has_value()) {
+      ++stats_.errors;
+      NIC_LOGF_WARNING("SQ fetch failed: qp={} index={}", qp.qp_number(), ring.consumer_index());
+      break;
+    }
+    ++stats_.sq_wqes_fetched;
+
+    // A rejected WQE is still consumed: the ring never rewinds
+    if (post_send_wqe(qp, decode_sq_wqe(*entry))) {
+      ++posted;
+    }
+  }
+  return posted;
+}
+
+bool RdmaEngine::process_incoming_packet(std::span<const std::byte> udp_payload,
+                                         std::array<std::uint8_t, 4> src_ip,
+                                         std::array<std::uint8_t, 4> dst_ip,
+                                         std::uint16_t /* src_port */) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return false;
+  }
+
+  // A bare UDP payload carries no ECN field; it is treated as CE-marked
+  return process_udp_payload(udp_payload, src_ip, dst_ip, EcnCodepoint::Ce);
+}
+
+bool RdmaEngine::process_incoming_frame(std::span<const std::byte> frame) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.enabled) {
+    return false;
+  }
+
+  auto info = parse_roce_frame(frame);
+  if (!info.has_value()) {
+    ++stats_.frame_errors;
+    ++stats_.errors;
+    NIC_LOGF_WARNING("incoming frame: malformed outer headers ({} bytes)", frame.size());
+    return false;
+  }
+
+  ++stats_.frames_received;
+  return process_udp_payload(info->udp_payload, info->src_ip, info->dest_ip, info->ecn);
+}
+
+bool RdmaEngine::process_udp_payload(std::span<const std::byte> udp_payload,
+                                     std::array<std::uint8_t, 4> src_ip,
+                                     std::array<std::uint8_t, 4> dst_ip,
+                                     EcnCodepoint ecn) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Copy packet data - parser holds spans referencing this data
+  std::vector<std::byte> packet_data(udp_payload.begin(), udp_payload.end());
+
+  RdmaPacketParser parser;
+  if (!parser.parse(packet_data)) {
+    ++stats_.errors;
+    return false;
+  }
+
+  const BthFields& bth = parser.bth();
+
+  // Find destination QP
+  auto qp_iter = qps_.find(bth.dest_qp);
+  if (qp_iter == qps_.end()) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("incoming packet: unknown dest QP {}", bth.dest_qp);
+    return false;
+  }
+
+  RdmaQueuePair& qp = *qp_iter->second;
+  idle_candidates_.insert(bth.dest_qp);
+
+  // UD QPs only accept UD opcodes, and RC QPs never accept them
+  if (opcode_is_ud(bth.opcode) != (qp.type() == QpType::Ud)) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("incoming packet: opcode {:#x} does not match QP {} transport",
+                     static_cast<int>(bth.opcode),
+                     bth.dest_qp);
+    return false;
+  }
+
+  if (qp.type() == QpType::Ud) {
+    ++stats_.packets_received;
+    stats_.bytes_received += udp_payload.size();
+    process_ud_send_packet(qp, parser, src_ip, dst_ip);
+    return true;
+  }
+
+  // Check for ECN marking (CE codepoint)
+  if (congestion_manager_.is_congestion_marked(ecn)) {
+    // Generate CNP back to sender
+    auto cnp = congestion_manager_.generate_cnp(bth.dest_qp, 0, 0);
+    if (cnp.has_value()) {
+      queue_outgoing_packet(std::move(*cnp), qp, static_cast<std::uint8_t>(kCnpDscp << 2));
+    }
+  }
+
+  ++stats_.packets_received;
+  stats_.bytes_received += udp_payload.size();
+
+  // Process based on opcode
+  RdmaOpcode opcode = bth.opcode;
 
+  if ((opcode == RdmaOpcode::kRcSendOnly) || (opcode == RdmaOpcode::kRcSendFirst)
+      || (opcode == RdmaOpcode::kRcSendMiddle) || (opcode == RdmaOpcode::kRcSendLast)
+      || (opcode == RdmaOpcode::kRcSendOnlyImm) || (opcode == RdmaOpcode::kRcSendLastImm)
+      || (opcode == RdmaOpcode::kRcSendOnlyInv) || (opcode == RdmaOpcode::kRcSendLastInv)) {
+    process_send_packet(qp, parser, src_ip);
+  } else if ((opcode == RdmaOpcode::kRcWriteOnly) || (opcode == RdmaOpcode::kRcWriteFirst)
+             || (opcode == RdmaOpcode::kRcWriteMiddle) || (opcode == RdmaOpcode::kRcWriteLast)
+             || (opcode == RdmaOpcode::kRcWriteOnlyImm)
+             || (opcode == RdmaOpcode::kRcWriteLastImm)) {
+    process_write_packet(qp, parser);
+  } else if (opcode == RdmaOpcode::kRcReadRequest) {
+    process_read_request_packet(qp, parser);
+  } else if ((opcode == RdmaOpcode::kRcReadResponseOnly)
+             || (opcode == RdmaOpcode::kRcReadResponseFirst)
+             || (opcode == RdmaOpcode::kRcReadResponseMiddle)
+             || (opcode == RdmaOpcode::kRcReadResponseLast)) {
+    process_read_response_packet(qp, parser);
+  } else if (opcode == RdmaOpcode::kRcAck) {
+    process_ack_packet(qp, parser);
+  } else if (opcode == RdmaOpcode::kCnp) {
+    process_cnp_packet(qp, parser);
+  } else {
+    ++stats_.errors;
+    return false;
+  }
+
+  return true;
+}
+
+RdmaQueuePair* RdmaEngine::loopback_peer(const RdmaQueuePair& qp) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!config_.local_ip.has_value() || (qp.dest_ip() != *config_.local_ip)) {
+    return nullptr;
+  }
+
+  auto iter = qps_.find(qp.dest_qp_number());
+  if (iter == qps_.end()) {
+    return nullptr;
+  }
+
+  // Only a connected pair with nothing in flight can skip the wire without reordering
+  RdmaQueuePair& peer = *iter->second;
+  if ((peer.type() != QpType::Rc) || (peer.dest_qp_number() != qp.qp_number())
+      || (peer.dest_ip() != *config_.local_ip) || !peer.can_receive()
+      || (peer.expected_recv_psn() != qp.sq_psn())
+      || reliability_manager_.has_outstanding(qp.qp_number())) {
+    return nullptr;
+  }
+  return &peer;
+}
+
+bool RdmaEngine::post_loopback(RdmaQueuePair& qp, RdmaQueuePair& peer, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  bool is_send = (wqe.opcode == WqeOpcode::Send) || (wqe.opcode == WqeOpcode::SendImm)
+                 || (wqe.opcode == WqeOpcode::SendWithInvalidate);
+  bool is_write = (wqe.opcode == WqeOpcode::RdmaWrite) || (wqe.opcode == WqeOpcode::RdmaWriteImm);
+  bool is_read = (wqe.opcode == WqeOpcode::RdmaRead);
+  bool has_invalidate = (wqe.opcode == WqeOpcode::SendWithInvalidate);
+  if (!is_send && !is_write && !is_read) {
+    return false;
+  }
+  idle_candidates_.insert(peer.qp_number());
+
+  // Returning false before anything is mutated hands the WQE to the packet path,
+  // which reports the same local errors and keeps RNR retry semantics.
+  std::vector<std::byte> data;
+  if (is_read) {
+    MrAccessStatus access = mr_table_.access_rkey(
+        wqe.rkey, peer.pd_handle(), wqe.remote_address, wqe.total_length, false, peer.qp_number());
+    if (access == MrAccessStatus::PageFault) {
+      return false;
+    }
+    if (access != MrAccessStatus::Ok) {
+      complete_loopback_error(qp, wqe, WqeStatus::RemoteAccessError);
+      return true;
+    }
+    data.resize(wqe.total_length);
+    if (!host_memory_.read(wqe.remote_address, data).ok()) {
+      complete_loopback_error(qp, wqe, WqeStatus::RemoteAccessError);
+      return true;
+    }
+  } else if (wqe.inline_data) {
+    std::span<const std::byte> payload = inline_payload_view(wqe);
+    data.assign(payload.begin(), payload.end());
+  } else if (!gather_sgl(wqe.sgl, wqe.local_lkey, data) || (data.size() != wqe.total_length)) {
+    return false;
+  }
+
+  if (is_write) {
+    MrAccessStatus access = mr_table_.access_rkey(
+        wqe.rkey, peer.pd_handle(), wqe.remote_address, wqe.total_length, true, peer.qp_number());
+    if (access == MrAccessStatus::PageFault) {
+      return false;
+    }
+    if (access != MrAccessStatus::Ok) {
+      complete_loopback_error(qp, wqe, WqeStatus::RemoteAccessError);
+      return true;
+    }
+  }
+
+  // SEND and WRITE-with-immediate consume a receive WQE on the responder
+  bool has_immediate =
+      (wqe.opcode == WqeOpcode::SendImm) || (wqe.opcode == WqeOpcode::RdmaWriteImm);
+  std::optional<RecvWqe> recv_wqe;
+  if (is_send || has_immediate) {
+    recv_wqe = peer.consume_recv();
+    check_srq_limit(peer);
+    if (!recv_wqe.has_value()) {
+      return false;
+    }
+  }
+
+  if (has_invalidate
+      && !mr_table_.invalidate(wqe.invalidate_rkey, peer.pd_handle(), peer.qp_number())) {
+    complete_loopback_error(qp, wqe, WqeStatus::RemoteInvalidRequestError);
+    return true;
+  }
+
+  if (is_send) {
+    if ((compute_sgl_length(recv_wqe->sgl) < data.size())
+        || !scatter_sgl(recv_wqe->sgl, data, std::nullopt)) {
+      complete_loopback_error(qp, wqe, WqeStatus::RemoteAccessError);
+      return true;
+    }
+  } else if (is_write) {
+    if (!data.empty() && !host_memory_.write(wqe.remote_address, data).ok()) {
+      complete_loopback_error(qp, wqe, WqeStatus::RemoteAccessError);
+      return true;
+    }
+  } else if (!scatter_sgl(wqe.sgl, data, wqe.local_lkey)) {
+    complete_loopback_error(qp, wqe, WqeStatus::LocalProtectionError);
+    return true;
+  }
+
+  // One PSN per message keeps both ends in step for any later wire traffic
+  static_cast<void>(qp.next_send_psn());
+  peer.advance_recv_psn();
+
+  if (recv_wqe.has_value()) {
+    RdmaCqe recv_cqe;
+    recv_cqe.wr_id = recv_wqe->wr_id;
+    recv_cqe.status = WqeStatus::Success;
+    recv_cqe.opcode = is_send ? wqe.opcode : WqeOpcode::RdmaWriteImm;
+    recv_cqe.qp_number = peer.qp_number();
+    recv_cqe.bytes_completed = static_cast<std::uint32_t>(data.size());
+    recv_cqe.has_immediate = has_immediate;
+    recv_cqe.immediate_data = has_immediate ? wqe.immediate_data : 0;
+    recv_cqe.has_invalidate = has_invalidate;
+    recv_cqe.invalidated_rkey = has_invalidate ? wqe.invalidate_rkey : 0;
+    recv_cqe.is_send = false;
+    recv_cqe.solicited = wqe.solicited;
+    deliver_cqe(peer.recv_cq_number(), recv_cqe);
+  }
+
+  if (wqe.signaled) {
+    RdmaCqe cqe;
+    cqe.wr_id = wqe.wr_id;
+    cqe.status = WqeStatus::Success;
+    cqe.opcode = wqe.opcode;
+    cqe.qp_number = qp.qp_number();
+    cqe.bytes_completed = wqe.total_length;
+    cqe.is_send = true;
+    deliver_cqe(qp.send_cq_number(), cqe);
+  }
+
+  ++stats_.send_wqes_posted;
+  ++stats_.loopback_ops;
+  NIC_LOGF_DEBUG("loopback: qp={} -> qp={} opcode={} len={}",
+                 qp.qp_number(),
+                 peer.qp_number(),
+                 static_cast<int>(wqe.opcode),
+                 wqe.total_length);
+  return true;
+}
+
+void RdmaEngine::complete_loopback_error(RdmaQueuePair& qp,
+                                         const SendWqe& wqe,
+                                         WqeStatus status) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Same outcome as a fatal NAK on the wire: error CQE, then the requester enters Error
+  RdmaCqe cqe;
+  cqe.wr_id = wqe.wr_id;
+  cqe.status = status;
+  cqe.opcode = wqe.opcode;
+  cqe.qp_number = qp.qp_number();
+  cqe.is_send = true;
+  deliver_cqe(qp.send_cq_number(), cqe);
+
+  ++stats_.send_wqes_posted;
+  ++stats_.loopback_ops;
+  ++stats_.errors;
+  NIC_LOGF_WARNING("loopback failed: qp={} wr_id={} status={}",
+                   qp.qp_number(),
+                   wqe.wr_id,
+                   static_cast<int>(status));
+
+  RdmaQpModifyParams params;
+  params.target_state = QpState::Error;
+  qp.modify(params);
+}
+
+void RdmaEngine::execute_memory_wqe(RdmaQueuePair& qp, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  bool ok = false;
+  WqeStatus error_status = WqeStatus::LocalProtectionError;
   switch (wqe.opcode) {
-    case WqeOpcode::Send:
-    case WqeOpcode::SendImm: {
-      packets = send_recv_processor_.generate_send_packets(qp, wqe);
+    case WqeOpcode::RegMr: {
+      // MRs are identity-mapped, so the page list must describe one contiguous range
+      bool contiguous = !wqe.sgl.empty();
+      for (std::size_t sge_idx = 1; contiguous && (sge_idx < wqe.sgl.size()); ++sge_idx) {
+        contiguous = (wqe.sgl[sge_idx].address
+                      == wqe.sgl[sge_idx - 1].address + wqe.sgl[sge_idx - 1].length);
+      }
+      ok = contiguous
+           && mr_table_.fast_register(wqe.local_lkey,
+                                      qp.pd_handle(),
+                                      wqe.sgl.front().address,
+                                      compute_sgl_length(wqe.sgl),
+                                      wqe.access,
+                                      wqe.new_rkey);
       break;
     }
-    case WqeOpcode::RdmaWrite:
-    case WqeOpcode::RdmaWriteImm: {
-      packets = write_processor_.generate_write_packets(qp, wqe);
+    case WqeOpcode::LocalInvalidate: {
+      ok = mr_table_.invalidate(wqe.invalidate_rkey, qp.pd_handle());
       break;
     }
-    case WqeOpcode::RdmaRead: {
-      packets = read_processor_.generate_read_request(qp, wqe);
+    case WqeOpcode::BindMw: {
+      error_status = WqeStatus::MemoryWindowBindError;
+      ok = (wqe.sgl.size() == 1)
+           && mr_table_.bind_mw(wqe.rkey,
+                                wqe.local_lkey,
+                                qp.pd_handle(),
+                                wqe.sgl.front().address,
+                                wqe.sgl.front().length,
+                                wqe.access,
+                                qp.qp_number(),
+                                wqe.new_rkey);
       break;
     }
     default:
-      ++stats_.errors;
-      return false;
+      break;
+  }
+
+  ++stats_.send_wqes_posted;
+  ++stats_.memory_wqes;
+
+  if (!ok) {
+    // A failed key operation is fatal to the QP, like a local protection error on data
+    RdmaCqe cqe;
+    cqe.wr_id = wqe.wr_id;
+    cqe.status = error_status;
+    cqe.opcode = wqe.opcode;
+    cqe.qp_number = qp.qp_number();
+    cqe.is_send = true;
+    deliver_cqe(qp.send_cq_number(), cqe);
+
+    ++stats_.errors;
+    NIC_LOGF_WARNING("memory WQE failed: qp={} wr_id={} opcode={}",
+                     qp.qp_number(),
+                     wqe.wr_id,
+                     static_cast<int>(wqe.opcode));
+
+    RdmaQpModifyParams params;
+    params.target_state = QpState::Error;
+    qp.modify(params);
+    return;
+  }
+
+  if (wqe.signaled) {
+    RdmaCqe cqe;
+    cqe.wr_id = wqe.wr_id;
+    cqe.status = WqeStatus::Success;
+    cqe.opcode = wqe.opcode;
+    cqe.qp_number = qp.qp_number();
+    cqe.is_send = true;
+    deliver_cqe(qp.send_cq_number(), cqe);
+  }
+}
+
+bool RdmaEngine::park_odp_wqe(RdmaQueuePair& qp, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // WQEs behind a parked one wait too, so the send queue stays in posting order
+  auto iter = odp_parked_.find(qp.qp_number());
+  if (iter != odp_parked_.end()) {
+    iter->second.wqes.push_back(make_wqe_record(wqe));
+    ++stats_.odp_parked_wqes;
+    return true;
+  }
+
+  if (access_wqe_memory(wqe.opcode, wqe.inline_data, wqe.local_lkey, wqe.sgl)
+      != MrAccessStatus::PageFault) {
+    return false;
+  }
+
+  OdpParkedWqes& parked = odp_parked_[qp.qp_number()];
+  parked.wqes.push_back(make_wqe_record(wqe));
+  parked.parked_at_us = now_us_;
+  ++stats_.odp_parked_wqes;
+  NIC_LOGF_DEBUG("ODP: qp={} wr_id={} parked on page fault", qp.qp_number(), wqe.wr_id);
+  return true;
+}
+
+MrAccessStatus RdmaEngine::access_wqe_memory(WqeOpcode opcode,
+                                             bool inline_data,
+                                             std::uint32_t lkey,
+                                             const WqeSgl& sgl) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (inline_data || is_memory_wqe(opcode)) {
+    return MrAccessStatus::Ok;
+  }
+
+  // READ scatters the response into its SGL; every other opcode gathers from it
+  bool is_write = (opcode == WqeOpcode::RdmaRead);
+  for (const SglEntry& entry : sgl) {
+    MrAccessStatus status = mr_table_.access_lkey(lkey, entry.address, entry.length, is_write);
+    if (status != MrAccessStatus::Ok) {
+      return status;
+    }
+  }
+  return MrAccessStatus::Ok;
+}
+
+void RdmaEngine::resume_odp_wqes() {
+  NIC_TRACE_SCOPED(__func__);
+
+  for (auto iter = odp_parked_.begin(); iter != odp_parked_.end();) {
+    auto qp_iter = qps_.find(iter->first);
+    OdpParkedWqes& parked = iter->second;
+    while (!parked.wqes.empty()) {
+      // A head WQE that still faults raises the fault again and keeps the queue parked
+      const SendWqeRecord& head = parked.wqes.front();
+      if ((qp_iter != qps_.end()) && qp_iter->second->can_send()
+          && (access_wqe_memory(head.opcode, head.inline_data, head.local_lkey, head.sgl)
+              == MrAccessStatus::PageFault)) {
+        break;
+      }
+
+      SendWqe wqe = make_send_wqe(parked.wqes.front());
+      parked.wqes.pop_front();
+      if (qp_iter == qps_.end()) {
+        continue;
+      }
+      RdmaQueuePair& qp = *qp_iter->second;
+      if (!qp.can_send()) {
+        flush_send_wqe(qp, wqe);
+        continue;
+      }
+      ++stats_.odp_resumed_wqes;
+      if (!start_send_wqe(qp, wqe)) {
+        NIC_LOGF_WARNING("ODP: qp={} wr_id={} failed on resume", qp.qp_number(), wqe.wr_id);
+      }
+    }
+
+    if (parked.wqes.empty()) {
+      stats_.odp_stall_us += now_us_ - parked.parked_at_us;
+      iter = odp_parked_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+void RdmaEngine::flush_send_wqe(RdmaQueuePair& qp, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // The QP left RTS while the WQE waited: flush it like the rest of the send queue
+  RdmaCqe cqe;
+  cqe.wr_id = wqe.wr_id;
+  cqe.status = WqeStatus::WrFlushError;
+  cqe.opcode = wqe.opcode;
+  cqe.qp_number = qp.qp_number();
+  cqe.is_send = true;
+  deliver_cqe(qp.send_cq_number(), cqe);
+}
+
+// ============================================
+// RNR Back-off and Credits
+// ============================================
+
+bool RdmaEngine::hold_send_wqe(RdmaQueuePair& qp, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = rnr_states_.find(qp.qp_number());
+  if (iter == rnr_states_.end()) {
+    return false;
   }
 
-  if (packets.empty()) {
-    ++stats_.errors;
+  RnrState& state = iter->second;
+  bool no_credits = credit_blocked(state, wqe.opcode);
+  if (state.held.empty() && !state.resend_psn.has_value() && !no_credits) {
     return false;
   }
 
-  // Track for reliability - end_psn is start + num_packets - 1
-  std::uint32_t end_psn = start_psn;
-  if (packets.size() > 1) {
-    end_psn = (start_psn + static_cast<std::uint32_t>(packets.size()) - 1) & 0xFFFFFF;
+  state.held.push_back(make_wqe_record(wqe));
+  if (no_credits) {
+    ++stats_.credit_stalls;
   }
+  NIC_LOGF_DEBUG("RNR: qp={} wr_id={} held ({} waiting)",
+                 qp.qp_number(),
+                 wqe.wr_id,
+                 state.held.size());
+  return true;
+}
 
-  reliability_manager_.add_pending(qp_number, start_psn, end_psn, wqe.wr_id, wqe.opcode, 0);
+bool RdmaEngine::credit_blocked(const RnrState& state, WqeOpcode opcode) const {
+  NIC_TRACE_SCOPED(__func__);
 
-  // Queue packets for sending
-  for (auto& packet : packets) {
-    stats_.bytes_sent += packet.size();
-    queue_outgoing_packet(std::move(packet), qp);
-  }
+  // With no consumer in flight one WQE may go anyway, so a stale zero cannot stall the QP
+  return config_.end_to_end_credits && consumes_recv_wqe(opcode)
+         && state.credits.has_value() && (*state.credits == 0) && !state.consumers.empty();
+}
 
-  ++stats_.send_wqes_posted;
-  stats_.packets_sent += packets.size();
-  NIC_LOGF_DEBUG("post_send: qp={} opcode={} len={} packets={}",
-                 qp_number,
-                 static_cast<int>(wqe.opcode),
-                 wqe.total_length,
-                 packets.size());
+void RdmaEngine::start_rnr_backoff(RdmaQueuePair& qp, std::uint32_t psn, std::uint64_t delay_us) {
+  NIC_TRACE_SCOPED(__func__);
 
-  return true;
+  RnrState& state = rnr_states_[qp.qp_number()];
+  if (!state.resend_psn.has_value()) {
+    state.resend_psn = psn;
+    state.backoff_start_us = now_us_;
+    ++stats_.rnr_backoffs;
+  }
+  state.resume_us = now_us_ + delay_us;
+  NIC_LOGF_DEBUG("RNR: qp={} psn={} backing off {} us", qp.qp_number(), psn, delay_us);
 }
 
-bool RdmaEngine::post_recv(std::uint32_t qp_number, const RecvWqe& wqe) {
+void RdmaEngine::process_rnr_ack(RdmaQueuePair& qp,
+                                 std::uint32_t ack_psn,
+                                 std::uint8_t credit_code) {
   NIC_TRACE_SCOPED(__func__);
 
-  if (!config_.enabled) {
-    return false;
+  auto iter = rnr_states_.find(qp.qp_number());
+  if (iter == rnr_states_.end()) {
+    if (!config_.end_to_end_credits) {
+      return;
+    }
+    iter = rnr_states_.emplace(qp.qp_number(), RnrState{}).first;
   }
 
-  auto iter = qps_.find(qp_number);
-  if (iter == qps_.end()) {
-    return false;
+  // A later ACK covering the NAKed PSN means it got through: nothing is left to resend
+  RnrState& state = iter->second;
+  if (state.resend_psn.has_value() && psn_acked(ack_psn, *state.resend_psn)) {
+    stats_.rnr_wait_us += now_us_ - state.backoff_start_us;
+    state.resend_psn.reset();
   }
 
-  if (!iter->second->post_recv(wqe)) {
-    ++stats_.errors;
-    return false;
+  // The peer's count already reflects the ACKed messages; later ones will still consume
+  if (config_.end_to_end_credits) {
+    while (!state.consumers.empty() && psn_acked(ack_psn, state.consumers.front())) {
+      state.consumers.pop_front();
+    }
+    std::optional<std::uint32_t> credits = decode_aeth_credits(credit_code);
+    if (credits.has_value()) {
+      auto in_flight = static_cast<std::uint32_t>(state.consumers.size());
+      state.credits = *credits - std::min(*credits, in_flight);
+    } else {
+      state.credits.reset();
+    }
   }
 
-  ++stats_.recv_wqes_posted;
-  return true;
+  release_rnr_wqes(qp, state);
 }
 
-// ============================================
-// Packet Processing
-// ============================================
-
-bool RdmaEngine::process_incoming_packet(std::span<const std::byte> udp_payload,
-                                         std::array<std::uint8_t, 4> src_ip,
-                                         std::array<std::uint8_t, 4> /* dst_ip */,
-                                         std::uint16_t /* src_port */) {
+void RdmaEngine::resend_from(RdmaQueuePair& qp, std::uint32_t psn) {
   NIC_TRACE_SCOPED(__func__);
 
-  if (!config_.enabled) {
-    return false;
+  // Go back N: the responder dropped everything after the NAKed PSN. Each WQE,
+  // signaled or not, goes out again at its original PSNs, so the responder sees
+  // the same sequence and later WQEs need no renumbering.
+  std::vector<PendingOperation> ops = qp.take_pending_from(psn);
+  if (ops.empty()) {
+    return;
   }
 
-  // Copy packet data - parser holds spans referencing this data
-  std::vector<std::byte> packet_data(udp_payload.begin(), udp_payload.end());
-
-  RdmaPacketParser parser;
-  if (!parser.parse(packet_data)) {
-    ++stats_.errors;
-    return false;
+  std::uint32_t next_psn = qp.sq_psn();
+  RdmaQpModifyParams rewind;
+  for (const PendingOperation& op : ops) {
+    rewind.sq_psn = op.psn;
+    qp.modify(rewind);
+    for (auto& packet : build_send_packets(qp, make_send_wqe(op.wqe))) {
+      stats_.bytes_sent += packet.size();
+      ++stats_.packets_sent;
+      queue_outgoing_packet(std::move(packet), qp);
+    }
+    ++stats_.rnr_resends;
   }
+  rewind.sq_psn = next_psn;
+  qp.modify(rewind);
+}
 
-  const BthFields& bth = parser.bth();
+void RdmaEngine::resume_rnr_wqes() {
+  NIC_TRACE_SCOPED(__func__);
 
-  // Find destination QP
-  auto qp_iter = qps_.find(bth.dest_qp);
-  if (qp_iter == qps_.end()) {
-    ++stats_.errors;
-    NIC_LOGF_WARNING("incoming packet: unknown dest QP {}", bth.dest_qp);
-    return false;
+  for (auto iter = rnr_states_.begin(); iter != rnr_states_.end();) {
+    auto qp_iter = qps_.find(iter->first);
+    if (qp_iter == qps_.end()) {
+      iter = rnr_states_.erase(iter);
+      continue;
+    }
+    release_rnr_wqes(*qp_iter->second, iter->second);
+    ++iter;
   }
+}
 
-  RdmaQueuePair& qp = *qp_iter->second;
+void RdmaEngine::release_rnr_wqes(RdmaQueuePair& qp, RnrState& state) {
+  NIC_TRACE_SCOPED(__func__);
 
-  // Check for ECN marking (CE codepoint)
-  if (congestion_manager_.is_congestion_marked(EcnCodepoint::Ce)) {
-    // Generate CNP back to sender
-    auto cnp = congestion_manager_.generate_cnp(bth.dest_qp, 0, 0);
-    if (cnp.has_value()) {
-      queue_outgoing_packet(std::move(*cnp), qp);
+  if (state.resend_psn.has_value()) {
+    if (qp.can_send() && (now_us_ < state.resume_us)) {
+      return;
+    }
+    stats_.rnr_wait_us += now_us_ - state.backoff_start_us;
+    std::uint32_t psn = *state.resend_psn;
+    state.resend_psn.reset();
+    if (qp.can_send()) {
+      resend_from(qp, psn);
     }
   }
 
-  ++stats_.packets_received;
-  stats_.bytes_received += udp_payload.size();
+  while (!state.held.empty()) {
+    if (qp.can_send() && credit_blocked(state, state.held.front().opcode)) {
+      break;
+    }
+    SendWqe wqe = make_send_wqe(state.held.front());
+    state.held.pop_front();
+    if (!qp.can_send()) {
+      flush_send_wqe(qp, wqe);
+      continue;
+    }
+    if (!transmit_send_wqe(qp, wqe)) {
+      NIC_LOGF_WARNING("RNR: qp={} wr_id={} failed on resume", qp.qp_number(), wqe.wr_id);
+    }
+  }
+}
 
-  // Process based on opcode
-  RdmaOpcode opcode = bth.opcode;
+std::uint8_t RdmaEngine::ack_credit_code(const RdmaQueuePair& qp) const {
+  NIC_TRACE_SCOPED(__func__);
 
-  if ((opcode == RdmaOpcode::kRcSendOnly) || (opcode == RdmaOpcode::kRcSendFirst)
-      || (opcode == RdmaOpcode::kRcSendMiddle) || (opcode == RdmaOpcode::kRcSendLast)
-      || (opcode == RdmaOpcode::kRcSendOnlyImm) || (opcode == RdmaOpcode::kRcSendLastImm)) {
-    process_send_packet(qp, parser, src_ip);
-  } else if ((opcode == RdmaOpcode::kRcWriteOnly) || (opcode == RdmaOpcode::kRcWriteFirst)
-             || (opcode == RdmaOpcode::kRcWriteMiddle) || (opcode == RdmaOpcode::kRcWriteLast)
-             || (opcode == RdmaOpcode::kRcWriteOnlyImm)
-             || (opcode == RdmaOpcode::kRcWriteLastImm)) {
-    process_write_packet(qp, parser);
-  } else if (opcode == RdmaOpcode::kRcReadRequest) {
-    process_read_request_packet(qp, parser);
-  } else if ((opcode == RdmaOpcode::kRcReadResponseOnly)
-             || (opcode == RdmaOpcode::kRcReadResponseFirst)
-             || (opcode == RdmaOpcode::kRcReadResponseMiddle)
-             || (opcode == RdmaOpcode::kRcReadResponseLast)) {
-    process_read_response_packet(qp, parser);
-  } else if (opcode == RdmaOpcode::kRcAck) {
-    process_ack_packet(qp, parser);
-  } else if (opcode == RdmaOpcode::kCnp) {
-    process_cnp_packet(qp, parser);
-  } else {
-    ++stats_.errors;
-    return false;
+  // SRQ QPs share their receive WQEs, so a per-QP count would mislead the requester
+  if (!config_.end_to_end_credits || (qp.srq() != nullptr)) {
+    return kAethCreditsInvalid;
   }
+  return encode_aeth_credits(qp.recv_queue_size());
+}
+
+bool RdmaEngine::gather_sgl(std::span<const SglEntry> sgl,
+                            std::uint32_t lkey,
+                            std::vector<std::byte>& out) const {
+  NIC_TRACE_SCOPED(__func__);
 
+  for (const auto& entry : sgl) {
+    if (!mr_table_.validate_lkey(lkey, entry.address, entry.length, false)) {
+      return false;
+    }
+    std::size_t old_size = out.size();
+    out.resize(old_size + entry.length);
+    std::span<std::byte> dest(out.data() + old_size, entry.length);
+    if (!host_memory_.read(entry.address, dest).ok()) {
+      return false;
+    }
+  }
   return true;
 }
 
+bool RdmaEngine::scatter_sgl(std::span<const SglEntry> sgl,
+                             std::span<const std::byte> data,
+                             std::optional<std::uint32_t> lkey) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::size_t offset = 0;
+  for (const auto& entry : sgl) {
+    if (offset >= data.size()) {
+      break;
+    }
+    std::size_t to_write = std::min<std::size_t>(entry.length, data.size() - offset);
+    if (lkey.has_value() && !mr_table_.validate_lkey(*lkey, entry.address, to_write, true)) {
+      return false;
+    }
+    if (!host_memory_.write(entry.address, data.subspan(offset, to_write)).ok()) {
+      return false;
+    }
+    offset += to_write;
+  }
+  return offset == data.size();
+}
+
 void RdmaEngine::process_send_packet(RdmaQueuePair& qp,
                                      const RdmaPacketParser& parser,
                                      std::array<std::uint8_t, 4> /* src_ip */) {
   NIC_TRACE_SCOPED(__func__);
 
   auto result = send_recv_processor_.process_recv_packet(qp, parser);
+  check_srq_limit(qp);
 
   if (!result.success) {
     if (result.syndrome != AethSyndrome::Ack) {
@@ -445,12 +2014,39 @@ void RdmaEngine::process_send_packet(RdmaQueuePair& qp,
   if (result.cqe.has_value()) {
     deliver_cqe(qp.recv_cq_number(), *result.cqe);
   }
+  retire_placed_writes(qp);
+}
+
+void RdmaEngine::process_ud_send_packet(RdmaQueuePair& qp,
+                                        const RdmaPacketParser& parser,
+                                        std::array<std::uint8_t, 4> src_ip,
+                                        std::array<std::uint8_t, 4> dst_ip) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto result = send_recv_processor_.process_ud_recv_packet(qp, parser, src_ip, dst_ip);
+  check_srq_limit(qp);
+
+  // UD never ACKs or NAKs; drops are only visible in processor stats
+  if (result.cqe.has_value()) {
+    deliver_cqe(qp.recv_cq_number(), *result.cqe);
+  }
 }
 
 void RdmaEngine::process_write_packet(RdmaQueuePair& qp, const RdmaPacketParser& parser) {
   NIC_TRACE_SCOPED(__func__);
 
   auto result = write_processor_.process_write_packet(qp, parser);
+  check_srq_limit(qp);
+  complete_write_result(qp, result);
+}
+
+void RdmaEngine::complete_write_result(RdmaQueuePair& qp, const WriteResult& result) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Writes with immediate that completed before any failure still generate receive CQEs
+  for (const RdmaCqe& cqe : result.recv_cqes) {
+    deliver_cqe(qp.recv_cq_number(), cqe);
+  }
 
   if (!result.success) {
     if (result.syndrome != AethSyndrome::Ack) {
@@ -463,11 +2059,15 @@ void RdmaEngine::process_write_packet(RdmaQueuePair& qp, const RdmaPacketParser&
   if (result.needs_ack) {
     generate_ack(qp, result.ack_psn, result.syndrome);
   }
+}
+
+void RdmaEngine::retire_placed_writes(RdmaQueuePair& qp) {
+  NIC_TRACE_SCOPED(__func__);
 
-  // If write with immediate completed, generate receive CQE
-  if (result.recv_cqe.has_value()) {
-    deliver_cqe(qp.recv_cq_number(), *result.recv_cqe);
+  if (config_.write_reorder_window == 0) {
+    return;
   }
+  complete_write_result(qp, write_processor_.retire_placed_packets(qp));
 }
 
 void RdmaEngine::process_read_request_packet(RdmaQueuePair& qp, const RdmaPacketParser& parser) {
@@ -485,6 +2085,7 @@ void RdmaEngine::process_read_request_packet(RdmaQueuePair& qp, const RdmaPacket
     queue_outgoing_packet(std::move(packet), qp);
     ++stats_.packets_sent;
   }
+  retire_placed_writes(qp);
 }
 
 void RdmaEngine::process_read_response_packet(RdmaQueuePair& qp, const RdmaPacketParser& parser) {
@@ -497,6 +2098,18 @@ void RdmaEngine::process_read_response_packet(RdmaQueuePair& qp, const RdmaPacke
     return;
   }
 
+  if (result.is_read_complete) {
+    // Responses implicitly ACK the READ and everything sent before it
+    auto acked = reliability_manager_.process_ack(qp.qp_number(), result.last_psn);
+    qp.handle_ack(result.last_psn, AethSyndrome::Ack);
+    for (std::uint64_t wr_id : acked.completed_wr_ids) {
+      RdmaCqe cqe;
+      cqe.wr_id = wr_id;
+      cqe.status = WqeStatus::Success;
+      cqe.qp_number = qp.qp_number();
+      deliver_cqe(qp.send_cq_number(), cqe);
+    }
+  }
   if (result.cqe.has_value()) {
     deliver_cqe(qp.send_cq_number(), *result.cqe);
   }
@@ -511,6 +2124,7 @@ void RdmaEngine::process_ack_packet(RdmaQueuePair& qp, const RdmaPacketParser& p
   if (aeth.syndrome == AethSyndrome::Ack) {
     // Normal ACK
     auto result = reliability_manager_.process_ack(qp.qp_number(), ack_psn);
+    qp.handle_ack(ack_psn, AethSyndrome::Ack);  // Retire the QP's retransmit copies
     for (std::uint64_t wr_id : result.completed_wr_ids) {
       RdmaCqe cqe;
       cqe.wr_id = wr_id;
@@ -518,6 +2132,7 @@ void RdmaEngine::process_ack_packet(RdmaQueuePair& qp, const RdmaPacketParser& p
       cqe.qp_number = qp.qp_number();
       deliver_cqe(qp.send_cq_number(), cqe);
     }
+    process_rnr_ack(qp, ack_psn, aeth.syndrome_value);
   } else {
     // NAK
     AethSyndrome syndrome = aeth.syndrome;
@@ -525,7 +2140,8 @@ void RdmaEngine::process_ack_packet(RdmaQueuePair& qp, const RdmaPacketParser& p
                      qp.qp_number(),
                      ack_psn,
                      static_cast<int>(syndrome));
-    auto result = reliability_manager_.process_nak(qp.qp_number(), ack_psn, syndrome);
+    auto result = reliability_manager_.process_nak(
+        qp.qp_number(), ack_psn, syndrome, aeth.syndrome_value, qp.config().rnr_retry_count);
 
     if (result.error_status.has_value()) {
       // Fatal error - generate error CQE
@@ -541,6 +2157,12 @@ void RdmaEngine::process_ack_packet(RdmaQueuePair& qp, const RdmaPacketParser& p
       RdmaQpModifyParams params;
       params.target_state = QpState::Error;
       qp.modify(params);
+      auto rnr_iter = rnr_states_.find(qp.qp_number());
+      if (rnr_iter != rnr_states_.end()) {
+        release_rnr_wqes(qp, rnr_iter->second);  // Flushes the held WQEs
+      }
+    } else if ((syndrome == AethSyndrome::RnrNak) && result.needs_retransmit) {
+      start_rnr_backoff(qp, ack_psn, result.retry_delay_us);
     }
   }
 }
@@ -561,6 +2183,11 @@ void RdmaEngine::generate_ack(RdmaQueuePair& qp, std::uint32_t psn, AethSyndrome
       .set_ack_request(false)
       .set_syndrome(syndrome)
       .set_msn(0);
+  if (syndrome == AethSyndrome::RnrNak) {
+    builder.set_syndrome_value(static_cast<std::uint8_t>(qp.config().min_rnr_timer));
+  } else if (syndrome == AethSyndrome::Ack) {
+    builder.set_syndrome_value(ack_credit_code(qp));
+  }
 
   auto packet = builder.build();
   queue_outgoing_packet(std::move(packet), qp);
@@ -573,14 +2200,26 @@ void RdmaEngine::generate_nak(RdmaQueuePair& qp, std::uint32_t psn, AethSyndrome
   generate_ack(qp, psn, syndrome);
 }
 
-void RdmaEngine::queue_outgoing_packet(std::vector<std::byte> packet, RdmaQueuePair& qp) {
+void RdmaEngine::queue_outgoing_packet(std::vector<std::byte> packet,
+                                       RdmaQueuePair& qp,
+                                       std::optional<std::uint8_t> traffic_class) {
   NIC_TRACE_SCOPED(__func__);
 
   OutgoingPacket out;
-  out.data = std::move(packet);
   out.dest_ip = qp.dest_ip();
   out.dest_port = kRoceUdpPort;
 
+  out.src_port = select_src_port(qp);
+
+  auto iter = qp_header_templates_.find(qp.qp_number());
+  if (iter != qp_header_templates_.end()) {
+    out.data = iter->second.encapsulate(packet, traffic_class, out.src_port);
+    out.is_frame = true;
+    ++stats_.frames_encapsulated;
+  } else {
+    out.data = std::move(packet);
+  }
+
   outgoing_packets_.push_back(std::move(out));
 }
 
@@ -589,9 +2228,168 @@ void RdmaEngine::deliver_cqe(std::uint32_t cq_number, const RdmaCqe& cqe) {
 
   auto iter = cqs_.find(cq_number);
   if (iter != cqs_.end()) {
-    iter->second->post(cqe);
+    RdmaCqe stamped = cqe;
+    stamped.timestamp_us = now_us_;
+    if (stamped.is_send) {
+      record_wqe_latency(stamped);
+    }
+    iter->second->post(stamped);
     ++stats_.cqes_generated;
+    check_cq_event(*iter->second);
+  }
+}
+
+void RdmaEngine::stamp_wqe_post(const RdmaQueuePair& qp, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // An error CQE without a wr_id leaves its entry behind; the SQ depth bounds the backlog
+  auto& stamps = wqe_timestamps_[qp.qp_number()];
+  if (stamps.size() >= std::max<std::size_t>(qp.config().send_queue_depth, 1)) {
+    stamps.pop_front();
+  }
+  stamps.push_back(WqeTimestamps{.wr_id = wqe.wr_id, .opcode = wqe.opcode, .post_us = now_us_});
+}
+
+void RdmaEngine::stamp_wqe_transmit(std::uint32_t qp_number, std::uint64_t wr_id) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = wqe_timestamps_.find(qp_number);
+  if (iter == wqe_timestamps_.end()) {
+    return;
+  }
+  for (WqeTimestamps& stamp : iter->second) {
+    if ((stamp.wr_id == wr_id) && !stamp.first_tx_us.has_value()) {
+      stamp.first_tx_us = now_us_;
+      latency_stats_.queueing.record(now_us_ - stamp.post_us);
+      return;
+    }
+  }
+}
+
+void RdmaEngine::record_wqe_latency(const RdmaCqe& cqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = wqe_timestamps_.find(cqe.qp_number);
+  if (iter == wqe_timestamps_.end()) {
+    return;
+  }
+  // Send completions arrive in posting order, so the match is almost always the front
+  auto& stamps = iter->second;
+  auto stamp = std::find_if(stamps.begin(), stamps.end(), [&cqe](const WqeTimestamps& entry) {
+    return entry.wr_id == cqe.wr_id;
+  });
+  if (stamp == stamps.end()) {
+    return;
+  }
+  if (cqe.status == WqeStatus::Success) {
+    std::uint64_t latency_us = cqe.timestamp_us - stamp->post_us;
+    latency_stats_.completion.record(latency_us);
+    latency_stats_.by_opcode[static_cast<std::size_t>(stamp->opcode)].record(latency_us);
+    latency_stats_.by_qp[cqe.qp_number].record(latency_us);
+  }
+  stamps.erase(stamp);
+}
+
+void RdmaEngine::check_cq_event(RdmaCompletionQueue& cq) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!cq.should_notify()) {
+    return;
+  }
+  if (cq.event_due()) {
+    raise_cq_event(cq);
+    return;
   }
+
+  // The period runs from the first CQE the event is waiting on
+  std::uint16_t period_us = cq.moderation().cq_period_us;
+  if (period_us != 0) {
+    cq_event_deadlines_.try_emplace(cq.cq_number(), now_us_ + period_us);
+  }
+}
+
+void RdmaEngine::raise_cq_event(RdmaCompletionQueue& cq) {
+  NIC_TRACE_SCOPED(__func__);
+
+  RdmaCqEvent event;
+  event.cq_number = cq.cq_number();
+  event.comp_vector = cq.comp_vector();
+  event.cqes = cq.take_event();
+  cq_event_deadlines_.erase(event.cq_number);
+  cq_events_.push_back(event);
+  ++stats_.cq_events;
+  NIC_LOGF_DEBUG(
+      "CQ event: cq={} vector={} cqes={}", event.cq_number, event.comp_vector, event.cqes);
+
+  if (cq_event_handler_) {
+    cq_event_handler_(event);
+  }
+}
+
+void RdmaEngine::expire_cq_moderation() {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::vector<std::uint32_t> expired;
+  for (const auto& [cq_number, deadline_us] : cq_event_deadlines_) {
+    if (now_us_ >= deadline_us) {
+      expired.push_back(cq_number);
+    }
+  }
+
+  for (std::uint32_t cq_number : expired) {
+    cq_event_deadlines_.erase(cq_number);
+    auto iter = cqs_.find(cq_number);
+    if ((iter != cqs_.end()) && iter->second->should_notify()) {
+      raise_cq_event(*iter->second);
+      ++stats_.cq_event_timeouts;
+    }
+  }
+}
+
+std::optional<std::uint64_t> RdmaEngine::time_to_next_timer_us() const {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::optional<std::uint64_t> deadline_us;
+  auto consider = [&deadline_us](std::uint64_t candidate_us) {
+    deadline_us = std::min(deadline_us.value_or(candidate_us), candidate_us);
+  };
+  for (const auto& [cq_number, cq_deadline_us] : cq_event_deadlines_) {
+    consider(cq_deadline_us);
+  }
+  for (const auto& [qp_number, state] : rnr_states_) {
+    if (state.resend_psn.has_value()) {
+      consider(state.resume_us);
+    }
+  }
+  if (!deadline_us.has_value()) {
+    return std::nullopt;
+  }
+  return (*deadline_us > now_us_) ? (*deadline_us - now_us_) : 0;
+}
+
+bool RdmaEngine::has_traffic_in_flight() const {
+  NIC_TRACE_SCOPED(__func__);
+  return !outgoing_packets_.empty() || reliability_manager_.has_any_outstanding();
+}
+
+void RdmaEngine::check_srq_limit(const RdmaQueuePair& qp) {
+  NIC_TRACE_SCOPED(__func__);
+
+  RdmaSharedReceiveQueue* srq = qp.srq();
+  if ((srq == nullptr) || !srq->take_limit_event()) {
+    return;
+  }
+
+  RdmaAsyncEvent event;
+  event.type = AsyncEventType::SrqLimitReached;
+  event.srq_number = srq->srq_number();
+  event.qp_number = qp.qp_number();
+  async_events_.push_back(event);
+  ++stats_.async_events;
+  NIC_LOGF_DEBUG("SRQ limit reached: srq={} qp={} remaining={}",
+                 srq->srq_number(),
+                 qp.qp_number(),
+                 srq->count());
 }
 
 std::vector<OutgoingPacket> RdmaEngine::generate_outgoing_packets() {
@@ -613,22 +2411,139 @@ void RdmaEngine::advance_time(std::uint64_t elapsed_us) {
     return;
   }
 
+  now_us_ += elapsed_us;
   congestion_manager_.advance_time(elapsed_us);
+  resume_rnr_wqes();
+  expire_cq_moderation();
+
+  // Check for timeouts on the QPs with operations awaiting an ACK.
+  // Note: Actual retransmission would require re-fetching the original data.
+  // For now, we just track the timeout statistics.
+  reliability_manager_.check_all_timeouts(now_us_);
+
+  release_idle_state();
+}
+
+std::size_t RdmaEngine::release_idle_state() {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Only QPs used since they were last found idle can hold releasable state.
+  // A candidate that is still busy stays in the set until it goes idle.
+  std::size_t released = 0;
+  for (auto iter = idle_candidates_.begin(); iter != idle_candidates_.end();) {
+    auto qp_iter = qps_.find(*iter);
+    if (qp_iter == qps_.end()) {
+      iter = idle_candidates_.erase(iter);
+      continue;
+    }
+    RdmaQueuePair& qp = *qp_iter->second;
+    bool had_storage = qp.has_queue_storage();
+    bool idle = release_qp_idle_state(qp);
+    if (had_storage && !qp.has_queue_storage()) {
+      ++released;
+    }
+    iter = idle ? idle_candidates_.erase(iter) : std::next(iter);
+  }
+
+  stats_.idle_storage_releases += released;
+  return released;
+}
+
+bool RdmaEngine::release_qp_idle_state(RdmaQueuePair& qp) {
+  NIC_TRACE_SCOPED(__func__);
 
-  // Check for timeouts on all QPs
-  for (auto& [qp_number, qp] : qps_) {
-    auto retransmit_psns = reliability_manager_.check_timeouts(qp_number, elapsed_us);
-    // Note: Actual retransmission would require re-fetching the original data
-    // For now, we just track the timeout statistics
+  std::uint32_t qp_number = qp.qp_number();
+  bool idle = qp.release_idle_storage() || !qp.has_queue_storage();
+  idle = send_recv_processor_.release_idle_state(qp_number) && idle;
+  idle = write_processor_.release_idle_state(qp_number) && idle;
+  idle = read_processor_.release_idle_state(qp_number) && idle;
+  idle = reliability_manager_.release_idle_state(qp_number) && idle;
+
+  auto rnr_iter = rnr_states_.find(qp_number);
+  if (rnr_iter != rnr_states_.end()) {
+    const RnrState& state = rnr_iter->second;
+    if (state.held.empty() && !state.resend_psn.has_value() && state.consumers.empty()) {
+      rnr_states_.erase(rnr_iter);
+    } else {
+      idle = false;
+    }
+  }
+  // Parked WQEs are resumed without a new post, so the QP stays a candidate
+  if (odp_parked_.contains(qp_number)) {
+    idle = false;
+  }
+  auto stamp_iter = wqe_timestamps_.find(qp_number);
+  if (stamp_iter != wqe_timestamps_.end()) {
+    if (stamp_iter->second.empty()) {
+      wqe_timestamps_.erase(stamp_iter);
+    } else {
+      idle = false;
+    }
+  }
+  return idle;
+}
+
+RdmaMemoryFootprint RdmaEngine::memory_footprint() const {
+  NIC_TRACE_SCOPED(__func__);
+
+  RdmaMemoryFootprint footprint;
+  footprint.qp_count = qps_.size();
+  for (const auto& [qp_number, qp] : qps_) {
+    footprint.qp_bytes += sizeof(qp_number) + qp->memory_footprint();
+    if (qp->has_queue_storage()) {
+      ++footprint.qps_with_storage;
+    }
+  }
+  footprint.sq_ring_bytes = sq_rings_.size() * (sizeof(std::uint32_t) + sizeof(RdmaSendQueueRing));
+  footprint.protocol_bytes = send_recv_processor_.memory_footprint()
+                             + write_processor_.memory_footprint()
+                             + read_processor_.memory_footprint()
+                             + reliability_manager_.memory_footprint()
+                             + congestion_manager_.memory_footprint()
+                             + (qp_header_templates_.size() + ah_header_templates_.size())
+                                   * (sizeof(std::uint32_t) + sizeof(RoceHeaderTemplate))
+                             + src_port_states_.size()
+                                   * (sizeof(std::uint32_t) + sizeof(SrcPortState));
+  for (const auto& [qp_number, state] : rnr_states_) {
+    footprint.protocol_bytes += sizeof(qp_number) + sizeof(state)
+                                + (state.consumers.size() * sizeof(std::uint32_t));
+    for (const SendWqeRecord& record : state.held) {
+      footprint.protocol_bytes += sizeof(record) + record.heap_bytes();
+    }
+  }
+  for (const auto& [qp_number, parked] : odp_parked_) {
+    footprint.protocol_bytes += sizeof(qp_number) + sizeof(parked);
+    for (const SendWqeRecord& record : parked.wqes) {
+      footprint.protocol_bytes += sizeof(record) + record.heap_bytes();
+    }
+  }
+  for (const auto& [qp_number, histogram] : latency_stats_.by_qp) {
+    footprint.protocol_bytes += sizeof(qp_number) + sizeof(histogram) + histogram.heap_bytes();
   }
+  return footprint;
 }
 
 void RdmaEngine::reset() {
   NIC_TRACE_SCOPED(__func__);
 
   qps_.clear();
+  sq_rings_.clear();
   cqs_.clear();
+  srqs_.clear();
+  ahs_.clear();
   outgoing_packets_.clear();
+  async_events_.clear();
+  cq_events_.clear();
+  cq_event_deadlines_.clear();
+  odp_parked_.clear();
+  qp_header_templates_.clear();
+  ah_header_templates_.clear();
+  src_port_states_.clear();
+  rnr_states_.clear();
+  wqe_timestamps_.clear();
+  idle_candidates_.clear();
+  latency_stats_ = RdmaLatencyStats{};
+  now_us_ = 0;
   pd_table_.reset();
   mr_table_.reset();
   send_recv_processor_.reset();
@@ -637,8 +2552,11 @@ void RdmaEngine::reset() {
   read_processor_.reset();
   write_processor_.reset();
   stats_ = RdmaEngineStats{};
-  next_cq_number_ = 1;
-  next_qp_number_ = 1;
+  next_cq_number_ = config_.first_object_number;
+  next_srq_number_ = config_.first_object_number;
+  next_ah_handle_ = 1;
+  next_qp_number_ = config_.first_object_number;
+  free_qp_numbers_.clear();
   NIC_LOG_INFO("RDMA engine reset");
 }
 
@@ -0,0 +1,87 @@
+#include "nic/rocev2/latency.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include "nic/trace.h"
+
+namespace nic::rocev2 {
+
+std::size_t LatencyHistogram::bucket_index(std::uint64_t value) noexcept {
+  if (value < kSubBuckets) {
+    return static_cast<std::size_t>(value);
+  }
+  // Keep the top kSubBucketBits + 1 bits: mantissa in [kSubBuckets, 2 * kSubBuckets)
+  auto exponent = static_cast<unsigned>(std::bit_width(value)) - (kSubBucketBits + 1);
+  std::uint64_t mantissa = value >> exponent;
+  return static_cast<std::size_t>((exponent * kSubBuckets) + mantissa);
+}
+
+std::uint64_t LatencyHistogram::bucket_upper_bound(std::size_t index) noexcept {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  std::uint64_t exponent = (index / kSubBuckets) - 1;
+  std::uint64_t mantissa = (index % kSubBuckets) + kSubBuckets;
+  return ((mantissa + 1) << exponent) - 1;  // Wraps to the maximum for the top bucket
+}
+
+void LatencyHistogram::record(std::uint64_t value) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::size_t index = bucket_index(value);
+  if (index >= counts_.size()) {
+    counts_.resize(index + 1, 0);
+  }
+  ++counts_[index];
+  ++count_;
+  sum_ += value;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (other.counts_.size() > counts_.size()) {
+    counts_.resize(other.counts_.size(), 0);
+  }
+  for (std::size_t index = 0; index < other.counts_.size(); ++index) {
+    counts_[index] += other.counts_[index];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::reset() noexcept {
+  counts_.clear();
+  count_ = 0;
+  sum_ = 0;
+  min_ = std::numeric_limits<std::uint64_t>::max();
+  max_ = 0;
+}
+
+std::uint64_t LatencyHistogram::value_at_percentile(double percentile) const noexcept {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (count_ == 0) {
+    return 0;
+  }
+  double fraction = std::clamp(percentile, 0.0, 100.0) / 100.0;
+  auto target = static_cast<std::uint64_t>(std::ceil(fraction * static_cast<double>(count_)));
+  target = std::clamp<std::uint64_t>(target, 1, count_);
+
+  std::uint64_t seen = 0;
+  for (std::size_t index = 0; index < counts_.size(); ++index) {
+    seen += counts_[index];
+    if (seen >= target) {
+      return std::min(bucket_upper_bound(index), max_);
+    }
+  }
+  return max_;
+}
+
+}  // namespace nic::rocev2
@@ -72,6 +72,202 @@ bool MemoryRegionTable::deregister_mr(std::uint32_t lkey) {
   return true;
 }
 
+std::optional<std::uint32_t> MemoryRegionTable::allocate_fast_reg_mr(std::uint32_t pd_handle,
+                                                                     std::size_t max_length) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if ((mrs_by_lkey_.size() >= config_.max_mrs) || (max_length == 0)) {
+    ++stats_.registration_failures;
+    NIC_LOGF_WARNING("fast-reg MR allocation failed: pd={} max_len={}", pd_handle, max_length);
+    return std::nullopt;
+  }
+
+  std::uint32_t lkey = generate_key();
+  std::uint32_t rkey = generate_key();
+
+  auto mr = std::make_unique<MemoryRegion>();
+  mr->lkey = lkey;
+  mr->rkey = rkey;
+  mr->virtual_address = 0;
+  mr->length = 0;
+  mr->pd_handle = pd_handle;
+  mr->access = AccessFlags{};
+  mr->is_valid = false;
+  mr->fast_reg = true;
+  mr->max_length = max_length;
+
+  MemoryRegion* mr_ptr = mr.get();
+  mrs_by_lkey_.emplace(lkey, std::move(mr));
+  mrs_by_rkey_.emplace(rkey, mr_ptr);
+
+  ++stats_.registrations;
+  return lkey;
+}
+
+bool MemoryRegionTable::fast_register(std::uint32_t lkey,
+                                      std::uint32_t pd_handle,
+                                      HostAddress virtual_address,
+                                      std::size_t length,
+                                      AccessFlags access,
+                                      std::uint32_t new_rkey) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = mrs_by_lkey_.find(lkey);
+  if ((iter == mrs_by_lkey_.end()) || !iter->second->fast_reg) {
+    ++stats_.access_errors;
+    NIC_LOGF_WARNING("fast register failed: lkey={:#x} is not a fast-reg MR", lkey);
+    return false;
+  }
+
+  // A mapping must be invalidated before it is replaced
+  MemoryRegion& mr = *iter->second;
+  if (mr.is_valid || (mr.pd_handle != pd_handle) || (length == 0) || (length > mr.max_length)) {
+    ++stats_.access_errors;
+    NIC_LOGF_WARNING("fast register failed: lkey={:#x} valid={} pd={}/{} len={} max={}",
+                     lkey,
+                     mr.is_valid,
+                     mr.pd_handle,
+                     pd_handle,
+                     length,
+                     mr.max_length);
+    return false;
+  }
+
+  if ((new_rkey != 0) && !rekey(mr, new_rkey)) {
+    ++stats_.access_errors;
+    return false;
+  }
+
+  mr.virtual_address = virtual_address;
+  mr.length = length;
+  mr.access = access;
+  mr.is_valid = true;
+  ++stats_.fast_registrations;
+  return true;
+}
+
+bool MemoryRegionTable::invalidate(std::uint32_t rkey,
+                                   std::uint32_t pd_handle,
+                                   std::optional<std::uint32_t> qp_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  MemoryRegion* mr = nullptr;
+  if (auto iter = mrs_by_rkey_.find(rkey); iter != mrs_by_rkey_.end()) {
+    mr = iter->second;
+  } else if (auto lkey_iter = mrs_by_lkey_.find(rkey); lkey_iter != mrs_by_lkey_.end()) {
+    mr = lkey_iter->second.get();
+  }
+
+  // Only keys a work request can re-validate may be invalidated
+  if ((mr == nullptr) || (!mr->fast_reg && !mr->is_window) || (mr->pd_handle != pd_handle)
+      || !mr->is_valid) {
+    ++stats_.access_errors;
+    NIC_LOGF_WARNING("invalidate failed: key={:#x} pd={}", rkey, pd_handle);
+    return false;
+  }
+
+  if (mr->is_window && qp_number.has_value() && (mr->bound_qp != qp_number)) {
+    ++stats_.access_errors;
+    NIC_LOGF_WARNING("invalidate failed: window rkey={:#x} not bound to qp={}", rkey, *qp_number);
+    return false;
+  }
+
+  mr->is_valid = false;
+  mr->bound_qp.reset();
+  ++stats_.invalidations;
+  return true;
+}
+
+std::optional<std::uint32_t> MemoryRegionTable::allocate_mw(std::uint32_t pd_handle) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (windows_.size() >= config_.max_mrs) {
+    ++stats_.registration_failures;
+    NIC_LOGF_WARNING("MW allocation failed: table full ({}/{})", windows_.size(), config_.max_mrs);
+    return std::nullopt;
+  }
+
+  std::uint32_t handle = generate_key();
+  std::uint32_t rkey = generate_key();
+
+  auto window = std::make_unique<MemoryRegion>();
+  window->lkey = handle;
+  window->rkey = rkey;
+  window->virtual_address = 0;
+  window->length = 0;
+  window->pd_handle = pd_handle;
+  window->access = AccessFlags{};
+  window->is_valid = false;
+  window->is_window = true;
+
+  MemoryRegion* window_ptr = window.get();
+  windows_.emplace(handle, std::move(window));
+  mrs_by_rkey_.emplace(rkey, window_ptr);
+  return rkey;
+}
+
+bool MemoryRegionTable::deallocate_mw(std::uint32_t rkey) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = mrs_by_rkey_.find(rkey);
+  if ((iter == mrs_by_rkey_.end()) || !iter->second->is_window) {
+    return false;
+  }
+
+  std::uint32_t handle = iter->second->lkey;
+  mrs_by_rkey_.erase(iter);
+  windows_.erase(handle);
+  return true;
+}
+
+bool MemoryRegionTable::bind_mw(std::uint32_t rkey,
+                                std::uint32_t parent_lkey,
+                                std::uint32_t pd_handle,
+                                HostAddress virtual_address,
+                                std::size_t length,
+                                AccessFlags access,
+                                std::uint32_t qp_number,
+                                std::uint32_t new_rkey) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = mrs_by_rkey_.find(rkey);
+  if ((iter == mrs_by_rkey_.end()) || !iter->second->is_window) {
+    ++stats_.access_errors;
+    NIC_LOGF_WARNING("MW bind failed: rkey={:#x} is not a memory window", rkey);
+    return false;
+  }
+
+  // Type-2 windows are bound once, then invalidated before rebinding
+  MemoryRegion& window = *iter->second;
+  const MemoryRegion* parent = get_by_lkey(parent_lkey);
+  if (window.is_valid || (window.pd_handle != pd_handle) || (parent == nullptr)
+      || !parent->is_valid || !parent->access.mw_bind || (parent->pd_handle != pd_handle)
+      || (virtual_address < parent->virtual_address)
+      || ((virtual_address - parent->virtual_address) + length > parent->length)) {
+    ++stats_.access_errors;
+    NIC_LOGF_WARNING("MW bind failed: rkey={:#x} parent={:#x} addr={:#x} len={}",
+                     rkey,
+                     parent_lkey,
+                     virtual_address,
+                     length);
+    return false;
+  }
+
+  if ((new_rkey != 0) && !rekey(window, new_rkey)) {
+    ++stats_.access_errors;
+    return false;
+  }
+
+  window.virtual_address = virtual_address;
+  window.length = length;
+  window.access = access;
+  window.parent_lkey = parent_lkey;
+  window.bound_qp = qp_number;
+  window.is_valid = true;
+  ++stats_.window_binds;
+  return true;
+}
+
 bool MemoryRegionTable::validate_lkey(std::uint32_t lkey,
                                       HostAddress address,
                                       std::size_t length,
@@ -81,31 +277,124 @@ bool MemoryRegionTable::validate_lkey(std::uint32_t lkey,
   ++stats_.lkey_validations;
 
   const MemoryRegion* mr = get_by_lkey(lkey);
-  return validate_access(mr, address, length, is_write, false);
+  if (!validate_access(mr, address, length, is_write, false)) {
+    return false;
+  }
+  return !is_on_demand(*mr) || pages_present(address, length);
 }
 
 bool MemoryRegionTable::validate_rkey(std::uint32_t rkey,
                                       std::uint32_t pd_handle,
                                       HostAddress address,
                                       std::size_t length,
-                                      bool is_write) const {
+                                      bool is_write,
+                                      std::optional<std::uint32_t> qp_number) const {
   NIC_TRACE_SCOPED(__func__);
 
   ++stats_.rkey_validations;
 
-  const MemoryRegion* mr = get_by_rkey(rkey);
-  if (mr == nullptr) {
-    ++stats_.access_errors;
+  const MemoryRegion* mr = find_remote(rkey, pd_handle, qp_number);
+  if ((mr == nullptr) || !validate_access(mr, address, length, is_write, true)) {
     return false;
   }
+  return !is_on_demand(*mr) || pages_present(address, length);
+}
 
-  // Check PD match
-  if (mr->pd_handle != pd_handle) {
-    ++stats_.access_errors;
-    return false;
+MrAccessStatus MemoryRegionTable::access_lkey(std::uint32_t lkey,
+                                              HostAddress address,
+                                              std::size_t length,
+                                              bool is_write) {
+  NIC_TRACE_SCOPED(__func__);
+
+  ++stats_.lkey_validations;
+
+  const MemoryRegion* mr = get_by_lkey(lkey);
+  if (!validate_access(mr, address, length, is_write, false)) {
+    return MrAccessStatus::Denied;
   }
+  if (!is_on_demand(*mr) || pages_present(address, length)) {
+    return MrAccessStatus::Ok;
+  }
+  return fault_in(*mr, address, length, is_write, false);
+}
+
+MrAccessStatus MemoryRegionTable::access_rkey(std::uint32_t rkey,
+                                              std::uint32_t pd_handle,
+                                              HostAddress address,
+                                              std::size_t length,
+                                              bool is_write,
+                                              std::optional<std::uint32_t> qp_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  ++stats_.rkey_validations;
+
+  const MemoryRegion* mr = find_remote(rkey, pd_handle, qp_number);
+  if ((mr == nullptr) || !validate_access(mr, address, length, is_write, true)) {
+    return MrAccessStatus::Denied;
+  }
+  if (!is_on_demand(*mr) || pages_present(address, length)) {
+    return MrAccessStatus::Ok;
+  }
+  return fault_in(*mr, address, length, is_write, true);
+}
+
+std::size_t MemoryRegionTable::populate(HostAddress address, std::size_t length) {
+  NIC_TRACE_SCOPED(__func__);
 
-  return validate_access(mr, address, length, is_write, true);
+  std::size_t added = add_present_pages(address, length);
+  stats_.pages_populated += added;
+  return added;
+}
+
+std::optional<std::size_t> MemoryRegionTable::prefetch(std::uint32_t lkey,
+                                                       HostAddress address,
+                                                       std::size_t length) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Advice only makes sense for a range inside an ODP MR; permissions are checked at access time
+  const MemoryRegion* mr = get_by_lkey(lkey);
+  if ((mr == nullptr) || !mr->is_valid || !mr->access.on_demand
+      || (address < mr->virtual_address)
+      || ((address - mr->virtual_address) + length > mr->length)) {
+    NIC_LOGF_WARNING("prefetch failed: lkey={:#x} addr={:#x} len={}", lkey, address, length);
+    return std::nullopt;
+  }
+
+  std::size_t added = add_present_pages(address, length);
+  stats_.pages_prefetched += added;
+  return added;
+}
+
+std::size_t MemoryRegionTable::invalidate_range(HostAddress address, std::size_t length) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::size_t dropped = 0;
+  if (length == 0) {
+    return dropped;
+  }
+  std::uint64_t first_page = address / config_.odp_page_size;
+  std::uint64_t last_page = (address + length - 1) / config_.odp_page_size;
+  for (std::uint64_t page = first_page; page <= last_page; ++page) {
+    dropped += odp_present_pages_.erase(page);
+  }
+  stats_.pages_invalidated += dropped;
+  return dropped;
+}
+
+bool MemoryRegionTable::pages_present(HostAddress address, std::size_t length) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (length == 0) {
+    return true;
+  }
+  std::uint64_t first_page = address / config_.odp_page_size;
+  std::uint64_t last_page = (address + length - 1) / config_.odp_page_size;
+  for (std::uint64_t page = first_page; page <= last_page; ++page) {
+    if (!odp_present_pages_.contains(page)) {
+      return false;
+    }
+  }
+  return true;
 }
 
 const MemoryRegion* MemoryRegionTable::get_by_lkey(std::uint32_t lkey) const noexcept {
@@ -133,15 +422,133 @@ void MemoryRegionTable::reset() {
 
   mrs_by_rkey_.clear();
   mrs_by_lkey_.clear();
+  windows_.clear();
+  odp_present_pages_.clear();
   next_key_ = 0x100;
   stats_ = {};
 }
 
 std::uint32_t MemoryRegionTable::generate_key() {
   NIC_TRACE_SCOPED(__func__);
+
+  // RegMr/BindMw may install caller-chosen keys; never hand one out twice
+  while (mrs_by_lkey_.contains(next_key_) || mrs_by_rkey_.contains(next_key_)
+         || windows_.contains(next_key_) || (next_key_ == 0)) {
+    ++next_key_;
+  }
   return next_key_++;
 }
 
+bool MemoryRegionTable::rekey(MemoryRegion& mr, std::uint32_t new_rkey) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (new_rkey == mr.rkey) {
+    return true;
+  }
+  // Keys are unique across lkeys, rkeys and window handles
+  if ((new_rkey == 0) || mrs_by_rkey_.contains(new_rkey) || mrs_by_lkey_.contains(new_rkey)
+      || windows_.contains(new_rkey)) {
+    NIC_LOGF_WARNING("rekey failed: rkey={:#x} already in use", new_rkey);
+    return false;
+  }
+
+  mrs_by_rkey_.erase(mr.rkey);
+  mr.rkey = new_rkey;
+  mrs_by_rkey_.emplace(new_rkey, &mr);
+  return true;
+}
+
+const MemoryRegion* MemoryRegionTable::find_remote(std::uint32_t rkey,
+                                                   std::uint32_t pd_handle,
+                                                   std::optional<std::uint32_t> qp_number) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  const MemoryRegion* mr = get_by_rkey(rkey);
+  if (mr == nullptr) {
+    ++stats_.access_errors;
+    return nullptr;
+  }
+
+  // Check PD match
+  if (mr->pd_handle != pd_handle) {
+    ++stats_.access_errors;
+    return nullptr;
+  }
+
+  // A window is usable only from its QP, and only while its parent MR is
+  if (mr->is_window) {
+    const MemoryRegion* parent = get_by_lkey(mr->parent_lkey);
+    if ((mr->bound_qp != qp_number) || (parent == nullptr) || !parent->is_valid) {
+      ++stats_.access_errors;
+      return nullptr;
+    }
+  }
+  return mr;
+}
+
+std::size_t MemoryRegionTable::add_present_pages(HostAddress address, std::size_t length) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::size_t added = 0;
+  if (length == 0) {
+    return added;
+  }
+  std::uint64_t first_page = address / config_.odp_page_size;
+  std::uint64_t last_page = (address + length - 1) / config_.odp_page_size;
+  for (std::uint64_t page = first_page; page <= last_page; ++page) {
+    if (odp_present_pages_.insert(page).second) {
+      ++added;
+    }
+  }
+  return added;
+}
+
+bool MemoryRegionTable::is_on_demand(const MemoryRegion& mr) const noexcept {
+  if (!mr.is_window) {
+    return mr.access.on_demand;
+  }
+  auto iter = mrs_by_lkey_.find(mr.parent_lkey);
+  return (iter != mrs_by_lkey_.end()) && iter->second->access.on_demand;
+}
+
+MrAccessStatus MemoryRegionTable::fault_in(const MemoryRegion& mr,
+                                           HostAddress address,
+                                           std::size_t length,
+                                           bool is_write,
+                                           bool is_remote) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Report from the first missing page to the end of the access
+  HostAddress fault_address = address - (address % config_.odp_page_size);
+  while (odp_present_pages_.contains(fault_address / config_.odp_page_size)) {
+    fault_address += config_.odp_page_size;
+  }
+  HostAddress end = address + length;
+  std::size_t rounded_end = ((end + config_.odp_page_size - 1) / config_.odp_page_size)
+                            * config_.odp_page_size;
+
+  OdpPageFault fault{
+      .lkey = mr.is_window ? mr.parent_lkey : mr.lkey,
+      .address = fault_address,
+      .length = rounded_end - fault_address,
+      .is_write = is_write,
+      .is_remote = is_remote,
+  };
+  ++stats_.page_faults;
+  NIC_LOGF_DEBUG("ODP page fault: lkey={:#x} addr={:#x} len={} write={} remote={}",
+                 fault.lkey,
+                 fault.address,
+                 fault.length,
+                 is_write,
+                 is_remote);
+
+  // The handler may resolve the fault before returning
+  if (fault_handler_) {
+    fault_handler_(fault);
+  }
+  return pages_present(address, length) ? MrAccessStatus::Ok : MrAccessStatus::PageFault;
+}
+
 bool MemoryRegionTable::validate_access(const MemoryRegion* mr,
                                         HostAddress address,
                                         std::size_t length,
@@ -1,5 +1,6 @@
 #include "nic/rocev2/packet.h"
 
+#include <algorithm>
 #include <bit>
 #include <cstring>
 
@@ -149,17 +150,37 @@ RdmaPacketBuilder& RdmaPacketBuilder::set_syndrome(AethSyndrome syndrome) {
   return *this;
 }
 
+RdmaPacketBuilder& RdmaPacketBuilder::set_syndrome_value(std::uint8_t value) {
+  syndrome_value_ = value & 0x1F;
+  return *this;
+}
+
 RdmaPacketBuilder& RdmaPacketBuilder::set_msn(std::uint32_t msn) {
   msn_ = msn & 0x00FFFFFF;
   return *this;
 }
 
+RdmaPacketBuilder& RdmaPacketBuilder::set_qkey(std::uint32_t qkey) {
+  qkey_ = qkey;
+  return *this;
+}
+
+RdmaPacketBuilder& RdmaPacketBuilder::set_src_qp(std::uint32_t src_qp) {
+  src_qp_ = src_qp & 0x00FFFFFF;
+  return *this;
+}
+
 RdmaPacketBuilder& RdmaPacketBuilder::set_immediate(std::uint32_t imm) {
   immediate_ = imm;
   has_immediate_ = true;
   return *this;
 }
 
+RdmaPacketBuilder& RdmaPacketBuilder::set_invalidate_rkey(std::uint32_t rkey) {
+  invalidate_rkey_ = rkey;
+  return *this;
+}
+
 RdmaPacketBuilder& RdmaPacketBuilder::set_payload(std::span<const std::byte> data) {
   payload_.assign(data.begin(), data.end());
   return *this;
@@ -196,12 +217,28 @@ bool RdmaPacketBuilder::needs_aeth() const noexcept {
   }
 }
 
+bool RdmaPacketBuilder::needs_deth() const noexcept {
+  return opcode_is_ud(opcode_);
+}
+
 bool RdmaPacketBuilder::has_immediate_variant() const noexcept {
   switch (opcode_) {
     case RdmaOpcode::kRcSendLastImm:
     case RdmaOpcode::kRcSendOnlyImm:
     case RdmaOpcode::kRcWriteLastImm:
     case RdmaOpcode::kRcWriteOnlyImm:
+    case RdmaOpcode::kUdSendOnlyImm:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool RdmaPacketBuilder::needs_ieth() const noexcept {
+  // IETH is present in the last/only packet of a SEND with Invalidate
+  switch (opcode_) {
+    case RdmaOpcode::kRcSendLastInv:
+    case RdmaOpcode::kRcSendOnlyInv:
       return true;
     default:
       return false;
@@ -252,8 +289,19 @@ void RdmaPacketBuilder::write_aeth(std::span<std::byte> buffer) const {
 
   bit_fields::NetworkBitWriter writer(buffer);
   writer.serialize(kAethFormat,
-                   static_cast<std::uint64_t>(syndrome_),  // syndrome
-                   static_cast<std::uint64_t>(msn_)        // msn
+                   static_cast<std::uint64_t>(syndrome_) | syndrome_value_,  // syndrome
+                   static_cast<std::uint64_t>(msn_)                          // msn
+  );
+}
+
+void RdmaPacketBuilder::write_deth(std::span<std::byte> buffer) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  bit_fields::NetworkBitWriter writer(buffer);
+  writer.serialize(kDethFormat,
+                   static_cast<std::uint64_t>(qkey_),   // qkey
+                   0ULL,                                // _reserved
+                   static_cast<std::uint64_t>(src_qp_)  // src_qp
   );
 }
 
@@ -266,6 +314,15 @@ void RdmaPacketBuilder::write_immediate(std::span<std::byte> buffer) const {
   );
 }
 
+void RdmaPacketBuilder::write_ieth(std::span<std::byte> buffer) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  bit_fields::NetworkBitWriter writer(buffer);
+  writer.serialize(kIethFormat,
+                   static_cast<std::uint64_t>(invalidate_rkey_)  // rkey
+  );
+}
+
 std::vector<std::byte> RdmaPacketBuilder::build() {
   NIC_TRACE_SCOPED(__func__);
 
@@ -277,9 +334,15 @@ std::vector<std::byte> RdmaPacketBuilder::build() {
   if (needs_aeth()) {
     total_size += kAethSize;
   }
+  if (needs_deth()) {
+    total_size += kDethSize;
+  }
   if (has_immediate_ && has_immediate_variant()) {
     total_size += kImmSize;
   }
+  if (needs_ieth()) {
+    total_size += kIethSize;
+  }
   total_size += payload_.size();
   total_size += kIcrcSize;
 
@@ -302,12 +365,24 @@ std::vector<std::byte> RdmaPacketBuilder::build() {
     offset += kAethSize;
   }
 
+  // Write DETH if needed
+  if (needs_deth()) {
+    write_deth(std::span<std::byte>(packet).subspan(offset, kDethSize));
+    offset += kDethSize;
+  }
+
   // Write immediate data if present
   if (has_immediate_ && has_immediate_variant()) {
     write_immediate(std::span<std::byte>(packet).subspan(offset, kImmSize));
     offset += kImmSize;
   }
 
+  // Write IETH if needed
+  if (needs_ieth()) {
+    write_ieth(std::span<std::byte>(packet).subspan(offset, kIethSize));
+    offset += kIethSize;
+  }
+
   // Write payload
   if (!payload_.empty()) {
     std::copy(
@@ -363,11 +438,27 @@ bool RdmaPacketParser::parse(std::span<const std::byte> data) {
     }
     bit_fields::NetworkBitReader aeth_reader(data.subspan(offset, kAethSize));
     auto aeth_parsed = aeth_reader.deserialize(kAethFormat);
-    aeth_.syndrome = static_cast<AethSyndrome>(aeth_parsed.get("syndrome"));
+    // ACKs and RNR NAKs carry a value in the low 5 bits; other NAKs use the whole byte
+    auto syndrome = static_cast<std::uint8_t>(aeth_parsed.get("syndrome"));
+    bool is_nak_code = (syndrome & 0x60) == 0x60;
+    aeth_.syndrome = static_cast<AethSyndrome>(is_nak_code ? syndrome : (syndrome & 0xE0));
+    aeth_.syndrome_value = is_nak_code ? 0 : static_cast<std::uint8_t>(syndrome & 0x1F);
     aeth_.msn = static_cast<std::uint32_t>(aeth_parsed.get("msn"));
     offset += kAethSize;
   }
 
+  // Parse DETH if expected
+  if (has_deth_) {
+    if (offset + kDethSize > data.size() - kIcrcSize) {
+      return false;
+    }
+    bit_fields::NetworkBitReader deth_reader(data.subspan(offset, kDethSize));
+    auto deth_parsed = deth_reader.deserialize(kDethFormat);
+    deth_.qkey = static_cast<std::uint32_t>(deth_parsed.get("qkey"));
+    deth_.src_qp = static_cast<std::uint32_t>(deth_parsed.get("src_qp"));
+    offset += kDethSize;
+  }
+
   // Parse immediate data if expected
   if (has_immediate_) {
     if (offset + kImmSize > data.size() - kIcrcSize) {
@@ -379,6 +470,17 @@ bool RdmaPacketParser::parse(std::span<const std::byte> data) {
     offset += kImmSize;
   }
 
+  // Parse IETH if expected
+  if (has_ieth_) {
+    if (offset + kIethSize > data.size() - kIcrcSize) {
+      return false;
+    }
+    bit_fields::NetworkBitReader ieth_reader(data.subspan(offset, kIethSize));
+    auto ieth_parsed = ieth_reader.deserialize(kIethFormat);
+    invalidate_rkey_ = static_cast<std::uint32_t>(ieth_parsed.get("rkey"));
+    offset += kIethSize;
+  }
+
   // Remaining data (excluding ICRC) is payload
   std::size_t payload_end = data.size() - kIcrcSize;
   if (offset < payload_end) {
@@ -424,7 +526,9 @@ void RdmaPacketParser::determine_headers() {
 
   has_reth_ = false;
   has_aeth_ = false;
+  has_deth_ = false;
   has_immediate_ = false;
+  has_ieth_ = false;
 
   switch (bth_.opcode) {
     case RdmaOpcode::kRcWriteFirst:
@@ -444,10 +548,24 @@ void RdmaPacketParser::determine_headers() {
       has_immediate_ = true;
       break;
 
+    case RdmaOpcode::kRcSendLastInv:
+    case RdmaOpcode::kRcSendOnlyInv:
+      has_ieth_ = true;
+      break;
+
     case RdmaOpcode::kRcAck:
       has_aeth_ = true;
       break;
 
+    case RdmaOpcode::kUdSendOnly:
+      has_deth_ = true;
+      break;
+
+    case RdmaOpcode::kUdSendOnlyImm:
+      has_deth_ = true;
+      has_immediate_ = true;
+      break;
+
     case RdmaOpcode::kRcReadResponseFirst:
     case RdmaOpcode::kRcReadResponseLast:
     case RdmaOpcode::kRcReadResponseOnly:
@@ -494,6 +612,7 @@ bool opcode_is_last(RdmaOpcode op) noexcept {
   switch (op) {
     case RdmaOpcode::kRcSendLast:
     case RdmaOpcode::kRcSendLastImm:
+    case RdmaOpcode::kRcSendLastInv:
     case RdmaOpcode::kRcWriteLast:
     case RdmaOpcode::kRcWriteLastImm:
     case RdmaOpcode::kRcReadResponseLast:
@@ -507,9 +626,12 @@ bool opcode_is_only(RdmaOpcode op) noexcept {
   switch (op) {
     case RdmaOpcode::kRcSendOnly:
     case RdmaOpcode::kRcSendOnlyImm:
+    case RdmaOpcode::kRcSendOnlyInv:
     case RdmaOpcode::kRcWriteOnly:
     case RdmaOpcode::kRcWriteOnlyImm:
     case RdmaOpcode::kRcReadResponseOnly:
+    case RdmaOpcode::kUdSendOnly:
+    case RdmaOpcode::kUdSendOnlyImm:
       return true;
     default:
       return false;
@@ -539,4 +661,48 @@ bool opcode_is_read_response(RdmaOpcode op) noexcept {
   }
 }
 
+bool opcode_is_ud(RdmaOpcode op) noexcept {
+  switch (op) {
+    case RdmaOpcode::kUdSendOnly:
+    case RdmaOpcode::kUdSendOnlyImm:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// =============================================================================
+// AETH value encodings
+// =============================================================================
+
+namespace {
+
+// Wait of each RNR timer code in microseconds (IBA table 45)
+constexpr std::array<std::uint64_t, 32> kRnrTimerUs = {
+    655360, 10, 20, 30, 40, 60, 80, 120, 160, 240, 320, 480, 640, 960, 1280, 1920, 2560, 3840, 5120,
+    7680, 10240, 15360, 20480, 30720, 40960, 61440, 81920, 122880, 163840, 245760, 327680, 491520};
+
+// Credit counts of codes 0-30; code 31 (kAethCreditsInvalid) carries no count
+constexpr std::array<std::uint32_t, 31> kAethCredits = {
+    0, 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048,
+    3072, 4096, 6144, 8192, 12288, 16384, 24576, 32768};
+
+}  // namespace
+
+std::uint64_t rnr_timer_us(std::uint8_t code) noexcept {
+  return kRnrTimerUs[code & 0x1F];
+}
+
+std::uint8_t encode_aeth_credits(std::size_t recv_wqes) noexcept {
+  auto iter = std::upper_bound(kAethCredits.begin(), kAethCredits.end(), recv_wqes);
+  return static_cast<std::uint8_t>(std::distance(kAethCredits.begin(), iter) - 1);
+}
+
+std::optional<std::uint32_t> decode_aeth_credits(std::uint8_t code) noexcept {
+  if ((code & 0x1F) == kAethCreditsInvalid) {
+    return std::nullopt;
+  }
+  return kAethCredits[code & 0x1F];
+}
+
 }  // namespace nic::rocev2
@@ -30,6 +30,10 @@ bool PdTable::deallocate(std::uint32_t pd_handle) {
   if (iter == pds_.end()) {
     return false;
   }
+  if (iter->second->ref_count() != 0) {
+    ++stats_.busy_deallocations;
+    return false;
+  }
 
   pds_.erase(iter);
   ++stats_.deallocations;
@@ -1,6 +1,7 @@
 #include "nic/rocev2/queue_pair.h"
 
 #include <algorithm>
+#include <utility>
 
 namespace nic::rocev2 {
 
@@ -41,6 +42,9 @@ bool RdmaQueuePair::modify(const RdmaQpModifyParams& params) {
   if (params.path_mtu.has_value()) {
     path_mtu_ = params.path_mtu.value();
   }
+  if (params.qkey.has_value()) {
+    qkey_ = params.qkey.value();
+  }
 
   return true;
 }
@@ -53,7 +57,7 @@ bool RdmaQueuePair::post_send(const SendWqe& wqe) {
     return false;
   }
 
-  send_queue_.push_back(wqe);
+  queues().send_queue.push_back(wqe);
   ++stats_.send_wqes_posted;
   return true;
 }
@@ -66,7 +70,7 @@ bool RdmaQueuePair::post_recv(const RecvWqe& wqe) {
     return false;
   }
 
-  recv_queue_.push_back(wqe);
+  queues().recv_queue.push_back(wqe);
   ++stats_.recv_wqes_posted;
   return true;
 }
@@ -74,24 +78,32 @@ bool RdmaQueuePair::post_recv(const RecvWqe& wqe) {
 std::optional<SendWqe> RdmaQueuePair::get_next_send() {
   NIC_TRACE_SCOPED(__func__);
 
-  if (!can_send() || send_queue_.empty()) {
+  if (!can_send() || (send_queue_size() == 0)) {
     return std::nullopt;
   }
 
-  SendWqe wqe = send_queue_.front();
-  send_queue_.pop_front();
+  SendWqe wqe = std::move(queues_->send_queue.front());
+  queues_->send_queue.pop_front();
   return wqe;
 }
 
 std::optional<RecvWqe> RdmaQueuePair::consume_recv() {
   NIC_TRACE_SCOPED(__func__);
 
-  if (!can_receive() || recv_queue_.empty()) {
+  if (!can_receive()) {
+    return std::nullopt;
+  }
+
+  if (srq_ != nullptr) {
+    return srq_->consume_recv();
+  }
+
+  if (recv_queue_size() == 0) {
     return std::nullopt;
   }
 
-  RecvWqe wqe = recv_queue_.front();
-  recv_queue_.pop_front();
+  RecvWqe wqe = std::move(queues_->recv_queue.front());
+  queues_->recv_queue.pop_front();
   return wqe;
 }
 
@@ -112,14 +124,14 @@ void RdmaQueuePair::handle_ack(std::uint32_t acked_psn, AethSyndrome syndrome) {
 
   if (syndrome == AethSyndrome::Ack) {
     // Normal ACK - remove all pending operations up to acked_psn
-    while (!pending_operations_.empty()) {
-      const auto& front = pending_operations_.front();
+    while (pending_count() != 0) {
+      const auto& front = queues_->pending_operations.front();
       std::uint32_t op_last_psn = advance_psn(front.psn, front.num_packets - 1);
 
       // Check if this operation is fully acknowledged
       if (psn_in_window(op_last_psn, last_acked_psn_, acked_psn - last_acked_psn_ + 1)) {
         ++stats_.send_completions;
-        pending_operations_.pop_front();
+        queues_->pending_operations.pop_front();
       } else {
         break;
       }
@@ -142,26 +154,47 @@ void RdmaQueuePair::handle_ack(std::uint32_t acked_psn, AethSyndrome syndrome) {
   }
 }
 
-void RdmaQueuePair::add_pending_operation(const SendWqe& wqe, std::uint32_t num_packets) {
+void RdmaQueuePair::add_pending_operation(const SendWqe& wqe,
+                                          std::uint32_t num_packets,
+                                          std::optional<std::uint32_t> start_psn) {
   NIC_TRACE_SCOPED(__func__);
 
   PendingOperation op{
-      .wqe = wqe,
-      .psn = sq_psn_,
+      .wqe = make_wqe_record(wqe),
+      .psn = start_psn.value_or(sq_psn_),
       .num_packets = num_packets,
       .timestamp_us = current_time_us_,
       .retry_count = static_cast<std::uint8_t>(config_.retry_count),
   };
-  pending_operations_.push_back(op);
+  queues().pending_operations.push_back(std::move(op));
 }
 
-std::vector<SendWqe> RdmaQueuePair::check_timeouts(std::uint64_t current_time_us) {
+std::vector<PendingOperation> RdmaQueuePair::take_pending_from(std::uint32_t psn) {
   NIC_TRACE_SCOPED(__func__);
 
-  std::vector<SendWqe> retransmits;
+  std::vector<PendingOperation> taken;
+  if (queues_ == nullptr) {
+    return taken;
+  }
+  auto& pending = queues_->pending_operations;
+  auto first = std::find_if(pending.begin(), pending.end(), [psn](const PendingOperation& op) {
+    return psn_in_window(psn, op.psn, op.num_packets);
+  });
+  taken.assign(std::make_move_iterator(first), std::make_move_iterator(pending.end()));
+  pending.erase(first, pending.end());
+  return taken;
+}
+
+std::vector<SendWqeRecord> RdmaQueuePair::check_timeouts(std::uint64_t current_time_us) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::vector<SendWqeRecord> retransmits;
+  if (queues_ == nullptr) {
+    return retransmits;
+  }
   std::uint64_t timeout = timeout_us();
 
-  for (auto& op : pending_operations_) {
+  for (auto& op : queues_->pending_operations) {
     if (current_time_us - op.timestamp_us >= timeout) {
       if (op.retry_count > 0) {
         --op.retry_count;
@@ -185,16 +218,16 @@ void RdmaQueuePair::advance_time(std::uint64_t elapsed_us) {
   current_time_us_ += elapsed_us;
 }
 
-std::uint32_t RdmaQueuePair::next_send_psn() {
+std::uint32_t RdmaQueuePair::next_send_psn(std::uint32_t count) {
   NIC_TRACE_SCOPED(__func__);
   std::uint32_t current = sq_psn_;
-  sq_psn_ = advance_psn(sq_psn_);
+  sq_psn_ = advance_psn(sq_psn_, count);
   return current;
 }
 
-void RdmaQueuePair::advance_recv_psn() {
+void RdmaQueuePair::advance_recv_psn(std::uint32_t count) {
   NIC_TRACE_SCOPED(__func__);
-  rq_psn_ = advance_psn(rq_psn_);
+  rq_psn_ = advance_psn(rq_psn_, count);
 }
 
 std::uint32_t RdmaQueuePair::mtu_bytes() const noexcept {
@@ -221,30 +254,83 @@ void RdmaQueuePair::reset() {
   dest_qp_number_ = 0;
   dest_ip_ = {};
   dest_port_ = kRoceUdpPort;
+  qkey_ = 0;
   sq_psn_ = 0;
   rq_psn_ = 0;
   last_acked_psn_ = 0;
-  send_queue_.clear();
-  recv_queue_.clear();
-  pending_operations_.clear();
+  unsignaled_run_ = 0;
+  queues_.reset();
   current_time_us_ = 0;
   stats_ = RdmaQpStats{};
 }
 
+bool RdmaQueuePair::violates_signal_interval(bool signaled) const noexcept {
+  if (signaled || (config_.sq_signal_interval == 0)) {
+    return false;
+  }
+  return (unsignaled_run_ + 1) >= config_.sq_signal_interval;
+}
+
+void RdmaQueuePair::record_send_signaling(bool signaled) noexcept {
+  unsignaled_run_ = signaled ? 0 : (unsignaled_run_ + 1);
+}
+
 bool RdmaQueuePair::can_post_send() const noexcept {
   // Can post send in Init, RTR, or RTS states (but only execute in RTS)
   if ((state_ != QpState::Init) && (state_ != QpState::Rtr) && (state_ != QpState::Rts)) {
     return false;
   }
-  return send_queue_.size() < config_.send_queue_depth;
+  return send_queue_size() < config_.send_queue_depth;
 }
 
 bool RdmaQueuePair::can_post_recv() const noexcept {
+  // Receive WQEs for SRQ-attached QPs are posted to the SRQ instead
+  if (srq_ != nullptr) {
+    return false;
+  }
+
   // Can post recv in Init, RTR, or RTS states
   if ((state_ != QpState::Init) && (state_ != QpState::Rtr) && (state_ != QpState::Rts)) {
     return false;
   }
-  return recv_queue_.size() < config_.recv_queue_depth;
+  return recv_queue_size() < config_.recv_queue_depth;
+}
+
+bool RdmaQueuePair::release_idle_storage() noexcept {
+  if ((queues_ == nullptr) || (send_queue_size() != 0) || (recv_queue_size() != 0)
+      || (pending_count() != 0)) {
+    return false;
+  }
+  queues_.reset();
+  return true;
+}
+
+std::size_t RdmaQueuePair::memory_footprint() const noexcept {
+  std::size_t bytes = sizeof(*this);
+  if (queues_ == nullptr) {
+    return bytes;
+  }
+
+  bytes += sizeof(QueueStorage);
+  for (const SendWqe& wqe : queues_->send_queue) {
+    bytes += sizeof(wqe) + wqe.sgl.heap_bytes();
+  }
+  for (const RecvWqe& wqe : queues_->recv_queue) {
+    bytes += sizeof(wqe) + wqe.sgl.heap_bytes();
+  }
+  for (const PendingOperation& op : queues_->pending_operations) {
+    bytes += sizeof(op) + op.wqe.heap_bytes();
+  }
+  return bytes;
+}
+
+RdmaQueuePair::QueueStorage& RdmaQueuePair::queues() {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (queues_ == nullptr) {
+    queues_ = std::make_unique<QueueStorage>();
+  }
+  return *queues_;
 }
 
 bool RdmaQueuePair::is_valid_transition(QpState from, QpState to) const {
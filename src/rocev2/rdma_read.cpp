@@ -29,8 +29,12 @@ std::vector<std::vector<std::byte>> ReadProcessor::generate_read_request(RdmaQue
                  wqe.rkey,
                  wqe.total_length);
 
-  // Get the PSN for this request (only call next_send_psn once!)
-  std::uint32_t request_psn = qp.next_send_psn();
+  // Responses are numbered from the request PSN, one per MTU of data, so the
+  // request reserves that many PSNs and the next message starts after them
+  std::uint32_t mtu = qp.mtu_bytes();
+  std::uint32_t num_responses =
+      (wqe.total_length == 0) ? 1 : ((wqe.total_length + mtu - 1) / mtu);
+  std::uint32_t request_psn = qp.next_send_psn(num_responses);
 
   // Create request state to track the outstanding read
   ReadRequestState& req_state = request_states_[qp.qp_number()];
@@ -40,11 +44,10 @@ std::vector<std::vector<std::byte>> ReadProcessor::generate_read_request(RdmaQue
   req_state.total_length = wqe.total_length;
   req_state.bytes_received = 0;
   req_state.start_psn = request_psn;
-  req_state.expected_psn = request_psn;  // Response starts at same PSN
   req_state.sgl = wqe.sgl;
-  req_state.current_sge_idx = 0;
-  req_state.sge_offset = 0;
   req_state.in_progress = true;
+  req_state.responses = PsnBitmap(request_psn, num_responses);
+  req_state.signaled = wqe.signaled;
 
   // Build READ_REQUEST packet with RETH
   RdmaPacketBuilder builder;
@@ -60,7 +63,7 @@ std::vector<std::vector<std::byte>> ReadProcessor::generate_read_request(RdmaQue
   ++stats_.read_requests_generated;
 
   // Add pending operation for reliability
-  qp.add_pending_operation(wqe, 1);
+  qp.add_pending_operation(wqe, num_responses, request_psn);
   qp.record_packet_sent(packets.back().size());
 
   return packets;
@@ -106,9 +109,21 @@ ReadRequestResult ReadProcessor::process_read_request(RdmaQueuePair& qp,
 
   const RethFields& reth = parser.reth();
 
-  // Validate rkey for remote read access
-  if (!mr_table_.validate_rkey(
-          reth.rkey, qp.pd_handle(), reth.virtual_address, reth.dma_length, false)) {
+  // Validate rkey for remote read access; a non-present ODP page is RNR-NAKed until populated
+  MrAccessStatus access = mr_table_.access_rkey(
+      reth.rkey, qp.pd_handle(), reth.virtual_address, reth.dma_length, false, qp.qp_number());
+  if (access == MrAccessStatus::PageFault) {
+    result.syndrome = AethSyndrome::RnrNak;
+    result.needs_nak = true;
+    result.nak_psn = bth.psn;
+    ++stats_.page_fault_naks;
+    NIC_LOGF_DEBUG("read page fault: qp={} addr={:#x} len={}",
+                   qp.qp_number(),
+                   reth.virtual_address,
+                   reth.dma_length);
+    return result;
+  }
+  if (access != MrAccessStatus::Ok) {
     result.syndrome = AethSyndrome::RemoteAccessError;
     result.needs_nak = true;
     result.nak_psn = bth.psn;
@@ -121,8 +136,11 @@ ReadRequestResult ReadProcessor::process_read_request(RdmaQueuePair& qp,
     return result;
   }
 
-  // Advance QP's expected PSN for the request
-  qp.advance_recv_psn();
+  // Advance QP's expected PSN past every response PSN the request covers
+  std::uint32_t mtu = qp.mtu_bytes();
+  std::uint32_t num_responses =
+      (reth.dma_length == 0) ? 1 : ((reth.dma_length + mtu - 1) / mtu);
+  qp.advance_recv_psn(num_responses);
 
   // Generate response packets
   result.response_packets =
@@ -174,10 +192,28 @@ ReadResponseResult ReadProcessor::process_read_response(RdmaQueuePair& qp,
   }
 
   ReadRequestState& req_state = req_iter->second;
+  result.request_psn = req_state.start_psn;
+  result.last_psn = advance_psn(req_state.start_psn,
+                                static_cast<std::uint32_t>(req_state.responses.size()) - 1);
+
+  // Each response lands at its own offset, so responses may arrive in any order
+  if (!req_state.responses.contains(bth.psn)) {
+    ++stats_.sequence_errors;
+    NIC_LOGF_WARNING("read response PSN out of range: qp={} psn={} first={} count={}",
+                     qp.qp_number(),
+                     bth.psn,
+                     req_state.start_psn,
+                     req_state.responses.size());
+    return result;
+  }
+  if (req_state.responses.test(bth.psn)) {
+    ++stats_.duplicate_responses;
+    result.success = true;
+    return result;
+  }
 
   bool is_first = opcode_is_first(bth.opcode);
   bool is_only = opcode_is_only(bth.opcode);
-  bool is_last = opcode_is_last(bth.opcode);
 
   // AETH is present in READ_RESPONSE (first and only packets)
   if (is_first || is_only) {
@@ -203,13 +239,12 @@ ReadResponseResult ReadProcessor::process_read_response(RdmaQueuePair& qp,
     }
   }
 
-  // Write payload to local buffer using SGL
+  // Write payload to its offset in the local buffer
   std::span<const std::byte> payload = parser.payload();
-  std::size_t bytes_written = write_to_sgl(req_state.sgl,
-                                           payload,
-                                           req_state.current_sge_idx,
-                                           req_state.sge_offset,
-                                           req_state.local_lkey);
+  std::uint32_t index = (bth.psn - req_state.start_psn) & kMaxPsn;
+  std::size_t offset = static_cast<std::size_t>(index) * qp.mtu_bytes();
+  std::size_t bytes_written =
+      write_to_sgl(req_state.sgl, offset, payload, req_state.local_lkey);
 
   if (bytes_written != payload.size()) {
     // Local access error
@@ -232,32 +267,32 @@ ReadResponseResult ReadProcessor::process_read_response(RdmaQueuePair& qp,
     return result;
   }
 
+  if ((index != 0) && !req_state.responses.test(advance_psn(bth.psn, kMaxPsn))) {
+    ++stats_.out_of_order_responses;  // Its predecessor has not arrived yet
+  }
+  req_state.responses.set(bth.psn);
   req_state.bytes_received += static_cast<std::uint32_t>(bytes_written);
-  req_state.expected_psn = advance_psn(bth.psn);
   stats_.bytes_read += bytes_written;
   ++stats_.read_responses_processed;
   qp.record_packet_received(bytes_written);
 
-  // Handle read completion
-  if (is_last || is_only) {
+  // The READ completes once every response has been placed, whichever arrived last
+  if (req_state.responses.full()) {
     result.is_read_complete = true;
     req_state.in_progress = false;
     ++stats_.reads_completed;
-    NIC_LOGF_DEBUG("read complete: qp={} wr_id={} bytes={}",
-                   qp.qp_number(),
-                   req_state.wr_id,
-                   req_state.bytes_received);
-
-    // Generate success CQE
-    RdmaCqe cqe;
-    cqe.wr_id = req_state.wr_id;
-    cqe.status = WqeStatus::Success;
-    cqe.opcode = WqeOpcode::RdmaRead;
-    cqe.qp_number = qp.qp_number();
-    cqe.bytes_completed = req_state.bytes_received;
-    cqe.is_send = true;
 
-    result.cqe = cqe;
+    // Generate success CQE (unsignaled READs retire silently)
+    if (req_state.signaled) {
+      RdmaCqe cqe;
+      cqe.wr_id = req_state.wr_id;
+      cqe.status = WqeStatus::Success;
+      cqe.opcode = WqeOpcode::RdmaRead;
+      cqe.qp_number = qp.qp_number();
+      cqe.bytes_completed = req_state.bytes_received;
+      cqe.is_send = true;
+      result.cqe = cqe;
+    }
     NIC_LOGF_DEBUG("read complete: qp={} wr_id={} bytes={}",
                    qp.qp_number(),
                    req_state.wr_id,
@@ -281,16 +316,49 @@ void ReadProcessor::clear_read_state(std::uint32_t qp_number) {
   responder_states_.erase(qp_number);
 }
 
+bool ReadProcessor::release_idle_state(std::uint32_t qp_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  bool idle = true;
+  auto request_iter = request_states_.find(qp_number);
+  if (request_iter != request_states_.end()) {
+    if (request_iter->second.in_progress) {
+      idle = false;
+    } else {
+      request_states_.erase(request_iter);
+    }
+  }
+  auto responder_iter = responder_states_.find(qp_number);
+  if (responder_iter != responder_states_.end()) {
+    if (responder_iter->second.in_progress) {
+      idle = false;
+    } else {
+      responder_states_.erase(responder_iter);
+    }
+  }
+  return idle;
+}
+
+std::size_t ReadProcessor::memory_footprint() const noexcept {
+  std::size_t bytes = responder_states_.size() * sizeof(decltype(responder_states_)::value_type);
+  for (const auto& [qp_number, state] : request_states_) {
+    bytes += sizeof(qp_number) + sizeof(state) + state.sgl.heap_bytes()
+             + state.responses.heap_bytes();
+  }
+  return bytes;
+}
+
 std::vector<std::byte> ReadProcessor::read_from_remote(std::uint64_t address,
                                                        std::uint32_t rkey,
                                                        std::uint32_t pd_handle,
+                                                       std::uint32_t qp_number,
                                                        std::size_t length) {
   NIC_TRACE_SCOPED(__func__);
 
   std::vector<std::byte> data;
 
   // Validate rkey for read access
-  if (!mr_table_.validate_rkey(rkey, pd_handle, address, length, false)) {
+  if (!mr_table_.validate_rkey(rkey, pd_handle, address, length, false, qp_number)) {
     return data;
   }
 
@@ -304,13 +372,20 @@ std::vector<std::byte> ReadProcessor::read_from_remote(std::uint64_t address,
   return data;
 }
 
-std::size_t ReadProcessor::write_to_sgl(const std::vector<SglEntry>& sgl,
+std::size_t ReadProcessor::write_to_sgl(std::span<const SglEntry> sgl,
+                                        std::size_t offset,
                                         std::span<const std::byte> data,
-                                        std::size_t& sge_idx,
-                                        std::size_t& sge_offset,
                                         std::uint32_t lkey) {
   NIC_TRACE_SCOPED(__func__);
 
+  // Find the SGE holding the offset
+  std::size_t sge_idx = 0;
+  while ((sge_idx < sgl.size()) && (offset >= sgl[sge_idx].length)) {
+    offset -= sgl[sge_idx].length;
+    ++sge_idx;
+  }
+  std::size_t sge_offset = offset;
+
   std::size_t total_written = 0;
   std::size_t data_offset = 0;
 
@@ -337,13 +412,10 @@ std::size_t ReadProcessor::write_to_sgl(const std::vector<SglEntry>& sgl,
 
     total_written += to_write;
     data_offset += to_write;
-    sge_offset += to_write;
 
-    // Move to next SGE if current is full
-    if (sge_offset >= entry.length) {
-      ++sge_idx;
-      sge_offset = 0;
-    }
+    // Continue at the start of the next SGE
+    ++sge_idx;
+    sge_offset = 0;
   }
 
   return total_written;
@@ -354,13 +426,13 @@ std::vector<std::vector<std::byte>> ReadProcessor::generate_read_responses(
     std::uint64_t address,
     std::uint32_t rkey,
     std::uint32_t length,
-    std::uint32_t /* request_psn */) {
+    std::uint32_t request_psn) {
   NIC_TRACE_SCOPED(__func__);
 
   std::vector<std::vector<std::byte>> packets;
 
   // Read data from remote memory
-  std::vector<std::byte> data = read_from_remote(address, rkey, qp.pd_handle(), length);
+  std::vector<std::byte> data = read_from_remote(address, rkey, qp.pd_handle(), qp.qp_number(), length);
   if (data.size() != length) {
     // Read failed - would generate NAK, but that's handled in process_read_request
     return packets;
@@ -374,7 +446,7 @@ std::vector<std::vector<std::byte>> ReadProcessor::generate_read_responses(
     RdmaPacketBuilder builder;
     builder.set_opcode(RdmaOpcode::kRcReadResponseOnly)
         .set_dest_qp(qp.dest_qp_number())
-        .set_psn(qp.next_send_psn())
+        .set_psn(request_psn)
         .set_ack_request(false)
         .set_syndrome(AethSyndrome::Ack)
         .set_msn(0);
@@ -386,7 +458,8 @@ std::vector<std::vector<std::byte>> ReadProcessor::generate_read_responses(
     return packets;
   }
 
-  // Generate response packets with MTU segmentation
+  // Generate response packets with MTU segmentation; response i carries request_psn + i,
+  // so the requester can place each one by its PSN alone
   std::size_t offset = 0;
   for (std::uint32_t pkt_idx = 0; pkt_idx < num_packets; ++pkt_idx) {
     bool is_first = (pkt_idx == 0);
@@ -407,7 +480,7 @@ std::vector<std::vector<std::byte>> ReadProcessor::generate_read_responses(
     RdmaPacketBuilder builder;
     builder.set_opcode(opcode)
         .set_dest_qp(qp.dest_qp_number())
-        .set_psn(qp.next_send_psn())
+        .set_psn(advance_psn(request_psn, pkt_idx))
         .set_pad_count(pad_count)
         .set_ack_request(false)
         .set_payload(payload);
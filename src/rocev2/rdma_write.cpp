@@ -6,8 +6,10 @@
 
 namespace nic::rocev2 {
 
-WriteProcessor::WriteProcessor(HostMemory& host_memory, MemoryRegionTable& mr_table)
-  : host_memory_(host_memory), mr_table_(mr_table) {
+WriteProcessor::WriteProcessor(HostMemory& host_memory,
+                               MemoryRegionTable& mr_table,
+                               std::uint32_t reorder_window)
+  : host_memory_(host_memory), mr_table_(mr_table), reorder_window_(reorder_window) {
   NIC_TRACE_SCOPED(__func__);
 }
 
@@ -22,14 +24,22 @@ std::vector<std::vector<std::byte>> WriteProcessor::generate_write_packets(RdmaQ
     return packets;
   }
 
-  // Read data from local scatter-gather list
-  std::vector<std::byte> data = read_from_sgl(wqe.sgl, wqe.local_lkey);
+  // Inline payloads travel in the WQE: no lkey check, no host memory read
+  std::vector<std::byte> sgl_data;
+  std::span<const std::byte> data = inline_payload_view(wqe);
+  if (wqe.inline_data) {
+    ++stats_.inline_writes;
+  } else {
+    sgl_data = read_from_sgl(wqe.sgl, wqe.local_lkey);
+    data = sgl_data;
+  }
   if (data.size() != wqe.total_length) {
     return packets;
   }
 
   std::uint32_t mtu = qp.mtu_bytes();
   std::uint32_t num_packets = calculate_packet_count(wqe.total_length, mtu);
+  std::uint32_t start_psn = qp.sq_psn();
   bool has_immediate = (wqe.opcode == WqeOpcode::RdmaWriteImm);
 
   ++stats_.writes_started;
@@ -59,7 +69,7 @@ std::vector<std::vector<std::byte>> WriteProcessor::generate_write_packets(RdmaQ
     packets.push_back(builder.build());
     ++stats_.write_packets_generated;
 
-    qp.add_pending_operation(wqe, 1);
+    qp.add_pending_operation(wqe, 1, start_psn);
     qp.record_packet_sent(packets.back().size());
 
     return packets;
@@ -115,7 +125,7 @@ std::vector<std::vector<std::byte>> WriteProcessor::generate_write_packets(RdmaQ
   }
 
   // Add pending operation for reliability
-  qp.add_pending_operation(wqe, num_packets);
+  qp.add_pending_operation(wqe, num_packets, start_psn);
 
   return packets;
 }
@@ -154,6 +164,10 @@ WriteResult WriteProcessor::process_write_packet(RdmaQueuePair& qp,
     return result;
   }
 
+  if (reorder_window_ > 0) {
+    return process_reordered_packet(qp, parser);
+  }
+
   // Check PSN
   std::uint32_t expected_psn = qp.expected_recv_psn();
   if (bth.psn != expected_psn) {
@@ -175,35 +189,17 @@ WriteResult WriteProcessor::process_write_packet(RdmaQueuePair& qp,
 
   // Handle first packet of a write
   if (is_first || is_only) {
-    // RETH must be present
-    if (!parser.has_reth()) {
-      result.syndrome = AethSyndrome::InvalidRequest;
-      result.needs_ack = true;
-      result.ack_psn = bth.psn;
+    if (!check_reth_access(qp, parser, result)) {
       return result;
     }
 
     const RethFields& reth = parser.reth();
-
-    // Validate rkey
-    if (!mr_table_.validate_rkey(
-            reth.rkey, qp.pd_handle(), reth.virtual_address, reth.dma_length, true)) {
-      result.syndrome = AethSyndrome::RemoteAccessError;
-      result.needs_ack = true;
-      result.ack_psn = bth.psn;
-      ++stats_.rkey_errors;
-      NIC_LOGF_WARNING("write rkey error: qp={} rkey={:#x} addr={:#x}",
-                       qp.qp_number(),
-                       reth.rkey,
-                       reth.virtual_address);
-      return result;
-    }
-
     write_state.remote_address = reth.virtual_address;
     write_state.rkey = reth.rkey;
     write_state.total_length = reth.dma_length;
     write_state.bytes_written = 0;
     write_state.expected_psn = bth.psn;
+    write_state.first_psn = bth.psn;
     write_state.in_progress = true;
     write_state.has_immediate = false;
     write_state.immediate_data = 0;
@@ -233,7 +229,7 @@ WriteResult WriteProcessor::process_write_packet(RdmaQueuePair& qp,
   std::uint64_t write_addr = write_state.remote_address + write_state.bytes_written;
 
   if (!payload.empty()) {
-    if (!write_to_remote(write_addr, write_state.rkey, qp.pd_handle(), payload)) {
+    if (!write_to_remote(write_addr, write_state.rkey, qp.pd_handle(), qp.qp_number(), payload)) {
       result.syndrome = AethSyndrome::RemoteAccessError;
       result.needs_ack = true;
       result.ack_psn = bth.psn;
@@ -243,6 +239,23 @@ WriteResult WriteProcessor::process_write_packet(RdmaQueuePair& qp,
     }
   }
 
+  // WRITE with immediate consumes a recv WQE. Without one the whole message is RNR-NAKed
+  // and the expected PSN goes back to its first packet, where the requester resends it.
+  std::optional<RecvWqe> recv_wqe;
+  if ((is_last || is_only) && parser.has_immediate()) {
+    recv_wqe = qp.consume_recv();
+    if (!recv_wqe.has_value()) {
+      RdmaQpModifyParams rewind;
+      rewind.rq_psn = write_state.first_psn;
+      qp.modify(rewind);
+      write_state.in_progress = false;
+      result.syndrome = AethSyndrome::RnrNak;
+      result.needs_ack = true;
+      result.ack_psn = bth.psn;
+      return result;
+    }
+  }
+
   write_state.bytes_written += static_cast<std::uint32_t>(payload.size());
   write_state.expected_psn = advance_psn(bth.psn);
 
@@ -264,17 +277,8 @@ WriteResult WriteProcessor::process_write_packet(RdmaQueuePair& qp,
     ++stats_.writes_completed;
     NIC_LOGF_DEBUG("write complete: qp={} bytes={}", qp.qp_number(), write_state.bytes_written);
 
-    // WRITE with immediate consumes a recv WQE and generates a CQE
-    if (write_state.has_immediate) {
-      std::optional<RecvWqe> recv_wqe = qp.consume_recv();
-      if (!recv_wqe.has_value()) {
-        // RNR NAK - no recv WQE for immediate
-        result.syndrome = AethSyndrome::RnrNak;
-        result.needs_ack = true;
-        result.ack_psn = bth.psn;
-        return result;
-      }
-
+    // WRITE with immediate generates a CQE for the recv WQE taken above
+    if (recv_wqe.has_value()) {
       RdmaCqe cqe;
       cqe.wr_id = recv_wqe->wr_id;
       cqe.status = WqeStatus::Success;
@@ -285,7 +289,7 @@ WriteResult WriteProcessor::process_write_packet(RdmaQueuePair& qp,
       cqe.immediate_data = write_state.immediate_data;
       cqe.is_send = false;
 
-      result.recv_cqe = cqe;
+      result.recv_cqes.push_back(cqe);
     }
   }
 
@@ -300,18 +304,353 @@ WriteResult WriteProcessor::process_write_packet(RdmaQueuePair& qp,
   return result;
 }
 
+WriteResult WriteProcessor::retire_placed_packets(RdmaQueuePair& qp) {
+  NIC_TRACE_SCOPED(__func__);
+
+  WriteResult result;
+  result.success = true;
+
+  auto iter = reorder_states_.find(qp.qp_number());
+  if (iter == reorder_states_.end()) {
+    return result;
+  }
+  sync_reorder_window(iter->second, qp.expected_recv_psn());
+  retire_in_order(qp, iter->second, result);
+  return result;
+}
+
+bool WriteProcessor::check_reth_access(RdmaQueuePair& qp,
+                                       const RdmaPacketParser& parser,
+                                       WriteResult& result) {
+  NIC_TRACE_SCOPED(__func__);
+
+  const BthFields& bth = parser.bth();
+
+  // RETH must be present
+  if (!parser.has_reth()) {
+    result.syndrome = AethSyndrome::InvalidRequest;
+    result.needs_ack = true;
+    result.ack_psn = bth.psn;
+    return false;
+  }
+
+  const RethFields& reth = parser.reth();
+
+  // Validate rkey; a non-present ODP page is RNR-NAKed and retried once the host populates it
+  MrAccessStatus access = mr_table_.access_rkey(
+      reth.rkey, qp.pd_handle(), reth.virtual_address, reth.dma_length, true, qp.qp_number());
+  if (access == MrAccessStatus::PageFault) {
+    result.syndrome = AethSyndrome::RnrNak;
+    result.needs_ack = true;
+    result.ack_psn = bth.psn;
+    ++stats_.page_fault_naks;
+    NIC_LOGF_DEBUG("write page fault: qp={} addr={:#x} len={}",
+                   qp.qp_number(),
+                   reth.virtual_address,
+                   reth.dma_length);
+    return false;
+  }
+  if (access != MrAccessStatus::Ok) {
+    result.syndrome = AethSyndrome::RemoteAccessError;
+    result.needs_ack = true;
+    result.ack_psn = bth.psn;
+    ++stats_.rkey_errors;
+    NIC_LOGF_WARNING("write rkey error: qp={} rkey={:#x} addr={:#x}",
+                     qp.qp_number(),
+                     reth.rkey,
+                     reth.virtual_address);
+    return false;
+  }
+  return true;
+}
+
+WriteResult WriteProcessor::process_reordered_packet(RdmaQueuePair& qp,
+                                                     const RdmaPacketParser& parser) {
+  NIC_TRACE_SCOPED(__func__);
+
+  WriteResult result;
+  const BthFields& bth = parser.bth();
+  std::uint32_t expected_psn = qp.expected_recv_psn();
+
+  WriteReorderState& state = reorder_states_[qp.qp_number()];
+  if (state.placed.size() == 0) {
+    state.placed = PsnBitmap(expected_psn, reorder_window_);
+  }
+  sync_reorder_window(state, expected_psn);
+
+  if (!state.placed.contains(bth.psn)) {
+    // A PSN just behind the window is a retransmission of a retired packet: re-ACK it
+    std::uint32_t behind_psn = (expected_psn - reorder_window_) & kMaxPsn;
+    if (psn_in_window(bth.psn, behind_psn, reorder_window_)) {
+      ++stats_.duplicate_packets;
+      result.success = true;
+      result.needs_ack = true;
+      result.ack_psn = advance_psn(expected_psn, kMaxPsn);  // expected_psn - 1
+      return result;
+    }
+    result.syndrome = AethSyndrome::PsnSeqError;
+    result.needs_ack = true;
+    result.ack_psn = expected_psn;
+    ++stats_.sequence_errors;
+    NIC_LOGF_WARNING("write PSN outside reorder window: qp={} expected={} got={}",
+                     qp.qp_number(),
+                     expected_psn,
+                     bth.psn);
+    return result;
+  }
+  if (state.placed.test(bth.psn) || state.staged.contains(bth.psn)) {
+    // A resent last packet may find its message still waiting for a recv WQE
+    ++stats_.duplicate_packets;
+    result.success = true;
+    retire_in_order(qp, state, result);
+    return result;
+  }
+
+  bool is_first = opcode_is_first(bth.opcode);
+  bool is_only = opcode_is_only(bth.opcode);
+  std::optional<std::uint32_t> immediate_data;
+  if (parser.has_immediate()) {
+    immediate_data = parser.immediate();
+  }
+
+  // A first or only packet opens its message; its RETH locates every later packet
+  if (is_first || is_only) {
+    if (!check_reth_access(qp, parser, result)) {
+      return result;
+    }
+    const RethFields& reth = parser.reth();
+    std::uint32_t num_packets = calculate_packet_count(reth.dma_length, qp.mtu_bytes());
+    PlacedWriteMessage message{.first_psn = bth.psn,
+                               .last_psn = advance_psn(bth.psn, num_packets - 1),
+                               .remote_address = reth.virtual_address,
+                               .rkey = reth.rkey,
+                               .total_length = reth.dma_length};
+    std::uint32_t base = state.placed.base();
+    auto position = std::find_if(
+        state.messages.begin(), state.messages.end(), [&](const PlacedWriteMessage& other) {
+          return ((other.first_psn - base) & kMaxPsn) > ((bth.psn - base) & kMaxPsn);
+        });
+    state.messages.insert(position, message);
+  }
+
+  auto covers = [](const PlacedWriteMessage& message, std::uint32_t psn) {
+    return psn_in_window(
+        psn, message.first_psn, ((message.last_psn - message.first_psn) & kMaxPsn) + 1);
+  };
+  auto message =
+      std::find_if(state.messages.begin(), state.messages.end(), [&](const auto& other) {
+        return covers(other, bth.psn);
+      });
+  if (message == state.messages.end()) {
+    // A middle or last packet ahead of its first packet waits for the RETH
+    state.staged.emplace(bth.psn,
+                         StagedWritePacket{
+                             .payload = std::vector<std::byte>(parser.payload().begin(),
+                                                               parser.payload().end()),
+                             .immediate_data = immediate_data,
+                             .ack_request = bth.ack_request});
+    ++stats_.staged_packets;
+    ++stats_.out_of_order_packets;
+    result.success = true;
+    return result;
+  }
+
+  if (bth.psn != expected_psn) {
+    ++stats_.out_of_order_packets;
+  }
+  bool placed = place_packet(
+      qp, state, *message, bth.psn, parser.payload(), immediate_data, bth.ack_request);
+
+  // A new message releases the staged packets that belong to it
+  if (is_first || is_only) {
+    for (auto staged = state.staged.begin(); placed && (staged != state.staged.end());) {
+      if (!covers(*message, staged->first)) {
+        ++staged;
+        continue;
+      }
+      placed = place_packet(qp,
+                            state,
+                            *message,
+                            staged->first,
+                            staged->second.payload,
+                            staged->second.immediate_data,
+                            staged->second.ack_request);
+      staged = state.staged.erase(staged);
+    }
+  }
+
+  if (!placed) {
+    result.syndrome = AethSyndrome::RemoteAccessError;
+    result.needs_ack = true;
+    result.ack_psn = bth.psn;
+    ++stats_.access_errors;
+    reorder_states_.erase(qp.qp_number());
+    return result;
+  }
+
+  result.success = true;
+  retire_in_order(qp, state, result);
+  return result;
+}
+
+bool WriteProcessor::place_packet(RdmaQueuePair& qp,
+                                  WriteReorderState& state,
+                                  PlacedWriteMessage& message,
+                                  std::uint32_t psn,
+                                  std::span<const std::byte> payload,
+                                  std::optional<std::uint32_t> immediate_data,
+                                  bool ack_request) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Every packet but the last carries exactly one MTU, so the PSN gives the offset
+  std::uint64_t offset =
+      static_cast<std::uint64_t>((psn - message.first_psn) & kMaxPsn) * qp.mtu_bytes();
+  if (offset + payload.size() > message.total_length) {
+    return false;
+  }
+  if (!payload.empty()
+      && !write_to_remote(message.remote_address + offset,
+                          message.rkey,
+                          qp.pd_handle(),
+                          qp.qp_number(),
+                          payload)) {
+    return false;
+  }
+
+  message.bytes_placed += static_cast<std::uint32_t>(payload.size());
+  if (immediate_data.has_value()) {
+    message.has_immediate = true;
+    message.immediate_data = *immediate_data;
+  }
+  state.ack_pending = state.ack_pending || ack_request;
+  state.placed.set(psn);
+  ++stats_.write_packets_processed;
+  qp.record_packet_received(payload.size());
+  return true;
+}
+
+void WriteProcessor::sync_reorder_window(WriteReorderState& state, std::uint32_t expected_psn) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (state.placed.base() == expected_psn) {
+    return;
+  }
+  state.placed.skip_to(expected_psn);
+  std::erase_if(state.staged,
+                [&state](const auto& entry) { return !state.placed.contains(entry.first); });
+}
+
+void WriteProcessor::retire_in_order(RdmaQueuePair& qp,
+                                     WriteReorderState& state,
+                                     WriteResult& result) {
+  NIC_TRACE_SCOPED(__func__);
+
+  bool retired = false;
+  while (state.placed.test(state.placed.base())) {
+    std::uint32_t psn = state.placed.base();
+    bool completes = !state.messages.empty() && (state.messages.front().last_psn == psn);
+
+    // WRITE with immediate consumes a recv WQE. Without one the last PSN stays placed but
+    // un-retired and the message stays queued, so the requester's resend completes it.
+    std::optional<RecvWqe> recv_wqe;
+    if (completes && state.messages.front().has_immediate) {
+      recv_wqe = qp.consume_recv();
+      if (!recv_wqe.has_value()) {
+        result.success = false;
+        result.syndrome = AethSyndrome::RnrNak;
+        result.needs_ack = true;
+        result.ack_psn = psn;
+        return;
+      }
+    }
+
+    state.placed.advance_base();
+    qp.advance_recv_psn();
+    retired = true;
+    if (!completes) {
+      continue;
+    }
+    PlacedWriteMessage message = state.messages.front();
+    state.messages.pop_front();
+    result.is_message_complete = true;
+    state.ack_pending = true;  // The last packet of a message is always ACKed
+    ++stats_.writes_completed;
+    NIC_LOGF_DEBUG("write complete: qp={} bytes={}", qp.qp_number(), message.bytes_placed);
+
+    // WRITE with immediate generates a CQE for the recv WQE taken above
+    if (recv_wqe.has_value()) {
+      RdmaCqe cqe;
+      cqe.wr_id = recv_wqe->wr_id;
+      cqe.status = WqeStatus::Success;
+      cqe.opcode = WqeOpcode::RdmaWriteImm;
+      cqe.qp_number = qp.qp_number();
+      cqe.bytes_completed = message.bytes_placed;
+      cqe.has_immediate = true;
+      cqe.immediate_data = message.immediate_data;
+      cqe.is_send = false;
+      result.recv_cqes.push_back(cqe);
+    }
+  }
+
+  // One cumulative ACK covers everything retired
+  if (retired && state.ack_pending) {
+    state.ack_pending = false;
+    result.needs_ack = true;
+    result.ack_psn = advance_psn(state.placed.base(), kMaxPsn);
+    result.syndrome = AethSyndrome::Ack;
+  }
+}
+
 void WriteProcessor::reset() {
   NIC_TRACE_SCOPED(__func__);
   write_states_.clear();
+  reorder_states_.clear();
   stats_ = WriteStats{};
 }
 
 void WriteProcessor::clear_write_state(std::uint32_t qp_number) {
   NIC_TRACE_SCOPED(__func__);
   write_states_.erase(qp_number);
+  reorder_states_.erase(qp_number);
+}
+
+bool WriteProcessor::release_idle_state(std::uint32_t qp_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  bool idle = true;
+  auto write_iter = write_states_.find(qp_number);
+  if (write_iter != write_states_.end()) {
+    if (write_iter->second.in_progress) {
+      idle = false;
+    } else {
+      write_states_.erase(write_iter);
+    }
+  }
+  auto reorder_iter = reorder_states_.find(qp_number);
+  if (reorder_iter != reorder_states_.end()) {
+    const auto& state = reorder_iter->second;
+    if ((state.placed.count() != 0) || !state.messages.empty() || !state.staged.empty()) {
+      idle = false;
+    } else {
+      reorder_states_.erase(reorder_iter);
+    }
+  }
+  return idle;
+}
+
+std::size_t WriteProcessor::memory_footprint() const noexcept {
+  std::size_t bytes = write_states_.size() * sizeof(decltype(write_states_)::value_type);
+  for (const auto& [qp_number, state] : reorder_states_) {
+    bytes += sizeof(qp_number) + sizeof(state) + state.placed.heap_bytes()
+             + state.messages.size() * sizeof(PlacedWriteMessage);
+    for (const auto& [psn, packet] : state.staged) {
+      bytes += sizeof(psn) + sizeof(packet) + packet.payload.capacity();
+    }
+  }
+  return bytes;
 }
 
-std::vector<std::byte> WriteProcessor::read_from_sgl(const std::vector<SglEntry>& sgl,
+std::vector<std::byte> WriteProcessor::read_from_sgl(std::span<const SglEntry> sgl,
                                                      std::uint32_t lkey) {
   NIC_TRACE_SCOPED(__func__);
 
@@ -338,11 +677,12 @@ std::vector<std::byte> WriteProcessor::read_from_sgl(const std::vector<SglEntry>
 bool WriteProcessor::write_to_remote(std::uint64_t address,
                                      std::uint32_t rkey,
                                      std::uint32_t pd_handle,
+                                     std::uint32_t qp_number,
                                      std::span<const std::byte> data) {
   NIC_TRACE_SCOPED(__func__);
 
   // Validate rkey for the write
-  if (!mr_table_.validate_rkey(rkey, pd_handle, address, data.size(), true)) {
+  if (!mr_table_.validate_rkey(rkey, pd_handle, address, data.size(), true, qp_number)) {
     return false;
   }
 
@@ -0,0 +1,139 @@
+#include "nic/rocev2/send_queue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace nic::rocev2 {
+
+std::optional<RdmaSqWqe> encode_sq_wqe(const SendWqe& wqe, std::uint32_t qp_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  RdmaSqWqe entry;
+  entry.wr_id = wqe.wr_id;
+  entry.remote_address = wqe.remote_address;
+  entry.lkey = wqe.local_lkey;
+  entry.rkey = wqe.rkey;
+  entry.immediate_data = wqe.immediate_data;
+  entry.qp_number = qp_number;
+  entry.opcode = static_cast<std::uint8_t>(wqe.opcode);
+  entry.flags = static_cast<std::uint8_t>((wqe.signaled ? kSqWqeSignaled : 0)
+                                          | (wqe.solicited ? kSqWqeSolicited : 0)
+                                          | (wqe.fence ? kSqWqeFence : 0));
+
+  if ((wqe.opcode == WqeOpcode::LocalInvalidate)
+      || (wqe.opcode == WqeOpcode::SendWithInvalidate)) {
+    entry.immediate_data = wqe.invalidate_rkey;
+  } else if ((wqe.opcode == WqeOpcode::RegMr) || (wqe.opcode == WqeOpcode::BindMw)) {
+    entry.immediate_data = wqe.new_rkey;
+    entry.access = static_cast<std::uint8_t>((wqe.access.local_write ? kSqAccessLocalWrite : 0)
+                                             | (wqe.access.remote_read ? kSqAccessRemoteRead : 0)
+                                             | (wqe.access.remote_write ? kSqAccessRemoteWrite : 0)
+                                             | (wqe.access.mw_bind ? kSqAccessMwBind : 0));
+  }
+
+  if (wqe.inline_data) {
+    if (wqe.total_length > kSqWqeInlineBytes) {
+      return std::nullopt;
+    }
+    std::span<const std::byte> payload = inline_payload_view(wqe);
+    std::copy(payload.begin(), payload.end(), entry.inline_data.begin());
+    entry.inline_length = static_cast<std::uint8_t>(payload.size());
+    entry.flags |= kSqWqeInline;
+    return entry;
+  }
+
+  if (wqe.sgl.size() > 1) {
+    return std::nullopt;
+  }
+  if (!wqe.sgl.empty()) {
+    entry.sge_address = wqe.sgl.front().address;
+    entry.sge_length = wqe.sgl.front().length;
+  }
+  return entry;
+}
+
+SendWqe decode_sq_wqe(const RdmaSqWqe& entry) {
+  NIC_TRACE_SCOPED(__func__);
+
+  SendWqe wqe;
+  wqe.wr_id = entry.wr_id;
+  wqe.opcode = static_cast<WqeOpcode>(entry.opcode);
+  wqe.signaled = (entry.flags & kSqWqeSignaled) != 0;
+  wqe.solicited = (entry.flags & kSqWqeSolicited) != 0;
+  wqe.fence = (entry.flags & kSqWqeFence) != 0;
+  wqe.immediate_data = entry.immediate_data;
+  wqe.remote_address = entry.remote_address;
+  wqe.rkey = entry.rkey;
+  wqe.local_lkey = entry.lkey;
+
+  if ((wqe.opcode == WqeOpcode::LocalInvalidate)
+      || (wqe.opcode == WqeOpcode::SendWithInvalidate)) {
+    wqe.invalidate_rkey = entry.immediate_data;
+  } else if ((wqe.opcode == WqeOpcode::RegMr) || (wqe.opcode == WqeOpcode::BindMw)) {
+    wqe.new_rkey = entry.immediate_data;
+    wqe.access.local_write = (entry.access & kSqAccessLocalWrite) != 0;
+    wqe.access.remote_read = (entry.access & kSqAccessRemoteRead) != 0;
+    wqe.access.remote_write = (entry.access & kSqAccessRemoteWrite) != 0;
+    wqe.access.mw_bind = (entry.access & kSqAccessMwBind) != 0;
+  }
+
+  if ((entry.flags & kSqWqeInline) != 0) {
+    std::size_t length = std::min<std::size_t>(entry.inline_length, kSqWqeInlineBytes);
+    set_inline_payload(wqe, std::span<const std::byte>(entry.inline_data.data(), length));
+    return wqe;
+  }
+
+  if (entry.sge_length > 0) {
+    wqe.sgl.push_back(SglEntry{.address = entry.sge_address, .length = entry.sge_length});
+  }
+  wqe.total_length = entry.sge_length;
+  return wqe;
+}
+
+RdmaSendQueueRing::RdmaSendQueueRing(RdmaSqRingConfig config, DMAEngine& dma_engine)
+  : config_(config), dma_engine_(dma_engine) {
+  NIC_TRACE_SCOPED(__func__);
+}
+
+bool RdmaSendQueueRing::update_producer(std::uint32_t producer_index) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Unsigned distance from the consumer: a stale or overrunning index exceeds depth
+  if ((producer_index - consumer_index_) > config_.depth
+      || (producer_index - consumer_index_) < pending()) {
+    return false;
+  }
+  producer_index_ = producer_index;
+  return true;
+}
+
+std::optional<RdmaSqWqe> RdmaSendQueueRing::fetch() {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (pending() == 0) {
+    return std::nullopt;
+  }
+
+  std::array<std::byte, kSqWqeSize> bytes{};
+  if (!dma_engine_.read(slot_address(consumer_index_), bytes).ok()) {
+    return std::nullopt;
+  }
+  ++consumer_index_;
+
+  RdmaSqWqe entry;
+  std::memcpy(static_cast<void*>(&entry), bytes.data(), kSqWqeSize);
+  return entry;
+}
+
+bool RdmaSendQueueRing::consume_blueflame() {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (pending() != 0) {
+    return false;
+  }
+  ++producer_index_;
+  ++consumer_index_;
+  return true;
+}
+
+}  // namespace nic::rocev2
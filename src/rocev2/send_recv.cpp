@@ -4,6 +4,7 @@
 #include <cstring>
 
 #include "nic/log.h"
+#include "nic/rocev2/formats.h"
 
 namespace nic::rocev2 {
 
@@ -19,19 +20,29 @@ std::vector<std::vector<std::byte>> SendRecvProcessor::generate_send_packets(Rdm
   std::vector<std::vector<std::byte>> packets;
 
   // Validate WQE opcode
-  if ((wqe.opcode != WqeOpcode::Send) && (wqe.opcode != WqeOpcode::SendImm)) {
+  if ((wqe.opcode != WqeOpcode::Send) && (wqe.opcode != WqeOpcode::SendImm)
+      && (wqe.opcode != WqeOpcode::SendWithInvalidate)) {
     return packets;
   }
 
-  // Read data from scatter-gather list
-  std::vector<std::byte> data = read_from_sgl(wqe.sgl, wqe.local_lkey, qp.pd_handle());
+  // Inline payloads travel in the WQE: no lkey check, no host memory read
+  std::vector<std::byte> sgl_data;
+  std::span<const std::byte> data = inline_payload_view(wqe);
+  if (wqe.inline_data) {
+    ++stats_.inline_sends;
+  } else {
+    sgl_data = read_from_sgl(wqe.sgl, wqe.local_lkey, qp.pd_handle());
+    data = sgl_data;
+  }
   if (data.size() != wqe.total_length) {
     return packets;
   }
 
   std::uint32_t mtu = qp.mtu_bytes();
   std::uint32_t num_packets = calculate_packet_count(wqe.total_length, mtu);
+  std::uint32_t start_psn = qp.sq_psn();
   bool has_immediate = (wqe.opcode == WqeOpcode::SendImm);
+  bool has_invalidate = (wqe.opcode == WqeOpcode::SendWithInvalidate);
 
   ++stats_.sends_started;
   NIC_LOGF_DEBUG(
@@ -40,7 +51,7 @@ std::vector<std::vector<std::byte>> SendRecvProcessor::generate_send_packets(Rdm
   // Handle zero-length send
   if (wqe.total_length == 0) {
     RdmaPacketBuilder builder;
-    RdmaOpcode opcode = has_immediate ? RdmaOpcode::kRcSendOnlyImm : RdmaOpcode::kRcSendOnly;
+    RdmaOpcode opcode = get_send_opcode(true, true, has_immediate, has_invalidate);
 
     builder.set_opcode(opcode)
         .set_dest_qp(qp.dest_qp_number())
@@ -51,12 +62,15 @@ std::vector<std::vector<std::byte>> SendRecvProcessor::generate_send_packets(Rdm
     if (has_immediate) {
       builder.set_immediate(wqe.immediate_data);
     }
+    if (has_invalidate) {
+      builder.set_invalidate_rkey(wqe.invalidate_rkey);
+    }
 
     packets.push_back(builder.build());
     ++stats_.send_packets_generated;
 
     // Add pending operation for reliability
-    qp.add_pending_operation(wqe, 1);
+    qp.add_pending_operation(wqe, 1, start_psn);
     qp.record_packet_sent(packets.back().size());
 
     return packets;
@@ -78,7 +92,7 @@ std::vector<std::vector<std::byte>> SendRecvProcessor::generate_send_packets(Rdm
       pad_count = static_cast<std::uint8_t>(aligned_size - payload_size);
     }
 
-    RdmaOpcode opcode = get_send_opcode(is_first, is_last, has_immediate && is_last);
+    RdmaOpcode opcode = get_send_opcode(is_first, is_last, has_immediate, has_invalidate);
 
     RdmaPacketBuilder builder;
     builder.set_opcode(opcode)
@@ -92,6 +106,9 @@ std::vector<std::vector<std::byte>> SendRecvProcessor::generate_send_packets(Rdm
     if (has_immediate && is_last) {
       builder.set_immediate(wqe.immediate_data);
     }
+    if (has_invalidate && is_last) {
+      builder.set_invalidate_rkey(wqe.invalidate_rkey);
+    }
 
     packets.push_back(builder.build());
     ++stats_.send_packets_generated;
@@ -102,7 +119,7 @@ std::vector<std::vector<std::byte>> SendRecvProcessor::generate_send_packets(Rdm
   }
 
   // Add pending operation for reliability
-  qp.add_pending_operation(wqe, num_packets);
+  qp.add_pending_operation(wqe, num_packets, start_psn);
 
   return packets;
 }
@@ -121,8 +138,10 @@ RecvResult SendRecvProcessor::process_recv_packet(RdmaQueuePair& qp,
     case RdmaOpcode::kRcSendMiddle:
     case RdmaOpcode::kRcSendLast:
     case RdmaOpcode::kRcSendLastImm:
+    case RdmaOpcode::kRcSendLastInv:
     case RdmaOpcode::kRcSendOnly:
     case RdmaOpcode::kRcSendOnlyImm:
+    case RdmaOpcode::kRcSendOnlyInv:
       is_send = true;
       break;
     default:
@@ -182,6 +201,8 @@ RecvResult SendRecvProcessor::process_recv_packet(RdmaQueuePair& qp,
     recv_state.in_progress = true;
     recv_state.has_immediate = false;
     recv_state.immediate_data = 0;
+    recv_state.has_invalidate = false;
+    recv_state.invalidated_rkey = 0;
   }
 
   // Validate we're in the right state
@@ -203,6 +224,22 @@ RecvResult SendRecvProcessor::process_recv_packet(RdmaQueuePair& qp,
     }
   }
 
+  // A key the requester may not invalidate fails the message before it is placed
+  if (parser.has_ieth()) {
+    if (!mr_table_.invalidate(parser.invalidate_rkey(), qp.pd_handle(), qp.qp_number())) {
+      result.syndrome = AethSyndrome::InvalidRequest;
+      result.needs_ack = true;
+      result.ack_psn = bth.psn;
+      recv_state.in_progress = false;
+      ++stats_.invalidate_errors;
+      NIC_LOGF_WARNING(
+          "recv invalidate failed: qp={} rkey={:#x}", qp.qp_number(), parser.invalidate_rkey());
+      return result;
+    }
+    recv_state.has_invalidate = true;
+    recv_state.invalidated_rkey = parser.invalidate_rkey();
+  }
+
   // Write payload to receive buffer
   std::span<const std::byte> payload = parser.payload();
   std::size_t bytes_written =
@@ -241,11 +278,17 @@ RecvResult SendRecvProcessor::process_recv_packet(RdmaQueuePair& qp,
     cqe.wr_id = recv_state.wr_id;
     cqe.status = WqeStatus::Success;
     cqe.opcode = recv_state.has_immediate ? WqeOpcode::SendImm : WqeOpcode::Send;
+    if (recv_state.has_invalidate) {
+      cqe.opcode = WqeOpcode::SendWithInvalidate;
+    }
     cqe.qp_number = qp.qp_number();
     cqe.bytes_completed = recv_state.bytes_received;
     cqe.has_immediate = recv_state.has_immediate;
     cqe.immediate_data = recv_state.immediate_data;
+    cqe.has_invalidate = recv_state.has_invalidate;
+    cqe.invalidated_rkey = recv_state.invalidated_rkey;
     cqe.is_send = false;
+    cqe.solicited = bth.solicited_event;
 
     result.cqe = cqe;
     ++stats_.recvs_completed;
@@ -266,6 +309,149 @@ RecvResult SendRecvProcessor::process_recv_packet(RdmaQueuePair& qp,
   return result;
 }
 
+std::vector<std::byte> SendRecvProcessor::generate_ud_send_packet(RdmaQueuePair& qp,
+                                                                 const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if ((wqe.opcode != WqeOpcode::Send) && (wqe.opcode != WqeOpcode::SendImm)) {
+    return {};
+  }
+
+  // UD messages are never segmented
+  if (wqe.total_length > qp.mtu_bytes()) {
+    NIC_LOGF_WARNING(
+        "UD send: qp={} len={} exceeds mtu={}", qp.qp_number(), wqe.total_length, qp.mtu_bytes());
+    return {};
+  }
+
+  std::vector<std::byte> sgl_data;
+  std::span<const std::byte> data = inline_payload_view(wqe);
+  if (wqe.inline_data) {
+    ++stats_.inline_sends;
+  } else {
+    sgl_data = read_from_sgl(wqe.sgl, wqe.local_lkey, qp.pd_handle());
+    data = sgl_data;
+  }
+  if (data.size() != wqe.total_length) {
+    return {};
+  }
+
+  std::uint32_t qkey = wqe.remote_qkey;
+  if ((qkey & kQkeyUseQpMask) != 0) {
+    qkey = qp.qkey();
+  }
+
+  bool has_immediate = (wqe.opcode == WqeOpcode::SendImm);
+  std::size_t aligned_size = (data.size() + 3) & ~static_cast<std::size_t>(3);
+
+  RdmaPacketBuilder builder;
+  builder.set_opcode(has_immediate ? RdmaOpcode::kUdSendOnlyImm : RdmaOpcode::kUdSendOnly)
+      .set_dest_qp(wqe.remote_qpn)
+      .set_psn(qp.next_send_psn())
+      .set_pad_count(static_cast<std::uint8_t>(aligned_size - data.size()))
+      .set_solicited_event(wqe.solicited)
+      .set_ack_request(false)
+      .set_qkey(qkey)
+      .set_src_qp(qp.qp_number())
+      .set_payload(data);
+
+  if (has_immediate) {
+    builder.set_immediate(wqe.immediate_data);
+  }
+
+  std::vector<std::byte> packet = builder.build();
+  ++stats_.ud_sends;
+  ++stats_.send_packets_generated;
+  stats_.bytes_sent += data.size();
+  qp.record_packet_sent(packet.size());
+  return packet;
+}
+
+RecvResult SendRecvProcessor::process_ud_recv_packet(RdmaQueuePair& qp,
+                                                     const RdmaPacketParser& parser,
+                                                     std::array<std::uint8_t, 4> src_ip,
+                                                     std::array<std::uint8_t, 4> dst_ip) {
+  NIC_TRACE_SCOPED(__func__);
+
+  RecvResult result;
+  const BthFields& bth = parser.bth();
+
+  if (!opcode_is_ud(bth.opcode) || !parser.has_deth() || !qp.can_receive()) {
+    return result;
+  }
+
+  // Q_Key mismatches are silently dropped (IB spec 9.6.1.1)
+  const DethFields& deth = parser.deth();
+  if (deth.qkey != qp.qkey()) {
+    ++stats_.qkey_violations;
+    NIC_LOGF_DEBUG("UD recv: qp={} Q_Key mismatch (got={:#x} expected={:#x})",
+                   qp.qp_number(),
+                   deth.qkey,
+                   qp.qkey());
+    return result;
+  }
+
+  // No RNR on UD: drop if no buffer is posted
+  std::optional<RecvWqe> recv_wqe = qp.consume_recv();
+  if (!recv_wqe.has_value()) {
+    ++stats_.ud_drops;
+    NIC_LOGF_DEBUG("UD recv: qp={} dropped, no recv WQE", qp.qp_number());
+    return result;
+  }
+
+  std::span<const std::byte> payload = parser.payload();
+
+  RdmaCqe cqe;
+  cqe.wr_id = recv_wqe->wr_id;
+  cqe.opcode = parser.has_immediate() ? WqeOpcode::SendImm : WqeOpcode::Send;
+  cqe.qp_number = qp.qp_number();
+  cqe.is_send = false;
+  cqe.solicited = bth.solicited_event;
+  cqe.src_qp = deth.src_qp;
+  cqe.has_immediate = parser.has_immediate();
+  cqe.immediate_data = parser.immediate();
+
+  // The buffer must hold the GRH plus the payload
+  if (compute_sgl_length(recv_wqe->sgl) < kGrhSize + payload.size()) {
+    cqe.status = WqeStatus::LocalLengthError;
+    result.cqe = cqe;
+    result.success = true;
+    return result;
+  }
+
+  std::size_t grh_payload_length = kBthSize + kDethSize + payload.size() + kIcrcSize;
+  if (parser.has_immediate()) {
+    grh_payload_length += kImmSize;
+  }
+  std::array<std::byte, kGrhSize> grh = build_grh(src_ip, dst_ip, grh_payload_length);
+
+  std::size_t sge_idx = 0;
+  std::size_t sge_offset = 0;
+  std::size_t bytes_written = write_to_sgl(recv_wqe->sgl, grh, sge_idx, sge_offset);
+  bytes_written += write_to_sgl(recv_wqe->sgl, payload, sge_idx, sge_offset);
+  if (bytes_written != kGrhSize + payload.size()) {
+    cqe.status = WqeStatus::LocalProtectionError;
+    result.cqe = cqe;
+    result.success = true;
+    return result;
+  }
+
+  cqe.status = WqeStatus::Success;
+  cqe.bytes_completed = static_cast<std::uint32_t>(bytes_written);
+  cqe.has_grh = true;
+
+  ++stats_.ud_recvs;
+  ++stats_.recvs_completed;
+  ++stats_.recv_packets_processed;
+  stats_.bytes_received += payload.size();
+  qp.record_packet_received(payload.size());
+
+  result.cqe = cqe;
+  result.is_message_complete = true;
+  result.success = true;
+  return result;
+}
+
 std::vector<std::byte> SendRecvProcessor::generate_ack(const RdmaQueuePair& qp,
                                                        std::uint32_t psn,
                                                        AethSyndrome syndrome,
@@ -294,7 +480,29 @@ void SendRecvProcessor::clear_recv_state(std::uint32_t qp_number) {
   recv_states_.erase(qp_number);
 }
 
-std::vector<std::byte> SendRecvProcessor::read_from_sgl(const std::vector<SglEntry>& sgl,
+bool SendRecvProcessor::release_idle_state(std::uint32_t qp_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  auto iter = recv_states_.find(qp_number);
+  if (iter == recv_states_.end()) {
+    return true;
+  }
+  if (iter->second.in_progress) {
+    return false;
+  }
+  recv_states_.erase(iter);
+  return true;
+}
+
+std::size_t SendRecvProcessor::memory_footprint() const noexcept {
+  std::size_t bytes = 0;
+  for (const auto& [qp_number, state] : recv_states_) {
+    bytes += sizeof(qp_number) + sizeof(state) + state.sgl.heap_bytes();
+  }
+  return bytes;
+}
+
+std::vector<std::byte> SendRecvProcessor::read_from_sgl(std::span<const SglEntry> sgl,
                                                         std::uint32_t lkey,
                                                         std::uint32_t /* pd_handle */) {
   NIC_TRACE_SCOPED(__func__);
@@ -319,7 +527,7 @@ std::vector<std::byte> SendRecvProcessor::read_from_sgl(const std::vector<SglEnt
   return data;
 }
 
-std::size_t SendRecvProcessor::write_to_sgl(const std::vector<SglEntry>& sgl,
+std::size_t SendRecvProcessor::write_to_sgl(std::span<const SglEntry> sgl,
                                             std::span<const std::byte> data,
                                             std::size_t& sge_idx,
                                             std::size_t& sge_offset) {
@@ -354,6 +562,35 @@ std::size_t SendRecvProcessor::write_to_sgl(const std::vector<SglEntry>& sgl,
   return total_written;
 }
 
+std::array<std::byte, kGrhSize> SendRecvProcessor::build_grh(std::array<std::uint8_t, 4> src_ip,
+                                                             std::array<std::uint8_t, 4> dst_ip,
+                                                             std::size_t payload_length) const {
+  NIC_TRACE_SCOPED(__func__);
+
+  // IPv4-mapped GID: ::ffff:a.b.c.d
+  auto mapped_gid_lo = [](std::array<std::uint8_t, 4> ip) {
+    return 0x0000FFFF00000000ULL | (static_cast<std::uint64_t>(ip[0]) << 24)
+           | (static_cast<std::uint64_t>(ip[1]) << 16) | (static_cast<std::uint64_t>(ip[2]) << 8)
+           | static_cast<std::uint64_t>(ip[3]);
+  };
+
+  std::array<std::byte, kGrhSize> grh{};
+  bit_fields::NetworkBitWriter writer(grh);
+  writer.serialize(kGrhFormat,
+                   6ULL,                                         // ip_version
+                   0ULL,                                         // traffic_class
+                   0ULL,                                         // flow_label
+                   static_cast<std::uint64_t>(payload_length),  // payload_length
+                   0x1BULL,                                      // next_header (IBA BTH)
+                   64ULL,                                        // hop_limit
+                   0ULL,                                         // sgid_hi
+                   mapped_gid_lo(src_ip),                        // sgid_lo
+                   0ULL,                                         // dgid_hi
+                   mapped_gid_lo(dst_ip)                         // dgid_lo
+  );
+  return grh;
+}
+
 std::uint32_t SendRecvProcessor::calculate_packet_count(std::uint32_t total_length,
                                                         std::uint32_t mtu) const {
   NIC_TRACE_SCOPED(__func__);
@@ -366,17 +603,24 @@ std::uint32_t SendRecvProcessor::calculate_packet_count(std::uint32_t total_leng
 
 RdmaOpcode SendRecvProcessor::get_send_opcode(bool is_first,
                                               bool is_last,
-                                              bool has_immediate) const {
+                                              bool has_immediate,
+                                              bool has_invalidate) const {
   NIC_TRACE_SCOPED(__func__);
 
   if (is_first && is_last) {
     // Only packet
+    if (has_invalidate) {
+      return RdmaOpcode::kRcSendOnlyInv;
+    }
     return has_immediate ? RdmaOpcode::kRcSendOnlyImm : RdmaOpcode::kRcSendOnly;
   }
   if (is_first) {
     return RdmaOpcode::kRcSendFirst;
   }
   if (is_last) {
+    if (has_invalidate) {
+      return RdmaOpcode::kRcSendLastInv;
+    }
     return has_immediate ? RdmaOpcode::kRcSendLastImm : RdmaOpcode::kRcSendLast;
   }
   return RdmaOpcode::kRcSendMiddle;
@@ -0,0 +1,560 @@
+#include "nic/rocev2/sharded_engine.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "nic/log.h"
+#include "nic/rocev2/packet.h"
+
+namespace nic::rocev2 {
+
+ShardedRdmaEngine::ShardedRdmaEngine(ShardedRdmaEngineConfig config, HostMemory& host_memory)
+  : config_(config) {
+  NIC_TRACE_SCOPED(__func__);
+
+  config_.num_shards = std::max<std::size_t>(config_.num_shards, 1);
+  shards_.reserve(config_.num_shards);
+  for (std::size_t shard_idx = 0; shard_idx < config_.num_shards; ++shard_idx) {
+    RdmaEngineConfig engine_config = config_.engine_config;
+    engine_config.first_object_number =
+        config_.engine_config.first_object_number + static_cast<std::uint32_t>(shard_idx);
+    engine_config.object_number_stride = static_cast<std::uint32_t>(config_.num_shards);
+
+    auto shard = std::make_unique<Shard>();
+    shard->dma_engine = std::make_unique<DMAEngine>(host_memory);
+    shard->engine = std::make_unique<RdmaEngine>(engine_config, *shard->dma_engine, host_memory);
+    shards_.push_back(std::move(shard));
+  }
+  NIC_LOGF_INFO("sharded RDMA engine created: shards={}", shards_.size());
+}
+
+ShardedRdmaEngine::~ShardedRdmaEngine() {
+  NIC_TRACE_SCOPED(__func__);
+  stop();
+}
+
+// ============================================
+// Worker Threads
+// ============================================
+
+void ShardedRdmaEngine::start() {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (running_) {
+    return;
+  }
+  for (auto& shard : shards_) {
+    {
+      std::lock_guard lock(shard->mutex);
+      shard->stopping = false;
+    }
+    shard->worker = std::thread([this, raw = shard.get()] { run_shard(*raw); });
+  }
+  running_ = true;
+}
+
+void ShardedRdmaEngine::stop() {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!running_) {
+    return;
+  }
+  for (auto& shard : shards_) {
+    {
+      std::lock_guard lock(shard->mutex);
+      shard->stopping = true;
+    }
+    shard->wake.notify_one();
+  }
+  for (auto& shard : shards_) {
+    shard->worker.join();
+  }
+  running_ = false;
+}
+
+void ShardedRdmaEngine::drain() {
+  NIC_TRACE_SCOPED(__func__);
+
+  for (auto& shard : shards_) {
+    std::unique_lock lock(shard->mutex);
+    shard->drained.wait(lock, [&shard] { return shard->inbox.empty(); });
+  }
+}
+
+void ShardedRdmaEngine::run_shard(Shard& shard) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::unique_lock lock(shard.mutex);
+  while (true) {
+    shard.wake.wait(lock, [&shard] { return shard.stopping || !shard.inbox.empty(); });
+    if (shard.inbox.empty()) {
+      return;  // Stopping with nothing left to process
+    }
+
+    // The lock stays held from pop to completion, so an empty inbox seen under
+    // the lock means every queued packet has been processed
+    InboundPacket packet = std::move(shard.inbox.front());
+    shard.inbox.pop_front();
+    if (!shard.engine->process_incoming_packet(
+            packet.data, packet.src_ip, packet.dst_ip, packet.src_port)) {
+      ++stats_.errors;
+    }
+    if (shard.inbox.empty()) {
+      shard.drained.notify_all();
+    }
+  }
+}
+
+// ============================================
+// Replicated Resources
+// ============================================
+
+std::vector<std::unique_lock<std::mutex>> ShardedRdmaEngine::lock_all_shards() {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::vector<std::unique_lock<std::mutex>> locks;
+  locks.reserve(shards_.size());
+  for (auto& shard : shards_) {
+    locks.emplace_back(shard->mutex);
+  }
+  return locks;
+}
+
+std::optional<std::uint32_t> ShardedRdmaEngine::create_pd() {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::lock_guard control(control_mutex_);
+  auto locks = lock_all_shards();
+
+  std::optional<std::uint32_t> pd_handle = shards_.front()->engine->create_pd();
+  if (!pd_handle.has_value()) {
+    ++stats_.errors;
+    return std::nullopt;
+  }
+  for (std::size_t shard_idx = 1; shard_idx < shards_.size(); ++shard_idx) {
+    if (shards_[shard_idx]->engine->create_pd() != pd_handle) {
+      // Replicas diverged; undo what was applied so the tables stay in step
+      for (std::size_t undo_idx = 0; undo_idx <= shard_idx; ++undo_idx) {
+        shards_[undo_idx]->engine->destroy_pd(*pd_handle);
+      }
+      ++stats_.errors;
+      NIC_LOGF_WARNING("PD replication failed on shard {}", shard_idx);
+      return std::nullopt;
+    }
+  }
+  ++stats_.replicated_ops;
+  return pd_handle;
+}
+
+bool ShardedRdmaEngine::destroy_pd(std::uint32_t pd_handle) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::lock_guard control(control_mutex_);
+  auto locks = lock_all_shards();
+
+  // A QP lives on one shard, so check every replica before destroying any of them
+  for (auto& shard : shards_) {
+    const ProtectionDomain* pd = shard->engine->pd_table().get(pd_handle);
+    if ((pd != nullptr) && (pd->ref_count() != 0)) {
+      ++stats_.errors;
+      return false;
+    }
+  }
+
+  bool destroyed = true;
+  for (auto& shard : shards_) {
+    destroyed = shard->engine->destroy_pd(pd_handle) && destroyed;
+  }
+  if (!destroyed) {
+    ++stats_.errors;
+    return false;
+  }
+  ++stats_.replicated_ops;
+  return true;
+}
+
+std::optional<std::uint32_t> ShardedRdmaEngine::register_mr(std::uint32_t pd_handle,
+                                                            std::uint64_t virtual_address,
+                                                            std::size_t length,
+                                                            AccessFlags access) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Page faults would populate only the faulting shard's replica
+  if (access.on_demand) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("register_mr failed: on-demand paging MRs are not replicated across shards");
+    return std::nullopt;
+  }
+
+  std::lock_guard control(control_mutex_);
+  auto locks = lock_all_shards();
+
+  std::optional<std::uint32_t> lkey =
+      shards_.front()->engine->register_mr(pd_handle, virtual_address, length, access);
+  if (!lkey.has_value()) {
+    ++stats_.errors;
+    return std::nullopt;
+  }
+  for (std::size_t shard_idx = 1; shard_idx < shards_.size(); ++shard_idx) {
+    if (shards_[shard_idx]->engine->register_mr(pd_handle, virtual_address, length, access)
+        != lkey) {
+      for (std::size_t undo_idx = 0; undo_idx <= shard_idx; ++undo_idx) {
+        shards_[undo_idx]->engine->deregister_mr(*lkey);
+      }
+      ++stats_.errors;
+      NIC_LOGF_WARNING("MR replication failed on shard {}", shard_idx);
+      return std::nullopt;
+    }
+  }
+  ++stats_.replicated_ops;
+  return lkey;
+}
+
+bool ShardedRdmaEngine::deregister_mr(std::uint32_t lkey) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::lock_guard control(control_mutex_);
+  auto locks = lock_all_shards();
+
+  bool deregistered = true;
+  for (auto& shard : shards_) {
+    deregistered = shard->engine->deregister_mr(lkey) && deregistered;
+  }
+  if (!deregistered) {
+    ++stats_.errors;
+    return false;
+  }
+  ++stats_.replicated_ops;
+  return true;
+}
+
+std::optional<std::uint32_t> ShardedRdmaEngine::query_rkey(std::uint32_t lkey) {
+  NIC_TRACE_SCOPED(__func__);
+
+  Shard& shard = *shards_.front();
+  std::lock_guard lock(shard.mutex);
+  const MemoryRegion* mr = shard.engine->mr_table().get_by_lkey(lkey);
+  if (mr == nullptr) {
+    return std::nullopt;
+  }
+  return mr->rkey;
+}
+
+std::optional<std::uint32_t> ShardedRdmaEngine::create_ah(std::uint32_t pd_handle,
+                                                          const RdmaAhAttr& attr) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::lock_guard control(control_mutex_);
+  auto locks = lock_all_shards();
+
+  std::optional<std::uint32_t> ah_handle = shards_.front()->engine->create_ah(pd_handle, attr);
+  if (!ah_handle.has_value()) {
+    ++stats_.errors;
+    return std::nullopt;
+  }
+  for (std::size_t shard_idx = 1; shard_idx < shards_.size(); ++shard_idx) {
+    if (shards_[shard_idx]->engine->create_ah(pd_handle, attr) != ah_handle) {
+      for (std::size_t undo_idx = 0; undo_idx <= shard_idx; ++undo_idx) {
+        shards_[undo_idx]->engine->destroy_ah(*ah_handle);
+      }
+      ++stats_.errors;
+      NIC_LOGF_WARNING("AH replication failed on shard {}", shard_idx);
+      return std::nullopt;
+    }
+  }
+  ++stats_.replicated_ops;
+  return ah_handle;
+}
+
+bool ShardedRdmaEngine::destroy_ah(std::uint32_t ah_handle) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::lock_guard control(control_mutex_);
+  auto locks = lock_all_shards();
+
+  bool destroyed = true;
+  for (auto& shard : shards_) {
+    destroyed = shard->engine->destroy_ah(ah_handle) && destroyed;
+  }
+  if (!destroyed) {
+    ++stats_.errors;
+    return false;
+  }
+  ++stats_.replicated_ops;
+  return true;
+}
+
+// ============================================
+// Shard-Local Resources
+// ============================================
+
+std::optional<std::size_t> ShardedRdmaEngine::shard_of(std::uint32_t object_number) const noexcept {
+  std::uint32_t first = config_.engine_config.first_object_number;
+  if (object_number < first) {
+    return std::nullopt;
+  }
+  return (object_number - first) % shards_.size();
+}
+
+ShardedRdmaEngine::Shard* ShardedRdmaEngine::owning_shard(std::uint32_t object_number) noexcept {
+  std::optional<std::size_t> shard_idx = shard_of(object_number);
+  return shard_idx.has_value() ? shards_[*shard_idx].get() : nullptr;
+}
+
+std::optional<std::uint32_t> ShardedRdmaEngine::create_cq(std::size_t depth) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::lock_guard control(control_mutex_);
+  Shard& shard = *shards_[next_shard_];
+  next_shard_ = (next_shard_ + 1) % shards_.size();
+
+  std::lock_guard lock(shard.mutex);
+  return shard.engine->create_cq(depth);
+}
+
+bool ShardedRdmaEngine::destroy_cq(std::uint32_t cq_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  Shard* shard = owning_shard(cq_number);
+  if (shard == nullptr) {
+    ++stats_.errors;
+    return false;
+  }
+  std::lock_guard lock(shard->mutex);
+  return shard->engine->destroy_cq(cq_number);
+}
+
+std::size_t ShardedRdmaEngine::poll_cq(std::uint32_t cq_number, std::span<RdmaCqe> out) {
+  NIC_TRACE_SCOPED(__func__);
+
+  Shard* shard = owning_shard(cq_number);
+  if (shard == nullptr) {
+    return 0;
+  }
+  std::lock_guard lock(shard->mutex);
+  return shard->engine->poll_cq(cq_number, out);
+}
+
+std::optional<std::uint32_t> ShardedRdmaEngine::create_srq(std::size_t depth, std::size_t limit) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::lock_guard control(control_mutex_);
+  Shard& shard = *shards_[next_shard_];
+  next_shard_ = (next_shard_ + 1) % shards_.size();
+
+  std::lock_guard lock(shard.mutex);
+  return shard.engine->create_srq(depth, limit);
+}
+
+bool ShardedRdmaEngine::destroy_srq(std::uint32_t srq_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  Shard* shard = owning_shard(srq_number);
+  if (shard == nullptr) {
+    ++stats_.errors;
+    return false;
+  }
+  std::lock_guard lock(shard->mutex);
+  return shard->engine->destroy_srq(srq_number);
+}
+
+bool ShardedRdmaEngine::post_srq_recv(std::uint32_t srq_number, const RecvWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  Shard* shard = owning_shard(srq_number);
+  if (shard == nullptr) {
+    ++stats_.errors;
+    return false;
+  }
+  std::lock_guard lock(shard->mutex);
+  return shard->engine->post_srq_recv(srq_number, wqe);
+}
+
+std::optional<std::uint32_t> ShardedRdmaEngine::create_qp(const RdmaQpConfig& config) {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::optional<std::size_t> shard_idx = shard_of(config.send_cq_number);
+  bool same_shard = shard_idx.has_value() && (shard_of(config.recv_cq_number) == shard_idx)
+                    && ((config.srq_number == 0) || (shard_of(config.srq_number) == shard_idx));
+  if (!same_shard) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("QP creation failed: send_cq={} recv_cq={} srq={} are not on one shard",
+                     config.send_cq_number,
+                     config.recv_cq_number,
+                     config.srq_number);
+    return std::nullopt;
+  }
+
+  Shard& shard = *shards_[*shard_idx];
+  std::lock_guard lock(shard.mutex);
+  return shard.engine->create_qp(config);
+}
+
+bool ShardedRdmaEngine::destroy_qp(std::uint32_t qp_number) {
+  NIC_TRACE_SCOPED(__func__);
+
+  Shard* shard = owning_shard(qp_number);
+  if (shard == nullptr) {
+    ++stats_.errors;
+    return false;
+  }
+  std::lock_guard lock(shard->mutex);
+  return shard->engine->destroy_qp(qp_number);
+}
+
+bool ShardedRdmaEngine::modify_qp(std::uint32_t qp_number, const RdmaQpModifyParams& params) {
+  NIC_TRACE_SCOPED(__func__);
+
+  Shard* shard = owning_shard(qp_number);
+  if (shard == nullptr) {
+    ++stats_.errors;
+    return false;
+  }
+  std::lock_guard lock(shard->mutex);
+  return shard->engine->modify_qp(qp_number, params);
+}
+
+bool ShardedRdmaEngine::post_send(std::uint32_t qp_number, const SendWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+  return post_send_list(qp_number, std::span<const SendWqe>(&wqe, 1)) == 1;
+}
+
+bool ShardedRdmaEngine::post_recv(std::uint32_t qp_number, const RecvWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+  return post_recv_list(qp_number, std::span<const RecvWqe>(&wqe, 1)) == 1;
+}
+
+std::size_t ShardedRdmaEngine::post_send_list(std::uint32_t qp_number,
+                                              std::span<const SendWqe> wqes) {
+  NIC_TRACE_SCOPED(__func__);
+
+  Shard* shard = owning_shard(qp_number);
+  if (shard == nullptr) {
+    ++stats_.errors;
+    return 0;
+  }
+
+  // Memory-key WQEs would change only this shard's MR replica: post up to the first one
+  auto changes_keys = [](const SendWqe& wqe) {
+    return (wqe.opcode == WqeOpcode::RegMr) || (wqe.opcode == WqeOpcode::LocalInvalidate)
+           || (wqe.opcode == WqeOpcode::BindMw)
+           || (wqe.opcode == WqeOpcode::SendWithInvalidate);
+  };
+  auto first_key_wqe = std::find_if(wqes.begin(), wqes.end(), changes_keys);
+  auto postable = wqes.first(static_cast<std::size_t>(first_key_wqe - wqes.begin()));
+
+  std::size_t posted = 0;
+  {
+    std::lock_guard lock(shard->mutex);
+    posted = postable.empty() ? 0 : shard->engine->post_send_list(qp_number, postable);
+  }
+  if ((posted == postable.size()) && (first_key_wqe != wqes.end())) {
+    ++stats_.errors;
+    NIC_LOGF_WARNING("post_send failed: qp={} memory-key WQE {} is not supported on shards",
+                     qp_number,
+                     static_cast<int>(first_key_wqe->opcode));
+  }
+  return posted;
+}
+
+std::size_t ShardedRdmaEngine::post_recv_list(std::uint32_t qp_number,
+                                              std::span<const RecvWqe> wqes) {
+  NIC_TRACE_SCOPED(__func__);
+
+  Shard* shard = owning_shard(qp_number);
+  if (shard == nullptr) {
+    ++stats_.errors;
+    return 0;
+  }
+  std::lock_guard lock(shard->mutex);
+  return shard->engine->post_recv_list(qp_number, wqes);
+}
+
+// ============================================
+// Packet Processing
+// ============================================
+
+bool ShardedRdmaEngine::deliver_packet(std::span<const std::byte> udp_payload,
+                                       std::array<std::uint8_t, 4> src_ip,
+                                       std::array<std::uint8_t, 4> dst_ip,
+                                       std::uint16_t src_port) {
+  NIC_TRACE_SCOPED(__func__);
+
+  // Destination QP is BTH bytes 5-7 (big-endian); no need for a full parse to route
+  Shard* shard = nullptr;
+  if (udp_payload.size() >= kBthSize) {
+    std::uint32_t dest_qp = (std::to_integer<std::uint32_t>(udp_payload[5]) << 16)
+                            | (std::to_integer<std::uint32_t>(udp_payload[6]) << 8)
+                            | std::to_integer<std::uint32_t>(udp_payload[7]);
+    shard = owning_shard(dest_qp);
+  }
+  if (shard == nullptr) {
+    ++stats_.unroutable_packets;
+    return false;
+  }
+  ++stats_.packets_routed;
+
+  std::unique_lock lock(shard->mutex);
+  if (!running_) {
+    return shard->engine->process_incoming_packet(udp_payload, src_ip, dst_ip, src_port);
+  }
+
+  if (shard->inbox.size() >= config_.max_inbox_packets) {
+    ++stats_.packets_dropped;
+    return false;
+  }
+  shard->inbox.push_back(InboundPacket{
+      .data = std::vector<std::byte>(udp_payload.begin(), udp_payload.end()),
+      .src_ip = src_ip,
+      .dst_ip = dst_ip,
+      .src_port = src_port,
+  });
+  ++stats_.packets_queued;
+  lock.unlock();
+  shard->wake.notify_one();
+  return true;
+}
+
+std::vector<OutgoingPacket> ShardedRdmaEngine::generate_outgoing_packets(std::size_t shard) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (shard >= shards_.size()) {
+    return {};
+  }
+  std::lock_guard lock(shards_[shard]->mutex);
+  return shards_[shard]->engine->generate_outgoing_packets();
+}
+
+std::vector<OutgoingPacket> ShardedRdmaEngine::generate_outgoing_packets() {
+  NIC_TRACE_SCOPED(__func__);
+
+  std::vector<OutgoingPacket> packets;
+  for (std::size_t shard_idx = 0; shard_idx < shards_.size(); ++shard_idx) {
+    std::vector<OutgoingPacket> shard_packets = generate_outgoing_packets(shard_idx);
+    packets.insert(packets.end(),
+                   std::make_move_iterator(shard_packets.begin()),
+                   std::make_move_iterator(shard_packets.end()));
+  }
+  return packets;
+}
+
+void ShardedRdmaEngine::advance_time(std::uint64_t elapsed_us) {
+  NIC_TRACE_SCOPED(__func__);
+
+  for (auto& shard : shards_) {
+    std::lock_guard lock(shard->mutex);
+    shard->engine->advance_time(elapsed_us);
+  }
+}
+
+RdmaEngineStats ShardedRdmaEngine::shard_stats(std::size_t shard) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (shard >= shards_.size()) {
+    return {};
+  }
+  std::lock_guard lock(shards_[shard]->mutex);
+  return shards_[shard]->engine->stats();
+}
+
+}  // namespace nic::rocev2
@@ -0,0 +1,68 @@
+#include "nic/rocev2/srq.h"
+
+namespace nic::rocev2 {
+
+RdmaSharedReceiveQueue::RdmaSharedReceiveQueue(std::uint32_t srq_number, RdmaSrqConfig config)
+  : srq_number_(srq_number), config_(config), limit_(config.limit) {
+  NIC_TRACE_SCOPED(__func__);
+}
+
+bool RdmaSharedReceiveQueue::post_recv(const RecvWqe& wqe) {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (is_full()) {
+    ++stats_.overflows;
+    return false;
+  }
+
+  recv_queue_.push_back(wqe);
+  ++stats_.recv_wqes_posted;
+  return true;
+}
+
+std::optional<RecvWqe> RdmaSharedReceiveQueue::consume_recv() {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (recv_queue_.empty()) {
+    ++stats_.empty_consumes;
+    return std::nullopt;
+  }
+
+  RecvWqe wqe = recv_queue_.front();
+  recv_queue_.pop_front();
+  ++stats_.recv_wqes_consumed;
+
+  if ((limit_ > 0) && (recv_queue_.size() < limit_)) {
+    // One-shot: latch the event and disarm until the consumer re-arms
+    limit_event_pending_ = true;
+    limit_ = 0;
+    ++stats_.limit_events;
+  }
+
+  return wqe;
+}
+
+void RdmaSharedReceiveQueue::arm(std::size_t limit) noexcept {
+  NIC_TRACE_SCOPED(__func__);
+  limit_ = limit;
+}
+
+bool RdmaSharedReceiveQueue::take_limit_event() noexcept {
+  NIC_TRACE_SCOPED(__func__);
+
+  if (!limit_event_pending_) {
+    return false;
+  }
+  limit_event_pending_ = false;
+  return true;
+}
+
+void RdmaSharedReceiveQueue::reset() {
+  NIC_TRACE_SCOPED(__func__);
+  recv_queue_.clear();
+  limit_ = config_.limit;
+  limit_event_pending_ = false;
+  stats_ = RdmaSrqStats{};
+}
+
+}  // namespace nic::rocev2
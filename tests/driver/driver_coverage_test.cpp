@@ -159,6 +159,8 @@ void test_rdma_methods_no_engine() {
   // poll_cq should return empty
   auto cqes = driver.poll_cq(CqHandle{1}, 10);
   assert(cqes.empty());
+  std::array<RdmaCqe, 4> cqe_buffer{};
+  assert(driver.poll_cq(CqHandle{1}, std::span<RdmaCqe>(cqe_buffer)) == 0);
 
   // create_qp should return nullopt
   RdmaQpConfig config;
@@ -184,6 +186,18 @@ void test_rdma_methods_no_engine() {
   bool post_recv_result = driver.post_recv(QpHandle{1}, recv_wqe);
   assert(!post_recv_result);
 
+  // List variants post nothing
+  std::array<SendWqe, 2> send_wqes{};
+  assert(driver.post_send_list(QpHandle{1}, send_wqes) == 0);
+  std::array<RecvWqe, 2> recv_wqes{};
+  assert(driver.post_recv_list(QpHandle{1}, recv_wqes) == 0);
+
+  // Host-ring posts and doorbell writes have no engine to reach
+  assert(!driver.post_send_doorbell(QpHandle{1}, send_wqe));
+  assert(!driver.post_send_blueflame(QpHandle{1}, send_wqe));
+  std::array<std::byte, sizeof(nic::rocev2::RdmaSqDoorbell)> record{};
+  assert(!driver.device()->write_doorbell(nic::rocev2::kRdmaSqDoorbellOffset, record));
+
   std::printf("    PASSED\n");
 }
 
@@ -216,6 +230,62 @@ void test_deregister_mr() {
   std::printf("    PASSED\n");
 }
 
+/// Host send ring posts go through the BAR2 doorbell page.
+void test_post_send_ring() {
+  std::printf("  test_post_send_ring...\n");
+  NIC_TRACE_SCOPED(__func__);
+
+  NicDriver driver;
+  driver.init(create_rdma_device());
+
+  auto pd = driver.create_pd();
+  auto cq = driver.create_cq(64);
+  assert(pd.has_value() && cq.has_value());
+
+  RdmaQpConfig qp_config;
+  qp_config.pd_handle = pd->value;
+  qp_config.send_cq_number = cq->value;
+  qp_config.recv_cq_number = cq->value;
+  auto plain_qp = driver.create_qp(qp_config);
+  qp_config.send_queue_depth = 16;
+  qp_config.sq_ring_address = 0x10000;
+  auto ring_qp = driver.create_qp(qp_config);
+  assert(plain_qp.has_value() && ring_qp.has_value());
+
+  RdmaQpModifyParams params;
+  params.target_state = QpState::Init;
+  assert(driver.modify_qp(*ring_qp, params));
+  params.target_state = QpState::Rtr;
+  params.dest_qp_number = ring_qp->value;
+  params.rq_psn = 0;
+  params.dest_ip = std::array<std::uint8_t, 4>{10, 0, 0, 1};
+  assert(driver.modify_qp(*ring_qp, params));
+  params = RdmaQpModifyParams{};
+  params.target_state = QpState::Rts;
+  params.sq_psn = 0;
+  assert(driver.modify_qp(*ring_qp, params));
+
+  SendWqe wqe;
+  wqe.wr_id = 1;
+  wqe.opcode = WqeOpcode::Send;
+  assert(!driver.post_send_doorbell(*plain_qp, wqe));
+  assert(driver.post_send_doorbell(*ring_qp, wqe));
+  wqe.wr_id = 2;
+  assert(driver.post_send_blueflame(*ring_qp, wqe));
+
+  const auto& stats = driver.device()->rdma_engine()->stats();
+  assert(stats.sq_doorbells == 1);
+  assert(stats.sq_wqes_fetched == 1);
+  assert(stats.blueflame_wqes == 1);
+
+  // Writes outside the doorbell registers are not decoded
+  std::array<std::byte, 4> word{};
+  assert(!driver.device()->write_doorbell(0x0040, word));
+  assert(!driver.device()->write_doorbell(16 * 1024, word));
+
+  std::printf("    PASSED\n");
+}
+
 /// rdma_generate_packets on uninit driver should return empty.
 void test_rdma_generate_packets_uninit() {
   std::printf("  test_rdma_generate_packets_uninit...\n");
@@ -352,6 +422,7 @@ int main() {
   test_rdma_enabled_no_rdma();
   test_rdma_methods_no_engine();
   test_deregister_mr();
+  test_post_send_ring();
   test_rdma_generate_packets_uninit();
   test_rdma_process_packet_uninit();
   test_clear_stats_uninitialized();
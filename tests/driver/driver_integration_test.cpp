@@ -1,11 +1,14 @@
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #include "nic/device.h"
+#include "nic/interrupt_dispatcher.h"
 #include "nic/packet_generator.h"
 #include "nic/simple_host_memory.h"
 #include "nic_driver/driver.h"
@@ -177,6 +180,265 @@ void test_device_access() {
   std::cout << "PASS\n";
 }
 
+/// Push one RX descriptor for a frame of up to 2 KB at rx_buffer_addr.
+void push_rx_descriptor(nic::Device& device, nic::HostAddress rx_buffer_addr) {
+  nic::RxDescriptor rx_desc{};
+  rx_desc.buffer_address = rx_buffer_addr;
+  rx_desc.buffer_length = 2048;
+  std::vector<std::byte> rx_desc_bytes(sizeof(nic::RxDescriptor));
+  std::memcpy(rx_desc_bytes.data(), &rx_desc, sizeof(nic::RxDescriptor));
+  [[maybe_unused]] auto result = device.queue_pair()->rx_ring().push_descriptor(rx_desc_bytes);
+  assert(result.ok());
+}
+
+void test_tx_buffer_recycling() {
+  std::cout << "Test: TX buffers recycled on completion... ";
+
+  NicDriver driver{};
+  driver.init(create_test_device());
+  const std::size_t capacity = driver.tx_buffers_available();
+  assert(capacity == 64);  // One buffer per TX ring slot
+
+  // Far more packets than buffers: every completion must return its buffer
+  std::vector<std::byte> packet(128, std::byte{0x5A});
+  for (std::size_t idx = 0; idx < capacity * 20; ++idx) {
+    push_rx_descriptor(*driver.device(), 0x20000);
+    [[maybe_unused]] bool sent = driver.send_packet(packet);
+    assert(sent);
+    [[maybe_unused]] bool processed = driver.process();
+    assert(processed);
+  }
+  [[maybe_unused]] auto stats = driver.get_stats();
+  assert(stats.tx_packets == capacity * 20);
+  assert(stats.tx_completions == capacity * 20);
+  assert(stats.tx_no_buffer == 0);
+  assert(driver.tx_buffers_available() == capacity);
+
+  // Frames larger than a buffer are refused up front
+  std::vector<std::byte> jumbo(4096);
+  assert(!driver.send_packet(jumbo));
+
+  std::cout << "PASS\n";
+}
+
+void test_zero_copy_send() {
+  std::cout << "Test: Zero-copy TX buffer... ";
+
+  NicDriver driver{};
+  DriverConfig config{.buffer_size = 1024, .tx_buffers = 4};
+  driver.init(create_test_device(), config);
+  assert(driver.tx_buffers_available() == 4);
+
+  // The frame is written straight into host memory
+  auto buffer = driver.alloc_tx_buffer();
+  assert(buffer.has_value());
+  assert(buffer->data.size() == 1024);
+  for (std::size_t idx = 0; idx < 96; ++idx) {
+    buffer->data[idx] = static_cast<std::byte>(idx);
+  }
+  assert(driver.send_buffer(*buffer, 96));
+  assert(!driver.send_buffer(*buffer, 2048));  // Longer than the buffer
+
+  push_rx_descriptor(*driver.device(), 0x20000);
+  assert(driver.process());
+  std::vector<std::byte> received(96);
+  [[maybe_unused]] auto read = driver.device()->host_memory().read(0x20000, received);
+  assert(read.ok());
+  for (std::size_t idx = 0; idx < received.size(); ++idx) {
+    assert(received[idx] == static_cast<std::byte>(idx));
+  }
+  assert(driver.tx_buffers_available() == 4);
+
+  // Exhaust the pool: allocation fails until a buffer comes back
+  std::vector<TxBuffer> held;
+  while (auto next = driver.alloc_tx_buffer()) {
+    held.push_back(*next);
+  }
+  assert(held.size() == 4);
+  assert(driver.get_stats().tx_no_buffer == 1);
+  assert(driver.free_tx_buffer(held.back()));
+  assert(!driver.free_tx_buffer(held.back()));  // Already free
+  assert(driver.alloc_tx_buffer().has_value());
+
+  // A pool that does not fit in host memory fails init
+  NicDriver oversized{};
+  assert(!oversized.init(create_test_device(), DriverConfig{.tx_buffers = 1024}));
+  assert(!oversized.is_initialized());
+
+  std::cout << "PASS\n";
+}
+
+void test_burst_loopback() {
+  std::cout << "Test: Burst TX/RX with RX refill... ";
+
+  NicDriver driver{};
+  DriverConfig config{.buffer_size = 512, .tx_buffers = 32, .rx_buffers = 48};
+  driver.init(create_test_device(), config);
+
+  constexpr std::size_t kBurst = 16;
+  std::array<TxBuffer, kBurst> buffers{};
+  std::array<PacketRef, kBurst> packets{};
+  std::array<RxPacketView, kBurst> views{};
+  std::size_t received_total = 0;
+
+  // Many more frames than RX buffers: the ring must be refilled every round
+  for (std::size_t round = 0; round < 20; ++round) {
+    [[maybe_unused]] std::size_t allocated = driver.alloc_tx_buffers(buffers);
+    assert(allocated == kBurst);
+    for (std::size_t idx = 0; idx < kBurst; ++idx) {
+      std::size_t length = 64 + idx;
+      for (std::size_t pos = 0; pos < length; ++pos) {
+        buffers[idx].data[pos] = static_cast<std::byte>(round + idx + pos);
+      }
+      packets[idx] = PacketRef{.buffer = buffers[idx], .length = length};
+    }
+    [[maybe_unused]] std::size_t sent = driver.send_burst(packets);
+    assert(sent == kBurst);
+    [[maybe_unused]] std::size_t processed = driver.process_burst(kBurst * 2);
+    assert(processed == kBurst);
+
+    // Two half-size polls; views stay valid until the next poll
+    for (std::size_t half = 0; half < 2; ++half) {
+      std::size_t count = driver.receive_burst(std::span(views).first(kBurst / 2));
+      assert(count == kBurst / 2);
+      for (std::size_t idx = 0; idx < count; ++idx) {
+        std::size_t frame = (half * (kBurst / 2)) + idx;
+        assert(views[idx].data.size() == 64 + frame);
+        assert(views[idx].data[1] == static_cast<std::byte>(round + frame + 1));
+      }
+      received_total += count;
+    }
+  }
+  assert(driver.receive_burst(views) == 0);
+
+  [[maybe_unused]] auto stats = driver.get_stats();
+  assert(received_total == 20 * kBurst);
+  assert(stats.rx_packets == 20 * kBurst);
+  assert(stats.rx_errors == 0);
+  assert(driver.tx_buffers_available() == 32);
+
+  // Without driver RX buffers, receive_burst has nothing to return
+  NicDriver plain{};
+  plain.init(create_test_device());
+  assert(plain.receive_burst(views) == 0);
+
+  std::cout << "PASS\n";
+}
+
+void test_multi_queue() {
+  std::cout << "Test: Multi-queue I/O with per-thread queues... ";
+
+  constexpr std::size_t kQueues = 4;
+  // Every queue's RX completions fire into one shared dispatcher
+  nic::MsixTable table{1};
+  nic::MsixMapping mapping{kQueues, 0};
+  std::uint64_t delivered = 0;  // Written under the dispatcher lock
+  nic::InterruptDispatcher dispatcher{
+      table, mapping, nic::CoalesceConfig{}, [&delivered](std::uint16_t, std::uint32_t batch) {
+        delivered += batch;
+      }};
+
+  nic::DeviceConfig device_config{};
+  device_config.enable_queue_pair = false;
+  device_config.enable_queue_manager = true;
+  device_config.interrupt_dispatcher = &dispatcher;
+  for (std::size_t queue_id = 0; queue_id < kQueues; ++queue_id) {
+    nic::QueuePairConfig qp_config = device_config.queue_pair_config;
+    qp_config.queue_id = static_cast<std::uint16_t>(queue_id);
+    device_config.queue_manager_config.queue_configs.push_back(qp_config);
+  }
+  auto device = std::make_unique<nic::Device>(device_config);
+  device->reset();
+
+  NicDriver driver{};
+  DriverConfig config{.buffer_size = 512, .tx_buffers = 32, .rx_buffers = 16};
+  [[maybe_unused]] bool init_result = driver.init(std::move(device), config);
+  assert(init_result);
+  assert(driver.queue_count() == kQueues);
+
+  constexpr std::size_t kBurst = 8;
+  constexpr std::size_t kRounds = 50;
+  std::array<std::size_t, kQueues> received{};
+
+  // Each thread owns one queue end to end: alloc, fill, send, process, receive
+  std::vector<std::thread> workers;
+  for (std::size_t worker = 0; worker < kQueues; ++worker) {
+    workers.emplace_back([&driver, &received, worker] {
+      auto queue_id = static_cast<std::uint16_t>(worker);
+      [[maybe_unused]] bool bound = driver.bind_queue(queue_id);
+      assert(bound);
+
+      std::array<TxBuffer, kBurst> buffers{};
+      std::array<PacketRef, kBurst> packets{};
+      std::array<RxPacketView, kBurst> views{};
+      for (std::size_t round = 0; round < kRounds; ++round) {
+        [[maybe_unused]] std::size_t allocated = driver.alloc_tx_buffers(queue_id, buffers);
+        assert(allocated == kBurst);
+        for (std::size_t idx = 0; idx < kBurst; ++idx) {
+          std::size_t length = 64 + idx;
+          std::fill_n(buffers[idx].data.begin(), length, static_cast<std::byte>(worker + round));
+          packets[idx] = PacketRef{.buffer = buffers[idx], .length = length};
+        }
+        [[maybe_unused]] std::size_t sent = driver.send_burst(queue_id, packets);
+        assert(sent == kBurst);
+        [[maybe_unused]] std::size_t processed = driver.process_burst(queue_id, kBurst * 2);
+        assert(processed == kBurst);
+
+        std::size_t count = driver.receive_burst(queue_id, views);
+        assert(count == kBurst);
+        for (std::size_t idx = 0; idx < count; ++idx) {
+          assert(views[idx].queue_id == queue_id);
+          assert(views[idx].data.size() == 64 + idx);
+          assert(views[idx].data.back() == static_cast<std::byte>(worker + round));
+        }
+        received[worker] += count;
+      }
+      driver.reclaim_tx_buffers(queue_id);
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  for (std::size_t queue_id = 0; queue_id < kQueues; ++queue_id) {
+    [[maybe_unused]] auto stats = driver.queue_stats(static_cast<std::uint16_t>(queue_id));
+    assert(received[queue_id] == kRounds * kBurst);
+    assert(stats.tx_packets == kRounds * kBurst);
+    assert(stats.rx_packets == kRounds * kBurst);
+    assert(stats.processed == kRounds * kBurst);
+    assert(driver.tx_buffers_available(static_cast<std::uint16_t>(queue_id)) == 32);
+  }
+  [[maybe_unused]] auto total = driver.get_stats();
+  assert(total.tx_packets == kQueues * kRounds * kBurst);
+  assert(total.rx_packets == kQueues * kRounds * kBurst);
+  assert(dispatcher.stats().interrupts_fired == kQueues * kRounds * kBurst);
+  assert(delivered == kQueues * kRounds * kBurst);
+
+  // Exited threads still own their queues; the main thread is refused until it takes over,
+  // and device-wide processing, which walks every queue, is refused too
+  assert(!driver.alloc_tx_buffer(1));
+  assert(!driver.bind_queue(1));
+  assert(!driver.process());
+  assert(driver.process_burst(kBurst) == 0);
+  assert(driver.alloc_tx_buffer(static_cast<std::uint16_t>(kQueues)) == std::nullopt);
+
+  NicDriver unbound{};
+  unbound.init(create_test_device());
+  assert(unbound.queue_count() == 1);
+  assert(unbound.bind_queue(0));
+  assert(unbound.unbind_queue(0));
+  std::thread other([&unbound] {
+    [[maybe_unused]] bool bound = unbound.bind_queue(0);
+    assert(bound);
+  });
+  other.join();
+  assert(!unbound.send_packet(std::vector<std::byte>(64)));
+  assert(!unbound.process());
+  assert(!unbound.unbind_queue(0));
+
+  std::cout << "PASS\n";
+}
+
 int main() {
   std::cout << "NIC Driver Integration Tests\n";
   std::cout << "=============================\n\n";
@@ -186,6 +448,10 @@ int main() {
   test_packet_processing();
   test_statistics();
   test_device_access();
+  test_tx_buffer_recycling();
+  test_zero_copy_send();
+  test_burst_loopback();
+  test_multi_queue();
 
   std::cout << "\n=============================\n";
   std::cout << "All tests passed!\n";
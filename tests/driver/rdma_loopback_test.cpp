@@ -33,6 +33,7 @@ std::unique_ptr<nic::Device> create_rdma_device() {
   config.enable_queue_pair = false;  // Don't need Ethernet queue pair
   config.enable_rdma = true;
   config.rdma_config.mtu = 1024;
+  config.msix_table = nic::MsixTable(4);  // Vector 0 carries CQ completion events
   auto device = std::make_unique<nic::Device>(config);
   device->reset();
   return device;
@@ -84,7 +85,8 @@ struct TwoDriverSetup {
   }
 
   /// Set up RDMA resources and connect QPs.
-  void setup_connection() {
+  /// @param compress_recv_cqs Create the receive CQs with CQE compression.
+  void setup_connection(bool compress_recv_cqs = false) {
     NIC_TRACE_SCOPED(__func__);
 
     // Create PDs
@@ -96,9 +98,10 @@ struct TwoDriverSetup {
 
     // Create CQs
     auto send_cq_a_opt = driver_a->create_cq(256);
-    auto recv_cq_a_opt = driver_a->create_cq(256);
+    RdmaCqConfig recv_cq_config{.depth = 256, .compression = compress_recv_cqs};
+    auto recv_cq_a_opt = driver_a->create_cq(recv_cq_config);
     auto send_cq_b_opt = driver_b->create_cq(256);
-    auto recv_cq_b_opt = driver_b->create_cq(256);
+    auto recv_cq_b_opt = driver_b->create_cq(recv_cq_config);
     assert(send_cq_a_opt.has_value() && recv_cq_a_opt.has_value());
     assert(send_cq_b_opt.has_value() && recv_cq_b_opt.has_value());
     send_cq_a = *send_cq_a_opt;
@@ -544,6 +547,251 @@ void test_qp_state_transitions() {
   std::printf("    PASSED\n");
 }
 
+// Test multipath QPs spread one connection across ECMP paths
+void test_multipath_ecmp_spread() {
+  std::printf("  test_multipath_ecmp_spread...\n");
+  NIC_TRACE_SCOPED(__func__);
+
+  TwoDriverSetup setup;
+  setup.setup_connection();
+
+  // Counts the ECMP paths used by one 8-packet WRITE from A to B
+  auto paths_used = [&setup](std::uint64_t wr_id) {
+    setup.router.set_ecmp_paths(8);
+    SendWqe wqe;
+    wqe.wr_id = wr_id;
+    wqe.opcode = WqeOpcode::RdmaWrite;
+    wqe.sgl.push_back(nic::SglEntry{.address = 0x1000, .length = 8 * 1024});
+    wqe.total_length = 8 * 1024;
+    wqe.local_lkey = setup.mr_a.lkey;
+    wqe.remote_address = 0x4000;
+    wqe.rkey = setup.mr_b.rkey;
+    assert(setup.driver_a->post_send(setup.qp_a, wqe));
+    setup.transfer_packets();  // WRITE packets only; ACKs stay queued on B
+
+    std::uint64_t routed = 0;
+    std::size_t used = 0;
+    for (std::uint64_t count : setup.router.path_packets()) {
+      routed += count;
+      used += (count != 0) ? 1 : 0;
+    }
+    assert(routed == 8);
+    while (setup.router.process_all() != 0) {
+    }
+    return used;
+  };
+
+  // The default flow hash keeps the connection on one path
+  assert(paths_used(1) == 1);
+
+  RdmaQpModifyParams params;
+  params.src_port = SrcPortConfig{.mode = SrcPortMode::Multipath, .path_count = 8};
+  assert(setup.driver_a->modify_qp(setup.qp_a, params));
+  std::size_t sprayed = paths_used(2);
+  std::printf("    multipath QP used %zu of 8 ECMP paths\n", sprayed);
+  assert(sprayed > 1);
+
+  auto cqes = setup.driver_a->poll_cq(setup.send_cq_a, 10);
+  assert(cqes.size() == 2);
+  for (const auto& cqe : cqes) {
+    assert(cqe.status == WqeStatus::Success);
+  }
+
+  // The path choice is a pure function of the 5-tuple
+  std::size_t path = PacketRouter::ecmp_path(TwoDriverSetup::kIpA,
+                                             TwoDriverSetup::kIpB,
+                                             0xC001,
+                                             nic::rocev2::kRoceUdpPort,
+                                             8);
+  assert(path == PacketRouter::ecmp_path(TwoDriverSetup::kIpA,
+                                         TwoDriverSetup::kIpB,
+                                         0xC001,
+                                         nic::rocev2::kRoceUdpPort,
+                                         8));
+  assert(path < 8);
+
+  std::printf("    PASSED\n");
+}
+
+// Test completion-channel events: solicited-only arming and moderation by count and period
+void test_completion_channel_events() {
+  std::printf("  test_completion_channel_events...\n");
+  NIC_TRACE_SCOPED(__func__);
+
+  TwoDriverSetup setup;
+  setup.setup_connection();
+  auto progress = [&setup]() { setup.transfer_packets(); };
+
+  for (std::uint64_t idx = 0; idx < 8; ++idx) {
+    RecvWqe recv_wqe;
+    recv_wqe.wr_id = 100 + idx;
+    recv_wqe.sgl.push_back(nic::SglEntry{.address = 0x2000, .length = 512});
+    assert(setup.driver_b->post_recv(setup.qp_b, recv_wqe));
+  }
+  auto send = [&setup](std::uint64_t wr_id, bool solicited) {
+    SendWqe wqe;
+    wqe.wr_id = wr_id;
+    wqe.opcode = WqeOpcode::Send;
+    wqe.sgl.push_back(nic::SglEntry{.address = 0x1000, .length = 64});
+    wqe.total_length = 64;
+    wqe.local_lkey = setup.mr_a.lkey;
+    wqe.solicited = solicited;
+    assert(setup.driver_a->post_send(setup.qp_a, wqe));
+  };
+
+  // Solicited-only: the plain SEND completes silently, the solicited one wakes the waiter
+  assert(setup.driver_b->req_notify_cq(setup.recv_cq_b, true));
+  send(1, false);
+  assert(!setup.driver_b->get_cq_event(20, progress).has_value());
+  send(2, true);
+  auto event = setup.driver_b->get_cq_event(20, progress);
+  assert(event.has_value() && (event->cq_number == setup.recv_cq_b.value));
+  assert(event->cqes == 1);
+  auto recv_cqes = setup.driver_b->poll_cq(setup.recv_cq_b, 10);
+  assert((recv_cqes.size() == 2) && !recv_cqes[0].solicited && recv_cqes[1].solicited);
+  assert(setup.driver_b->device()->interrupt_stats().per_vector_fired.at(0) == 1);
+
+  // Moderation: two CQEs stay below cq_count, so the event waits out cq_period
+  setup.transfer_packets();  // ACK of the solicited SEND
+  while (!setup.driver_a->poll_cq(setup.send_cq_a, 10).empty()) {
+  }
+  assert(setup.driver_a->modify_cq(setup.send_cq_a, {.cq_count = 4, .cq_period_us = 50}));
+  assert(setup.driver_a->req_notify_cq(setup.send_cq_a));
+  send(3, false);
+  send(4, false);
+  event = setup.driver_a->get_cq_event(100, progress);
+  assert(event.has_value() && (event->cqes == 2));
+  const auto& stats = setup.driver_a->device()->rdma_engine()->stats();
+  assert(stats.cq_event_timeouts == 1);
+
+  // Four CQEs reach cq_count well before the period ends
+  assert(setup.driver_a->req_notify_cq(setup.send_cq_a));
+  for (std::uint64_t wr_id = 5; wr_id < 9; ++wr_id) {
+    send(wr_id, false);
+  }
+  event = setup.driver_a->get_cq_event(100, progress);
+  assert(event.has_value() && (event->cqes == 4));
+  assert((stats.cq_events == 2) && (stats.cq_event_timeouts == 1));
+  assert(setup.driver_a->poll_cq(setup.send_cq_a, 10).size() == 6);
+
+  // Once the traffic settles the wait jumps to the moderation deadline, not 1 us at a time
+  assert(setup.driver_a->modify_cq(setup.send_cq_a, {.cq_count = 4, .cq_period_us = 5000}));
+  assert(setup.driver_a->req_notify_cq(setup.send_cq_a));
+  RecvWqe recv_wqe;
+  recv_wqe.wr_id = 108;
+  recv_wqe.sgl.push_back(nic::SglEntry{.address = 0x2000, .length = 512});
+  assert(setup.driver_b->post_recv(setup.qp_b, recv_wqe));
+  send(9, false);
+  std::size_t rounds = 0;
+  auto counted = [&setup, &rounds]() {
+    ++rounds;
+    setup.transfer_packets();
+  };
+  event = setup.driver_a->get_cq_event(10000, counted);
+  assert(event.has_value() && (event->cqes == 1));
+  assert(stats.cq_event_timeouts == 2);
+  assert(rounds < 10);
+
+  std::printf("    PASSED\n");
+}
+
+// Test a burst of small SENDs into a compressed receive CQ
+void test_compressed_recv_cq() {
+  std::printf("  test_compressed_recv_cq...\n");
+  NIC_TRACE_SCOPED(__func__);
+
+  TwoDriverSetup setup;
+  setup.setup_connection(true);
+
+  constexpr std::uint64_t kMessages = 32;
+  for (std::uint64_t idx = 0; idx < kMessages; ++idx) {
+    RecvWqe recv_wqe;
+    recv_wqe.wr_id = 5000 + idx;
+    recv_wqe.sgl.push_back(nic::SglEntry{.address = 0x2000 + (idx * 64), .length = 64});
+    assert(setup.driver_b->post_recv(setup.qp_b, recv_wqe));
+
+    SendWqe send_wqe;
+    send_wqe.wr_id = idx;
+    send_wqe.opcode = WqeOpcode::Send;
+    send_wqe.sgl.push_back(nic::SglEntry{.address = 0x1000, .length = 16 + idx});
+    send_wqe.total_length = static_cast<std::uint32_t>(16 + idx);
+    send_wqe.local_lkey = setup.mr_a.lkey;
+    assert(setup.driver_a->post_send(setup.qp_a, send_wqe));
+  }
+  setup.transfer_packets();
+
+  // The driver sees ordinary CQEs; the ring saw mostly mini-CQEs
+  auto cqes = setup.driver_b->poll_cq(setup.recv_cq_b, kMessages);
+  assert(cqes.size() == kMessages);
+  for (std::uint64_t idx = 0; idx < kMessages; ++idx) {
+    assert(cqes[idx].wr_id == 5000 + idx);
+    assert(cqes[idx].bytes_completed == 16 + idx);
+    assert((cqes[idx].status == WqeStatus::Success) && (cqes[idx].qp_number == setup.qp_b.value));
+  }
+  const auto* cq = setup.driver_b->device()->rdma_engine()->query_cq(setup.recv_cq_b.value);
+  assert(cq->stats().compressed_cqes == kMessages - 1);
+  std::printf("    %.1f ring bytes per CQE (full slot %zu)\n",
+              cq->stats().bytes_per_cqe(),
+              nic::rocev2::kCqeSlotSize);
+  assert(cq->stats().bytes_per_cqe() < nic::rocev2::kCqeSlotSize / 2.0);
+  std::printf("    PASSED\n");
+}
+
+// Test bulk connection setup: many QPs created, brought up and torn down in batches
+void test_bulk_qp_setup() {
+  std::printf("  test_bulk_qp_setup...\n");
+  NIC_TRACE_SCOPED(__func__);
+
+  NicDriver driver;
+  driver.init(create_rdma_device());
+
+  auto pd = driver.create_pd();
+  auto cq = driver.create_cq(256);
+  assert(pd.has_value() && cq.has_value());
+
+  std::vector<RdmaMrRegion> regions(4, RdmaMrRegion{.length = 0x1000});
+  for (std::size_t idx = 0; idx < regions.size(); ++idx) {
+    regions[idx].virtual_address = 0x1000 * idx;
+  }
+  std::vector<MrHandle> mrs = driver.register_mrs(*pd, regions);
+  assert(mrs.size() == regions.size());
+
+  RdmaQpConfig config;
+  config.pd_handle = pd->value;
+  config.send_cq_number = cq->value;
+  config.recv_cq_number = cq->value;
+  constexpr std::size_t kQps = 32;
+  std::vector<QpHandle> qps = driver.create_qps(std::vector<RdmaQpConfig>(kQps, config));
+  assert(qps.size() == kQps);
+
+  RdmaQpModifyParams init;
+  init.target_state = QpState::Init;
+  assert(driver.modify_qps(qps, std::span(&init, 1)) == kQps);
+  std::vector<RdmaQpModifyParams> rtr(kQps);
+  for (std::size_t idx = 0; idx < kQps; ++idx) {
+    rtr[idx].target_state = QpState::Rtr;
+    rtr[idx].dest_qp_number = 1000 + static_cast<std::uint32_t>(idx);
+    rtr[idx].dest_ip = {192, 168, 1, 2};
+  }
+  assert(driver.modify_qps(qps, rtr) == kQps);
+  RdmaQpModifyParams rts;
+  rts.target_state = QpState::Rts;
+  assert(driver.modify_qps(qps, std::span(&rts, 1)) == kQps);
+
+  // Teardown order is enforced: the PD and CQ outlive everything created in them
+  assert(!driver.destroy_cq(*cq));
+  for (QpHandle qp : qps) {
+    assert(driver.destroy_qp(qp));
+  }
+  assert(!driver.destroy_pd(*pd));
+  for (MrHandle mr : mrs) {
+    assert(driver.deregister_mr(mr));
+  }
+  assert(driver.destroy_cq(*cq));
+  assert(driver.destroy_pd(*pd));
+  std::printf("    PASSED\n");
+}
+
 }  // namespace
 
 int main() {
@@ -558,6 +806,10 @@ int main() {
   test_two_driver_rdma_write();
   test_two_driver_rdma_read();
   test_two_driver_bidirectional();
+  test_multipath_ecmp_spread();
+  test_completion_channel_events();
+  test_compressed_recv_cq();
+  test_bulk_qp_setup();
 
   std::printf("All RDMA loopback tests PASSED!\n");
   return 0;
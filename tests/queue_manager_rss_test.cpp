@@ -8,6 +8,7 @@
 #include "nic/device.h"
 #include "nic/dma_engine.h"
 #include "nic/queue_manager.h"
+#include "nic/rocev2/encap.h"
 #include "nic/rss.h"
 #include "nic/simple_host_memory.h"
 #include "nic/trace.h"
@@ -377,12 +378,124 @@ void test_queue_manager_edge_cases() {
   const QueueManager& cqm = qm;
   assert(cqm.queue(0) != nullptr);
   assert(cqm.queue(1) == nullptr);
+  assert(cqm.queue(0)->config().tx_ring.ring_size == 2);
 
   assert(!qm.process_once());
+  assert(!qm.process_queue(0));  // Idle
+  assert(!qm.process_queue(1));  // Out of range
 }
 
 }  // namespace
 
+void test_roce_traffic_class() {
+  NIC_TRACE_SCOPED(__func__);
+  HostMemoryConfig mem_cfg{.size_bytes = 4096, .page_size = 64, .iommu_enabled = false};
+  SimpleHostMemory mem{mem_cfg};
+  DMAEngine dma{mem};
+
+  QueuePairConfig qp0{
+      .queue_id = 0,
+      .tx_ring = {.descriptor_size = sizeof(TxDescriptor),
+                  .ring_size = 8,
+                  .base_address = 0,
+                  .queue_id = 0,
+                  .host_backed = false},
+      .rx_ring = {.descriptor_size = sizeof(RxDescriptor),
+                  .ring_size = 8,
+                  .base_address = 0,
+                  .queue_id = 0,
+                  .host_backed = false},
+      .tx_completion = {.ring_size = 8, .queue_id = 0},
+      .rx_completion = {.ring_size = 8, .queue_id = 0},
+      .weight = 1,
+  };
+
+  PFCManager::Config pfc_cfg{.pfc_enabled = true};
+  pfc_cfg.priority_enabled[3] = true;
+  PFCManager pfc{pfc_cfg};
+
+  QueueManagerConfig qm_cfg;
+  qm_cfg.queue_configs = {qp0};
+  qm_cfg.roce = {.enabled = true, .priority = 3, .weight = 2, .max_queued_frames = 4};
+  qm_cfg.pfc = &pfc;
+  QueueManager qm{qm_cfg, dma};
+
+  std::vector<std::vector<std::byte>> wire;
+  qm.set_roce_egress(
+      [&wire](std::span<const std::byte> frame) { wire.emplace_back(frame.begin(), frame.end()); });
+
+  // Three Ethernet packets on queue 0
+  std::vector<std::byte> payload(16, std::byte{0x5A});
+  assert(mem.write(100, payload).ok());
+  for (std::uint16_t idx = 0; idx < 3; ++idx) {
+    TxDescriptor tx{.buffer_address = 100, .length = 16, .descriptor_index = idx};
+    RxDescriptor rx{.buffer_address = static_cast<HostAddress>(1000 + (idx * 100)),
+                    .buffer_length = 64,
+                    .descriptor_index = idx};
+    assert(qm.queue(0)->tx_ring().push_descriptor(serialize_tx(tx)).ok());
+    assert(qm.queue(0)->rx_ring().push_descriptor(serialize_rx(rx)).ok());
+  }
+
+  // Four RoCE frames fit the class buffer; the fifth is tail-dropped
+  rocev2::RoceHeaderTemplate header{rocev2::RoceFlowAttr{}};
+  std::vector<std::byte> roce_frame = header.encapsulate(payload);
+  for (int idx = 0; idx < 4; ++idx) {
+    assert(qm.enqueue_roce_frame(roce_frame));
+  }
+  assert(!qm.enqueue_roce_frame(roce_frame));
+  assert(qm.roce_queue_depth() == 4);
+
+  // Weighted round-robin: one Ethernet packet, then two RoCE frames
+  for (int idx = 0; idx < 3; ++idx) {
+    assert(qm.process_once());
+  }
+  assert(qm.queue(0)->tx_completion().available() == 1);
+  assert(wire.size() == 2);
+
+  // PFC pauses the RoCE priority; Ethernet traffic keeps flowing
+  PFCFrame pause;
+  pause.enabled_priorities = 1 << 3;
+  pause.pause_times[3] = 100;
+  pfc.on_pfc_frame_received(pause);
+  assert(qm.process_once());
+  assert(qm.process_once());
+  assert(!qm.process_once());
+  assert(qm.queue(0)->tx_completion().available() == 3);
+  assert(wire.size() == 2);
+
+  pfc.tick(100);
+  assert(qm.process_once());
+  assert(qm.process_once());
+  assert(wire.size() == 4);
+  assert(qm.roce_queue_depth() == 0);
+
+  auto stats = qm.stats();
+  assert(stats.roce_tx_frames == 4);
+  assert(stats.roce_tx_bytes == 4 * roce_frame.size());
+  assert(stats.roce_drops_queue_full == 1);
+  assert(stats.pfc_paused_skips >= 2);
+  assert(stats.total_tx_packets == 3);
+
+  // Ingress: UDP/4791 frames go to the RoCE handler, other frames to the RX ring
+  std::size_t classified = 0;
+  qm.set_roce_ingress([&classified](std::span<const std::byte>) { ++classified; });
+  RxDescriptor rx{.buffer_address = 2000, .buffer_length = 64, .descriptor_index = 3};
+  assert(qm.queue(0)->rx_ring().push_descriptor(serialize_rx(rx)).ok());
+  assert(qm.receive_frame(wire.front()));
+  assert(qm.receive_frame(payload));
+  assert(classified == 1);
+  stats = qm.stats();
+  assert(stats.roce_rx_frames == 1);
+  assert(stats.total_rx_packets == 4);
+  assert(!qm.receive_frame(payload));  // No RX descriptor left
+
+  // Disabled class rejects frames
+  QueueManagerConfig plain_cfg;
+  plain_cfg.queue_configs = {qp0};
+  QueueManager plain{plain_cfg, dma};
+  assert(!plain.enqueue_roce_frame(roce_frame));
+}
+
 int main() {
   NIC_TRACE_SCOPED(__func__);
   test_rss_basic();
@@ -393,6 +506,7 @@ int main() {
   test_rss_defaults_and_reset();
   test_queue_manager_empty_config();
   test_queue_manager_edge_cases();
+  test_roce_traffic_class();
 
   // Device wiring: two queues via QueueManager + RSS
   nic::DeviceConfig config{};
@@ -0,0 +1,540 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "nic/checksum.h"
+#include "nic/dma_engine.h"
+#include "nic/rocev2/encap.h"
+#include "nic/rocev2/engine.h"
+#include "nic/simple_host_memory.h"
+#include "nic/trace.h"
+
+using namespace nic;
+using namespace nic::rocev2;
+
+static void WaitForTracyConnection();
+
+namespace {
+
+constexpr std::array<std::uint8_t, 4> kIpA = {192, 168, 1, 1};
+constexpr std::array<std::uint8_t, 4> kIpB = {192, 168, 1, 2};
+constexpr MacAddress kMacA = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+constexpr MacAddress kMacB = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+
+[[nodiscard]] RoceFlowAttr make_flow() {
+  RoceFlowAttr flow;
+  flow.src_mac = kMacA;
+  flow.dest_mac = kMacB;
+  flow.src_ip = kIpA;
+  flow.dest_ip = kIpB;
+  flow.src_port = roce_flow_src_port(1, 2);
+  return flow;
+}
+
+[[nodiscard]] std::vector<std::byte> make_payload(std::size_t length) {
+  std::vector<std::byte> payload(length);
+  for (std::size_t idx = 0; idx < payload.size(); ++idx) {
+    payload[idx] = static_cast<std::byte>(idx * 7);
+  }
+  return payload;
+}
+
+/// Rewrite one IPv4 header byte and restore a valid header checksum.
+void patch_ipv4_byte(std::vector<std::byte>& frame,
+                     std::size_t ip_offset,
+                     std::size_t byte_offset,
+                     std::uint8_t value) {
+  frame[ip_offset + byte_offset] = static_cast<std::byte>(value);
+  frame[ip_offset + 10] = std::byte{0};
+  frame[ip_offset + 11] = std::byte{0};
+  std::uint16_t checksum = compute_checksum(std::span(frame).subspan(ip_offset, kIpv4HeaderSize));
+  frame[ip_offset + 10] = static_cast<std::byte>(checksum >> 8);
+  frame[ip_offset + 11] = static_cast<std::byte>(checksum & 0xFF);
+}
+
+// ============================================
+// Test: Template frames round-trip through the parser
+// ============================================
+
+void test_template_round_trip() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_template_round_trip...\n");
+
+  RoceHeaderTemplate header(make_flow());
+  assert(header.header_size() == kEthHeaderSize + kIpv4HeaderSize + kUdpHeaderSize);
+
+  // Frames of different sizes share the template; only lengths and checksum differ
+  for (std::size_t length : {std::size_t{16}, std::size_t{333}, std::size_t{1024}}) {
+    auto payload = make_payload(length);
+    auto frame = header.encapsulate(payload);
+    assert(frame.size() == header.header_size() + length);
+    assert(compute_checksum(std::span(frame).subspan(kEthHeaderSize, kIpv4HeaderSize)) == 0);
+
+    auto info = parse_roce_frame(frame);
+    assert(info.has_value());
+    assert(info->src_mac == kMacA);
+    assert(info->dest_mac == kMacB);
+    assert(!info->vlan_id.has_value());
+    assert(info->src_ip == kIpA);
+    assert(info->dest_ip == kIpB);
+    assert(info->ecn == EcnCodepoint::Ect0);
+    assert(info->src_port == roce_flow_src_port(1, 2));
+    assert(std::equal(info->udp_payload.begin(),
+                      info->udp_payload.end(),
+                      payload.begin(),
+                      payload.end()));
+  }
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: VLAN tag and per-packet traffic class override
+// ============================================
+
+void test_vlan_and_traffic_class() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_vlan_and_traffic_class...\n");
+
+  RoceFlowAttr flow = make_flow();
+  flow.vlan_id = 100;
+  flow.vlan_pcp = 3;
+  RoceHeaderTemplate header(flow);
+  assert(header.header_size() == kEthHeaderSize + kVlanTagSize + kIpv4HeaderSize + kUdpHeaderSize);
+
+  auto payload = make_payload(64);
+  auto cnp_class = static_cast<std::uint8_t>((kCnpDscp << 2)
+                                             | static_cast<std::uint8_t>(EcnCodepoint::Ce));
+  auto frame = header.encapsulate(payload, cnp_class);
+  std::size_t ip_offset = kEthHeaderSize + kVlanTagSize;
+  assert(compute_checksum(std::span(frame).subspan(ip_offset, kIpv4HeaderSize)) == 0);
+  assert(std::to_integer<std::uint8_t>(frame[ip_offset + 1]) == cnp_class);
+
+  auto info = parse_roce_frame(frame);
+  assert(info.has_value());
+  assert(info->vlan_id == 100);
+  assert(info->ecn == EcnCodepoint::Ce);
+  assert(info->udp_payload.size() == payload.size());
+
+  // The override applies to one packet only
+  auto data_frame = header.encapsulate(payload);
+  auto data_info = parse_roce_frame(data_frame);
+  assert(data_info.has_value() && (data_info->ecn == EcnCodepoint::Ect0));
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: Malformed outer headers are rejected
+// ============================================
+
+void test_parse_rejects_malformed() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_parse_rejects_malformed...\n");
+
+  RoceHeaderTemplate header(make_flow());
+  auto good = header.encapsulate(make_payload(32));
+  assert(parse_roce_frame(good).has_value());
+
+  // Truncated
+  assert(!parse_roce_frame(std::span(good).first(kEthHeaderSize + 10)).has_value());
+
+  // Bad IPv4 checksum
+  auto bad_checksum = good;
+  bad_checksum[kEthHeaderSize + 11] ^= std::byte{0x01};
+  assert(!parse_roce_frame(bad_checksum).has_value());
+
+  // More-fragments flag set
+  auto fragment = good;
+  patch_ipv4_byte(fragment, kEthHeaderSize, 6, 0x20);
+  assert(!parse_roce_frame(fragment).has_value());
+
+  // Not UDP
+  auto tcp = good;
+  patch_ipv4_byte(tcp, kEthHeaderSize, 9, 6);
+  assert(!parse_roce_frame(tcp).has_value());
+
+  // Not the RoCEv2 port
+  auto wrong_port = good;
+  wrong_port[kEthHeaderSize + kIpv4HeaderSize + 3] ^= std::byte{0x01};
+  assert(!parse_roce_frame(wrong_port).has_value());
+
+  // Not IPv4
+  auto ipv6 = good;
+  ipv6[12] = std::byte{0x86};
+  ipv6[13] = std::byte{0xDD};
+  assert(!parse_roce_frame(ipv6).has_value());
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: Flow-hashed UDP source ports
+// ============================================
+
+void test_flow_src_port() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_flow_src_port...\n");
+
+  assert(roce_flow_src_port(5, 9) == roce_flow_src_port(5, 9));
+  assert(roce_flow_src_port(5, 9) != roce_flow_src_port(9, 5));
+
+  std::vector<bool> seen(0x4000, false);
+  std::size_t distinct = 0;
+  for (std::uint32_t qp = 1; qp <= 256; ++qp) {
+    std::uint16_t port = roce_flow_src_port(qp, qp + 1);
+    assert(port >= kRoceSrcPortBase);
+    if (!seen[port - kRoceSrcPortBase]) {
+      seen[port - kRoceSrcPortBase] = true;
+      ++distinct;
+    }
+  }
+  assert(distinct > 240);  // Connections spread across ECMP paths
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: Engine exchanges encapsulated frames
+// ============================================
+
+/// Two connected RC QPs on one engine with encapsulation enabled.
+struct EncapSetup {
+  std::unique_ptr<SimpleHostMemory> host_memory;
+  std::unique_ptr<DMAEngine> dma_engine;
+  std::unique_ptr<RdmaEngine> engine;
+  std::uint32_t send_cq{0};
+  std::uint32_t recv_cq{0};
+  std::uint32_t qp1{0};
+  std::uint32_t qp2{0};
+  std::uint32_t mr_lkey{0};
+
+  EncapSetup() {
+    NIC_TRACE_SCOPED(__func__);
+    HostMemoryConfig mem_cfg{.size_bytes = 64 * 1024};
+    host_memory = std::make_unique<SimpleHostMemory>(mem_cfg);
+    dma_engine = std::make_unique<DMAEngine>(*host_memory);
+
+    RdmaEngineConfig engine_config;
+    engine_config.mtu = 1024;
+    engine_config.encap.enabled = true;
+    engine_config.encap.src_mac = kMacA;
+    engine_config.encap.src_ip = kIpA;
+    engine_config.encap.vlan_id = 7;
+    engine = std::make_unique<RdmaEngine>(engine_config, *dma_engine, *host_memory);
+
+    auto pd = engine->create_pd();
+    auto cq1 = engine->create_cq(256);
+    auto cq2 = engine->create_cq(256);
+    assert(pd.has_value() && cq1.has_value() && cq2.has_value());
+    send_cq = *cq1;
+    recv_cq = *cq2;
+
+    RdmaQpConfig qp_config;
+    qp_config.pd_handle = *pd;
+    qp_config.send_cq_number = send_cq;
+    qp_config.recv_cq_number = recv_cq;
+    auto qp1_opt = engine->create_qp(qp_config);
+    auto qp2_opt = engine->create_qp(qp_config);
+    assert(qp1_opt.has_value() && qp2_opt.has_value());
+    qp1 = *qp1_opt;
+    qp2 = *qp2_opt;
+
+    AccessFlags access{.local_read = true, .local_write = true};
+    auto lkey = engine->register_mr(*pd, 0x1000, 32 * 1024, access);
+    assert(lkey.has_value());
+    mr_lkey = *lkey;
+
+    RdmaQpModifyParams params;
+    params.target_state = QpState::Init;
+    assert(engine->modify_qp(qp1, params));
+    assert(engine->modify_qp(qp2, params));
+
+    params.target_state = QpState::Rtr;
+    params.rq_psn = 0;
+    params.dest_qp_number = qp2;
+    params.dest_ip = kIpB;
+    params.dest_mac = kMacB;
+    assert(engine->modify_qp(qp1, params));
+    params.dest_qp_number = qp1;
+    params.dest_ip = kIpA;
+    params.dest_mac = kMacA;
+    assert(engine->modify_qp(qp2, params));
+
+    params = RdmaQpModifyParams{};
+    params.target_state = QpState::Rts;
+    params.sq_psn = 0;
+    assert(engine->modify_qp(qp1, params));
+    assert(engine->modify_qp(qp2, params));
+  }
+
+  void post_send(std::uint64_t wr_id, std::uint32_t length) {
+    NIC_TRACE_SCOPED(__func__);
+    RecvWqe recv;
+    recv.wr_id = wr_id;
+    recv.sgl.push_back(SglEntry{.address = 0x4000, .length = 4096});
+    assert(engine->post_recv(qp2, recv));
+
+    SendWqe wqe;
+    wqe.wr_id = wr_id;
+    wqe.opcode = WqeOpcode::Send;
+    wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = length});
+    wqe.total_length = length;
+    wqe.local_lkey = mr_lkey;
+    assert(engine->post_send(qp1, wqe));
+  }
+};
+
+void test_engine_frames() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_engine_frames...\n");
+
+  EncapSetup setup;
+  setup.post_send(1, 2000);  // Two MTU-sized packets
+
+  auto packets = setup.engine->generate_outgoing_packets();
+  assert(packets.size() == 2);
+  assert(setup.engine->stats().frames_encapsulated == 2);
+  for (const auto& pkt : packets) {
+    assert(pkt.is_frame);
+    assert(pkt.src_port == roce_flow_src_port(setup.qp1, setup.qp2));
+    auto info = parse_roce_frame(pkt.data);
+    assert(info.has_value());
+    assert((info->dest_mac == kMacB) && (info->src_mac == kMacA));
+    assert(info->vlan_id == 7);
+    assert(info->dest_ip == kIpB);
+    assert(info->ecn == EcnCodepoint::Ect0);
+    assert(setup.engine->process_incoming_frame(pkt.data));
+  }
+  assert(setup.engine->stats().frames_received == 2);
+
+  auto recv_cqes = setup.engine->poll_cq(setup.recv_cq, 4);
+  assert((recv_cqes.size() == 1) && (recv_cqes[0].bytes_completed == 2000));
+
+  // ECT(0) frames do not trigger CNPs; the responder only ACKs
+  auto replies = setup.engine->generate_outgoing_packets();
+  assert(!replies.empty());
+  for (const auto& pkt : replies) {
+    auto info = parse_roce_frame(pkt.data);
+    assert(info.has_value() && (info->dest_ip == kIpA));
+    RdmaPacketParser parser;
+    assert(parser.parse(info->udp_payload));
+    assert(parser.bth().opcode == RdmaOpcode::kRcAck);
+    assert(setup.engine->process_incoming_frame(pkt.data));
+  }
+  auto send_cqes = setup.engine->poll_cq(setup.send_cq, 4);
+  assert((send_cqes.size() == 1) && (send_cqes[0].status == WqeStatus::Success));
+
+  // A CE-marked frame makes the responder return a CNP in the CNP traffic class
+  setup.post_send(2, 100);
+  packets = setup.engine->generate_outgoing_packets();
+  assert(packets.size() == 1);
+  patch_ipv4_byte(packets[0].data,
+                  kEthHeaderSize + kVlanTagSize,
+                  1,
+                  kDefaultRoceTrafficClass | static_cast<std::uint8_t>(EcnCodepoint::Ce));
+  assert(setup.engine->process_incoming_frame(packets[0].data));
+
+  bool saw_cnp = false;
+  for (const auto& pkt : setup.engine->generate_outgoing_packets()) {
+    auto info = parse_roce_frame(pkt.data);
+    assert(info.has_value());
+    RdmaPacketParser parser;
+    assert(parser.parse(info->udp_payload));
+    if (parser.bth().opcode == RdmaOpcode::kCnp) {
+      std::size_t ip_offset = kEthHeaderSize + kVlanTagSize;
+      assert((std::to_integer<std::uint8_t>(pkt.data[ip_offset + 1]) >> 2) == kCnpDscp);
+      saw_cnp = true;
+    }
+  }
+  assert(saw_cnp);
+
+  // Malformed frames are counted and dropped
+  std::vector<std::byte> runt(20);
+  std::uint64_t errors = setup.engine->stats().errors;
+  assert(!setup.engine->process_incoming_frame(runt));
+  assert(setup.engine->stats().frame_errors == 1);
+  assert(setup.engine->stats().errors == errors + 1);
+
+  // Destroying a QP drops its template from the footprint
+  std::size_t protocol_bytes = setup.engine->memory_footprint().protocol_bytes;
+  assert(setup.engine->destroy_qp(setup.qp2));
+  assert(setup.engine->memory_footprint().protocol_bytes < protocol_bytes);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: Per-QP source port policies
+// ============================================
+
+void test_src_port_modes() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_src_port_modes...\n");
+
+  EncapSetup setup;
+  RdmaEngine& engine = *setup.engine;
+  assert(roce_path_src_port(setup.qp1, setup.qp2, 0) == roce_flow_src_port(setup.qp1, setup.qp2));
+
+  // Returns the source ports of the requester's packets and delivers all traffic
+  auto exchange = [&engine]() {
+    std::vector<std::uint16_t> ports;
+    for (auto packets = engine.generate_outgoing_packets(); !packets.empty();
+         packets = engine.generate_outgoing_packets()) {
+      for (const auto& pkt : packets) {
+        auto info = parse_roce_frame(pkt.data);
+        assert(info.has_value() && (info->src_port == pkt.src_port));
+        if (info->dest_ip == kIpB) {
+          ports.push_back(pkt.src_port);
+        }
+        assert(engine.process_incoming_frame(pkt.data));
+      }
+    }
+    return ports;
+  };
+
+  // Multipath without a flowlet gap sprays consecutive packets across the paths
+  RdmaQpModifyParams params;
+  params.src_port = SrcPortConfig{.mode = SrcPortMode::Multipath, .path_count = 4};
+  assert(engine.modify_qp(setup.qp1, params));
+  setup.post_send(1, 4000);  // Four MTU-sized packets
+  auto ports = exchange();
+  assert(ports.size() == 4);
+  for (std::size_t idx = 0; idx < ports.size(); ++idx) {
+    assert(ports[idx] == roce_path_src_port(setup.qp1, setup.qp2, idx));
+  }
+  std::vector<std::uint16_t> distinct = ports;
+  std::sort(distinct.begin(), distinct.end());
+  assert(std::unique(distinct.begin(), distinct.end()) == distinct.end());
+  assert(engine.stats().src_port_switches == 3);
+  auto recv_cqes = engine.poll_cq(setup.recv_cq, 4);
+  assert((recv_cqes.size() == 1) && (recv_cqes[0].bytes_completed == 4000));
+
+  // With a flowlet gap a burst keeps one port; an idle gap moves to the next path
+  params.src_port->flowlet_gap_us = 10;
+  assert(engine.modify_qp(setup.qp1, params));
+  setup.post_send(2, 3000);
+  ports = exchange();
+  assert((ports.size() == 3) && (ports[0] == ports[1]) && (ports[1] == ports[2]));
+  engine.advance_time(20);
+  setup.post_send(3, 100);
+  auto next_ports = exchange();
+  assert((next_ports.size() == 1) && (next_ports[0] != ports[0]));
+
+  // Fixed pins every packet to one port; FlowHash restores the connection hash
+  params.src_port = SrcPortConfig{.mode = SrcPortMode::Fixed, .fixed_port = 0xD123};
+  assert(engine.modify_qp(setup.qp1, params));
+  setup.post_send(4, 2000);
+  ports = exchange();
+  assert((ports.size() == 2) && (ports[0] == 0xD123) && (ports[1] == 0xD123));
+
+  params.src_port = SrcPortConfig{};
+  assert(engine.modify_qp(setup.qp1, params));
+  setup.post_send(5, 100);
+  ports = exchange();
+  assert((ports.size() == 1) && (ports[0] == roce_flow_src_port(setup.qp1, setup.qp2)));
+
+  // A multipath policy without paths is rejected
+  std::uint64_t errors = engine.stats().errors;
+  params.src_port = SrcPortConfig{.mode = SrcPortMode::Multipath, .path_count = 0};
+  assert(!engine.modify_qp(setup.qp1, params));
+  assert(engine.stats().errors == errors + 1);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: UD sends use the address handle's template
+// ============================================
+
+void test_engine_ud_frames() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_engine_ud_frames...\n");
+
+  EncapSetup setup;
+  auto pd = setup.engine->create_pd();
+  assert(pd.has_value());
+
+  RdmaQpConfig qp_config;
+  qp_config.type = QpType::Ud;
+  qp_config.pd_handle = *pd;
+  qp_config.send_cq_number = setup.send_cq;
+  qp_config.recv_cq_number = setup.recv_cq;
+  auto qp = setup.engine->create_qp(qp_config);
+  assert(qp.has_value());
+  RdmaQpModifyParams params;
+  params.target_state = QpState::Init;
+  params.qkey = 0x1234;
+  assert(setup.engine->modify_qp(*qp, params));
+  params = RdmaQpModifyParams{};
+  params.target_state = QpState::Rtr;
+  assert(setup.engine->modify_qp(*qp, params));
+  params.target_state = QpState::Rts;
+  assert(setup.engine->modify_qp(*qp, params));
+
+  auto ah = setup.engine->create_ah(
+      *pd, RdmaAhAttr{.dest_ip = kIpB, .dest_mac = kMacB, .traffic_class = std::uint8_t{0x02}});
+  assert(ah.has_value());
+
+  SendWqe wqe;
+  wqe.opcode = WqeOpcode::Send;
+  std::array<std::byte, 8> data{};
+  assert(set_inline_payload(wqe, data));
+  wqe.ah_handle = *ah;
+  wqe.remote_qpn = *qp;
+  wqe.remote_qkey = 0x1234;
+  assert(setup.engine->post_send(*qp, wqe));
+
+  auto packets = setup.engine->generate_outgoing_packets();
+  assert((packets.size() == 1) && packets[0].is_frame);
+  auto info = parse_roce_frame(packets[0].data);
+  assert(info.has_value());
+  assert((info->dest_mac == kMacB) && (info->dest_ip == kIpB));
+  assert(info->ecn == EcnCodepoint::Ect0);
+  assert(info->src_port == packets[0].src_port);
+
+  assert(setup.engine->destroy_ah(*ah));
+
+  std::printf("    PASSED\n");
+}
+
+}  // namespace
+
+int main() {
+  NIC_TRACE_SCOPED(__func__);
+  WaitForTracyConnection();
+  std::printf("Running RoCEv2 encapsulation tests...\n");
+
+  test_template_round_trip();
+  test_vlan_and_traffic_class();
+  test_parse_rejects_malformed();
+  test_flow_src_port();
+  test_engine_frames();
+  test_src_port_modes();
+  test_engine_ud_frames();
+
+  std::printf("All RoCEv2 encapsulation tests PASSED!\n");
+  return 0;
+}
+
+static void WaitForTracyConnection() {
+#ifdef TRACY_ENABLE
+  const char* wait_env = std::getenv("NIC_WAIT_FOR_TRACY");
+  if (!wait_env || wait_env[0] == '\0' || wait_env[0] == '0') {
+    return;
+  }
+
+  const auto timeout = std::chrono::seconds(2);
+  const auto start = std::chrono::steady_clock::now();
+  while (!tracy::GetProfiler().IsConnected()) {
+    if (std::chrono::steady_clock::now() - start > timeout) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+#endif
+}
@@ -1,8 +1,11 @@
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <thread>
+#include <vector>
 
 #include "nic/dma_engine.h"
 #include "nic/rocev2/engine.h"
@@ -319,6 +322,9 @@ void test_poll_cq_invalid() {
   auto cqes = setup.engine->poll_cq(9999, 10);
   assert(cqes.empty());
 
+  std::array<RdmaCqe, 4> out{};
+  assert(setup.engine->poll_cq(9999, std::span<RdmaCqe>(out)) == 0);
+
   std::printf("    PASSED\n");
 }
 
@@ -419,6 +425,1276 @@ void test_create_cq_max_exceeded() {
   std::printf("    PASSED\n");
 }
 
+// ============================================
+// Test: create_cq with a host-resident CQE ring
+// ============================================
+void test_create_cq_host_ring() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_create_cq_host_ring...\n");
+
+  EngineSetup setup;
+
+  // Ring past the end of host memory is rejected.
+  auto bad_cq = setup.engine->create_cq(16, HostAddress{64 * 1024});
+  assert(!bad_cq.has_value());
+  assert(setup.engine->stats().errors == 1);
+
+  auto cq = setup.engine->create_cq(16, HostAddress{0x8000});
+  assert(cq.has_value());
+  std::array<RdmaCqe, 4> out{};
+  assert(setup.engine->poll_cq(*cq, std::span<RdmaCqe>(out)) == 0);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: inline post_send validation and retire-at-post
+// ============================================
+void test_post_send_inline() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_post_send_inline...\n");
+
+  EngineSetup setup;
+  auto pd_handle = setup.create_pd();
+  auto send_cq = setup.create_cq();
+  auto recv_cq = setup.create_cq();
+
+  // max_inline_data above the WQE's fixed buffer is rejected.
+  RdmaQpConfig qp_config;
+  qp_config.pd_handle = pd_handle;
+  qp_config.send_cq_number = send_cq;
+  qp_config.recv_cq_number = recv_cq;
+  qp_config.max_inline_data = kMaxInlineData + 1;
+  assert(!setup.engine->create_qp(qp_config).has_value());
+
+  qp_config.max_inline_data = 32;
+  auto qp = setup.engine->create_qp(qp_config);
+  assert(qp.has_value());
+  setup.transition_qp_to_rts(*qp, *qp);
+
+  std::array<std::byte, 64> payload{};
+  SendWqe wqe;
+  wqe.wr_id = 1;
+  wqe.opcode = WqeOpcode::Send;
+  wqe.signaled = false;
+
+  // Longer than the QP's max_inline_data
+  assert(set_inline_payload(wqe, payload));
+  assert(!setup.engine->post_send(*qp, wqe));
+
+  // Inline READ makes no sense
+  assert(set_inline_payload(wqe, std::span<const std::byte>(payload).first(16)));
+  wqe.opcode = WqeOpcode::RdmaRead;
+  assert(!setup.engine->post_send(*qp, wqe));
+
+  // Unsignaled inline SEND: no MR registered for the source, never produces a send CQE
+  AccessFlags access{.local_read = true, .local_write = true};
+  auto lkey = setup.engine->register_mr(pd_handle, 0x2000, 4096, access);
+  assert(lkey.has_value());
+  RecvWqe recv_wqe;
+  recv_wqe.wr_id = 2;
+  recv_wqe.sgl.push_back(SglEntry{.address = 0x2000, .length = 64});
+  assert(setup.engine->post_recv(*qp, recv_wqe));
+
+  wqe.opcode = WqeOpcode::Send;
+  assert(setup.engine->post_send(*qp, wqe));
+  assert(setup.engine->stats().inline_sends == 1);
+  // Still resendable until ACKed, though it will never produce a CQE
+  assert(setup.engine->query_qp(*qp)->pending_count() == 1);
+  assert(setup.engine->reliability_manager().has_outstanding(*qp));
+
+  // The QP is connected to itself: deliver the SEND, then the ACK.
+  for (int hop = 0; hop < 2; ++hop) {
+    for (auto& pkt : setup.engine->generate_outgoing_packets()) {
+      setup.engine->process_incoming_packet(pkt.data, pkt.dest_ip, pkt.dest_ip, pkt.src_port);
+    }
+  }
+  assert(setup.engine->poll_cq(recv_cq, 10).size() == 1);
+  assert(setup.engine->poll_cq(send_cq, 10).empty());
+  assert(setup.engine->query_qp(*qp)->pending_count() == 0);
+  assert(setup.engine->reliability_manager().stats().unsignaled_retired == 1);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: selective signaling, signal interval and sq_sig_all
+// ============================================
+void test_post_send_selective_signaling() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_post_send_selective_signaling...\n");
+
+  EngineSetup setup;
+  auto pd_handle = setup.create_pd();
+  auto send_cq = setup.create_cq();
+  auto recv_cq = setup.create_cq();
+
+  RdmaQpConfig qp_config;
+  qp_config.pd_handle = pd_handle;
+  qp_config.send_cq_number = send_cq;
+  qp_config.recv_cq_number = recv_cq;
+  qp_config.sq_signal_interval = 4;
+  auto qp = setup.engine->create_qp(qp_config);
+  assert(qp.has_value());
+  setup.transition_qp_to_rts(*qp, *qp);
+
+  for (std::uint64_t recv_idx = 0; recv_idx < 8; ++recv_idx) {
+    assert(setup.engine->post_recv(*qp, RecvWqe{.wr_id = 100 + recv_idx}));
+  }
+
+  // Zero-length SENDs: three unsignaled, then the interval demands a signaled one.
+  SendWqe wqe;
+  wqe.opcode = WqeOpcode::Send;
+  wqe.signaled = false;
+  for (std::uint64_t wr_idx = 1; wr_idx <= 3; ++wr_idx) {
+    wqe.wr_id = wr_idx;
+    assert(setup.engine->post_send(*qp, wqe));
+  }
+  assert(setup.engine->query_qp(*qp)->unsignaled_run() == 3);
+  wqe.wr_id = 4;
+  assert(!setup.engine->post_send(*qp, wqe));
+  assert(setup.engine->stats().errors == 1);
+
+  wqe.signaled = true;
+  assert(setup.engine->post_send(*qp, wqe));
+  assert(setup.engine->query_qp(*qp)->unsignaled_run() == 0);
+  assert(setup.engine->stats().unsignaled_sends == 3);
+
+  // The QP is connected to itself: deliver the SENDs, then the ACKs.
+  for (int hop = 0; hop < 2; ++hop) {
+    for (auto& pkt : setup.engine->generate_outgoing_packets()) {
+      setup.engine->process_incoming_packet(pkt.data, pkt.dest_ip, pkt.dest_ip, pkt.src_port);
+    }
+  }
+  assert(setup.engine->poll_cq(recv_cq, 10).size() == 4);
+  auto send_cqes = setup.engine->poll_cq(send_cq, 10);
+  assert(send_cqes.size() == 1);
+  assert(send_cqes[0].wr_id == 4);
+  assert(setup.engine->reliability_manager().stats().unsignaled_retired == 3);
+
+  // sq_sig_all signals every WQE and ignores the per-WR flag.
+  qp_config.sq_signal_interval = 0;
+  qp_config.sq_sig_all = true;
+  auto sig_all_qp = setup.engine->create_qp(qp_config);
+  assert(sig_all_qp.has_value());
+  setup.transition_qp_to_rts(*sig_all_qp, *sig_all_qp);
+  assert(setup.engine->post_recv(*sig_all_qp, RecvWqe{.wr_id = 200}));
+
+  wqe.wr_id = 5;
+  wqe.signaled = false;
+  assert(setup.engine->post_send(*sig_all_qp, wqe));
+  assert(setup.engine->stats().unsignaled_sends == 3);
+  for (int hop = 0; hop < 2; ++hop) {
+    for (auto& pkt : setup.engine->generate_outgoing_packets()) {
+      setup.engine->process_incoming_packet(pkt.data, pkt.dest_ip, pkt.dest_ip, pkt.src_port);
+    }
+  }
+  send_cqes = setup.engine->poll_cq(send_cq, 10);
+  assert(send_cqes.size() == 1);
+  assert(send_cqes[0].wr_id == 5);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: chained post_send_list / post_recv_list
+// ============================================
+void test_post_lists() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_post_lists...\n");
+
+  EngineSetup setup;
+  auto pd_handle = setup.create_pd();
+  auto send_cq = setup.create_cq();
+  auto recv_cq = setup.create_cq();
+
+  RdmaQpConfig qp_config;
+  qp_config.pd_handle = pd_handle;
+  qp_config.send_cq_number = send_cq;
+  qp_config.recv_cq_number = recv_cq;
+  qp_config.recv_queue_depth = 4;
+  auto qp = setup.engine->create_qp(qp_config);
+  assert(qp.has_value());
+
+  // Unknown QP and non-RTS QP post nothing
+  std::array<SendWqe, 4> send_wqes{};
+  assert(setup.engine->post_send_list(9999, send_wqes) == 0);
+  assert(setup.engine->post_send_list(*qp, send_wqes) == 0);
+
+  setup.transition_qp_to_rts(*qp, *qp);
+
+  // Receive list stops at the first WQE that does not fit
+  std::array<RecvWqe, 6> recv_wqes{};
+  for (std::size_t wqe_idx = 0; wqe_idx < recv_wqes.size(); ++wqe_idx) {
+    recv_wqes[wqe_idx].wr_id = 100 + wqe_idx;
+  }
+  assert(setup.engine->post_recv_list(9999, recv_wqes) == 0);
+  assert(setup.engine->post_recv_list(*qp, recv_wqes) == 4);
+  assert(setup.engine->stats().recv_wqes_posted == 4);
+
+  // Zero-length SENDs; the inline READ at index 2 is invalid and ends the chain
+  for (std::size_t wqe_idx = 0; wqe_idx < send_wqes.size(); ++wqe_idx) {
+    send_wqes[wqe_idx].wr_id = wqe_idx + 1;
+    send_wqes[wqe_idx].opcode = WqeOpcode::Send;
+  }
+  send_wqes[2].opcode = WqeOpcode::RdmaRead;
+  send_wqes[2].inline_data = true;
+  assert(setup.engine->post_send_list(*qp, send_wqes) == 2);
+  assert(setup.engine->stats().send_wqes_posted == 2);
+
+  // Resume from the failing index once it is fixed
+  send_wqes[2].opcode = WqeOpcode::Send;
+  send_wqes[2].inline_data = false;
+  auto remaining = std::span<const SendWqe>(send_wqes).subspan(2);
+  assert(setup.engine->post_send_list(*qp, remaining) == remaining.size());
+
+  for (int hop = 0; hop < 2; ++hop) {
+    for (auto& pkt : setup.engine->generate_outgoing_packets()) {
+      setup.engine->process_incoming_packet(pkt.data, pkt.dest_ip, pkt.dest_ip, pkt.src_port);
+    }
+  }
+  auto send_cqes = setup.engine->poll_cq(send_cq, 10);
+  assert(send_cqes.size() == 4);
+  for (std::size_t cqe_idx = 0; cqe_idx < send_cqes.size(); ++cqe_idx) {
+    assert(send_cqes[cqe_idx].wr_id == cqe_idx + 1);
+  }
+  assert(setup.engine->poll_cq(recv_cq, 10).size() == 4);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: loopback between two local QPs
+// ============================================
+void test_loopback() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_loopback...\n");
+
+  RdmaEngineConfig config;
+  config.local_ip = std::array<std::uint8_t, 4>{192, 168, 1, 2};
+  EngineSetup setup(config);
+  auto pd_handle = setup.create_pd();
+  auto send_cq = setup.create_cq();
+  auto recv_cq = setup.create_cq();
+  auto qp_a = setup.create_qp(pd_handle, send_cq, recv_cq);
+  auto qp_b = setup.create_qp(pd_handle, send_cq, recv_cq);
+  setup.transition_qp_to_rts(qp_a, qp_b);
+  setup.transition_qp_to_rts(qp_b, qp_a);
+
+  AccessFlags access{
+      .local_read = true, .local_write = true, .remote_read = true, .remote_write = true};
+  auto lkey = setup.engine->register_mr(pd_handle, 0x1000, 0x4000, access);
+  assert(lkey.has_value());
+  std::uint32_t rkey = setup.engine->mr_table().get_by_lkey(*lkey)->rkey;
+
+  std::array<std::byte, 64> pattern{};
+  for (std::size_t byte_idx = 0; byte_idx < pattern.size(); ++byte_idx) {
+    pattern[byte_idx] = static_cast<std::byte>(byte_idx + 1);
+  }
+  assert(setup.host_memory->write(0x1000, pattern).ok());
+
+  // SEND with immediate lands in B's receive buffer without touching the wire
+  RecvWqe recv_wqe;
+  recv_wqe.wr_id = 10;
+  recv_wqe.sgl.push_back(SglEntry{.address = 0x2000, .length = 64});
+  assert(setup.engine->post_recv(qp_b, recv_wqe));
+
+  SendWqe wqe;
+  wqe.wr_id = 1;
+  wqe.opcode = WqeOpcode::SendImm;
+  wqe.immediate_data = 0xABCD;
+  wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 64});
+  wqe.total_length = 64;
+  wqe.local_lkey = *lkey;
+  assert(setup.engine->post_send(qp_a, wqe));
+  assert(setup.engine->generate_outgoing_packets().empty());
+
+  auto recv_cqes = setup.engine->poll_cq(recv_cq, 10);
+  assert(recv_cqes.size() == 1);
+  assert(recv_cqes[0].wr_id == 10);
+  assert(recv_cqes[0].qp_number == qp_b);
+  assert(recv_cqes[0].has_immediate && (recv_cqes[0].immediate_data == 0xABCD));
+  assert(recv_cqes[0].bytes_completed == 64);
+  auto send_cqes = setup.engine->poll_cq(send_cq, 10);
+  assert(send_cqes.size() == 1);
+  assert((send_cqes[0].wr_id == 1) && (send_cqes[0].status == WqeStatus::Success));
+
+  std::array<std::byte, 64> readback{};
+  assert(setup.host_memory->read(0x2000, readback).ok());
+  assert(readback == pattern);
+
+  // Unsignaled WRITE, then READ it back into a third buffer
+  wqe = SendWqe{};
+  wqe.wr_id = 2;
+  wqe.opcode = WqeOpcode::RdmaWrite;
+  wqe.signaled = false;
+  wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 64});
+  wqe.total_length = 64;
+  wqe.local_lkey = *lkey;
+  wqe.remote_address = 0x3000;
+  wqe.rkey = rkey;
+  assert(setup.engine->post_send(qp_a, wqe));
+
+  wqe = SendWqe{};
+  wqe.wr_id = 3;
+  wqe.opcode = WqeOpcode::RdmaRead;
+  wqe.sgl.push_back(SglEntry{.address = 0x4000, .length = 64});
+  wqe.total_length = 64;
+  wqe.local_lkey = *lkey;
+  wqe.remote_address = 0x3000;
+  wqe.rkey = rkey;
+  assert(setup.engine->post_send(qp_a, wqe));
+  assert(setup.engine->generate_outgoing_packets().empty());
+
+  send_cqes = setup.engine->poll_cq(send_cq, 10);
+  assert(send_cqes.size() == 1);
+  assert((send_cqes[0].wr_id == 3) && (send_cqes[0].opcode == WqeOpcode::RdmaRead));
+  assert(setup.host_memory->read(0x4000, readback).ok());
+  assert(readback == pattern);
+  assert(setup.engine->stats().loopback_ops == 3);
+
+  // No receive WQE: falls back to the packet path (and its RNR handling)
+  wqe = SendWqe{};
+  wqe.wr_id = 4;
+  wqe.opcode = WqeOpcode::Send;
+  assert(setup.engine->post_send(qp_a, wqe));
+  assert(setup.engine->generate_outgoing_packets().size() == 1);
+  assert(setup.engine->stats().loopback_ops == 3);
+
+  // Bad rkey: error CQE and the requester moves to Error, as after a fatal NAK
+  setup.engine->reset();
+  pd_handle = setup.create_pd();
+  send_cq = setup.create_cq();
+  recv_cq = setup.create_cq();
+  qp_a = setup.create_qp(pd_handle, send_cq, recv_cq);
+  qp_b = setup.create_qp(pd_handle, send_cq, recv_cq);
+  setup.transition_qp_to_rts(qp_a, qp_b);
+  setup.transition_qp_to_rts(qp_b, qp_a);
+  lkey = setup.engine->register_mr(pd_handle, 0x1000, 0x4000, AccessFlags{});
+  assert(lkey.has_value());
+  rkey = setup.engine->mr_table().get_by_lkey(*lkey)->rkey;
+
+  wqe = SendWqe{};
+  wqe.wr_id = 5;
+  wqe.opcode = WqeOpcode::RdmaWrite;
+  wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 16});
+  wqe.total_length = 16;
+  wqe.local_lkey = *lkey;
+  wqe.remote_address = 0x3000;
+  wqe.rkey = rkey;
+  assert(setup.engine->post_send(qp_a, wqe));
+  send_cqes = setup.engine->poll_cq(send_cq, 10);
+  assert(send_cqes.size() == 1);
+  assert((send_cqes[0].wr_id == 5) && (send_cqes[0].status == WqeStatus::RemoteAccessError));
+  assert(setup.engine->query_qp(qp_a)->state() == QpState::Error);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: idle QP state is released and accounted
+// ============================================
+void test_memory_footprint() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_memory_footprint...\n");
+
+  EngineSetup requester;
+  EngineSetup responder;
+  auto req_pd = requester.create_pd();
+  auto req_cq = requester.create_cq();
+  auto resp_pd = responder.create_pd();
+  auto resp_cq = responder.create_cq();
+
+  // Idle QPs hold no queue storage and cost only their fixed record
+  constexpr std::size_t kIdleQps = 64;
+  for (std::size_t qp_idx = 0; qp_idx < kIdleQps; ++qp_idx) {
+    (void)requester.create_qp(req_pd, req_cq, req_cq);
+  }
+  RdmaMemoryFootprint footprint = requester.engine->memory_footprint();
+  assert(footprint.qp_count == kIdleQps);
+  assert(footprint.qps_with_storage == 0);
+  assert(footprint.qp_bytes <= kIdleQps * 512);
+  assert(footprint.total() >= footprint.qp_bytes);
+
+  auto qp_a = requester.create_qp(req_pd, req_cq, req_cq);
+  auto qp_b = responder.create_qp(resp_pd, resp_cq, resp_cq);
+  requester.transition_qp_to_rts(qp_a, qp_b);
+  responder.transition_qp_to_rts(qp_b, qp_a);
+
+  auto lkey = requester.engine->register_mr(req_pd, 0x1000, 0x1000, AccessFlags{});
+  auto resp_lkey = responder.engine->register_mr(
+      resp_pd, 0x2000, 0x1000, AccessFlags{.local_write = true});
+  assert(lkey.has_value() && resp_lkey.has_value());
+
+  RecvWqe recv_wqe;
+  recv_wqe.wr_id = 7;
+  recv_wqe.sgl.push_back(SglEntry{.address = 0x2000, .length = 64});
+  assert(responder.engine->post_recv(qp_b, recv_wqe));
+
+  SendWqe wqe;
+  wqe.wr_id = 1;
+  wqe.opcode = WqeOpcode::Send;
+  wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 64});
+  wqe.total_length = 64;
+  wqe.local_lkey = *lkey;
+  assert(requester.engine->post_send(qp_a, wqe));
+
+  // The unacknowledged send keeps its storage across housekeeping
+  assert(requester.engine->query_qp(qp_a)->pending_count() == 1);
+  static_assert(sizeof(PendingOperation) < sizeof(SendWqe) / 2);  // No inline buffer copy
+  assert(requester.engine->release_idle_state() == 0);
+  footprint = requester.engine->memory_footprint();
+  assert(footprint.qps_with_storage == 1);
+  assert(footprint.protocol_bytes > 0);
+
+  std::array<std::uint8_t, 4> req_ip{192, 168, 1, 1};
+  std::array<std::uint8_t, 4> resp_ip{192, 168, 1, 2};
+  for (const auto& packet : requester.engine->generate_outgoing_packets()) {
+    assert(responder.engine->process_incoming_packet(packet.data, req_ip, resp_ip, 49152));
+  }
+  for (const auto& packet : responder.engine->generate_outgoing_packets()) {
+    assert(requester.engine->process_incoming_packet(packet.data, resp_ip, req_ip, 49152));
+  }
+  assert(requester.engine->poll_cq(req_cq, 4).size() == 1);
+  assert(responder.engine->poll_cq(resp_cq, 4).size() == 1);
+
+  // The ACK retired the retransmit copy; the next tick frees both sides' storage
+  assert(requester.engine->query_qp(qp_a)->pending_count() == 0);
+  requester.engine->advance_time(1);
+  responder.engine->advance_time(1);
+  assert(requester.engine->stats().idle_storage_releases == 1);
+  assert(responder.engine->stats().idle_storage_releases == 1);
+  assert(requester.engine->memory_footprint().qps_with_storage == 0);
+  assert(!responder.engine->query_qp(qp_b)->has_queue_storage());
+
+  // Idle QPs are not revisited; a new post makes the QP a candidate again
+  responder.engine->advance_time(1);
+  assert(responder.engine->stats().idle_storage_releases == 1);
+  RecvWqe again;
+  again.wr_id = 7;
+  again.sgl.push_back(SglEntry{.address = 0x2000, .length = 64});
+  assert(responder.engine->post_recv(qp_b, again));
+  responder.engine->advance_time(1);
+  assert(responder.engine->query_qp(qp_b)->has_queue_storage());
+  assert(responder.engine->stats().idle_storage_releases == 1);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: a multi-MTU READ takes one PSN per response, so a later SEND stays in sequence
+// ============================================
+void test_read_then_send() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_read_then_send...\n");
+
+  EngineSetup requester;
+  EngineSetup responder;
+  auto req_pd = requester.create_pd();
+  auto req_cq = requester.create_cq();
+  auto resp_pd = responder.create_pd();
+  auto resp_cq = responder.create_cq();
+  auto qp_a = requester.create_qp(req_pd, req_cq, req_cq);
+  auto qp_b = responder.create_qp(resp_pd, resp_cq, resp_cq);
+  requester.transition_qp_to_rts(qp_a, qp_b);
+  responder.transition_qp_to_rts(qp_b, qp_a);
+
+  AccessFlags access{.local_write = true, .remote_read = true};
+  auto lkey = requester.engine->register_mr(req_pd, 0x1000, 0x4000, access);
+  auto resp_lkey = responder.engine->register_mr(resp_pd, 0x8000, 0x4000, access);
+  assert(lkey.has_value() && resp_lkey.has_value());
+  std::uint32_t rkey = responder.engine->mr_table().get_by_lkey(*resp_lkey)->rkey;
+
+  std::uint32_t mtu = requester.engine->query_qp(qp_a)->mtu_bytes();
+  std::uint32_t read_length = (mtu * 3) - 16;  // Three responses
+  std::vector<std::byte> pattern(read_length);
+  for (std::size_t byte_idx = 0; byte_idx < pattern.size(); ++byte_idx) {
+    pattern[byte_idx] = static_cast<std::byte>(byte_idx * 7);
+  }
+  assert(responder.host_memory->write(0x8000, pattern).ok());
+
+  RecvWqe recv_wqe;
+  recv_wqe.wr_id = 20;
+  recv_wqe.sgl.push_back(SglEntry{.address = 0xA000, .length = 64});
+  assert(responder.engine->post_recv(qp_b, recv_wqe));
+
+  SendWqe wqe;
+  wqe.wr_id = 1;
+  wqe.opcode = WqeOpcode::RdmaRead;
+  wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = read_length});
+  wqe.total_length = read_length;
+  wqe.local_lkey = *lkey;
+  wqe.remote_address = 0x8000;
+  wqe.rkey = rkey;
+  assert(requester.engine->post_send(qp_a, wqe));
+  assert(requester.engine->query_qp(qp_a)->sq_psn() == 3);
+
+  wqe = SendWqe{};
+  wqe.wr_id = 2;
+  wqe.opcode = WqeOpcode::Send;
+  wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 64});
+  wqe.total_length = 64;
+  wqe.local_lkey = *lkey;
+  assert(requester.engine->post_send(qp_a, wqe));
+
+  std::array<std::uint8_t, 4> req_ip{192, 168, 1, 1};
+  std::array<std::uint8_t, 4> resp_ip{192, 168, 1, 2};
+  for (const auto& packet : requester.engine->generate_outgoing_packets()) {
+    assert(responder.engine->process_incoming_packet(packet.data, req_ip, resp_ip, 49152));
+  }
+  assert(responder.engine->query_qp(qp_b)->expected_recv_psn() == 4);
+  for (const auto& packet : responder.engine->generate_outgoing_packets()) {
+    assert(requester.engine->process_incoming_packet(packet.data, resp_ip, req_ip, 49152));
+  }
+
+  // Both complete in order and the SEND was accepted rather than NAKed
+  auto send_cqes = requester.engine->poll_cq(req_cq, 8);
+  std::vector<std::uint64_t> wr_ids;
+  for (const auto& cqe : send_cqes) {
+    assert(cqe.status == WqeStatus::Success);
+    wr_ids.push_back(cqe.wr_id);
+  }
+  assert((wr_ids == std::vector<std::uint64_t>{1, 2}));
+  auto recv_cqes = responder.engine->poll_cq(resp_cq, 8);
+  assert((recv_cqes.size() == 1) && (recv_cqes[0].wr_id == 20));
+  assert(responder.engine->stats().errors == 0);
+  assert(requester.engine->query_qp(qp_a)->pending_count() == 0);
+
+  std::vector<std::byte> readback(read_length);
+  assert(requester.host_memory->read(0x1000, readback).ok());
+  assert(readback == pattern);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: fast registration, remote writes through it, and SEND with Invalidate
+// ============================================
+void test_fast_register_and_invalidate() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_fast_register_and_invalidate...\n");
+
+  EngineSetup requester;
+  EngineSetup responder;
+  auto req_pd = requester.create_pd();
+  auto req_cq = requester.create_cq();
+  auto resp_pd = responder.create_pd();
+  auto resp_cq = responder.create_cq();
+  auto qp_a = requester.create_qp(req_pd, req_cq, req_cq);
+  auto qp_b = responder.create_qp(resp_pd, resp_cq, resp_cq);
+  requester.transition_qp_to_rts(qp_a, qp_b);
+  responder.transition_qp_to_rts(qp_b, qp_a);
+
+  std::array<std::uint8_t, 4> req_ip{192, 168, 1, 1};
+  std::array<std::uint8_t, 4> resp_ip{192, 168, 1, 2};
+  auto exchange = [&] {
+    for (const auto& packet : requester.engine->generate_outgoing_packets()) {
+      (void)responder.engine->process_incoming_packet(packet.data, req_ip, resp_ip, 49152);
+    }
+    for (const auto& packet : responder.engine->generate_outgoing_packets()) {
+      (void)requester.engine->process_incoming_packet(packet.data, resp_ip, req_ip, 49152);
+    }
+  };
+
+  auto src_lkey = requester.engine->register_mr(req_pd, 0x1000, 0x1000, AccessFlags{});
+  auto recv_lkey = responder.engine->register_mr(
+      resp_pd, 0x8000, 0x1000, AccessFlags{.local_write = true});
+  auto frmr = responder.engine->alloc_fast_reg_mr(resp_pd, 0x1000);
+  assert(src_lkey.has_value() && recv_lkey.has_value() && frmr.has_value());
+  assert(!responder.engine->alloc_fast_reg_mr(resp_pd + 1, 0x1000).has_value());
+
+  // Register the I/O buffer from the send queue; the page list is one contiguous range
+  constexpr std::uint32_t kIoRkey = 0x7700;
+  SendWqe reg;
+  reg.wr_id = 10;
+  reg.opcode = WqeOpcode::RegMr;
+  reg.local_lkey = *frmr;
+  reg.new_rkey = kIoRkey;
+  reg.access = AccessFlags{.local_write = true, .remote_write = true};
+  reg.sgl.push_back(SglEntry{.address = 0x3000, .length = 0x200});
+  reg.sgl.push_back(SglEntry{.address = 0x3200, .length = 0x200});
+  assert(responder.engine->post_send(qp_b, reg));
+  auto cqes = responder.engine->poll_cq(resp_cq, 4);
+  assert(cqes.size() == 1);
+  assert(cqes[0].opcode == WqeOpcode::RegMr);
+  assert(cqes[0].status == WqeStatus::Success);
+  assert(responder.engine->stats().memory_wqes == 1);
+  assert(requester.engine->generate_outgoing_packets().empty());
+
+  SendWqe write;
+  write.wr_id = 1;
+  write.opcode = WqeOpcode::RdmaWrite;
+  write.sgl.push_back(SglEntry{.address = 0x1000, .length = 64});
+  write.total_length = 64;
+  write.local_lkey = *src_lkey;
+  write.remote_address = 0x3100;
+  write.rkey = kIoRkey;
+  assert(requester.engine->post_send(qp_a, write));
+  exchange();
+  cqes = requester.engine->poll_cq(req_cq, 4);
+  assert(cqes.size() == 1);
+  assert(cqes[0].status == WqeStatus::Success);
+
+  // The completion message invalidates the key at the responder
+  RecvWqe recv;
+  recv.wr_id = 20;
+  recv.sgl.push_back(SglEntry{.address = 0x8000, .length = 64});
+  assert(responder.engine->post_recv(qp_b, recv));
+  SendWqe send_inv = write;
+  send_inv.wr_id = 2;
+  send_inv.opcode = WqeOpcode::SendWithInvalidate;
+  send_inv.invalidate_rkey = kIoRkey;
+  assert(requester.engine->post_send(qp_a, send_inv));
+  exchange();
+  cqes = responder.engine->poll_cq(resp_cq, 4);
+  assert(cqes.size() == 1);
+  assert(cqes[0].opcode == WqeOpcode::SendWithInvalidate);
+  assert(cqes[0].has_invalidate);
+  assert(cqes[0].invalidated_rkey == kIoRkey);
+  assert(!responder.engine->mr_table().get_by_rkey(kIoRkey)->is_valid);
+  assert(requester.engine->poll_cq(req_cq, 4).size() == 1);
+
+  // Re-register for the next I/O with a fresh key, then retire it locally
+  reg.wr_id = 11;
+  reg.new_rkey = kIoRkey + 1;
+  assert(responder.engine->post_send(qp_b, reg));
+  SendWqe local_inv;
+  local_inv.wr_id = 12;
+  local_inv.opcode = WqeOpcode::LocalInvalidate;
+  local_inv.invalidate_rkey = kIoRkey + 1;
+  local_inv.signaled = false;
+  assert(responder.engine->post_send(qp_b, local_inv));
+  assert(responder.engine->poll_cq(resp_cq, 4).size() == 1);
+  assert(responder.engine->mr_table().get_by_rkey(kIoRkey) == nullptr);
+
+  // A write through the retired key is refused by the responder
+  write.wr_id = 3;
+  write.rkey = kIoRkey + 1;
+  assert(requester.engine->post_send(qp_a, write));
+  exchange();
+  cqes = requester.engine->poll_cq(req_cq, 4);
+  assert(cqes.size() == 1);
+  assert(cqes[0].status == WqeStatus::RemoteAccessError);
+
+  // Invalidating a key that is already invalid fails the WQE and the QP
+  assert(responder.engine->post_send(qp_b, local_inv));
+  cqes = responder.engine->poll_cq(resp_cq, 4);
+  assert(cqes.size() == 1);
+  assert(cqes[0].status == WqeStatus::LocalProtectionError);
+  assert(responder.engine->query_qp(qp_b)->state() == QpState::Error);
+
+  std::printf("    PASSED\n");
+}
+
+void test_on_demand_paging() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_on_demand_paging...\n");
+
+  EngineSetup requester;
+  EngineSetup responder;
+  auto req_pd = requester.create_pd();
+  auto req_cq = requester.create_cq();
+  auto resp_pd = responder.create_pd();
+  auto resp_cq = responder.create_cq();
+  auto qp_a = requester.create_qp(req_pd, req_cq, req_cq);
+  auto qp_b = responder.create_qp(resp_pd, resp_cq, resp_cq);
+  requester.transition_qp_to_rts(qp_a, qp_b);
+  responder.transition_qp_to_rts(qp_b, qp_a);
+
+  std::array<std::uint8_t, 4> req_ip{192, 168, 1, 1};
+  std::array<std::uint8_t, 4> resp_ip{192, 168, 1, 2};
+  auto src_lkey = requester.engine->register_mr(
+      req_pd, 0x1000, 0x4000, AccessFlags{.local_read = true, .on_demand = true});
+  auto dst_lkey = responder.engine->register_mr(
+      resp_pd, 0x8000, 0x2000, AccessFlags{.remote_write = true, .on_demand = true});
+  assert(src_lkey.has_value() && dst_lkey.has_value());
+  std::uint32_t dst_rkey = responder.engine->mr_table().get_by_lkey(*dst_lkey)->rkey;
+
+  // Requester side: a faulting WQE parks, and later WQEs queue behind it
+  SendWqe write;
+  write.wr_id = 1;
+  write.opcode = WqeOpcode::RdmaWrite;
+  write.sgl.push_back(SglEntry{.address = 0x1000, .length = 64});
+  write.total_length = 64;
+  write.local_lkey = *src_lkey;
+  write.remote_address = 0x8000;
+  write.rkey = dst_rkey;
+  assert(requester.engine->post_send(qp_a, write));
+  assert(requester.engine->odp_parked_count(qp_a) == 1);
+  assert(requester.engine->mr_table().stats().page_faults == 1);
+  assert(requester.engine->advise_mr(*src_lkey, 0x4000, 0x1000) == 1u);
+  assert(requester.engine->odp_parked_count(qp_a) == 1);
+  SendWqe second = write;
+  second.wr_id = 2;
+  second.sgl = WqeSgl{SglEntry{.address = 0x4000, .length = 64}};
+  assert(requester.engine->post_send(qp_a, second));
+  assert(requester.engine->odp_parked_count(qp_a) == 2);
+  assert(requester.engine->generate_outgoing_packets().empty());
+
+  requester.engine->advance_time(50);
+  assert(requester.engine->populate_odp_pages(0x1000, 0x1000) == 1);
+  assert(requester.engine->odp_parked_count(qp_a) == 0);
+  assert(requester.engine->stats().odp_parked_wqes == 2);
+  assert(requester.engine->stats().odp_resumed_wqes == 2);
+  assert(requester.engine->stats().odp_stall_us == 50);
+  auto requests = requester.engine->generate_outgoing_packets();
+  assert(requests.size() == 2);
+
+  // Responder side: the WRITE faults, is RNR-NAKed, and succeeds once the host populates
+  std::vector<OdpPageFault> faults;
+  responder.engine->set_page_fault_handler(
+      [&](const OdpPageFault& fault) { faults.push_back(fault); });
+  assert(responder.engine->process_incoming_packet(requests[0].data, req_ip, resp_ip, 49152));
+  assert(faults.size() == 1);
+  assert(faults[0].lkey == *dst_lkey);
+  assert(faults[0].is_write && faults[0].is_remote);
+  assert(responder.engine->write_processor().stats().page_fault_naks == 1);
+  for (const auto& packet : responder.engine->generate_outgoing_packets()) {
+    (void)requester.engine->process_incoming_packet(packet.data, resp_ip, req_ip, 49152);
+  }
+  assert(requester.engine->reliability_manager().stats().rnr_retries == 1);
+  assert(requester.engine->poll_cq(req_cq, 4).empty());
+
+  assert(responder.engine->populate_odp_pages(faults[0].address, faults[0].length) == 1);
+  for (const auto& packet : requests) {
+    assert(responder.engine->process_incoming_packet(packet.data, req_ip, resp_ip, 49152));
+  }
+  for (const auto& packet : responder.engine->generate_outgoing_packets()) {
+    (void)requester.engine->process_incoming_packet(packet.data, resp_ip, req_ip, 49152);
+  }
+  auto cqes = requester.engine->poll_cq(req_cq, 4);
+  assert(cqes.size() == 2);
+  assert(cqes[0].status == WqeStatus::Success);
+  assert(cqes[1].status == WqeStatus::Success);
+
+  // Invalidation makes the next access fault again
+  assert(requester.engine->invalidate_odp_range(0x1000, 0x4000) == 2);
+  write.wr_id = 3;
+  assert(requester.engine->post_send(qp_a, write));
+  assert(requester.engine->odp_parked_count(qp_a) == 1);
+  assert(!requester.engine->advise_mr(*src_lkey, 0x8000, 0x1000).has_value());
+
+  std::printf("    PASSED\n");
+}
+
+void test_rnr_backoff_and_credits() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_rnr_backoff_and_credits...\n");
+
+  RdmaEngineConfig config;
+  config.end_to_end_credits = true;
+  EngineSetup requester(config);
+  EngineSetup responder(config);
+  auto req_pd = requester.create_pd();
+  auto req_cq = requester.create_cq();
+  auto resp_pd = responder.create_pd();
+  auto resp_cq = responder.create_cq();
+  auto qp_a = requester.create_qp(req_pd, req_cq, req_cq);
+  auto qp_b = responder.create_qp(resp_pd, resp_cq, resp_cq);
+  requester.transition_qp_to_rts(qp_a, qp_b);
+  responder.transition_qp_to_rts(qp_b, qp_a);
+
+  auto lkey = requester.engine->register_mr(req_pd, 0x1000, 0x1000, AccessFlags{});
+  auto resp_lkey = responder.engine->register_mr(
+      resp_pd, 0x2000, 0x1000, AccessFlags{.local_write = true});
+  assert(lkey.has_value() && resp_lkey.has_value());
+
+  std::array<std::uint8_t, 4> req_ip{192, 168, 1, 1};
+  std::array<std::uint8_t, 4> resp_ip{192, 168, 1, 2};
+  auto post_recv = [&](std::uint64_t wr_id) {
+    RecvWqe recv;
+    recv.wr_id = wr_id;
+    recv.sgl.push_back(SglEntry{.address = 0x2000, .length = 64});
+    assert(responder.engine->post_recv(qp_b, recv));
+  };
+  auto post_send = [&](std::uint64_t wr_id) {
+    SendWqe wqe;
+    wqe.wr_id = wr_id;
+    wqe.opcode = WqeOpcode::Send;
+    wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 32});
+    wqe.total_length = 32;
+    wqe.local_lkey = *lkey;
+    assert(requester.engine->post_send(qp_a, wqe));
+  };
+  // Bare UDP payloads count as CE-marked, so CNPs ride along; only SENDs are counted
+  auto to_responder = [&]() {
+    std::size_t sends = 0;
+    for (const auto& packet : requester.engine->generate_outgoing_packets()) {
+      RdmaPacketParser parser;
+      if (parser.parse(packet.data) && (parser.bth().opcode == RdmaOpcode::kRcSendOnly)) {
+        ++sends;
+      }
+      (void)responder.engine->process_incoming_packet(packet.data, req_ip, resp_ip, 49152);
+    }
+    return sends;
+  };
+  auto to_requester = [&]() {
+    for (const auto& packet : responder.engine->generate_outgoing_packets()) {
+      (void)requester.engine->process_incoming_packet(packet.data, resp_ip, req_ip, 49152);
+    }
+  };
+
+  // One receive WQE for two SENDs: the second is RNR-NAKed with the QP's min RNR timer
+  post_recv(100);
+  post_send(1);
+  post_send(2);
+  assert(to_responder() == 2);
+  std::vector<AethFields> acks;
+  for (const auto& packet : responder.engine->generate_outgoing_packets()) {
+    RdmaPacketParser parser;
+    if (parser.parse(packet.data) && (parser.bth().opcode == RdmaOpcode::kRcAck)) {
+      acks.push_back(parser.aeth());
+    }
+    (void)requester.engine->process_incoming_packet(packet.data, resp_ip, req_ip, 49152);
+  }
+  assert(acks.size() == 2);
+  assert(acks[0].syndrome == AethSyndrome::Ack);
+  assert(decode_aeth_credits(acks[0].syndrome_value) == 0U);
+  assert(acks[1].syndrome == AethSyndrome::RnrNak);
+  assert(rnr_timer_us(acks[1].syndrome_value) == 640);  // min_rnr_timer 12
+  assert(requester.engine->stats().rnr_backoffs == 1);
+  assert(requester.engine->poll_cq(req_cq, 4).size() == 1);
+
+  // The send queue waits out the back-off, then goes back to the NAKed SEND
+  post_send(3);
+  assert(requester.engine->rnr_held_count(qp_a) == 1);
+  requester.engine->advance_time(100);
+  assert(to_responder() == 0);
+  post_recv(101);
+  post_recv(102);
+  requester.engine->advance_time(600);
+  assert(requester.engine->stats().rnr_resends == 1);
+  assert(requester.engine->stats().rnr_wait_us == 700);
+
+  // SEND 3 waits for the credit the resent SEND's ACK returns
+  assert(requester.engine->rnr_held_count(qp_a) == 1);
+  assert(to_responder() == 1);
+  to_requester();
+  assert(requester.engine->rnr_held_count(qp_a) == 0);
+  assert(to_responder() == 1);
+  to_requester();
+
+  auto cqes = requester.engine->poll_cq(req_cq, 4);
+  assert(cqes.size() == 2);
+  assert((cqes[0].wr_id == 2) && (cqes[0].status == WqeStatus::Success));
+  assert((cqes[1].wr_id == 3) && (cqes[1].status == WqeStatus::Success));
+  assert(responder.engine->poll_cq(resp_cq, 4).size() == 3);
+
+  // With no credits left and nothing in flight, one SEND still goes out as a probe
+  std::uint64_t credit_stalls = requester.engine->stats().credit_stalls;
+  post_send(4);
+  post_send(5);
+  assert(requester.engine->rnr_held_count(qp_a) == 1);
+  assert(requester.engine->stats().credit_stalls == credit_stalls + 1);
+  assert(to_responder() == 1);
+
+  // A multi-packet WRITE_IMM with no recv WQE is RNR-NAKed on its last packet; the resend
+  // after the back-off completes it on both ends
+  EngineSetup writer;
+  EngineSetup target;
+  auto writer_pd = writer.create_pd();
+  auto writer_cq = writer.create_cq();
+  auto target_pd = target.create_pd();
+  auto target_cq = target.create_cq();
+  auto qp_w = writer.create_qp(writer_pd, writer_cq, writer_cq);
+  auto qp_t = target.create_qp(target_pd, target_cq, target_cq);
+  writer.transition_qp_to_rts(qp_w, qp_t);
+  target.transition_qp_to_rts(qp_t, qp_w);
+
+  auto src_lkey = writer.engine->register_mr(writer_pd, 0x1000, 0x1000, AccessFlags{});
+  auto dst_lkey = target.engine->register_mr(
+      target_pd, 0x4000, 0x1000, AccessFlags{.local_write = true, .remote_write = true});
+  assert(src_lkey.has_value() && dst_lkey.has_value());
+  auto forward = [&]() {
+    for (const auto& packet : writer.engine->generate_outgoing_packets()) {
+      (void)target.engine->process_incoming_packet(packet.data, req_ip, resp_ip, 49152);
+    }
+    for (const auto& packet : target.engine->generate_outgoing_packets()) {
+      (void)writer.engine->process_incoming_packet(packet.data, resp_ip, req_ip, 49152);
+    }
+  };
+
+  SendWqe write;
+  write.wr_id = 7;
+  write.opcode = WqeOpcode::RdmaWriteImm;
+  write.sgl.push_back(SglEntry{.address = 0x1000, .length = 2500});  // 3 packets
+  write.total_length = 2500;
+  write.local_lkey = *src_lkey;
+  write.remote_address = 0x4000;
+  write.rkey = target.engine->mr_table().get_by_lkey(*dst_lkey)->rkey;
+  write.immediate_data = 0xabcd;
+  assert(writer.engine->post_send(qp_w, write));
+  forward();
+  assert(writer.engine->stats().rnr_backoffs == 1);
+  assert(target.engine->poll_cq(target_cq, 4).empty());
+
+  RecvWqe recv;
+  recv.wr_id = 200;
+  assert(target.engine->post_recv(qp_t, recv));
+  writer.engine->advance_time(1000);
+  assert(writer.engine->stats().rnr_resends == 1);
+  forward();
+
+  auto write_cqes = writer.engine->poll_cq(writer_cq, 4);
+  assert(write_cqes.size() == 1);
+  assert((write_cqes[0].wr_id == 7) && (write_cqes[0].status == WqeStatus::Success));
+  auto recv_cqes = target.engine->poll_cq(target_cq, 4);
+  assert(recv_cqes.size() == 1);
+  assert((recv_cqes[0].wr_id == 200) && (recv_cqes[0].immediate_data == 0xabcd));
+  assert(recv_cqes[0].bytes_completed == 2500);
+
+  // The RNR retry limit is the requester QP's own: 0 fails on the first RNR NAK
+  RdmaQpConfig no_retry_config;
+  no_retry_config.pd_handle = writer_pd;
+  no_retry_config.send_cq_number = writer_cq;
+  no_retry_config.recv_cq_number = writer_cq;
+  no_retry_config.rnr_retry_count = 0;
+  auto qp_n = writer.engine->create_qp(no_retry_config);
+  auto qp_m = target.create_qp(target_pd, target_cq, target_cq);
+  assert(qp_n.has_value());
+  writer.transition_qp_to_rts(*qp_n, qp_m);
+  target.transition_qp_to_rts(qp_m, *qp_n);
+  write.wr_id = 8;
+  write.opcode = WqeOpcode::Send;
+  assert(writer.engine->post_send(*qp_n, write));
+  forward();
+  write_cqes = writer.engine->poll_cq(writer_cq, 4);
+  assert(write_cqes.size() == 1);
+  assert(write_cqes[0].status == WqeStatus::RnrRetryExceededError);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: an RNR resend repeats unsignaled inline WQEs at their original PSNs
+// ============================================
+void test_rnr_resend_keeps_unsignaled_inline() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_rnr_resend_keeps_unsignaled_inline...\n");
+
+  EngineSetup requester;
+  EngineSetup responder;
+  auto req_pd = requester.create_pd();
+  auto req_cq = requester.create_cq();
+  auto resp_pd = responder.create_pd();
+  auto resp_cq = responder.create_cq();
+  RdmaQpConfig qp_config;
+  qp_config.pd_handle = req_pd;
+  qp_config.send_cq_number = req_cq;
+  qp_config.recv_cq_number = req_cq;
+  qp_config.max_inline_data = 32;
+  auto qp_a = requester.engine->create_qp(qp_config);
+  assert(qp_a.has_value());
+  auto qp_b = responder.create_qp(resp_pd, resp_cq, resp_cq);
+  requester.transition_qp_to_rts(*qp_a, qp_b);
+  responder.transition_qp_to_rts(qp_b, *qp_a);
+
+  auto lkey = requester.engine->register_mr(req_pd, 0x1000, 0x1000, AccessFlags{});
+  auto resp_lkey = responder.engine->register_mr(
+      resp_pd, 0x2000, 0x1000, AccessFlags{.local_write = true});
+  assert(lkey.has_value() && resp_lkey.has_value());
+
+  std::array<std::uint8_t, 4> req_ip{192, 168, 1, 1};
+  std::array<std::uint8_t, 4> resp_ip{192, 168, 1, 2};
+  auto to_responder = [&]() {
+    for (const auto& packet : requester.engine->generate_outgoing_packets()) {
+      (void)responder.engine->process_incoming_packet(packet.data, req_ip, resp_ip, 49152);
+    }
+  };
+  auto to_requester = [&]() {
+    for (const auto& packet : responder.engine->generate_outgoing_packets()) {
+      (void)requester.engine->process_incoming_packet(packet.data, resp_ip, req_ip, 49152);
+    }
+  };
+
+  // Signaled SEND, unsignaled inline SEND, signaled SEND; no receive WQE yet
+  SendWqe wqe;
+  wqe.wr_id = 1;
+  wqe.opcode = WqeOpcode::Send;
+  wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 32});
+  wqe.total_length = 32;
+  wqe.local_lkey = *lkey;
+  assert(requester.engine->post_send(*qp_a, wqe));
+
+  SendWqe inline_wqe;
+  inline_wqe.wr_id = 2;
+  inline_wqe.opcode = WqeOpcode::Send;
+  inline_wqe.signaled = false;
+  std::array<std::byte, 16> payload{};
+  payload.fill(std::byte{0x5A});
+  assert(set_inline_payload(inline_wqe, payload));
+  assert(requester.engine->post_send(*qp_a, inline_wqe));
+
+  wqe.wr_id = 3;
+  assert(requester.engine->post_send(*qp_a, wqe));
+  assert(requester.engine->query_qp(*qp_a)->pending_count() == 3);
+
+  // The first SEND is RNR-NAKed and the other two are dropped behind it
+  to_responder();
+  to_requester();
+  assert(requester.engine->stats().rnr_backoffs == 1);
+  assert(requester.engine->poll_cq(req_cq, 4).empty());
+
+  for (std::uint64_t wr_id = 100; wr_id < 103; ++wr_id) {
+    RecvWqe recv;
+    recv.wr_id = wr_id;
+    recv.sgl.push_back(SglEntry{.address = 0x2000 + (wr_id - 100) * 64, .length = 64});
+    assert(responder.engine->post_recv(qp_b, recv));
+  }
+  requester.engine->advance_time(10000);
+  assert(requester.engine->stats().rnr_resends == 3);
+  assert(requester.engine->query_qp(*qp_a)->sq_psn() == 3);
+
+  // All three land in order; only the signaled ones complete
+  to_responder();
+  to_requester();
+  auto recv_cqes = responder.engine->poll_cq(resp_cq, 4);
+  assert(recv_cqes.size() == 3);
+  for (std::size_t cqe_idx = 0; cqe_idx < recv_cqes.size(); ++cqe_idx) {
+    assert(recv_cqes[cqe_idx].wr_id == 100 + cqe_idx);
+    assert(recv_cqes[cqe_idx].status == WqeStatus::Success);
+  }
+  assert(recv_cqes[1].bytes_completed == payload.size());
+  std::array<std::byte, 16> landed{};
+  assert(responder.host_memory->read(0x2040, landed).ok());
+  assert(landed == payload);
+
+  auto send_cqes = requester.engine->poll_cq(req_cq, 4);
+  assert(send_cqes.size() == 2);
+  assert((send_cqes[0].wr_id == 1) && (send_cqes[0].status == WqeStatus::Success));
+  assert((send_cqes[1].wr_id == 3) && (send_cqes[1].status == WqeStatus::Success));
+  assert(requester.engine->query_qp(*qp_a)->pending_count() == 0);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: batch create/modify/register and reference-counted teardown
+// ============================================
+void test_bulk_resource_setup() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_bulk_resource_setup...\n");
+
+  EngineSetup setup;
+  auto pd_handle = setup.create_pd();
+  auto send_cq = setup.create_cq();
+  auto recv_cq = setup.create_cq();
+  auto srq = setup.engine->create_srq(16);
+  assert(srq.has_value());
+
+  std::vector<RdmaMrRegion> regions(3);
+  for (std::size_t idx = 0; idx < regions.size(); ++idx) {
+    regions[idx] = RdmaMrRegion{.virtual_address = 0x1000 * (idx + 1),
+                                .length = 0x1000,
+                                .access = AccessFlags{.local_write = true}};
+  }
+  std::vector<std::uint32_t> lkeys = setup.engine->register_mrs(pd_handle, regions);
+  assert(lkeys.size() == regions.size());
+  assert(setup.engine->register_mrs(9999, regions).empty());
+
+  RdmaQpConfig qp_config;
+  qp_config.pd_handle = pd_handle;
+  qp_config.send_cq_number = send_cq;
+  qp_config.recv_cq_number = recv_cq;
+  qp_config.srq_number = *srq;
+  std::vector<RdmaQpConfig> configs(4, qp_config);
+  configs[2].recv_cq_number = 9999;  // Stops the batch
+  std::vector<std::uint32_t> qps = setup.engine->create_qps(configs);
+  assert(qps.size() == 2);
+  configs[2].recv_cq_number = recv_cq;
+  std::vector<std::uint32_t> more = setup.engine->create_qps(std::span(configs).subspan(2));
+  assert(more.size() == 2);
+  qps.insert(qps.end(), more.begin(), more.end());
+
+  // One parameter set applied to every QP, then per-QP parameters
+  RdmaQpModifyParams init;
+  init.target_state = QpState::Init;
+  assert(setup.engine->modify_qps(qps, std::span(&init, 1)) == qps.size());
+  std::vector<RdmaQpModifyParams> rtr(qps.size());
+  for (std::size_t idx = 0; idx < qps.size(); ++idx) {
+    rtr[idx].target_state = QpState::Rtr;
+    rtr[idx].dest_qp_number = qps[(idx + 1) % qps.size()];
+  }
+  assert(setup.engine->modify_qps(qps, rtr) == qps.size());
+  assert(setup.engine->query_qp(qps[3])->state() == QpState::Rtr);
+  assert(setup.engine->modify_qps(qps, std::span(rtr).first(2)) == 0);  // Size mismatch
+
+  // Nothing in use can be destroyed; the PD is held by the QPs and the MRs
+  assert(!setup.engine->destroy_cq(send_cq));
+  assert(!setup.engine->destroy_srq(*srq));
+  assert(!setup.engine->destroy_pd(pd_handle));
+  for (std::uint32_t qp_number : qps) {
+    assert(setup.engine->destroy_qp(qp_number));
+  }
+  assert(setup.engine->destroy_cq(send_cq));
+  assert(setup.engine->destroy_srq(*srq));
+  assert(!setup.engine->destroy_pd(pd_handle));
+  for (std::uint32_t lkey : lkeys) {
+    assert(setup.engine->deregister_mr(lkey));
+  }
+
+  // Destroyed QP numbers stay out of use for the quarantine, then come back oldest first
+  qp_config.send_cq_number = recv_cq;
+  qp_config.srq_number = 0;
+  auto fresh = setup.engine->create_qp(qp_config);
+  assert(fresh.has_value() && (std::find(qps.begin(), qps.end(), *fresh) == qps.end()));
+  assert(setup.engine->stats().qp_numbers_reused == 0);
+  setup.engine->advance_time(RdmaEngineConfig{}.qp_number_quarantine_us);
+  assert(setup.engine->create_qp(qp_config) == qps[0]);
+  assert(setup.engine->create_qp(qp_config) == qps[1]);
+  assert(setup.engine->stats().qp_numbers_reused == 2);
+  assert(!setup.engine->destroy_pd(pd_handle));
+  assert(setup.engine->destroy_qp(qps[0]));
+  assert(setup.engine->destroy_qp(qps[1]));
+  assert(setup.engine->destroy_qp(*fresh));
+  assert(setup.engine->destroy_pd(pd_handle));
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: log-linear latency histogram percentiles
+// ============================================
+void test_latency_histogram() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_latency_histogram...\n");
+
+  LatencyHistogram histogram;
+  assert(histogram.value_at_percentile(99.0) == 0);
+
+  // Small values are exact
+  for (std::uint64_t value = 1; value <= 10; ++value) {
+    histogram.record(value);
+  }
+  assert(histogram.count() == 10);
+  assert((histogram.min() == 1) && (histogram.max() == 10));
+  assert(histogram.value_at_percentile(50.0) == 5);
+  assert(histogram.value_at_percentile(100.0) == 10);
+
+  // Large values land in a bucket within 1/32 of the sample
+  for (std::uint64_t value : {1000ULL, 123456ULL, 1ULL << 40}) {
+    std::size_t index = LatencyHistogram::bucket_index(value);
+    std::uint64_t upper = LatencyHistogram::bucket_upper_bound(index);
+    assert((upper >= value) && (upper - value <= value / LatencyHistogram::kSubBuckets));
+    assert(LatencyHistogram::bucket_index(upper) == index);
+    assert(LatencyHistogram::bucket_index(upper + 1) == index + 1);
+  }
+
+  // 990 fast samples and 10 slow ones: p99 is fast, p99.9 is slow
+  LatencyHistogram tail;
+  for (int idx = 0; idx < 990; ++idx) {
+    tail.record(20);
+  }
+  for (int idx = 0; idx < 10; ++idx) {
+    tail.record(5000);
+  }
+  assert(tail.value_at_percentile(99.0) == 20);
+  std::uint64_t p999 = tail.value_at_percentile(99.9);
+  assert((p999 >= 5000) && (p999 <= 5000 + (5000 / LatencyHistogram::kSubBuckets)));
+
+  histogram.merge(tail);
+  assert((histogram.count() == 1010) && (histogram.max() == 5000) && (histogram.min() == 1));
+  histogram.reset();
+  assert((histogram.count() == 0) && (histogram.value_at_percentile(50.0) == 0));
+  assert(LatencyHistogram{}.heap_bytes() == 0);
+  assert(tail.heap_bytes() >= LatencyHistogram::bucket_index(5000) * sizeof(std::uint64_t));
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: CQE timestamps and per-QP/per-opcode completion latency
+// ============================================
+void test_wqe_latency_stats() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_wqe_latency_stats...\n");
+
+  EngineSetup requester;
+  EngineSetup responder;
+  auto req_pd = requester.create_pd();
+  auto req_cq = requester.create_cq();
+  auto resp_pd = responder.create_pd();
+  auto resp_cq = responder.create_cq();
+  auto qp_a = requester.create_qp(req_pd, req_cq, req_cq);
+  auto qp_b = responder.create_qp(resp_pd, resp_cq, resp_cq);
+  requester.transition_qp_to_rts(qp_a, qp_b);
+  responder.transition_qp_to_rts(qp_b, qp_a);
+
+  auto lkey = requester.engine->register_mr(req_pd, 0x1000, 0x1000, AccessFlags{});
+  auto resp_lkey = responder.engine->register_mr(
+      resp_pd, 0x2000, 0x1000, AccessFlags{.local_write = true, .remote_write = true});
+  assert(lkey.has_value() && resp_lkey.has_value());
+  auto rkey = responder.engine->mr_table().get_by_lkey(*resp_lkey)->rkey;
+
+  std::array<std::uint8_t, 4> req_ip{192, 168, 1, 1};
+  std::array<std::uint8_t, 4> resp_ip{192, 168, 1, 2};
+  auto round_trip = [&](std::uint64_t wire_us) {
+    requester.engine->advance_time(wire_us);
+    for (const auto& packet : requester.engine->generate_outgoing_packets()) {
+      (void)responder.engine->process_incoming_packet(packet.data, req_ip, resp_ip, 49152);
+    }
+    requester.engine->advance_time(wire_us);
+    for (const auto& packet : responder.engine->generate_outgoing_packets()) {
+      (void)requester.engine->process_incoming_packet(packet.data, resp_ip, req_ip, 49152);
+    }
+  };
+
+  // A WRITE completes after two 3us hops; a SEND after two 10us hops
+  requester.engine->advance_time(100);
+  SendWqe write;
+  write.wr_id = 1;
+  write.opcode = WqeOpcode::RdmaWrite;
+  write.sgl.push_back(SglEntry{.address = 0x1000, .length = 64});
+  write.total_length = 64;
+  write.local_lkey = *lkey;
+  write.remote_address = 0x2000;
+  write.rkey = rkey;
+  assert(requester.engine->post_send(qp_a, write));
+  round_trip(3);
+
+  RecvWqe recv;
+  recv.wr_id = 50;
+  recv.sgl.push_back(SglEntry{.address = 0x2000, .length = 64});
+  assert(responder.engine->post_recv(qp_b, recv));
+  SendWqe send = write;
+  send.wr_id = 2;
+  send.opcode = WqeOpcode::Send;
+  assert(requester.engine->post_send(qp_a, send));
+  round_trip(10);
+
+  auto cqes = requester.engine->poll_cq(req_cq, 4);
+  assert(cqes.size() == 2);
+  assert((cqes[0].wr_id == 1) && (cqes[0].timestamp_us == 106));
+  assert((cqes[1].wr_id == 2) && (cqes[1].timestamp_us == 126));
+
+  const RdmaLatencyStats& latency = requester.engine->latency_stats();
+  assert(latency.completion.count() == 2);
+  assert((latency.completion.min() == 6) && (latency.completion.max() == 20));
+  assert(latency.completion.value_at_percentile(50.0) == 6);
+  assert(latency.opcode(WqeOpcode::RdmaWrite).value_at_percentile(99.0) == 6);
+  assert(latency.opcode(WqeOpcode::Send).value_at_percentile(99.0) == 20);
+  assert(latency.opcode(WqeOpcode::RdmaRead).count() == 0);
+  assert(latency.by_qp.at(qp_a).count() == 2);
+  assert((latency.queueing.count() == 2) && (latency.queueing.max() == 0));
+
+  // Receive CQEs are stamped but not counted as send latency
+  auto recv_cqes = responder.engine->poll_cq(resp_cq, 4);
+  assert((recv_cqes.size() == 1) && (recv_cqes[0].timestamp_us == 0));
+  assert(responder.engine->latency_stats().completion.count() == 0);
+
+  // Per-QP histograms are part of the footprint and go away with their QP
+  std::size_t by_qp_bytes = sizeof(LatencyHistogram) + latency.by_qp.at(qp_a).heap_bytes();
+  assert(latency.by_qp.at(qp_a).heap_bytes() > 0);
+  std::size_t protocol_bytes = requester.engine->memory_footprint().protocol_bytes;
+  assert(protocol_bytes >= by_qp_bytes);
+  assert(requester.engine->destroy_qp(qp_a));
+  assert(requester.engine->memory_footprint().protocol_bytes + by_qp_bytes <= protocol_bytes);
+  assert(requester.engine->latency_stats().by_qp.empty());
+  assert(requester.engine->latency_stats().completion.count() == 2);
+
+  std::printf("    PASSED\n");
+}
+
 }  // namespace
 
 int main() {
@@ -441,6 +1717,20 @@ int main() {
   test_destroy_qp_invalid();
   test_advance_time();
   test_create_cq_max_exceeded();
+  test_create_cq_host_ring();
+  test_post_send_inline();
+  test_post_send_selective_signaling();
+  test_post_lists();
+  test_loopback();
+  test_memory_footprint();
+  test_read_then_send();
+  test_fast_register_and_invalidate();
+  test_on_demand_paging();
+  test_rnr_backoff_and_credits();
+  test_rnr_resend_keeps_unsignaled_inline();
+  test_bulk_resource_setup();
+  test_latency_histogram();
+  test_wqe_latency_stats();
 
   std::printf("All RoCEv2 engine coverage tests PASSED!\n");
   return 0;
@@ -7,6 +7,7 @@
 #include <iostream>
 #include <thread>
 #include <tracy/Tracy.hpp>
+#include <vector>
 
 #include "nic/rocev2/protection_domain.h"
 #include "nic/rocev2/types.h"
@@ -333,6 +334,167 @@ static void test_max_mrs_limit() {
   std::cout << "PASSED\n";
 }
 
+static void test_fast_register_lifecycle() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_fast_register_lifecycle... " << std::flush;
+
+  MemoryRegionTable mr_table;
+  AccessFlags access{.local_read = true, .local_write = true, .remote_write = true};
+
+  [[maybe_unused]] auto lkey = mr_table.allocate_fast_reg_mr(1, 8192);
+  assert(lkey.has_value());
+  [[maybe_unused]] std::uint32_t rkey = mr_table.get_by_lkey(*lkey)->rkey;
+
+  // No mapping until registered
+  assert(!mr_table.validate_lkey(*lkey, 0x1000, 64, false));
+  assert(!mr_table.fast_register(*lkey, 1, 0x1000, 16384, access, 0));
+  assert(!mr_table.fast_register(*lkey, 2, 0x1000, 4096, access, 0));
+  assert(mr_table.fast_register(*lkey, 1, 0x1000, 4096, access, 0));
+  assert(mr_table.validate_rkey(rkey, 1, 0x1000, 4096, true));
+  assert(!mr_table.validate_rkey(rkey, 1, 0x1000, 4097, true));
+
+  // A live mapping must be invalidated before it is replaced
+  assert(!mr_table.fast_register(*lkey, 1, 0x4000, 4096, access, 0));
+  assert(mr_table.invalidate(rkey, 1));
+  assert(!mr_table.invalidate(rkey, 1));
+  assert(!mr_table.validate_rkey(rkey, 1, 0x1000, 64, true));
+
+  // Remapping under a new key retires the old one
+  [[maybe_unused]] std::uint32_t new_rkey = rkey + 0x1000;
+  assert(mr_table.fast_register(*lkey, 1, 0x4000, 8192, access, new_rkey));
+  assert(mr_table.get_by_rkey(rkey) == nullptr);
+  assert(mr_table.validate_rkey(new_rkey, 1, 0x5000, 4096, true));
+
+  // Keys held by another region cannot be taken
+  [[maybe_unused]] auto other = mr_table.register_mr(1, 0x8000, 4096, access);
+  assert(other.has_value());
+  assert(mr_table.invalidate(new_rkey, 1));
+  assert(!mr_table.fast_register(*lkey, 1, 0x4000, 4096, access, *other));
+
+  // Ordinary registrations cannot be invalidated by a work request
+  assert(!mr_table.invalidate(mr_table.get_by_lkey(*other)->rkey, 1));
+  assert(mr_table.stats().fast_registrations == 2);
+  assert(mr_table.stats().invalidations == 2);
+
+  std::cout << "PASSED\n";
+}
+
+static void test_memory_window_bind() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_memory_window_bind... " << std::flush;
+
+  MemoryRegionTable mr_table;
+  AccessFlags parent_access{.local_read = true, .local_write = true, .mw_bind = true};
+  AccessFlags window_access{.remote_read = true, .remote_write = true};
+  constexpr std::uint32_t kQp = 5;
+
+  [[maybe_unused]] auto parent = mr_table.register_mr(1, 0x1000, 0x4000, parent_access);
+  [[maybe_unused]] auto no_bind = mr_table.register_mr(1, 0x8000, 0x1000, window_access);
+  [[maybe_unused]] auto rkey = mr_table.allocate_mw(1);
+  assert(parent.has_value() && no_bind.has_value() && rkey.has_value());
+  assert(mr_table.window_count() == 1);
+  assert(mr_table.count() == 2);
+
+  // Unbound windows grant nothing; binds need mw_bind rights and an in-range window
+  assert(!mr_table.validate_rkey(*rkey, 1, 0x1000, 64, false, kQp));
+  assert(!mr_table.bind_mw(*rkey, *no_bind, 1, 0x8000, 64, window_access, kQp, 0));
+  assert(!mr_table.bind_mw(*rkey, *parent, 1, 0x4800, 0x1000, window_access, kQp, 0));
+  assert(!mr_table.bind_mw(*rkey, *parent, 2, 0x2000, 0x1000, window_access, kQp, 0));
+  assert(mr_table.bind_mw(*rkey, *parent, 1, 0x2000, 0x1000, window_access, kQp, 0));
+
+  // A type-2 window only serves its QP, and the parent's lkey is not widened
+  assert(mr_table.validate_rkey(*rkey, 1, 0x2000, 0x1000, true, kQp));
+  assert(!mr_table.validate_rkey(*rkey, 1, 0x2000, 0x1000, true, kQp + 1));
+  assert(!mr_table.validate_rkey(*rkey, 1, 0x2000, 0x1000, true));
+  assert(!mr_table.validate_rkey(*rkey, 1, 0x1000, 64, true, kQp));
+  assert(!mr_table.validate_lkey(*rkey, 0x2000, 64, false));
+
+  // Bound once; a remote invalidate must come from the bound QP
+  assert(!mr_table.bind_mw(*rkey, *parent, 1, 0x3000, 0x100, window_access, kQp, 0));
+  assert(!mr_table.invalidate(*rkey, 1, kQp + 1));
+  assert(mr_table.invalidate(*rkey, 1, kQp));
+  assert(!mr_table.validate_rkey(*rkey, 1, 0x2000, 64, true, kQp));
+
+  // Rebinding under a new key; the window dies with its parent
+  [[maybe_unused]] std::uint32_t new_rkey = *rkey + 0x1000;
+  assert(mr_table.bind_mw(*rkey, *parent, 1, 0x3000, 0x100, window_access, kQp, new_rkey));
+  assert(mr_table.validate_rkey(new_rkey, 1, 0x3000, 0x100, false, kQp));
+  assert(mr_table.deregister_mr(*parent));
+  assert(!mr_table.validate_rkey(new_rkey, 1, 0x3000, 0x100, false, kQp));
+  assert(!mr_table.deallocate_mw(*rkey));
+  assert(mr_table.deallocate_mw(new_rkey));
+  assert(mr_table.window_count() == 0);
+  assert(mr_table.stats().window_binds == 2);
+
+  std::cout << "PASSED\n";
+}
+
+static void test_odp_page_faults() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_odp_page_faults... " << std::flush;
+
+  MemoryRegionTable mr_table;
+  AccessFlags odp_access{
+      .local_read = true, .local_write = true, .remote_write = true, .on_demand = true};
+  [[maybe_unused]] auto lkey = mr_table.register_mr(1, 0x10000, 0x10000, odp_access);
+  [[maybe_unused]] std::uint32_t rkey = mr_table.get_by_lkey(*lkey)->rkey;
+
+  // Nothing is present: plain validation fails quietly, access raises a fault
+  std::vector<OdpPageFault> faults;
+  mr_table.set_page_fault_handler([&](const OdpPageFault& fault) { faults.push_back(fault); });
+  assert(!mr_table.validate_lkey(*lkey, 0x10100, 64, false));
+  assert(mr_table.stats().access_errors == 0);
+  assert(mr_table.access_lkey(*lkey, 0x10100, 0x1000, false) == MrAccessStatus::PageFault);
+  assert(faults.size() == 1);
+  assert(faults[0].lkey == *lkey);
+  assert(faults[0].address == 0x10000);
+  assert(faults[0].length == 0x2000);
+  assert(!faults[0].is_remote);
+
+  // Permission checks still come first and never fault
+  assert(mr_table.access_rkey(rkey, 1, 0x10000, 64, false) == MrAccessStatus::Denied);
+  assert(mr_table.access_rkey(rkey, 1, 0x30000, 64, true) == MrAccessStatus::Denied);
+  assert(mr_table.stats().page_faults == 1);
+
+  // Populating resolves the fault; the fault points at the first missing page
+  assert(mr_table.populate(0x10000, 0x1000) == 1);
+  assert(mr_table.access_rkey(rkey, 1, 0x10100, 0x1000, true) == MrAccessStatus::PageFault);
+  assert(faults.back().address == 0x11000);
+  assert(faults.back().length == 0x1000);
+  assert(faults.back().is_write && faults.back().is_remote);
+  assert(mr_table.populate(0x10000, 0x2000) == 1);
+  assert(mr_table.access_rkey(rkey, 1, 0x10100, 0x1000, true) == MrAccessStatus::Ok);
+  assert(mr_table.validate_lkey(*lkey, 0x10100, 0x1000, false));
+
+  // A handler that populates synchronously hides the fault from the caller
+  mr_table.set_page_fault_handler([&](const OdpPageFault& fault) {
+    faults.push_back(fault);
+    mr_table.populate(fault.address, fault.length);
+  });
+  assert(mr_table.access_lkey(*lkey, 0x14000, 0x2000, true) == MrAccessStatus::Ok);
+  assert(mr_table.stats().page_faults == 3);
+  assert(mr_table.stats().pages_populated == 4);
+
+  // Prefetch advice only applies inside an ODP MR
+  assert(mr_table.prefetch(*lkey, 0x18000, 0x3000) == 3u);
+  assert(!mr_table.prefetch(*lkey, 0x1f000, 0x2000).has_value());
+  assert(mr_table.stats().pages_prefetched == 3);
+
+  // Invalidation drops pages; the next access faults again
+  assert(mr_table.invalidate_range(0x18000, 0x8000) == 3);
+  assert(!mr_table.pages_present(0x18000, 0x1000));
+  assert(mr_table.access_lkey(*lkey, 0x18000, 64, false) == MrAccessStatus::Ok);
+  assert(mr_table.stats().page_faults == 4);
+  assert(mr_table.stats().pages_invalidated == 3);
+
+  // Pinned MRs never fault
+  [[maybe_unused]] auto pinned = mr_table.register_mr(1, 0x40000, 0x1000, AccessFlags{});
+  assert(mr_table.access_lkey(*pinned, 0x40000, 0x1000, false) == MrAccessStatus::Ok);
+  assert(mr_table.stats().page_faults == 4);
+
+  std::cout << "PASSED\n";
+}
+
 // =============================================================================
 // Protection Domain Tests
 // =============================================================================
@@ -496,6 +658,9 @@ int main() {
   test_get_by_rkey();
   test_mr_reset();
   test_max_mrs_limit();
+  test_fast_register_lifecycle();
+  test_memory_window_bind();
+  test_odp_page_faults();
 
   // Protection Domain tests
   test_pd_allocate_success();
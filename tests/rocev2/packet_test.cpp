@@ -348,6 +348,46 @@ static void test_parser_ack() {
   std::cout << "PASSED\n";
 }
 
+static void test_parser_aeth_values() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_parser_aeth_values... " << std::flush;
+
+  // RNR NAKs and ACKs carry a 5-bit value below the syndrome type
+  RdmaPacketBuilder builder;
+  auto rnr_nak = builder.set_opcode(RdmaOpcode::kRcAck)
+                     .set_syndrome(AethSyndrome::RnrNak)
+                     .set_syndrome_value(14)
+                     .build();
+  assert(static_cast<std::uint8_t>(rnr_nak[12]) == 0x2E);
+  RdmaPacketParser parser;
+  assert(parser.parse(rnr_nak));
+  assert(parser.aeth().syndrome == AethSyndrome::RnrNak);
+  assert(parser.aeth().syndrome_value == 14);
+  assert(rnr_timer_us(parser.aeth().syndrome_value) == 1280);
+
+  auto ack =
+      builder.set_syndrome(AethSyndrome::Ack).set_syndrome_value(kAethCreditsInvalid).build();
+  assert(parser.parse(ack));
+  assert(parser.aeth().syndrome == AethSyndrome::Ack);
+  assert(!decode_aeth_credits(parser.aeth().syndrome_value).has_value());
+
+  // Other NAK codes use the whole byte
+  auto nak = builder.set_syndrome(AethSyndrome::RemoteOpError).set_syndrome_value(0).build();
+  assert(parser.parse(nak));
+  assert(parser.aeth().syndrome == AethSyndrome::RemoteOpError);
+  assert(parser.aeth().syndrome_value == 0);
+
+  // Credit counts round down to the logarithmic encoding
+  assert(rnr_timer_us(0) == 655360);
+  assert(encode_aeth_credits(0) == 0);
+  assert(encode_aeth_credits(5) == 4);
+  assert(decode_aeth_credits(encode_aeth_credits(5)) == 4U);
+  assert(decode_aeth_credits(encode_aeth_credits(100)) == 96U);
+  assert(decode_aeth_credits(encode_aeth_credits(1000000)) == 32768U);
+
+  std::cout << "PASSED\n";
+}
+
 static void test_parser_send_with_immediate() {
   NIC_TRACE_SCOPED(__func__);
   std::cout << "test_parser_send_with_immediate... " << std::flush;
@@ -373,6 +413,44 @@ static void test_parser_send_with_immediate() {
   std::cout << "PASSED\n";
 }
 
+static void test_parser_ud_send_with_deth() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_parser_ud_send_with_deth... " << std::flush;
+
+  RdmaPacketBuilder builder;
+  std::array<std::byte, 3> payload{std::byte{0x11}, std::byte{0x22}, std::byte{0x33}};
+
+  auto packet = builder.set_opcode(RdmaOpcode::kUdSendOnlyImm)
+                    .set_dest_qp(0x000042)
+                    .set_psn(0x000007)
+                    .set_ack_request(false)
+                    .set_qkey(0x11112222)
+                    .set_src_qp(0x000123)
+                    .set_immediate(0xCAFEF00D)
+                    .set_payload(payload)
+                    .build();
+
+  // BTH + DETH + ImmDt + payload + ICRC
+  assert(packet.size() == kBthSize + kDethSize + kImmSize + payload.size() + kIcrcSize);
+
+  RdmaPacketParser parser;
+  assert(parser.parse(packet));
+  assert(parser.has_deth());
+  assert(!parser.has_reth());
+  assert(!parser.has_aeth());
+  assert(parser.deth().qkey == 0x11112222);
+  assert(parser.deth().src_qp == 0x000123);
+  assert(parser.has_immediate());
+  assert(parser.immediate() == 0xCAFEF00D);
+  assert(parser.payload().size() == payload.size());
+  assert(parser.payload()[2] == std::byte{0x33});
+  assert(opcode_is_ud(parser.bth().opcode));
+  assert(opcode_is_only(parser.bth().opcode));
+  assert(!opcode_is_ud(RdmaOpcode::kRcSendOnly));
+
+  std::cout << "PASSED\n";
+}
+
 static void test_parser_invalid_short_packet() {
   NIC_TRACE_SCOPED(__func__);
   std::cout << "test_parser_invalid_short_packet... " << std::flush;
@@ -495,7 +573,9 @@ int main() {
   test_parser_send_only();
   test_parser_write_only();
   test_parser_ack();
+  test_parser_aeth_values();
   test_parser_send_with_immediate();
+  test_parser_ud_send_with_deth();
   test_parser_invalid_short_packet();
 
   // Opcode helper tests
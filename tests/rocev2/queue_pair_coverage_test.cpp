@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <chrono>
 #include <client/TracyProfiler.hpp>
@@ -11,6 +13,7 @@
 #include "nic/trace.h"
 
 using namespace nic::rocev2;
+using nic::SglEntry;
 
 static void WaitForTracyConnection();
 
@@ -555,6 +558,137 @@ static void test_mtu_all_values() {
   std::cout << "PASSED\n";
 }
 
+// =============================================================================
+// Compact State Tests
+// =============================================================================
+
+static void test_queue_storage_lifecycle() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_queue_storage_lifecycle... " << std::flush;
+
+  RdmaQpConfig config;
+  RdmaQueuePair qp(1, config);
+  transition_to_rts(qp, 0x1000);
+
+  // An idle QP holds no queue storage
+  assert(!qp.has_queue_storage());
+  assert(sizeof(RdmaQueuePair) <= 512);
+  std::size_t idle_bytes = qp.memory_footprint();
+  assert(idle_bytes == sizeof(RdmaQueuePair));
+  assert(qp.send_queue_size() == 0);
+  assert(qp.pending_count() == 0);
+  assert(!qp.get_next_send().has_value());
+  assert(qp.check_timeouts(1'000'000).empty());
+  assert(!qp.release_idle_storage());
+
+  // Posting allocates storage, and queued WQEs show up in the footprint
+  SendWqe wqe{.wr_id = 1, .opcode = WqeOpcode::Send, .total_length = 64};
+  wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 64});
+  assert(qp.post_send(wqe));
+  assert(qp.has_queue_storage());
+  assert(qp.memory_footprint() >= idle_bytes + sizeof(SendWqe));
+
+  // Busy storage is kept
+  assert(!qp.release_idle_storage());
+  std::optional<SendWqe> next = qp.get_next_send();
+  assert(next.has_value() && next->sgl.size() == 1);
+  qp.add_pending_operation(*next, 1);
+  assert(!qp.release_idle_storage());
+
+  // Once the ACK drains the pending op, the storage can go
+  qp.handle_ack(0x1000, AethSyndrome::Ack);
+  assert(qp.pending_count() == 0);
+  assert(qp.release_idle_storage());
+  assert(!qp.has_queue_storage());
+  assert(qp.memory_footprint() == idle_bytes);
+
+  // Reset releases storage too
+  RecvWqe recv{.wr_id = 2, .total_length = 64};
+  assert(qp.post_recv(recv));
+  assert(qp.has_queue_storage());
+  qp.reset();
+  assert(!qp.has_queue_storage());
+
+  std::cout << "PASSED\n";
+}
+
+static void test_wqe_sgl_inline_and_spill() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_wqe_sgl_inline_and_spill... " << std::flush;
+
+  WqeSgl sgl;
+  assert(sgl.empty());
+  for (std::size_t i = 0; i < kWqeInlineSges; ++i) {
+    sgl.push_back(SglEntry{.address = 0x1000 * (i + 1), .length = 16});
+  }
+  assert(sgl.size() == kWqeInlineSges);
+  assert(sgl.heap_bytes() == 0);
+
+  // One more entry spills the whole list to the heap, preserving order
+  sgl.push_back(SglEntry{.address = 0x9000, .length = 32});
+  assert(sgl.size() == kWqeInlineSges + 1);
+  assert(sgl.heap_bytes() >= (kWqeInlineSges + 1) * sizeof(SglEntry));
+  assert(sgl.front().address == 0x1000);
+  assert(sgl[kWqeInlineSges].address == 0x9000);
+  assert(compute_sgl_length(sgl) == (16 * kWqeInlineSges) + 32);
+
+  // Copies are independent; clear returns to inline storage
+  WqeSgl copy = sgl;
+  sgl.clear();
+  assert(sgl.empty() && sgl.heap_bytes() == 0);
+  assert(copy.size() == kWqeInlineSges + 1);
+  assert(copy[kWqeInlineSges].length == 32);
+
+  WqeSgl listed{SglEntry{.address = 0x10, .length = 4}};
+  assert(listed.size() == 1 && listed.front().address == 0x10);
+
+  std::cout << "PASSED\n";
+}
+
+static void test_pending_operation_record() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_pending_operation_record... " << std::flush;
+
+  RdmaQpConfig config;
+  config.timeout = 0;
+  RdmaQueuePair qp(1, config);
+  transition_to_rts(qp, 0x1000);
+
+  // Inline data is copied at its own length, not as the WQE's fixed buffer
+  std::array<std::byte, 24> payload{};
+  payload.fill(std::byte{0x5A});
+  SendWqe wqe{.wr_id = 9, .opcode = WqeOpcode::RdmaWrite, .signaled = false};
+  wqe.remote_address = 0x4000;
+  wqe.rkey = 0x77;
+  assert(set_inline_payload(wqe, payload));
+  qp.add_pending_operation(wqe, 1);
+
+  auto retransmits = qp.check_timeouts(10);
+  assert(retransmits.size() == 1);
+  const SendWqeRecord& record = retransmits[0];
+  assert(record.inline_data);
+  assert(record.inline_payload.size() == payload.size());
+  assert(record.heap_bytes() < kMaxInlineData);
+
+  // The rebuilt WQE generates the same packets as the original
+  SendWqe rebuilt = make_send_wqe(record);
+  assert(rebuilt.wr_id == 9 && !rebuilt.signaled);
+  assert(rebuilt.remote_address == 0x4000 && rebuilt.rkey == 0x77);
+  assert(rebuilt.total_length == payload.size());
+  auto view = inline_payload_view(rebuilt);
+  assert(std::equal(view.begin(), view.end(), payload.begin(), payload.end()));
+
+  // A non-inline WQE's record carries only its SGL
+  SendWqe sgl_wqe{.wr_id = 10, .opcode = WqeOpcode::Send, .total_length = 64};
+  sgl_wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 64});
+  SendWqeRecord sgl_record = make_wqe_record(sgl_wqe);
+  assert(sgl_record.inline_payload.empty());
+  assert(sgl_record.heap_bytes() == 0);
+  assert(make_send_wqe(sgl_record).sgl.size() == 1);
+
+  std::cout << "PASSED\n";
+}
+
 int main() {
   NIC_TRACE_SCOPED(__func__);
   WaitForTracyConnection();
@@ -587,6 +721,11 @@ int main() {
   // MTU tests
   test_mtu_all_values();
 
+  // Compact state tests
+  test_queue_storage_lifecycle();
+  test_wqe_sgl_inline_and_spill();
+  test_pending_operation_record();
+
   std::cout << "\n=== All tests passed! ===\n\n";
 
   return 0;
@@ -1,15 +1,19 @@
 #include "nic/rocev2/queue_pair.h"
 
+#include <array>
 #include <cassert>
 #include <chrono>
 #include <client/TracyProfiler.hpp>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <thread>
 #include <tracy/Tracy.hpp>
+#include <vector>
 
 #include "nic/rocev2/completion_queue.h"
 #include "nic/rocev2/types.h"
+#include "nic/simple_host_memory.h"
 #include "nic/trace.h"
 
 using namespace nic::rocev2;
@@ -110,6 +114,119 @@ static void test_cq_arm_and_notify() {
   std::cout << "PASSED\n";
 }
 
+static void test_cq_compression() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_cq_compression... " << std::flush;
+
+  nic::SimpleHostMemory memory(nic::HostMemoryConfig{.size_bytes = 4096});
+  RdmaCompletionQueue cq(
+      7, RdmaCqConfig{.depth = 4, .host_ring_address = 0x100, .compression = true}, &memory);
+  assert(cq.is_compressed());
+
+  // One title plus a full block of mini-CQEs, then three more still in the open block
+  constexpr std::uint64_t kCqes = 1 + kMiniCqesPerSlot + 3;
+  for (std::uint64_t idx = 0; idx < kCqes; ++idx) {
+    RdmaCqe cqe{.wr_id = 100 + idx, .qp_number = 3, .is_send = false};
+    cqe.bytes_completed = static_cast<std::uint32_t>(64 + idx);
+    assert(cq.post(cqe));
+  }
+  assert(cq.count() == kCqes);
+  assert(cq.stats().compressed_cqes == kCqes - 1);
+  assert(cq.stats().mini_blocks == 1);
+  assert(cq.stats().bytes_written == 2 * kCqeSlotSize);
+
+  // The block's slot carries the mini-CQEs as raw payload bytes
+  RdmaCqeSlot slot;
+  std::array<std::byte, kCqeSlotSize> bytes{};
+  assert(memory.read(0x100 + kCqeSlotSize, bytes).ok());
+  std::memcpy(static_cast<void*>(&slot), bytes.data(), kCqeSlotSize);
+  assert((slot.format == kCqeFormatMiniBlock) && (slot.mini_count == kMiniCqesPerSlot));
+  std::array<RdmaMiniCqe, kMiniCqesPerSlot> minis{};
+  slot.load_minis(minis);
+  assert((minis[0].wr_id_delta == 1) && (minis[0].bytes_completed == 65));
+
+  // A CQE with other fields ends the run and becomes the next title
+  assert(cq.post(RdmaCqe{.wr_id = 7, .qp_number = 4}));
+  assert(cq.stats().mini_blocks == 2);
+  assert(cq.stats().bytes_written == 4 * kCqeSlotSize);
+  assert(cq.stats().bytes_per_cqe() < static_cast<double>(kCqeSlotSize));
+
+  // Small polls stop inside a block and resume where they left off
+  std::array<RdmaCqe, 3> out{};
+  std::vector<RdmaCqe> polled;
+  while (!cq.is_empty()) {
+    std::size_t count = cq.poll(std::span<RdmaCqe>(out));
+    assert(count != 0);
+    polled.insert(polled.end(), out.begin(), out.begin() + static_cast<std::ptrdiff_t>(count));
+  }
+  assert(polled.size() == kCqes + 1);
+  for (std::uint64_t idx = 0; idx < kCqes; ++idx) {
+    assert(polled[idx].wr_id == 100 + idx);
+    assert(polled[idx].bytes_completed == 64 + idx);
+    assert((polled[idx].qp_number == 3) && !polled[idx].is_send);
+  }
+  assert((polled.back().wr_id == 7) && (polled.back().qp_number == 4));
+  assert(cq.stats().cqes_polled == kCqes + 1);
+
+  // Errors are never compressed
+  assert(cq.post(RdmaCqe{.wr_id = 8, .status = WqeStatus::WrFlushError, .qp_number = 4}));
+  assert(cq.stats().compressed_cqes == kCqes - 1);
+  auto error = cq.poll_one();
+  assert(error.has_value() && (error->status == WqeStatus::WrFlushError));
+
+  std::cout << "PASSED\n";
+}
+
+static void test_cq_solicited_only_arm() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_cq_solicited_only_arm... " << std::flush;
+
+  RdmaCompletionQueue cq(1);
+  cq.arm(true);
+  assert(cq.is_solicited_only());
+
+  cq.post(RdmaCqe{.wr_id = 1, .is_send = false});
+  assert(!cq.should_notify());  // Unsolicited receive
+
+  cq.post(RdmaCqe{.wr_id = 2, .status = WqeStatus::RemoteAccessError});
+  assert(cq.should_notify());  // Errors always notify
+  assert(cq.event_cqes() == 1);
+
+  cq.arm(true);
+  RdmaCqe solicited{.wr_id = 3, .is_send = false};
+  solicited.solicited = true;
+  cq.post(solicited);
+  assert(cq.should_notify());
+  assert(cq.take_event() == 1);
+  assert(!cq.is_armed());
+  assert(cq.stats().events == 1);
+
+  std::cout << "PASSED\n";
+}
+
+static void test_cq_moderation_count() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_cq_moderation_count... " << std::flush;
+
+  RdmaCompletionQueue cq(1, RdmaCqConfig{.moderation = {.cq_count = 3}});
+  cq.arm();
+  cq.post(RdmaCqe{.wr_id = 1});
+  cq.post(RdmaCqe{.wr_id = 2});
+  assert(cq.should_notify());
+  assert(!cq.event_due());  // Two of three CQEs
+  cq.post(RdmaCqe{.wr_id = 3});
+  assert(cq.event_due());
+  assert(cq.take_event() == 3);
+
+  // A period-only moderation leaves the event to the owner's timer
+  cq.set_moderation(RdmaCqModeration{.cq_period_us = 10});
+  cq.arm();
+  cq.post(RdmaCqe{.wr_id = 4});
+  assert(cq.should_notify() && !cq.event_due());
+
+  std::cout << "PASSED\n";
+}
+
 static void test_cq_reset() {
   NIC_TRACE_SCOPED(__func__);
   std::cout << "test_cq_reset... " << std::flush;
@@ -130,6 +247,83 @@ static void test_cq_reset() {
   std::cout << "PASSED\n";
 }
 
+static void test_cq_depth_rounds_to_power_of_two() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_cq_depth_rounds_to_power_of_two... " << std::flush;
+
+  RdmaCompletionQueue cq(1, RdmaCqConfig{.depth = 5});
+  assert(cq.depth() == 8);
+
+  for (std::uint64_t wr_idx = 0; wr_idx < 8; ++wr_idx) {
+    assert(cq.post(RdmaCqe{.wr_id = wr_idx}));
+  }
+  assert(cq.is_full());
+  assert(!cq.post(RdmaCqe{.wr_id = 8}));
+
+  std::cout << "PASSED\n";
+}
+
+static void test_cq_span_poll_across_wrap() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_cq_span_poll_across_wrap... " << std::flush;
+
+  RdmaCompletionQueue cq(1, RdmaCqConfig{.depth = 4});
+  std::array<RdmaCqe, 3> out{};
+
+  // Several passes over the ring exercise both owner-bit phases.
+  std::uint64_t next_post = 0;
+  std::uint64_t next_poll = 0;
+  for (int round = 0; round < 6; ++round) {
+    for (int post_idx = 0; post_idx < 3; ++post_idx) {
+      assert(cq.post(RdmaCqe{.wr_id = next_post++}));
+    }
+    std::size_t polled = cq.poll(std::span<RdmaCqe>(out));
+    assert(polled == 3);
+    for (std::size_t cqe_idx = 0; cqe_idx < polled; ++cqe_idx) {
+      assert(out[cqe_idx].wr_id == next_poll++);
+    }
+  }
+  assert(cq.is_empty());
+  assert(cq.poll(std::span<RdmaCqe>(out)) == 0);
+  assert(cq.consumer_index() == 18);
+  assert(cq.stats().cqes_polled == 18);
+
+  std::cout << "PASSED\n";
+}
+
+static void test_cq_host_resident_ring() {
+  NIC_TRACE_SCOPED(__func__);
+  std::cout << "test_cq_host_resident_ring... " << std::flush;
+
+  nic::SimpleHostMemory memory(nic::HostMemoryConfig{.size_bytes = 4096});
+  constexpr nic::HostAddress kRingBase = 0x100;
+  RdmaCompletionQueue cq(7, RdmaCqConfig{.depth = 4, .host_ring_address = kRingBase}, &memory);
+  assert(cq.is_host_resident());
+
+  // Slots start hardware-owned.
+  RdmaCqeSlot slot;
+  std::array<std::byte, kCqeSlotSize> bytes{};
+  assert(memory.read(kRingBase, bytes).ok());
+  std::memcpy(static_cast<void*>(&slot), bytes.data(), kCqeSlotSize);
+  assert(slot.owner == 1);
+
+  for (std::uint64_t wr_idx = 0; wr_idx < 6; ++wr_idx) {
+    assert(cq.post(RdmaCqe{.wr_id = wr_idx, .qp_number = 3}));
+    auto polled = cq.poll_one();
+    assert(polled.has_value());
+    assert(polled->wr_id == wr_idx);
+    assert(polled->qp_number == 3);
+  }
+
+  // Slot 1 was written on the second pass, so its owner bit has flipped.
+  assert(memory.read(kRingBase + kCqeSlotSize, bytes).ok());
+  std::memcpy(static_cast<void*>(&slot), bytes.data(), kCqeSlotSize);
+  assert(slot.owner == 1);
+  assert(slot.load_cqe().wr_id == 5);
+
+  std::cout << "PASSED\n";
+}
+
 // =============================================================================
 // Queue Pair State Machine Tests
 // =============================================================================
@@ -479,7 +673,13 @@ int main() {
   test_cq_poll_multiple();
   test_cq_overflow();
   test_cq_arm_and_notify();
+  test_cq_solicited_only_arm();
+  test_cq_moderation_count();
   test_cq_reset();
+  test_cq_depth_rounds_to_power_of_two();
+  test_cq_span_poll_across_wrap();
+  test_cq_host_resident_ring();
+  test_cq_compression();
 
   // QP State Machine tests
   test_qp_state_transitions();
@@ -918,6 +918,87 @@ void test_invalid_request_opcode() {
   std::printf("    PASSED\n");
 }
 
+// Test READ responses arriving out of order are placed by PSN
+void test_out_of_order_responses() {
+  std::printf("  test_out_of_order_responses...\n");
+
+  HostMemoryConfig mem_cfg{.size_bytes = kTestMemorySize};
+  SimpleHostMemory host_memory{mem_cfg};
+  MemoryRegionTable mr_table;
+
+  RdmaQpConfig config;
+  config.pd_handle = 1;
+  RdmaQueuePair requester_qp{kRequesterQpNum, config};
+  RdmaQueuePair responder_qp{kResponderQpNum, config};
+  setup_qp_for_rdma(requester_qp, kResponderQpNum);
+  setup_qp_for_rdma(responder_qp, kRequesterQpNum);
+  RdmaQpModifyParams mtu_params;
+  mtu_params.path_mtu = 1;  // 256 bytes
+  assert(requester_qp.modify(mtu_params));
+  assert(responder_qp.modify(mtu_params));
+
+  AccessFlags local_access{.local_read = true, .local_write = true};
+  auto local_lkey = mr_table.register_mr(1, 0x1000, 8192, local_access);
+  AccessFlags remote_access{.local_read = true, .local_write = true, .remote_read = true};
+  auto remote_lkey = mr_table.register_mr(1, 0x4000, 8192, remote_access);
+  assert(local_lkey.has_value() && remote_lkey.has_value());
+
+  std::vector<std::byte> test_data = make_test_pattern(600);
+  (void) host_memory.write(0x4000, test_data);
+
+  // SGE boundaries fall inside response packets
+  SendWqe read_wqe;
+  read_wqe.wr_id = 1010;
+  read_wqe.opcode = WqeOpcode::RdmaRead;
+  read_wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 200});
+  read_wqe.sgl.push_back(SglEntry{.address = 0x1400, .length = 200});
+  read_wqe.sgl.push_back(SglEntry{.address = 0x1800, .length = 200});
+  read_wqe.total_length = 600;
+  read_wqe.local_lkey = local_lkey.value();
+  read_wqe.remote_address = 0x4000;
+  read_wqe.rkey = mr_table.get_by_lkey(remote_lkey.value())->rkey;
+
+  ReadProcessor processor{host_memory, mr_table};
+  auto request_packets = processor.generate_read_request(requester_qp, read_wqe);
+  RdmaPacketParser parser;
+  assert(parser.parse(request_packets[0]));
+  ReadRequestResult req_result = processor.process_read_request(responder_qp, parser);
+  assert(req_result.response_packets.size() == 3);
+
+  // Responses are numbered from the request PSN
+  for (std::size_t idx = 0; idx < 3; ++idx) {
+    assert(parser.parse(req_result.response_packets[idx]));
+    assert(parser.bth().psn == idx);
+  }
+
+  // Last, first, then middle: the READ completes when the final hole fills
+  ReadResponseResult resp_result;
+  for (std::size_t idx : {2, 0}) {
+    assert(parser.parse(req_result.response_packets[idx]));
+    resp_result = processor.process_read_response(requester_qp, parser);
+    assert(resp_result.success && !resp_result.is_read_complete);
+  }
+  assert(parser.parse(req_result.response_packets[2]));
+  resp_result = processor.process_read_response(requester_qp, parser);
+  assert(resp_result.success && !resp_result.is_read_complete);
+  assert(processor.stats().duplicate_responses == 1);
+
+  assert(parser.parse(req_result.response_packets[1]));
+  resp_result = processor.process_read_response(requester_qp, parser);
+  assert(resp_result.success && resp_result.is_read_complete);
+  assert(resp_result.request_psn == 0);
+  assert(resp_result.cqe.has_value() && (resp_result.cqe->bytes_completed == 600));
+  assert(processor.stats().out_of_order_responses == 1);
+
+  std::vector<std::byte> local_data(600);
+  (void) host_memory.read(0x1000, std::span<std::byte>(local_data).subspan(0, 200));
+  (void) host_memory.read(0x1400, std::span<std::byte>(local_data).subspan(200, 200));
+  (void) host_memory.read(0x1800, std::span<std::byte>(local_data).subspan(400, 200));
+  assert(local_data == test_data);
+
+  std::printf("    PASSED\n");
+}
+
 }  // namespace
 
 int main() {
@@ -939,6 +1020,7 @@ int main() {
   test_response_no_request();
   test_invalid_response_opcode();
   test_invalid_request_opcode();
+  test_out_of_order_responses();
 
   std::printf("All RDMA READ tests PASSED!\n");
   return 0;
@@ -39,6 +39,30 @@ void test_ack_processing() {
   std::printf("    PASSED\n");
 }
 
+// Test that unsignaled operations retire without reporting their wr_id
+void test_ack_unsignaled() {
+  std::printf("  test_ack_unsignaled...\n");
+
+  ReliabilityManager manager;
+
+  manager.add_pending(1, 0, 0, 1001, WqeOpcode::Send, 0, false);
+  manager.add_pending(1, 1, 1, 1002, WqeOpcode::RdmaWrite, 0, false);
+  manager.add_pending(1, 2, 2, 1003, WqeOpcode::Send, 0, true);
+
+  // One cumulative ACK covers all three; only the signaled op is reported
+  AckResult result = manager.process_ack(1, 2);
+  assert(result.success);
+  assert(result.completed_wr_ids.size() == 1);
+  assert(result.completed_wr_ids[0] == 1003);
+  assert(manager.stats().unsignaled_retired == 2);
+
+  // Retired ops are gone: a repeated ACK completes nothing
+  result = manager.process_ack(1, 2);
+  assert(result.completed_wr_ids.empty());
+
+  std::printf("    PASSED\n");
+}
+
 // Test NAK processing for PSN sequence error
 void test_nak_psn_sequence_error() {
   std::printf("  test_nak_psn_sequence_error...\n");
@@ -85,6 +109,73 @@ void test_nak_rnr() {
   assert(result.error_status.value() == WqeStatus::RnrRetryExceededError);
   assert(manager.stats().retry_exceeded == 1);
 
+  // A per-QP limit overrides the configured one; kRnrRetryInfinite never gives up
+  manager.add_pending(2, 20, 20, 2001, WqeOpcode::Send, 0);
+  result = manager.process_nak(2, 20, AethSyndrome::RnrNak, 0, 0);
+  assert(result.error_status == WqeStatus::RnrRetryExceededError);
+  manager.add_pending(3, 30, 30, 3001, WqeOpcode::Send, 0);
+  for (int retry_idx = 0; retry_idx < 20; ++retry_idx) {
+    result = manager.process_nak(3, 30, AethSyndrome::RnrNak, 0, kRnrRetryInfinite);
+    assert(result.needs_retransmit && !result.error_status.has_value());
+  }
+
+  std::printf("    PASSED\n");
+}
+
+// Test RNR back-off: the advertised timer doubles per retry, capped at rnr_timeout_us
+void test_nak_rnr_backoff() {
+  std::printf("  test_nak_rnr_backoff...\n");
+
+  ReliabilityConfig config;
+  config.rnr_timeout_us = 2000;
+  ReliabilityManager manager{config};
+  manager.add_pending(1, 10, 12, 1001, WqeOpcode::Send, 0);
+
+  constexpr std::uint8_t kTimer = 12;  // 640 us
+  AckResult result = manager.process_nak(1, 10, AethSyndrome::RnrNak, kTimer);
+  assert(result.needs_retransmit);
+  assert(result.retry_delay_us == 640);
+  result = manager.process_nak(1, 10, AethSyndrome::RnrNak, kTimer);
+  assert(result.retry_delay_us == 1280);
+  result = manager.process_nak(1, 10, AethSyndrome::RnrNak, kTimer);
+  assert(result.retry_delay_us == 2000);
+
+  // Other NAKs carry no delay
+  result = manager.process_nak(1, 10, AethSyndrome::PsnSeqError);
+  assert(result.retry_delay_us == 0);
+
+  std::printf("    PASSED\n");
+}
+
+// Test that ACK timeouts do not feed the RNR back-off or its retry limit
+void test_nak_rnr_after_timeouts() {
+  std::printf("  test_nak_rnr_after_timeouts...\n");
+
+  ReliabilityConfig config;
+  config.ack_timeout_us = 100;
+  config.max_retries = 7;
+  config.rnr_retry_count = 1;
+  ReliabilityManager manager{config};
+  manager.add_pending(1, 10, 10, 1001, WqeOpcode::Send, 0);
+
+  // Three timeouts before the responder starts answering
+  std::uint64_t now_us = 0;
+  for (int timeout_idx = 0; timeout_idx < 3; ++timeout_idx) {
+    now_us += 100ULL << timeout_idx;
+    assert(manager.check_timeouts(1, now_us).size() == 1);
+  }
+  assert(manager.stats().timeouts == 3);
+
+  // The first RNR NAK still waits the advertised timer and is within the RNR limit
+  constexpr std::uint8_t kTimer = 12;  // 640 us
+  AckResult result = manager.process_nak(1, 10, AethSyndrome::RnrNak, kTimer);
+  assert(result.needs_retransmit);
+  assert(!result.error_status.has_value());
+  assert(result.retry_delay_us == 640);
+
+  result = manager.process_nak(1, 10, AethSyndrome::RnrNak, kTimer);
+  assert(result.error_status == WqeStatus::RnrRetryExceededError);
+
   std::printf("    PASSED\n");
 }
 
@@ -197,8 +288,11 @@ int main() {
   std::printf("Running reliability tests...\n");
 
   test_ack_processing();
+  test_ack_unsignaled();
   test_nak_psn_sequence_error();
   test_nak_rnr();
+  test_nak_rnr_backoff();
+  test_nak_rnr_after_timeouts();
   test_nak_remote_access_error();
   test_timeout_detection();
   test_multiple_pending();
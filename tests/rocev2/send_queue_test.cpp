@@ -0,0 +1,345 @@
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "nic/dma_engine.h"
+#include "nic/rocev2/engine.h"
+#include "nic/rocev2/send_queue.h"
+#include "nic/simple_host_memory.h"
+#include "nic/trace.h"
+
+using namespace nic;
+using namespace nic::rocev2;
+
+static void WaitForTracyConnection();
+
+namespace {
+
+constexpr HostAddress kRingAddress = 0x8000;
+constexpr std::size_t kRingDepth = 8;
+
+/// One self-connected RC QP whose send queue lives in host memory.
+struct RingSetup {
+  std::unique_ptr<SimpleHostMemory> host_memory;
+  std::unique_ptr<DMAEngine> dma_engine;
+  std::unique_ptr<RdmaEngine> engine;
+  std::uint32_t pd_handle{0};
+  std::uint32_t send_cq{0};
+  std::uint32_t recv_cq{0};
+  std::uint32_t qp{0};
+
+  RingSetup() {
+    NIC_TRACE_SCOPED(__func__);
+    HostMemoryConfig mem_cfg{.size_bytes = 64 * 1024};
+    host_memory = std::make_unique<SimpleHostMemory>(mem_cfg);
+    dma_engine = std::make_unique<DMAEngine>(*host_memory);
+    engine = std::make_unique<RdmaEngine>(RdmaEngineConfig{}, *dma_engine, *host_memory);
+
+    auto pd = engine->create_pd();
+    auto cq1 = engine->create_cq(64);
+    auto cq2 = engine->create_cq(64);
+    assert(pd.has_value() && cq1.has_value() && cq2.has_value());
+    pd_handle = *pd;
+    send_cq = *cq1;
+    recv_cq = *cq2;
+
+    RdmaQpConfig qp_config;
+    qp_config.pd_handle = pd_handle;
+    qp_config.send_cq_number = send_cq;
+    qp_config.recv_cq_number = recv_cq;
+    qp_config.send_queue_depth = kRingDepth;
+    qp_config.sq_ring_address = kRingAddress;
+    auto qp_opt = engine->create_qp(qp_config);
+    assert(qp_opt.has_value());
+    qp = *qp_opt;
+  }
+
+  /// Move the QP to RTS, connected to itself.
+  void connect() {
+    NIC_TRACE_SCOPED(__func__);
+    RdmaQpModifyParams params;
+    params.target_state = QpState::Init;
+    assert(engine->modify_qp(qp, params));
+
+    params.target_state = QpState::Rtr;
+    params.dest_qp_number = qp;
+    params.rq_psn = 0;
+    params.dest_ip = std::array<std::uint8_t, 4>{192, 168, 1, 1};
+    assert(engine->modify_qp(qp, params));
+
+    params = RdmaQpModifyParams{};
+    params.target_state = QpState::Rts;
+    params.sq_psn = 0;
+    assert(engine->modify_qp(qp, params));
+  }
+
+  /// Write a zero-length SEND into ring slot `index` and return its encoding.
+  RdmaSqWqe write_slot(std::uint32_t index, std::uint64_t wr_id) {
+    NIC_TRACE_SCOPED(__func__);
+    SendWqe wqe;
+    wqe.wr_id = wr_id;
+    wqe.opcode = WqeOpcode::Send;
+    auto entry = encode_sq_wqe(wqe, qp);
+    assert(entry.has_value());
+
+    std::array<std::byte, kSqWqeSize> bytes{};
+    std::memcpy(bytes.data(), static_cast<const void*>(&*entry), bytes.size());
+    assert(host_memory->write(engine->query_sq_ring(qp)->slot_address(index), bytes).ok());
+    return *entry;
+  }
+
+  /// Deliver pending packets and their ACKs.
+  void transfer_packets() {
+    NIC_TRACE_SCOPED(__func__);
+    for (int hop = 0; hop < 2; ++hop) {
+      for (auto& pkt : engine->generate_outgoing_packets()) {
+        engine->process_incoming_packet(pkt.data, pkt.dest_ip, pkt.dest_ip, pkt.src_port);
+      }
+    }
+  }
+};
+
+// ============================================
+// Test: ring slot encoding round trip
+// ============================================
+void test_sq_wqe_encoding() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_sq_wqe_encoding...\n");
+
+  SendWqe wqe;
+  wqe.wr_id = 0x1234;
+  wqe.opcode = WqeOpcode::RdmaWriteImm;
+  wqe.signaled = false;
+  wqe.fence = true;
+  wqe.immediate_data = 0xCAFE;
+  wqe.sgl.push_back(SglEntry{.address = 0x2000, .length = 128});
+  wqe.total_length = 128;
+  wqe.local_lkey = 0x101;
+  wqe.remote_address = 0x3000;
+  wqe.rkey = 0x202;
+
+  auto entry = encode_sq_wqe(wqe, 7);
+  assert(entry.has_value());
+  assert(entry->qp_number == 7);
+  SendWqe decoded = decode_sq_wqe(*entry);
+  assert(decoded.wr_id == wqe.wr_id);
+  assert(decoded.opcode == wqe.opcode);
+  assert(!decoded.signaled && decoded.fence && !decoded.solicited);
+  assert(decoded.immediate_data == 0xCAFE);
+  assert(decoded.sgl.size() == 1);
+  assert((decoded.sgl[0].address == 0x2000) && (decoded.sgl[0].length == 128));
+  assert(decoded.total_length == 128);
+  assert((decoded.local_lkey == 0x101) && (decoded.rkey == 0x202));
+  assert(decoded.remote_address == 0x3000);
+
+  // One slot holds one SGE
+  wqe.sgl.push_back(SglEntry{.address = 0x4000, .length = 16});
+  assert(!encode_sq_wqe(wqe, 7).has_value());
+
+  // Inline payload up to kSqWqeInlineBytes
+  std::array<std::byte, kSqWqeInlineBytes + 1> payload{};
+  payload[3] = std::byte{0x5A};
+  assert(set_inline_payload(wqe, payload));
+  assert(!encode_sq_wqe(wqe, 7).has_value());
+  assert(set_inline_payload(wqe, std::span<const std::byte>(payload).first(kSqWqeInlineBytes)));
+  entry = encode_sq_wqe(wqe, 7);
+  assert(entry.has_value());
+  decoded = decode_sq_wqe(*entry);
+  assert(decoded.inline_data && decoded.sgl.empty());
+  assert(decoded.total_length == kSqWqeInlineBytes);
+  assert(decoded.inline_payload[3] == std::byte{0x5A});
+
+  // Key operations carry their key in the immediate slot and access in its own byte
+  SendWqe reg;
+  reg.opcode = WqeOpcode::RegMr;
+  reg.local_lkey = 0x300;
+  reg.new_rkey = 0x7700;
+  reg.access = AccessFlags{.local_write = true, .remote_write = true};
+  reg.sgl.push_back(SglEntry{.address = 0x5000, .length = 0x400});
+  entry = encode_sq_wqe(reg, 7);
+  assert(entry.has_value());
+  decoded = decode_sq_wqe(*entry);
+  assert((decoded.new_rkey == 0x7700) && (decoded.local_lkey == 0x300));
+  assert(decoded.access.local_write && decoded.access.remote_write);
+  assert(!decoded.access.remote_read && !decoded.access.mw_bind);
+
+  SendWqe send_inv;
+  send_inv.opcode = WqeOpcode::SendWithInvalidate;
+  send_inv.invalidate_rkey = 0x7700;
+  entry = encode_sq_wqe(send_inv, 7);
+  assert(entry.has_value());
+  assert(decode_sq_wqe(*entry).invalidate_rkey == 0x7700);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: QP creation validates the ring
+// ============================================
+void test_sq_ring_create() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_sq_ring_create...\n");
+
+  RingSetup setup;
+  const RdmaSendQueueRing* ring = setup.engine->query_sq_ring(setup.qp);
+  assert(ring != nullptr);
+  assert(ring->depth() == kRingDepth);
+  assert(ring->slot_address(kRingDepth + 1) == kRingAddress + kSqWqeSize);
+
+  RdmaQpConfig qp_config;
+  qp_config.pd_handle = setup.pd_handle;
+  qp_config.send_cq_number = setup.send_cq;
+  qp_config.recv_cq_number = setup.recv_cq;
+
+  // Not a power of two
+  qp_config.send_queue_depth = 12;
+  qp_config.sq_ring_address = kRingAddress;
+  assert(!setup.engine->create_qp(qp_config).has_value());
+
+  // Outside host memory
+  qp_config.send_queue_depth = 16;
+  qp_config.sq_ring_address = 64 * 1024 - kSqWqeSize;
+  assert(!setup.engine->create_qp(qp_config).has_value());
+
+  // No ring requested
+  qp_config.sq_ring_address = std::nullopt;
+  auto plain_qp = setup.engine->create_qp(qp_config);
+  assert(plain_qp.has_value());
+  assert(setup.engine->query_sq_ring(*plain_qp) == nullptr);
+  assert(setup.engine->ring_sq_doorbell(*plain_qp, 1) == 0);
+
+  assert(setup.engine->destroy_qp(setup.qp));
+  assert(setup.engine->query_sq_ring(setup.qp) == nullptr);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: doorbell fetches every published slot
+// ============================================
+void test_sq_ring_doorbell() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_sq_ring_doorbell...\n");
+
+  RingSetup setup;
+  setup.connect();
+  for (std::uint32_t index = 0; index < 3; ++index) {
+    RecvWqe recv_wqe;
+    recv_wqe.wr_id = 100 + index;
+    assert(setup.engine->post_recv(setup.qp, recv_wqe));
+    setup.write_slot(index, index + 1);
+  }
+
+  std::size_t reads_before = setup.dma_engine->counters().read_ops;
+  assert(setup.engine->ring_sq_doorbell(setup.qp, 3) == 3);
+  assert(setup.dma_engine->counters().read_ops == reads_before + 3);
+  assert(setup.engine->stats().sq_doorbells == 1);
+  assert(setup.engine->stats().sq_wqes_fetched == 3);
+
+  const RdmaSendQueueRing* ring = setup.engine->query_sq_ring(setup.qp);
+  assert((ring->producer_index() == 3) && (ring->consumer_index() == 3));
+
+  // Stale and overrunning producer indices are ignored
+  std::uint64_t errors_before = setup.engine->stats().errors;
+  assert(setup.engine->ring_sq_doorbell(setup.qp, 2) == 0);
+  assert(setup.engine->ring_sq_doorbell(setup.qp, 3 + kRingDepth + 1) == 0);
+  assert(setup.engine->stats().errors == errors_before + 2);
+  assert(ring->pending() == 0);
+
+  setup.transfer_packets();
+  auto send_cqes = setup.engine->poll_cq(setup.send_cq, 10);
+  assert(send_cqes.size() == 3);
+  for (std::size_t cqe_idx = 0; cqe_idx < send_cqes.size(); ++cqe_idx) {
+    assert(send_cqes[cqe_idx].wr_id == cqe_idx + 1);
+  }
+  assert(setup.engine->poll_cq(setup.recv_cq, 10).size() == 3);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: BlueFlame skips the descriptor fetch
+// ============================================
+void test_sq_blueflame() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_sq_blueflame...\n");
+
+  RingSetup setup;
+
+  // Published before the QP can send: the slot stays pending
+  setup.write_slot(0, 1);
+  assert(setup.engine->ring_sq_doorbell(setup.qp, 1) == 0);
+  const RdmaSendQueueRing* ring = setup.engine->query_sq_ring(setup.qp);
+  assert(ring->pending() == 1);
+
+  setup.connect();
+  for (std::uint32_t index = 0; index < 3; ++index) {
+    RecvWqe recv_wqe;
+    recv_wqe.wr_id = 100 + index;
+    assert(setup.engine->post_recv(setup.qp, recv_wqe));
+  }
+
+  // The BlueFlame WQE may not overtake slot 0, so both are fetched from the ring
+  RdmaSqWqe entry = setup.write_slot(1, 2);
+  std::size_t reads_before = setup.dma_engine->counters().read_ops;
+  assert(setup.engine->post_blueflame(entry));
+  assert(setup.dma_engine->counters().read_ops == reads_before + 2);
+  assert(setup.engine->stats().blueflame_fallbacks == 1);
+  assert(setup.engine->stats().blueflame_wqes == 0);
+
+  // Empty ring: posted straight from the doorbell write
+  entry = setup.write_slot(2, 3);
+  reads_before = setup.dma_engine->counters().read_ops;
+  assert(setup.engine->post_blueflame(entry));
+  assert(setup.dma_engine->counters().read_ops == reads_before);
+  assert(setup.engine->stats().blueflame_wqes == 1);
+  assert((ring->producer_index() == 3) && (ring->consumer_index() == 3));
+
+  // Unknown QP
+  entry.qp_number = 9999;
+  assert(!setup.engine->post_blueflame(entry));
+
+  setup.transfer_packets();
+  assert(setup.engine->poll_cq(setup.send_cq, 10).size() == 3);
+  assert(setup.engine->poll_cq(setup.recv_cq, 10).size() == 3);
+
+  std::printf("    PASSED\n");
+}
+
+}  // namespace
+
+int main() {
+  NIC_TRACE_SCOPED(__func__);
+  WaitForTracyConnection();
+  std::printf("Running RoCEv2 send queue ring tests...\n");
+
+  test_sq_wqe_encoding();
+  test_sq_ring_create();
+  test_sq_ring_doorbell();
+  test_sq_blueflame();
+
+  std::printf("All RoCEv2 send queue ring tests PASSED!\n");
+  return 0;
+}
+
+static void WaitForTracyConnection() {
+#ifdef TRACY_ENABLE
+  const char* wait_env = std::getenv("NIC_WAIT_FOR_TRACY");
+  if (!wait_env || wait_env[0] == '\0' || wait_env[0] == '0') {
+    return;
+  }
+
+  const auto timeout = std::chrono::seconds(2);
+  const auto start = std::chrono::steady_clock::now();
+  while (!tracy::GetProfiler().IsConnected()) {
+    if (std::chrono::steady_clock::now() - start > timeout) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+#endif
+}
@@ -950,6 +950,57 @@ void test_multi_packet_psn_mismatch() {
   std::printf("    PASSED\n");
 }
 
+// Test inline SEND: payload carried in the WQE, no MR or host memory read
+void test_inline_send() {
+  std::printf("  test_inline_send...\n");
+
+  HostMemoryConfig mem_cfg{.size_bytes = kTestMemorySize};
+  SimpleHostMemory host_memory{mem_cfg};
+  MemoryRegionTable mr_table;  // Deliberately empty: inline sends need no lkey
+
+  RdmaQpConfig config;
+  config.pd_handle = 1;
+  RdmaQueuePair sender_qp{kSenderQpNum, config};
+  setup_qp_for_send(sender_qp, kReceiverQpNum);
+
+  std::vector<std::byte> test_data = make_test_pattern(48);
+  SendWqe send_wqe;
+  send_wqe.wr_id = 77;
+  send_wqe.opcode = WqeOpcode::Send;
+  assert(set_inline_payload(send_wqe, test_data));
+  assert(send_wqe.inline_data);
+  assert(send_wqe.total_length == 48);
+
+  SendRecvProcessor processor{host_memory, mr_table};
+  auto packets = processor.generate_send_packets(sender_qp, send_wqe);
+  assert(packets.size() == 1);
+  assert(processor.stats().inline_sends == 1);
+
+  RdmaPacketParser parser;
+  assert(parser.parse(packets[0]));
+  assert(parser.payload().size() == 48);
+  assert(std::memcmp(parser.payload().data(), test_data.data(), 48) == 0);
+
+  // Signaled inline WQEs are still tracked until ACKed
+  assert(sender_qp.pending_count() == 1);
+
+  // Unsignaled inline WQEs keep a retransmit record too; only their CQE is suppressed
+  send_wqe.signaled = false;
+  packets = processor.generate_send_packets(sender_qp, send_wqe);
+  assert(packets.size() == 1);
+  assert(sender_qp.pending_count() == 2);
+  sender_qp.handle_ack(sender_qp.last_sent_psn(), AethSyndrome::Ack);
+  assert(sender_qp.pending_count() == 0);
+
+  // Oversized payloads cannot be made inline
+  std::vector<std::byte> too_big(kMaxInlineData + 1);
+  SendWqe big_wqe;
+  assert(!set_inline_payload(big_wqe, too_big));
+  assert(!big_wqe.inline_data);
+
+  std::printf("    PASSED\n");
+}
+
 }  // namespace
 
 int main() {
@@ -972,6 +1023,7 @@ int main() {
   test_processor_reset();
   test_clear_recv_state();
   test_multi_packet_psn_mismatch();
+  test_inline_send();
 
   std::printf("All SEND/RECV tests PASSED!\n");
   return 0;
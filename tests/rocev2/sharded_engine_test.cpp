@@ -0,0 +1,263 @@
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "nic/rocev2/sharded_engine.h"
+#include "nic/simple_host_memory.h"
+#include "nic/trace.h"
+
+using namespace nic;
+using namespace nic::rocev2;
+
+static void WaitForTracyConnection();
+
+namespace {
+
+constexpr std::size_t kShards = 4;
+constexpr std::array<std::uint8_t, 4> kRequesterIp{10, 0, 0, 1};
+constexpr std::array<std::uint8_t, 4> kResponderIp{10, 0, 0, 2};
+
+/// One host: a sharded engine over its own memory, with a PD and one MR over all of it.
+struct ShardedHost {
+  std::unique_ptr<SimpleHostMemory> host_memory;
+  std::unique_ptr<ShardedRdmaEngine> engine;
+  std::uint32_t pd_handle{0};
+  std::uint32_t lkey{0};
+
+  ShardedHost() {
+    NIC_TRACE_SCOPED(__func__);
+    HostMemoryConfig mem_cfg{.size_bytes = 64 * 1024};
+    host_memory = std::make_unique<SimpleHostMemory>(mem_cfg);
+    engine = std::make_unique<ShardedRdmaEngine>(
+        ShardedRdmaEngineConfig{.num_shards = kShards}, *host_memory);
+
+    auto pd = engine->create_pd();
+    assert(pd.has_value());
+    pd_handle = *pd;
+    AccessFlags access{.local_read = true, .local_write = true, .remote_write = true};
+    auto mr = engine->register_mr(pd_handle, 0, 64 * 1024, access);
+    assert(mr.has_value());
+    lkey = *mr;
+  }
+
+  /// Create a CQ and a QP on the next shard.
+  [[nodiscard]] std::pair<std::uint32_t, std::uint32_t> create_qp() {
+    NIC_TRACE_SCOPED(__func__);
+    auto cq = engine->create_cq(64);
+    assert(cq.has_value());
+    RdmaQpConfig qp_config;
+    qp_config.pd_handle = pd_handle;
+    qp_config.send_cq_number = *cq;
+    qp_config.recv_cq_number = *cq;
+    auto qp = engine->create_qp(qp_config);
+    assert(qp.has_value());
+    return {*cq, *qp};
+  }
+
+  void connect(std::uint32_t qp, std::uint32_t dest_qp, std::array<std::uint8_t, 4> dest_ip) {
+    NIC_TRACE_SCOPED(__func__);
+    RdmaQpModifyParams params;
+    params.target_state = QpState::Init;
+    assert(engine->modify_qp(qp, params));
+    params.target_state = QpState::Rtr;
+    params.dest_qp_number = dest_qp;
+    params.dest_ip = dest_ip;
+    assert(engine->modify_qp(qp, params));
+    params = RdmaQpModifyParams{};
+    params.target_state = QpState::Rts;
+    assert(engine->modify_qp(qp, params));
+  }
+};
+
+// ============================================
+// Test: objects are spread across shards and routed by number
+// ============================================
+void test_shard_placement() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_shard_placement...\n");
+
+  ShardedHost host;
+  assert(host.engine->num_shards() == kShards);
+  assert(host.engine->stats().replicated_ops == 2);
+
+  std::array<std::uint32_t, kShards> cqs{};
+  std::array<std::uint32_t, kShards> qps{};
+  for (std::size_t shard_idx = 0; shard_idx < kShards; ++shard_idx) {
+    auto [cq, qp] = host.create_qp();
+    cqs[shard_idx] = cq;
+    qps[shard_idx] = qp;
+    assert(host.engine->shard_of(cq) == shard_idx);
+    assert(host.engine->shard_of(qp) == shard_idx);
+    assert(host.engine->shard_stats(shard_idx).qps_created == 1);
+  }
+  assert(!host.engine->shard_of(0).has_value());
+
+  // A QP cannot straddle shards
+  RdmaQpConfig qp_config;
+  qp_config.pd_handle = host.pd_handle;
+  qp_config.send_cq_number = cqs[0];
+  qp_config.recv_cq_number = cqs[1];
+  assert(!host.engine->create_qp(qp_config).has_value());
+  assert(host.engine->stats().errors == 1);
+
+  // Nothing may change one shard's MR replica: no ODP MRs and no memory-key WQEs
+  AccessFlags odp_access{.local_write = true, .on_demand = true};
+  assert(!host.engine->register_mr(host.pd_handle, 0, 4096, odp_access).has_value());
+  assert(host.engine->stats().errors == 2);
+  host.connect(qps[0], qps[1], kResponderIp);
+  std::array<SendWqe, 3> wqes{};
+  wqes[0].opcode = WqeOpcode::Send;
+  wqes[1].opcode = WqeOpcode::LocalInvalidate;
+  wqes[1].invalidate_rkey = host.lkey;
+  wqes[2].opcode = WqeOpcode::Send;
+  assert(host.engine->post_send_list(qps[0], wqes) == 1);
+  assert(host.engine->stats().errors == 3);
+  assert(!host.engine->post_send(qps[0], wqes[1]));
+  assert(host.engine->stats().errors == 4);
+  assert(host.engine->query_rkey(host.lkey).has_value());
+
+  // Replicated objects are valid on every shard
+  auto ah = host.engine->create_ah(host.pd_handle, RdmaAhAttr{});
+  assert(ah.has_value());
+  assert(host.engine->destroy_ah(*ah));
+  assert(host.engine->query_rkey(host.lkey).has_value());
+  assert(host.engine->deregister_mr(host.lkey));
+  assert(!host.engine->query_rkey(host.lkey).has_value());
+  assert(!host.engine->deregister_mr(host.lkey));
+
+  // Unroutable packets are counted, not processed
+  std::array<std::byte, 4> runt{};
+  assert(!host.engine->deliver_packet(runt, kRequesterIp, kResponderIp, 49152));
+  assert(host.engine->stats().unroutable_packets == 1);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: RC traffic on every shard, with responder workers and concurrent posters
+// ============================================
+void test_threaded_traffic() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_threaded_traffic...\n");
+
+  constexpr std::size_t kQpsPerShard = 2;
+  constexpr std::size_t kQps = kShards * kQpsPerShard;
+  constexpr std::size_t kMessagesPerQp = 16;
+  constexpr std::uint32_t kMessageBytes = 64;
+
+  ShardedHost requester;
+  ShardedHost responder;
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> req_qps;
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> resp_qps;
+  for (std::size_t qp_idx = 0; qp_idx < kQps; ++qp_idx) {
+    req_qps.push_back(requester.create_qp());
+    resp_qps.push_back(responder.create_qp());
+  }
+  for (std::size_t qp_idx = 0; qp_idx < kQps; ++qp_idx) {
+    requester.connect(req_qps[qp_idx].second, resp_qps[qp_idx].second, kResponderIp);
+    responder.connect(resp_qps[qp_idx].second, req_qps[qp_idx].second, kRequesterIp);
+  }
+
+  for (std::size_t qp_idx = 0; qp_idx < kQps; ++qp_idx) {
+    for (std::size_t msg_idx = 0; msg_idx < kMessagesPerQp; ++msg_idx) {
+      RecvWqe recv;
+      recv.wr_id = msg_idx;
+      recv.sgl.push_back(SglEntry{.address = 0x1000 + (qp_idx * 0x400), .length = kMessageBytes});
+      recv.total_length = kMessageBytes;
+      assert(responder.engine->post_recv(resp_qps[qp_idx].second, recv));
+    }
+  }
+
+  // One application thread per requester shard posts to that shard's QPs
+  std::vector<std::thread> posters;
+  for (std::size_t shard_idx = 0; shard_idx < kShards; ++shard_idx) {
+    posters.emplace_back([&, shard_idx] {
+      for (std::size_t qp_idx = shard_idx; qp_idx < kQps; qp_idx += kShards) {
+        for (std::size_t msg_idx = 0; msg_idx < kMessagesPerQp; ++msg_idx) {
+          SendWqe wqe;
+          wqe.wr_id = msg_idx;
+          wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = kMessageBytes});
+          wqe.total_length = kMessageBytes;
+          wqe.local_lkey = requester.lkey;
+          bool posted = requester.engine->post_send(req_qps[qp_idx].second, wqe);
+          assert(posted);
+          (void)posted;
+        }
+      }
+    });
+  }
+  for (auto& poster : posters) {
+    poster.join();
+  }
+
+  // Responder shards process their packets on their own threads
+  responder.engine->start();
+  assert(responder.engine->is_running());
+  std::vector<OutgoingPacket> requests = requester.engine->generate_outgoing_packets();
+  assert(requests.size() == kQps * kMessagesPerQp);
+  for (const auto& packet : requests) {
+    assert(responder.engine->deliver_packet(packet.data, kRequesterIp, kResponderIp, 49152));
+  }
+  responder.engine->drain();
+  responder.engine->stop();
+  assert(responder.engine->stats().packets_queued == requests.size());
+  assert(responder.engine->stats().errors == 0);
+
+  // ACKs go back inline on the caller's thread
+  for (const auto& packet : responder.engine->generate_outgoing_packets()) {
+    assert(requester.engine->deliver_packet(packet.data, kResponderIp, kRequesterIp, 49152));
+  }
+
+  std::array<RdmaCqe, 64> cqes{};
+  for (std::size_t qp_idx = 0; qp_idx < kQps; ++qp_idx) {
+    std::size_t recv_count = responder.engine->poll_cq(resp_qps[qp_idx].first, cqes);
+    assert(recv_count == kMessagesPerQp);
+    assert(cqes[0].qp_number == resp_qps[qp_idx].second);
+    assert(cqes[0].bytes_completed == kMessageBytes);
+    std::size_t send_count = requester.engine->poll_cq(req_qps[qp_idx].first, cqes);
+    assert(send_count == kMessagesPerQp);
+    assert(cqes[0].status == WqeStatus::Success);
+  }
+  for (std::size_t shard_idx = 0; shard_idx < kShards; ++shard_idx) {
+    assert(responder.engine->shard_stats(shard_idx).packets_received
+           == kQpsPerShard * kMessagesPerQp);
+  }
+
+  std::printf("    PASSED\n");
+}
+
+}  // namespace
+
+int main() {
+  NIC_TRACE_SCOPED(__func__);
+  WaitForTracyConnection();
+  std::printf("Running RoCEv2 sharded engine tests...\n");
+
+  test_shard_placement();
+  test_threaded_traffic();
+
+  std::printf("All RoCEv2 sharded engine tests PASSED!\n");
+  return 0;
+}
+
+static void WaitForTracyConnection() {
+#ifdef TRACY_ENABLE
+  const char* wait_env = std::getenv("NIC_WAIT_FOR_TRACY");
+  if (!wait_env || wait_env[0] == '\0' || wait_env[0] == '0') {
+    return;
+  }
+
+  const auto timeout = std::chrono::seconds(2);
+  const auto start = std::chrono::steady_clock::now();
+  while (!tracy::GetProfiler().IsConnected()) {
+    if (std::chrono::steady_clock::now() - start > timeout) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+#endif
+}
@@ -0,0 +1,337 @@
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "nic/dma_engine.h"
+#include "nic/rocev2/engine.h"
+#include "nic/simple_host_memory.h"
+#include "nic/trace.h"
+
+using namespace nic;
+using namespace nic::rocev2;
+
+static void WaitForTracyConnection();
+
+namespace {
+
+/// Two requester QPs connected to two responder QPs that share one SRQ.
+struct SrqSetup {
+  std::unique_ptr<SimpleHostMemory> host_memory;
+  std::unique_ptr<DMAEngine> dma_engine;
+  std::unique_ptr<RdmaEngine> engine;
+  std::uint32_t pd_handle{0};
+  std::uint32_t send_cq{0};
+  std::uint32_t recv_cq{0};
+  std::uint32_t srq{0};
+  std::uint32_t requesters[2]{};
+  std::uint32_t responders[2]{};
+  std::uint32_t mr_lkey{0};
+
+  explicit SrqSetup(std::size_t srq_depth = 16, std::size_t srq_limit = 0) {
+    NIC_TRACE_SCOPED(__func__);
+    HostMemoryConfig mem_cfg{.size_bytes = 64 * 1024};
+    host_memory = std::make_unique<SimpleHostMemory>(mem_cfg);
+    dma_engine = std::make_unique<DMAEngine>(*host_memory);
+
+    RdmaEngineConfig engine_config;
+    engine_config.mtu = 1024;
+    engine = std::make_unique<RdmaEngine>(engine_config, *dma_engine, *host_memory);
+
+    auto pd = engine->create_pd();
+    assert(pd.has_value());
+    pd_handle = *pd;
+
+    auto cq1 = engine->create_cq(256);
+    auto cq2 = engine->create_cq(256);
+    assert(cq1.has_value() && cq2.has_value());
+    send_cq = *cq1;
+    recv_cq = *cq2;
+
+    auto srq_opt = engine->create_srq(srq_depth, srq_limit);
+    assert(srq_opt.has_value());
+    srq = *srq_opt;
+
+    RdmaQpConfig qp_config;
+    qp_config.pd_handle = pd_handle;
+    qp_config.send_cq_number = send_cq;
+    qp_config.recv_cq_number = recv_cq;
+    for (auto& qp : requesters) {
+      auto qp_opt = engine->create_qp(qp_config);
+      assert(qp_opt.has_value());
+      qp = *qp_opt;
+    }
+
+    qp_config.srq_number = srq;
+    for (auto& qp : responders) {
+      auto qp_opt = engine->create_qp(qp_config);
+      assert(qp_opt.has_value());
+      qp = *qp_opt;
+    }
+
+    AccessFlags access{
+        .local_read = true, .local_write = true, .remote_read = true, .remote_write = true};
+    auto lkey = engine->register_mr(pd_handle, 0x1000, 32 * 1024, access);
+    assert(lkey.has_value());
+    mr_lkey = *lkey;
+
+    for (std::size_t pair_idx = 0; pair_idx < 2; ++pair_idx) {
+      connect(requesters[pair_idx], responders[pair_idx]);
+      connect(responders[pair_idx], requesters[pair_idx]);
+    }
+  }
+
+  /// Transition a QP through Reset -> Init -> RTR -> RTS towards a peer.
+  void connect(std::uint32_t qp_number, std::uint32_t dest_qp_number) {
+    NIC_TRACE_SCOPED(__func__);
+    RdmaQpModifyParams params;
+    params.target_state = QpState::Init;
+    assert(engine->modify_qp(qp_number, params));
+
+    params.target_state = QpState::Rtr;
+    params.dest_qp_number = dest_qp_number;
+    params.rq_psn = 0;
+    params.dest_ip = std::array<std::uint8_t, 4>{192, 168, 1, 1};
+    assert(engine->modify_qp(qp_number, params));
+
+    params = RdmaQpModifyParams{};
+    params.target_state = QpState::Rts;
+    params.sq_psn = 0;
+    assert(engine->modify_qp(qp_number, params));
+  }
+
+  /// Post a receive buffer to the shared queue.
+  void post_srq_recv(std::uint64_t wr_id, HostAddress address) {
+    NIC_TRACE_SCOPED(__func__);
+    RecvWqe recv_wqe;
+    recv_wqe.wr_id = wr_id;
+    recv_wqe.sgl.push_back(SglEntry{.address = address, .length = 256});
+    assert(engine->post_srq_recv(srq, recv_wqe));
+  }
+
+  /// Post a 64-byte SEND on one of the requesters.
+  void send(std::size_t pair_idx, std::uint64_t wr_id) {
+    NIC_TRACE_SCOPED(__func__);
+    SendWqe send_wqe;
+    send_wqe.wr_id = wr_id;
+    send_wqe.opcode = WqeOpcode::Send;
+    send_wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 64});
+    send_wqe.total_length = 64;
+    send_wqe.local_lkey = mr_lkey;
+    assert(engine->post_send(requesters[pair_idx], send_wqe));
+  }
+
+  /// Loop all pending packets back into the engine.
+  void transfer_packets() {
+    NIC_TRACE_SCOPED(__func__);
+    auto packets = engine->generate_outgoing_packets();
+    for (auto& pkt : packets) {
+      std::array<std::uint8_t, 4> src_ip = {192, 168, 1, 1};
+      engine->process_incoming_packet(pkt.data, src_ip, pkt.dest_ip, pkt.src_port);
+    }
+  }
+};
+
+// ============================================
+// Test: SRQ creation, validation, and destroy
+// ============================================
+void test_srq_create_destroy() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_srq_create_destroy...\n");
+
+  SrqSetup setup;
+  assert(setup.engine->stats().srqs_created == 1);
+
+  const RdmaSharedReceiveQueue* srq = setup.engine->query_srq(setup.srq);
+  assert(srq != nullptr);
+  assert(srq->depth() == 16);
+  assert(srq->count() == 0);
+  assert(!srq->is_armed());
+
+  // Zero depth and limit above depth are rejected.
+  assert(!setup.engine->create_srq(0, 0).has_value());
+  assert(!setup.engine->create_srq(4, 8).has_value());
+
+  // QP attached to an unknown SRQ is rejected.
+  RdmaQpConfig qp_config;
+  qp_config.pd_handle = setup.pd_handle;
+  qp_config.send_cq_number = setup.send_cq;
+  qp_config.recv_cq_number = setup.recv_cq;
+  qp_config.srq_number = 777;
+  assert(!setup.engine->create_qp(qp_config).has_value());
+
+  // SRQ cannot be destroyed while QPs are attached.
+  assert(!setup.engine->destroy_srq(setup.srq));
+  assert(setup.engine->destroy_qp(setup.responders[0]));
+  assert(setup.engine->destroy_qp(setup.responders[1]));
+  assert(setup.engine->destroy_srq(setup.srq));
+  assert(setup.engine->query_srq(setup.srq) == nullptr);
+  assert(!setup.engine->destroy_srq(setup.srq));
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: SRQ-attached QPs reject private receives
+// ============================================
+void test_srq_qp_rejects_private_recv() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_srq_qp_rejects_private_recv...\n");
+
+  SrqSetup setup;
+
+  RecvWqe recv_wqe;
+  recv_wqe.wr_id = 1;
+  recv_wqe.sgl.push_back(SglEntry{.address = 0x4000, .length = 256});
+  assert(!setup.engine->post_recv(setup.responders[0], recv_wqe));
+  assert(setup.engine->post_recv(setup.requesters[0], recv_wqe));
+
+  // Unknown SRQ
+  assert(!setup.engine->post_srq_recv(999, recv_wqe));
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: Two QPs draw receive WQEs from one SRQ
+// ============================================
+void test_srq_shared_between_qps() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_srq_shared_between_qps...\n");
+
+  SrqSetup setup;
+  setup.post_srq_recv(100, 0x4000);
+  setup.post_srq_recv(101, 0x4100);
+  assert(setup.engine->query_srq(setup.srq)->count() == 2);
+
+  setup.send(0, 1);
+  setup.send(1, 2);
+  setup.transfer_packets();
+  setup.transfer_packets();
+
+  // WQEs are consumed in posting order, regardless of QP.
+  auto recv_cqes = setup.engine->poll_cq(setup.recv_cq, 10);
+  assert(recv_cqes.size() == 2);
+  assert(recv_cqes[0].wr_id == 100);
+  assert(recv_cqes[0].qp_number == setup.responders[0]);
+  assert(recv_cqes[1].wr_id == 101);
+  assert(recv_cqes[1].qp_number == setup.responders[1]);
+  assert(setup.engine->query_srq(setup.srq)->count() == 0);
+
+  // A third send finds the pool empty.
+  setup.send(0, 3);
+  setup.transfer_packets();
+  assert(setup.engine->query_srq(setup.srq)->stats().empty_consumes == 1);
+  assert(setup.engine->poll_cq(setup.recv_cq, 10).empty());
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: Limit-reached async event fires once and re-arms
+// ============================================
+void test_srq_limit_event() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_srq_limit_event...\n");
+
+  SrqSetup setup(8, 2);
+  for (std::uint64_t wr_id = 0; wr_id < 4; ++wr_id) {
+    setup.post_srq_recv(wr_id, 0x4000 + (wr_id * 0x100));
+  }
+  assert(setup.engine->query_srq(setup.srq)->is_armed());
+
+  // 4 -> 3 -> 2: still at the watermark, no event.
+  setup.send(0, 10);
+  setup.send(1, 11);
+  setup.transfer_packets();
+  assert(setup.engine->poll_async_events(10).empty());
+
+  // 2 -> 1: below the watermark.
+  setup.send(0, 12);
+  setup.transfer_packets();
+  auto events = setup.engine->poll_async_events(10);
+  assert(events.size() == 1);
+  assert(events[0].type == AsyncEventType::SrqLimitReached);
+  assert(events[0].srq_number == setup.srq);
+  assert(events[0].qp_number == setup.responders[0]);
+  assert(!setup.engine->query_srq(setup.srq)->is_armed());
+
+  // Disarmed: draining the last WQE does not fire again.
+  setup.send(1, 13);
+  setup.transfer_packets();
+  assert(setup.engine->poll_async_events(10).empty());
+
+  // Refill and re-arm, then cross the watermark again.
+  assert(!setup.engine->arm_srq(setup.srq, 9));
+  for (std::uint64_t wr_id = 20; wr_id < 23; ++wr_id) {
+    setup.post_srq_recv(wr_id, 0x4000 + ((wr_id - 20) * 0x100));
+  }
+  assert(setup.engine->arm_srq(setup.srq, 3));
+  setup.send(0, 14);
+  setup.transfer_packets();
+  events = setup.engine->poll_async_events(10);
+  assert(events.size() == 1);
+  assert(setup.engine->stats().async_events == 2);
+  assert(setup.engine->query_srq(setup.srq)->stats().limit_events == 2);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: reset() clears SRQs and pending events
+// ============================================
+void test_srq_engine_reset() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_srq_engine_reset...\n");
+
+  SrqSetup setup(4, 4);
+  setup.post_srq_recv(1, 0x4000);
+  setup.send(0, 1);
+  setup.transfer_packets();
+
+  setup.engine->reset();
+  assert(setup.engine->query_srq(setup.srq) == nullptr);
+  assert(setup.engine->poll_async_events(10).empty());
+
+  // Numbering restarts after reset.
+  auto srq = setup.engine->create_srq(4, 0);
+  assert(srq.has_value() && (*srq == 1));
+
+  std::printf("    PASSED\n");
+}
+
+}  // namespace
+
+int main() {
+  NIC_TRACE_SCOPED(__func__);
+  WaitForTracyConnection();
+  std::printf("Running RoCEv2 SRQ tests...\n");
+
+  test_srq_create_destroy();
+  test_srq_qp_rejects_private_recv();
+  test_srq_shared_between_qps();
+  test_srq_limit_event();
+  test_srq_engine_reset();
+
+  std::printf("All RoCEv2 SRQ tests PASSED!\n");
+  return 0;
+}
+
+static void WaitForTracyConnection() {
+#ifdef TRACY_ENABLE
+  const char* wait_env = std::getenv("NIC_WAIT_FOR_TRACY");
+  if (!wait_env || wait_env[0] == '\0' || wait_env[0] == '0') {
+    return;
+  }
+
+  const auto timeout = std::chrono::seconds(2);
+  const auto start = std::chrono::steady_clock::now();
+  while (!tracy::GetProfiler().IsConnected()) {
+    if (std::chrono::steady_clock::now() - start > timeout) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+#endif
+}
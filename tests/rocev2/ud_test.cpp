@@ -0,0 +1,347 @@
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "nic/dma_engine.h"
+#include "nic/rocev2/engine.h"
+#include "nic/simple_host_memory.h"
+#include "nic/trace.h"
+
+using namespace nic;
+using namespace nic::rocev2;
+
+static void WaitForTracyConnection();
+
+namespace {
+
+constexpr std::uint32_t kQkeyA = 0x11110000;
+constexpr std::uint32_t kQkeyB = 0x22220000;
+constexpr std::array<std::uint8_t, 4> kIpA = {10, 0, 0, 1};
+constexpr std::array<std::uint8_t, 4> kIpB = {10, 0, 0, 2};
+
+/// Two UD QPs on one engine; packets are looped back by hand.
+struct UdSetup {
+  std::unique_ptr<SimpleHostMemory> host_memory;
+  std::unique_ptr<DMAEngine> dma_engine;
+  std::unique_ptr<RdmaEngine> engine;
+  std::uint32_t pd_handle{0};
+  std::uint32_t send_cq{0};
+  std::uint32_t recv_cq{0};
+  std::uint32_t qp_a{0};
+  std::uint32_t qp_b{0};
+  std::uint32_t ah_to_b{0};
+  std::uint32_t mr_lkey{0};
+
+  UdSetup() {
+    NIC_TRACE_SCOPED(__func__);
+    HostMemoryConfig mem_cfg{.size_bytes = 64 * 1024};
+    host_memory = std::make_unique<SimpleHostMemory>(mem_cfg);
+    dma_engine = std::make_unique<DMAEngine>(*host_memory);
+
+    RdmaEngineConfig engine_config;
+    engine_config.mtu = 1024;
+    engine = std::make_unique<RdmaEngine>(engine_config, *dma_engine, *host_memory);
+
+    auto pd = engine->create_pd();
+    assert(pd.has_value());
+    pd_handle = *pd;
+
+    auto cq1 = engine->create_cq(256);
+    auto cq2 = engine->create_cq(256);
+    assert(cq1.has_value() && cq2.has_value());
+    send_cq = *cq1;
+    recv_cq = *cq2;
+
+    qp_a = create_ud_qp(kQkeyA);
+    qp_b = create_ud_qp(kQkeyB);
+
+    AccessFlags access{.local_read = true, .local_write = true};
+    auto lkey = engine->register_mr(pd_handle, 0x1000, 32 * 1024, access);
+    assert(lkey.has_value());
+    mr_lkey = *lkey;
+
+    auto ah = engine->create_ah(pd_handle, RdmaAhAttr{.dest_ip = kIpB});
+    assert(ah.has_value());
+    ah_to_b = *ah;
+
+    // Seed the send buffer
+    std::vector<std::byte> data(256);
+    for (std::size_t idx = 0; idx < data.size(); ++idx) {
+      data[idx] = static_cast<std::byte>(idx);
+    }
+    [[maybe_unused]] auto write_result = host_memory->write(0x1000, data);
+    assert(write_result.ok());
+  }
+
+  /// Create a UD QP and move it to RTS. UD needs no remote QP or PSN exchange.
+  [[nodiscard]] std::uint32_t create_ud_qp(std::uint32_t qkey) {
+    NIC_TRACE_SCOPED(__func__);
+    RdmaQpConfig qp_config;
+    qp_config.type = QpType::Ud;
+    qp_config.pd_handle = pd_handle;
+    qp_config.send_cq_number = send_cq;
+    qp_config.recv_cq_number = recv_cq;
+    auto qp = engine->create_qp(qp_config);
+    assert(qp.has_value());
+
+    RdmaQpModifyParams params;
+    params.target_state = QpState::Init;
+    params.qkey = qkey;
+    assert(engine->modify_qp(*qp, params));
+
+    params = RdmaQpModifyParams{};
+    params.target_state = QpState::Rtr;
+    assert(engine->modify_qp(*qp, params));
+    params.target_state = QpState::Rts;
+    assert(engine->modify_qp(*qp, params));
+    return *qp;
+  }
+
+  /// Build a UD send WQE from QP A to QP B.
+  [[nodiscard]] SendWqe make_send(std::uint64_t wr_id, std::uint32_t length) const {
+    SendWqe wqe;
+    wqe.wr_id = wr_id;
+    wqe.opcode = WqeOpcode::Send;
+    wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = length});
+    wqe.total_length = length;
+    wqe.local_lkey = mr_lkey;
+    wqe.ah_handle = ah_to_b;
+    wqe.remote_qpn = qp_b;
+    wqe.remote_qkey = kQkeyB;
+    return wqe;
+  }
+
+  /// Post a receive buffer on QP B.
+  void post_recv_b(std::uint64_t wr_id, HostAddress address, std::uint32_t length) {
+    NIC_TRACE_SCOPED(__func__);
+    RecvWqe wqe;
+    wqe.wr_id = wr_id;
+    wqe.sgl.push_back(SglEntry{.address = address, .length = length});
+    assert(engine->post_recv(qp_b, wqe));
+  }
+
+  /// Deliver all pending packets as if they arrived from kIpA.
+  std::size_t transfer_packets() {
+    NIC_TRACE_SCOPED(__func__);
+    auto packets = engine->generate_outgoing_packets();
+    for (auto& pkt : packets) {
+      engine->process_incoming_packet(pkt.data, kIpA, pkt.dest_ip, pkt.src_port);
+    }
+    return packets.size();
+  }
+};
+
+// ============================================
+// Test: UD SEND delivers GRH + payload with source QP
+// ============================================
+void test_ud_send_recv_with_grh() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_ud_send_recv_with_grh...\n");
+
+  UdSetup setup;
+  setup.post_recv_b(500, 0x4000, 1024);
+  assert(setup.engine->post_send(setup.qp_a, setup.make_send(7, 64)));
+
+  // Send completes at post time; nothing waits for an ACK.
+  auto send_cqes = setup.engine->poll_cq(setup.send_cq, 10);
+  assert(send_cqes.size() == 1);
+  assert(send_cqes[0].wr_id == 7);
+  assert(send_cqes[0].status == WqeStatus::Success);
+  assert(setup.engine->query_qp(setup.qp_a)->pending_count() == 0);
+
+  // Packet is addressed by the AH, not by QP connection state.
+  auto packets = setup.engine->generate_outgoing_packets();
+  assert(packets.size() == 1);
+  assert(packets[0].dest_ip == kIpB);
+  setup.engine->process_incoming_packet(packets[0].data, kIpA, kIpB, packets[0].src_port);
+
+  // Receiver never ACKs.
+  assert(setup.engine->generate_outgoing_packets().empty());
+
+  auto recv_cqes = setup.engine->poll_cq(setup.recv_cq, 10);
+  assert(recv_cqes.size() == 1);
+  assert(recv_cqes[0].wr_id == 500);
+  assert(recv_cqes[0].status == WqeStatus::Success);
+  assert(recv_cqes[0].qp_number == setup.qp_b);
+  assert(recv_cqes[0].src_qp == setup.qp_a);
+  assert(recv_cqes[0].has_grh);
+  assert(recv_cqes[0].bytes_completed == kGrhSize + 64);
+
+  // GRH: IPv6 version, BTH next header, IPv4-mapped SGID/DGID.
+  std::array<std::byte, kGrhSize + 64> buffer{};
+  [[maybe_unused]] auto read_result = setup.host_memory->read(0x4000, buffer);
+  assert(read_result.ok());
+  assert((static_cast<std::uint8_t>(buffer[0]) >> 4) == 6);
+  assert(buffer[6] == std::byte{0x1B});
+  assert(buffer[18] == std::byte{0xFF} && buffer[19] == std::byte{0xFF});
+  assert(buffer[20] == std::byte{10} && buffer[23] == std::byte{1});
+  assert(buffer[34] == std::byte{0xFF} && buffer[39] == std::byte{2});
+  for (std::size_t idx = 0; idx < 64; ++idx) {
+    assert(buffer[kGrhSize + idx] == static_cast<std::byte>(idx));
+  }
+
+  // No reliability state: timeouts never fire for UD.
+  setup.engine->advance_time(10'000'000);
+  assert(setup.engine->reliability_manager().stats().timeouts == 0);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: Q_Key mismatch and missing buffers are silent drops
+// ============================================
+void test_ud_silent_drops() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_ud_silent_drops...\n");
+
+  UdSetup setup;
+
+  // No recv WQE: dropped without an RNR NAK.
+  assert(setup.engine->post_send(setup.qp_a, setup.make_send(1, 32)));
+  assert(setup.transfer_packets() == 1);
+  assert(setup.engine->generate_outgoing_packets().empty());
+  assert(setup.engine->send_recv_processor().stats().ud_drops == 1);
+
+  // Wrong Q_Key: dropped, recv WQE stays posted.
+  setup.post_recv_b(2, 0x4000, 1024);
+  SendWqe wqe = setup.make_send(3, 32);
+  wqe.remote_qkey = 0x0BAD0BAD;
+  assert(setup.engine->post_send(setup.qp_a, wqe));
+  setup.transfer_packets();
+  assert(setup.engine->send_recv_processor().stats().qkey_violations == 1);
+  assert(setup.engine->query_qp(setup.qp_b)->recv_queue_size() == 1);
+  assert(setup.engine->poll_cq(setup.recv_cq, 10).empty());
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: Q_Key MSB selects the sending QP's own Q_Key
+// ============================================
+void test_ud_qkey_from_qp() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_ud_qkey_from_qp...\n");
+
+  UdSetup setup;
+  RdmaQpModifyParams params;
+  params.qkey = kQkeyB;
+  assert(setup.engine->modify_qp(setup.qp_a, params));
+
+  setup.post_recv_b(9, 0x4000, 1024);
+  SendWqe wqe = setup.make_send(10, 16);
+  wqe.remote_qkey = kQkeyUseQpMask;
+  assert(setup.engine->post_send(setup.qp_a, wqe));
+  setup.transfer_packets();
+
+  auto recv_cqes = setup.engine->poll_cq(setup.recv_cq, 10);
+  assert(recv_cqes.size() == 1);
+  assert(recv_cqes[0].status == WqeStatus::Success);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: Receive buffer must fit GRH + payload
+// ============================================
+void test_ud_recv_buffer_too_small() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_ud_recv_buffer_too_small...\n");
+
+  UdSetup setup;
+  setup.post_recv_b(11, 0x4000, 64);  // Payload fits, GRH + payload does not
+  assert(setup.engine->post_send(setup.qp_a, setup.make_send(12, 64)));
+  setup.transfer_packets();
+
+  auto recv_cqes = setup.engine->poll_cq(setup.recv_cq, 10);
+  assert(recv_cqes.size() == 1);
+  assert(recv_cqes[0].wr_id == 11);
+  assert(recv_cqes[0].status == WqeStatus::LocalLengthError);
+
+  std::printf("    PASSED\n");
+}
+
+// ============================================
+// Test: Invalid UD work requests and transport mismatches
+// ============================================
+void test_ud_invalid_requests() {
+  NIC_TRACE_SCOPED(__func__);
+  std::printf("  test_ud_invalid_requests...\n");
+
+  UdSetup setup;
+
+  // Larger than one MTU
+  SendWqe wqe = setup.make_send(1, 2048);
+  assert(!setup.engine->post_send(setup.qp_a, wqe));
+
+  // RDMA operations are RC-only
+  wqe = setup.make_send(2, 16);
+  wqe.opcode = WqeOpcode::RdmaWrite;
+  assert(!setup.engine->post_send(setup.qp_a, wqe));
+
+  // Unknown AH
+  wqe = setup.make_send(3, 16);
+  wqe.ah_handle = 999;
+  assert(!setup.engine->post_send(setup.qp_a, wqe));
+
+  // AH from a different PD
+  auto other_pd = setup.engine->create_pd();
+  assert(other_pd.has_value());
+  auto other_ah = setup.engine->create_ah(*other_pd, RdmaAhAttr{.dest_ip = kIpB});
+  assert(other_ah.has_value());
+  wqe.ah_handle = *other_ah;
+  assert(!setup.engine->post_send(setup.qp_a, wqe));
+  assert(setup.engine->destroy_ah(*other_ah));
+  assert(!setup.engine->destroy_ah(*other_ah));
+
+  // AH on an invalid PD
+  assert(!setup.engine->create_ah(777, RdmaAhAttr{}).has_value());
+
+  // RC opcode aimed at a UD QP is rejected
+  RdmaPacketBuilder builder;
+  auto rc_packet = builder.set_opcode(RdmaOpcode::kRcSendOnly)
+                       .set_dest_qp(setup.qp_b)
+                       .set_psn(0)
+                       .build();
+  assert(!setup.engine->process_incoming_packet(rc_packet, kIpA, kIpB, 0));
+
+  assert(setup.engine->generate_outgoing_packets().empty());
+
+  std::printf("    PASSED\n");
+}
+
+}  // namespace
+
+int main() {
+  NIC_TRACE_SCOPED(__func__);
+  WaitForTracyConnection();
+  std::printf("Running RoCEv2 UD tests...\n");
+
+  test_ud_send_recv_with_grh();
+  test_ud_silent_drops();
+  test_ud_qkey_from_qp();
+  test_ud_recv_buffer_too_small();
+  test_ud_invalid_requests();
+
+  std::printf("All RoCEv2 UD tests PASSED!\n");
+  return 0;
+}
+
+static void WaitForTracyConnection() {
+#ifdef TRACY_ENABLE
+  const char* wait_env = std::getenv("NIC_WAIT_FOR_TRACY");
+  if (!wait_env || wait_env[0] == '\0' || wait_env[0] == '0') {
+    return;
+  }
+
+  const auto timeout = std::chrono::seconds(2);
+  const auto start = std::chrono::steady_clock::now();
+  while (!tracy::GetProfiler().IsConnected()) {
+    if (std::chrono::steady_clock::now() - start > timeout) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+#endif
+}
@@ -121,7 +121,7 @@ void test_single_packet_write() {
   assert(result.is_message_complete);
   assert(result.needs_ack);
   assert(result.syndrome == AethSyndrome::Ack);
-  assert(!result.recv_cqe.has_value());  // No CQE for plain WRITE
+  assert(result.recv_cqes.empty());  // No CQE for plain WRITE
 
   // Verify data was written to remote buffer
   std::vector<std::byte> recv_data(256);
@@ -295,11 +295,11 @@ void test_write_with_immediate() {
   [[maybe_unused]] WriteResult result = processor.process_write_packet(receiver_qp, parser);
   assert(result.success);
   assert(result.is_message_complete);
-  assert(result.recv_cqe.has_value());
-  assert(result.recv_cqe->has_immediate);
-  assert(result.recv_cqe->immediate_data == 0xCAFEBABE);
-  assert(result.recv_cqe->wr_id == 2003);
-  assert(result.recv_cqe->opcode == WqeOpcode::RdmaWriteImm);
+  assert(result.recv_cqes.size() == 1);
+  assert(result.recv_cqes[0].has_immediate);
+  assert(result.recv_cqes[0].immediate_data == 0xCAFEBABE);
+  assert(result.recv_cqes[0].wr_id == 2003);
+  assert(result.recv_cqes[0].opcode == WqeOpcode::RdmaWriteImm);
 
   // Verify data was written
   std::vector<std::byte> recv_data(128);
@@ -982,6 +982,192 @@ void test_psn_sequence_error() {
   std::printf("    PASSED\n");
 }
 
+// Test inline RDMA WRITE: payload carried in the WQE, no local MR needed
+void test_inline_write() {
+  std::printf("  test_inline_write...\n");
+
+  HostMemoryConfig mem_cfg{.size_bytes = kTestMemorySize};
+  SimpleHostMemory host_memory{mem_cfg};
+  MemoryRegionTable mr_table;
+
+  RdmaQpConfig config;
+  config.pd_handle = 1;
+  RdmaQueuePair sender_qp{kSenderQpNum, config};
+  RdmaQueuePair receiver_qp{kReceiverQpNum, config};
+  setup_qp_for_rdma(sender_qp, kReceiverQpNum);
+  setup_qp_for_rdma(receiver_qp, kSenderQpNum);
+
+  // Only the remote side needs an MR
+  AccessFlags remote_access{.local_read = true, .local_write = true, .remote_write = true};
+  auto remote_lkey = mr_table.register_mr(1, 0x2000, 4096, remote_access);
+  assert(remote_lkey.has_value());
+  const MemoryRegion* remote_mr = mr_table.get_by_lkey(remote_lkey.value());
+  assert(remote_mr != nullptr);
+
+  std::vector<std::byte> test_data = make_test_pattern(64);
+  SendWqe write_wqe;
+  write_wqe.wr_id = 88;
+  write_wqe.opcode = WqeOpcode::RdmaWrite;
+  write_wqe.remote_address = 0x2000;
+  write_wqe.rkey = remote_mr->rkey;
+  write_wqe.signaled = false;
+  assert(set_inline_payload(write_wqe, test_data));
+
+  WriteProcessor processor{host_memory, mr_table};
+  auto packets = processor.generate_write_packets(sender_qp, write_wqe);
+  assert(packets.size() == 1);
+  assert(processor.stats().inline_writes == 1);
+  assert(sender_qp.pending_count() == 1);  // Unsignaled inline: still resent until ACKed
+
+  RdmaPacketParser parser;
+  assert(parser.parse(packets[0]));
+  [[maybe_unused]] WriteResult result = processor.process_write_packet(receiver_qp, parser);
+  assert(result.success);
+
+  std::vector<std::byte> recv_data(64);
+  (void) host_memory.read(0x2000, recv_data);
+  assert(recv_data == test_data);
+
+  std::printf("    PASSED\n");
+}
+
+// Test WRITE packets placed out of order within the reorder window
+void test_out_of_order_placement() {
+  std::printf("  test_out_of_order_placement...\n");
+
+  HostMemoryConfig mem_cfg{.size_bytes = kTestMemorySize};
+  SimpleHostMemory host_memory{mem_cfg};
+  MemoryRegionTable mr_table;
+
+  RdmaQpConfig config;
+  config.pd_handle = 1;
+  RdmaQueuePair sender_qp{kSenderQpNum, config};
+  RdmaQueuePair receiver_qp{kReceiverQpNum, config};
+  setup_qp_for_rdma(sender_qp, kReceiverQpNum);
+  setup_qp_for_rdma(receiver_qp, kSenderQpNum);
+  RdmaQpModifyParams mtu_params;
+  mtu_params.path_mtu = 1;  // 256 bytes
+  assert(sender_qp.modify(mtu_params));
+  assert(receiver_qp.modify(mtu_params));
+
+  AccessFlags local_access{.local_read = true, .local_write = true};
+  auto local_lkey = mr_table.register_mr(1, 0x1000, 8192, local_access);
+  AccessFlags remote_access{.local_read = true, .local_write = true, .remote_write = true};
+  auto remote_lkey = mr_table.register_mr(1, 0x4000, 8192, remote_access);
+  assert(local_lkey.has_value() && remote_lkey.has_value());
+  std::uint32_t rkey = mr_table.get_by_lkey(remote_lkey.value())->rkey;
+
+  std::vector<std::byte> test_data = make_test_pattern(900);
+  (void) host_memory.write(0x1000, test_data);
+
+  SendWqe write_wqe;
+  write_wqe.wr_id = 1010;
+  write_wqe.opcode = WqeOpcode::RdmaWriteImm;
+  write_wqe.sgl.push_back(SglEntry{.address = 0x1000, .length = 900});
+  write_wqe.total_length = 900;
+  write_wqe.local_lkey = local_lkey.value();
+  write_wqe.remote_address = 0x4000;
+  write_wqe.rkey = rkey;
+  write_wqe.immediate_data = 0x1234;
+
+  RecvWqe recv_wqe;
+  recv_wqe.wr_id = 2010;
+  assert(receiver_qp.post_recv(recv_wqe));
+
+  WriteProcessor processor{host_memory, mr_table, 16};
+  auto packets = processor.generate_write_packets(sender_qp, write_wqe);
+  assert(packets.size() == 4);  // PSNs 0-3
+
+  auto deliver = [&](std::size_t index) {
+    RdmaPacketParser parser;
+    assert(parser.parse(packets[index]));
+    return processor.process_write_packet(receiver_qp, parser);
+  };
+
+  // Middle and last packets ahead of the first wait for its RETH
+  WriteResult result = deliver(2);
+  assert(result.success && !result.needs_ack);
+  result = deliver(3);
+  assert(result.success && !result.needs_ack);
+  assert(processor.stats().staged_packets == 2);
+  assert(receiver_qp.expected_recv_psn() == 0);
+
+  // The first packet places itself and the staged packets; only PSN 0 retires
+  result = deliver(0);
+  assert(result.success && !result.is_message_complete);
+  assert(receiver_qp.expected_recv_psn() == 1);
+
+  // Filling the hole retires the rest and completes the message
+  result = deliver(1);
+  assert(result.success && result.is_message_complete);
+  assert(result.needs_ack && (result.ack_psn == 3));
+  assert(receiver_qp.expected_recv_psn() == 4);
+  assert(result.recv_cqes.size() == 1);
+  assert(result.recv_cqes[0].wr_id == 2010);
+  assert(result.recv_cqes[0].immediate_data == 0x1234);
+  assert(result.recv_cqes[0].bytes_completed == 900);
+  assert(processor.stats().out_of_order_packets == 2);
+  assert(processor.stats().writes_completed == 1);
+
+  std::vector<std::byte> recv_data(900);
+  (void) host_memory.read(0x4000, recv_data);
+  assert(recv_data == test_data);
+
+  // A retransmitted packet is re-ACKed; a PSN past the window is still a sequence error
+  result = deliver(2);
+  assert(result.success && result.needs_ack && (result.ack_psn == 3));
+  assert(processor.stats().duplicate_packets == 1);
+
+  RdmaPacketBuilder builder;
+  builder.set_opcode(RdmaOpcode::kRcWriteMiddle).set_dest_qp(kReceiverQpNum).set_psn(40);
+  std::vector<std::byte> far_packet = builder.build();
+  RdmaPacketParser parser;
+  assert(parser.parse(far_packet));
+  result = processor.process_write_packet(receiver_qp, parser);
+  assert(!result.success && (result.syndrome == AethSyndrome::PsnSeqError));
+  assert(result.ack_psn == 4);
+
+  // A PSN consumed by another receive path lets placed packets behind it retire
+  write_wqe.opcode = WqeOpcode::RdmaWrite;
+  write_wqe.total_length = 256;
+  write_wqe.sgl = {SglEntry{.address = 0x1000, .length = 256}};
+  static_cast<void>(sender_qp.next_send_psn());  // PSN 4 goes to a SEND
+  packets = processor.generate_write_packets(sender_qp, write_wqe);
+  assert(packets.size() == 1);
+  result = deliver(0);  // PSN 5
+  assert(result.success && !result.needs_ack);
+  receiver_qp.advance_recv_psn();  // The SEND at PSN 4 arrives
+  result = processor.retire_placed_packets(receiver_qp);
+  assert(result.success && result.is_message_complete && (result.ack_psn == 5));
+  assert(receiver_qp.expected_recv_psn() == 6);
+
+  // A WRITE_IMM with no recv WQE keeps its last PSN un-retired; the resend completes it
+  write_wqe.opcode = WqeOpcode::RdmaWriteImm;
+  write_wqe.total_length = 300;
+  write_wqe.sgl = {SglEntry{.address = 0x1000, .length = 300}};
+  packets = processor.generate_write_packets(sender_qp, write_wqe);
+  assert(packets.size() == 2);  // PSNs 6-7
+  result = deliver(0);
+  assert(result.success);
+  result = deliver(1);
+  assert(!result.success && (result.syndrome == AethSyndrome::RnrNak));
+  assert(result.ack_psn == 7);
+  assert(receiver_qp.expected_recv_psn() == 7);
+
+  recv_wqe.wr_id = 2011;
+  assert(receiver_qp.post_recv(recv_wqe));
+  result = deliver(0);  // Resent first packet, already retired
+  assert(result.success && result.needs_ack && (result.ack_psn == 6));
+  result = deliver(1);
+  assert(result.success && result.is_message_complete && (result.ack_psn == 7));
+  assert(result.recv_cqes.size() == 1);
+  assert(result.recv_cqes[0].wr_id == 2011);
+  assert(result.recv_cqes[0].bytes_completed == 300);
+  assert(receiver_qp.expected_recv_psn() == 8);
+
+  std::printf("    PASSED\n");
+}
+
 }  // namespace
 
 int main() {
@@ -1004,6 +1190,8 @@ int main() {
   test_clear_write_state();
   test_multi_packet_psn_mismatch();
   test_psn_sequence_error();
+  test_inline_write();
+  test_out_of_order_placement();
 
   std::printf("All RDMA WRITE tests PASSED!\n");
   return 0;
@@ -182,6 +182,7 @@ void test_tx_rx_success() {
   assert(tx_comp->segments_produced == 1);
   assert(!rx_comp->vlan_stripped);
   assert(!rx_comp->checksum_verified);
+  assert(rx_comp->byte_count == payload.size());
   assert(qp.stats().tx_packets == 1);
   assert(qp.stats().rx_packets == 1);
 